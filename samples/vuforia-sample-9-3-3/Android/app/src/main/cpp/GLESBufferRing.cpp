@@ -0,0 +1,246 @@
+/*===============================================================================
+Copyright (c) 2020 PTC Inc. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "GLESBufferRing.h"
+
+#include "GLESCommandRecorder.h"
+
+#include <Log.h>
+
+#include <EGL/egl.h>
+
+#include <cstring>
+
+#include "GLESRecordedCalls.h"
+
+
+namespace
+{
+    /// How long to wait for the GPU to release a region before giving up on the frame's writes
+    constexpr GLuint64 FENCE_TIMEOUT_NS = 100000000;
+}
+
+
+bool GLESBufferRing::init(GLsizeiptr regionSize)
+{
+    deinit();
+
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &mAlignment);
+    if (mAlignment <= 0)
+    {
+        mAlignment = 256;
+    }
+    // Every region has to start on an aligned offset too
+    mRegionSize = (regionSize + mAlignment - 1) / mAlignment * mAlignment;
+
+    PFNGLBUFFERSTORAGEEXTPROC bufferStorage = nullptr;
+    const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    if (extensions != nullptr && std::strstr(extensions, "GL_EXT_buffer_storage") != nullptr)
+    {
+        if (GLESCommandRecorder::getActive() == nullptr)
+        {
+            bufferStorage = reinterpret_cast<PFNGLBUFFERSTORAGEEXTPROC>(eglGetProcAddress("glBufferStorageEXT"));
+        }
+    }
+    else
+    {
+        LOG("GL_EXT_buffer_storage isn't supported, the buffer ring is mapped every frame");
+    }
+
+    glGenBuffers(1, &mBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, mBuffer);
+    if (bufferStorage == nullptr || !mapPersistently(bufferStorage, mRegionSize * NUM_REGIONS))
+    {
+        glBufferData(GL_COPY_WRITE_BUFFER, mRegionSize * NUM_REGIONS, nullptr, GL_DYNAMIC_DRAW);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (glGetError() != GL_NO_ERROR)
+    {
+        LOG("Error: failed to create a %ld byte buffer ring", static_cast<long>(mRegionSize * NUM_REGIONS));
+        deinit();
+        return false;
+    }
+    return true;
+}
+
+
+void GLESBufferRing::deinit()
+{
+    if (mMapped != nullptr)
+    {
+        unmap();
+    }
+    for (GLsync& fence : mFences)
+    {
+        if (fence != nullptr)
+        {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    if (mBuffer != 0)
+    {
+        // Deleting the buffer unmaps it
+        glDeleteBuffers(1, &mBuffer);
+        mBuffer = 0;
+    }
+    mPersistentMapping = nullptr;
+    mRegion = 0;
+    mCursor = 0;
+}
+
+
+bool GLESBufferRing::beginFrame()
+{
+    if (mBuffer == 0)
+    {
+        return false;
+    }
+
+    mCursor = 0;
+
+    unsigned int region = (mRegion + 1) % NUM_REGIONS;
+    GLsync& fence = mFences[region];
+    if (fence != nullptr)
+    {
+        GLenum status = glClientWaitSync(fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED)
+        {
+            ++mNumWaits;
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+        }
+        if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED)
+        {
+            // The GPU may still read the region, writing over it would change the constants of
+            // draws in flight. Leave it fenced and unmapped so this frame's writes fail and its
+            // draws are dropped, the next frame tries the same region again.
+            LOG("Buffer ring region %u still in use after %llu ns, skipping this frame's writes", region,
+                static_cast<unsigned long long>(FENCE_TIMEOUT_NS));
+            return false;
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+    mRegion = region;
+
+    if (mPersistentMapping != nullptr)
+    {
+        mMapped = mPersistentMapping + mRegionSize * mRegion;
+        return true;
+    }
+
+    // Map through the copy target, which nothing draws from, to leave the other bindings alone
+    glBindBuffer(GL_COPY_WRITE_BUFFER, mBuffer);
+    mMapped = static_cast<unsigned char*>(
+        glMapBufferRange(GL_COPY_WRITE_BUFFER, mRegionSize * mRegion, mRegionSize,
+                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+                         GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_FLUSH_EXPLICIT_BIT));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (mMapped == nullptr)
+    {
+        LOG("Error: failed to map buffer ring region %u", mRegion);
+        return false;
+    }
+    return true;
+}
+
+
+void GLESBufferRing::unmap()
+{
+    if (mMapped == nullptr)
+    {
+        return;
+    }
+    if (mPersistentMapping != nullptr)
+    {
+        // Coherent writes are visible to the commands issued after them, only writing has to stop
+        mMapped = nullptr;
+        return;
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, mBuffer);
+    if (mCursor > 0)
+    {
+        glFlushMappedBufferRange(GL_COPY_WRITE_BUFFER, 0, mCursor);
+    }
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    mMapped = nullptr;
+}
+
+
+void GLESBufferRing::endFrame()
+{
+    unmap();
+
+    if (mBuffer != 0 && mCursor > 0)
+    {
+        mFences[mRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
+
+
+GLsizeiptr GLESBufferRing::getBytesFree() const
+{
+    if (mMapped == nullptr)
+    {
+        return 0;
+    }
+    GLsizeiptr start = (mCursor + mAlignment - 1) / mAlignment * mAlignment;
+    return start < mRegionSize ? mRegionSize - start : 0;
+}
+
+
+bool GLESBufferRing::write(const void* data, GLsizeiptr size, GLintptr& offset)
+{
+    if (mMapped == nullptr)
+    {
+        return false;
+    }
+
+    GLsizeiptr start = (mCursor + mAlignment - 1) / mAlignment * mAlignment;
+    if (start + size > mRegionSize)
+    {
+        LOG("Error: buffer ring region of %ld bytes is full", static_cast<long>(mRegionSize));
+        return false;
+    }
+
+    std::memcpy(mMapped + start, data, size);
+    mCursor = start + size;
+    offset = mRegionSize * mRegion + start;
+    return true;
+}
+
+
+bool GLESBufferRing::mapPersistently(PFNGLBUFFERSTORAGEEXTPROC bufferStorage, GLsizeiptr size)
+{
+    // Drain errors left by earlier calls, so that only bufferStorage's own can fail the mapping
+    for (GLenum error = glGetError(); error != GL_NO_ERROR; error = glGetError())
+    {
+        LOG("GL error 0x%x pending before creating the buffer ring", error);
+    }
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT_EXT | GL_MAP_COHERENT_BIT_EXT;
+    bufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+    if (glGetError() == GL_NO_ERROR)
+    {
+        mPersistentMapping = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+        if (mPersistentMapping != nullptr)
+        {
+            return true;
+        }
+    }
+
+    // Immutable storage can't be given again, so start over with a new buffer
+    LOG("Error: failed to map the buffer ring persistently, mapping it every frame instead");
+    glDeleteBuffers(1, &mBuffer);
+    glGenBuffers(1, &mBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, mBuffer);
+    return false;
+}
@@ -0,0 +1,92 @@
+/*===============================================================================
+Copyright (c) 2020 PTC Inc. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef _VUFORIA_GLESBUFFERRING_H_
+#define _VUFORIA_GLESBUFFERRING_H_
+
+#include <GLES3/gl31.h>
+#include <GLES2/gl2ext.h>
+
+#include <cstddef>
+
+
+/// Buffer for data streamed every frame, split into one region per frame in flight.
+/**
+ * Each frame maps its region with unsynchronized writes and appends uniform
+ * block or instance data to it, then unmaps it before the draws that read it
+ * are issued.
+ * A fence after those draws guards the region until it comes round again,
+ * NUM_REGIONS frames later, so writing never waits on the GPU unless it has
+ * fallen that far behind. A region is never written while its fence is pending.
+ *
+ * Where GL_EXT_buffer_storage is supported the buffer is instead mapped once,
+ * persistently and coherently, so that a frame writes to its region without
+ * any map, flush or unmap calls. Not while GL commands are being recorded, as
+ * the recorder only sees data written through glFlushMappedBufferRange.
+ */
+class GLESBufferRing
+{
+public:
+    /// Frames that can be in flight before writing waits on the GPU
+    static constexpr unsigned int NUM_REGIONS = 3;
+
+    /// Create the buffer, regionSize bytes per frame
+    bool init(GLsizeiptr regionSize);
+    /// Delete the buffer and any pending fences
+    void deinit();
+
+    /// Wait for the next region to be free and map it for writing. Returns false,
+    /// with nothing mapped so that the frame's writes fail, if the GPU doesn't release it in time.
+    bool beginFrame();
+    /// Unmap the region, call before issuing draws that read from it
+    void unmap();
+    /// Fence the region, call after issuing the draws that read from it
+    void endFrame();
+
+    /// Copy size bytes of data into the mapped region.
+    /// Returns false if the region is full or not mapped, otherwise
+    /// sets offset to where the data starts in the buffer.
+    bool write(const void* data, GLsizeiptr size, GLintptr& offset);
+
+    GLuint getBuffer() const { return mBuffer; }
+
+    /// Bytes written since beginFrame, including alignment padding
+    GLsizeiptr getBytesWritten() const { return mCursor; }
+
+    /// Largest write the mapped region still has room for
+    GLsizeiptr getBytesFree() const;
+
+    /// Distance between the offsets of consecutive writes of size bytes
+    GLsizeiptr getAlignedSize(GLsizeiptr size) const { return (size + mAlignment - 1) / mAlignment * mAlignment; }
+
+    /// Number of times beginFrame had to wait for the GPU since the ring was created
+    unsigned int getNumWaits() const { return mNumWaits; }
+
+private: // methods
+
+    /// Give the bound buffer immutable storage and map all of it for the ring's
+    /// lifetime. Returns false, leaving the buffer without storage, if it can't.
+    bool mapPersistently(PFNGLBUFFERSTORAGEEXTPROC bufferStorage, GLsizeiptr size);
+
+private: // data members
+    GLuint mBuffer = 0;
+    GLsizeiptr mRegionSize = 0;
+    /// Offsets handed out are multiples of GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT,
+    /// which also suits vertex attributes
+    GLint mAlignment = 0;
+
+    GLsync mFences[NUM_REGIONS] = {};
+    unsigned int mRegion = 0;
+    unsigned char* mMapped = nullptr;
+    /// The whole buffer, when it is persistently mapped
+    unsigned char* mPersistentMapping = nullptr;
+    GLsizeiptr mCursor = 0;
+
+    unsigned int mNumWaits = 0;
+};
+
+#endif //_VUFORIA_GLESBUFFERRING_H_
@@ -0,0 +1,288 @@
+/*===============================================================================
+Copyright (c) 2020 PTC Inc. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef _VUFORIA_GLESCOMMANDFORMAT_H_
+#define _VUFORIA_GLESCOMMANDFORMAT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+
+/// Encoding shared by GLESCommandRecorder and the desktop GLCommandReplayer.
+/**
+ * A recording starts with MAGIC followed by one command per recorded GL call,
+ * each an opcode byte then its arguments in the order given by its Layout:
+ * integers as zigzag varints, floats as 4 little endian bytes, and a data
+ * payload as a varint length followed by the bytes. A recording cut short is
+ * readable up to the last complete command.
+ *
+ * Integer arguments are the values the renderer passed, with pointers into
+ * buffers given as offsets. Object names are the ones the recording driver
+ * returned, and the Gen and Create commands give them so a replay can map them
+ * to its own. GLsync objects are numbered in creation order.
+ *
+ * Payloads hold what the driver would read from client memory: buffer and
+ * texture data, shader sources, and the bytes written to a mapped buffer range
+ * when it is flushed or unmapped. An empty payload stands for a null pointer.
+ */
+namespace GLESCommandFormat
+{
+    constexpr char MAGIC[] = { 'V', 'G', 'L', '1' };
+
+    /// The most integer and float arguments of any command
+    constexpr size_t MAX_INTS = 10;
+    constexpr size_t MAX_FLOATS = 4;
+
+    enum Opcode : uint8_t
+    {
+        // Markers written by the renderer rather than GL calls
+        OP_FRAME_BEGIN,
+        OP_FRAME_END,
+        OP_SURFACE_SIZE,
+
+        OP_ACTIVE_TEXTURE,
+        OP_ATTACH_SHADER,
+        OP_BIND_BUFFER,
+        OP_BIND_BUFFER_RANGE,
+        OP_BIND_TEXTURE,
+        OP_BIND_VERTEX_ARRAY,
+        OP_BIND_VERTEX_BUFFER,
+        OP_BLEND_FUNC,
+        OP_BUFFER_DATA,
+        OP_BUFFER_SUB_DATA,
+        OP_CLEAR,
+        OP_CLEAR_COLOR,
+        OP_CLIENT_WAIT_SYNC,
+        OP_COMPILE_SHADER,
+        OP_COMPRESSED_TEX_SUB_IMAGE_3D,
+        OP_CREATE_PROGRAM,
+        OP_CREATE_SHADER,
+        OP_CULL_FACE,
+        OP_DELETE_BUFFER,
+        OP_DELETE_PROGRAM,
+        OP_DELETE_SHADER,
+        OP_DELETE_SYNC,
+        OP_DELETE_TEXTURE,
+        OP_DELETE_VERTEX_ARRAY,
+        OP_DISABLE,
+        OP_DRAW_ARRAYS,
+        OP_DRAW_ELEMENTS,
+        OP_DRAW_ELEMENTS_INSTANCED,
+        OP_ENABLE,
+        OP_ENABLE_VERTEX_ATTRIB_ARRAY,
+        OP_FENCE_SYNC,
+        OP_FLUSH_MAPPED_BUFFER_RANGE,
+        OP_FRONT_FACE,
+        OP_GEN_BUFFER,
+        OP_GEN_TEXTURE,
+        OP_GEN_VERTEX_ARRAY,
+        OP_LINE_WIDTH,
+        OP_LINK_PROGRAM,
+        OP_MAP_BUFFER_RANGE,
+        OP_PIXEL_STOREI,
+        OP_PROGRAM_PARAMETERI,
+        OP_SCISSOR,
+        OP_SHADER_SOURCE,
+        OP_TEX_IMAGE_2D,
+        OP_TEX_PARAMETERI,
+        OP_TEX_STORAGE_3D,
+        OP_TEX_SUB_IMAGE_3D,
+        OP_UNIFORM_1I,
+        OP_UNMAP_BUFFER,
+        OP_USE_PROGRAM,
+        OP_VERTEX_ATTRIB_BINDING,
+        OP_VERTEX_ATTRIB_FORMAT,
+        OP_VERTEX_ATTRIB_POINTER,
+        OP_VERTEX_BINDING_DIVISOR,
+        OP_VIEWPORT,
+
+        // Added after the first recordings, after the rest so those stay readable
+        OP_BIND_FRAMEBUFFER,
+        OP_BLIT_FRAMEBUFFER,
+        OP_DELETE_FRAMEBUFFER,
+        OP_DRAW_ARRAYS_INSTANCED,
+        OP_FRAMEBUFFER_TEXTURE_LAYER,
+        OP_FRAMEBUFFER_TEXTURE_MULTIVIEW,
+        OP_GEN_FRAMEBUFFER,
+        OP_BLEND_FUNC_SEPARATE,
+        OP_CLEAR_BUFFERFV,
+        OP_FRAMEBUFFER_TEXTURE_2D,
+        OP_TEX_STORAGE_2D,
+        OP_UNIFORM_4F,
+
+        NUM_OPCODES
+    };
+
+    /// Arguments of a command
+    struct Layout
+    {
+        const char* name;
+        uint8_t numInts;
+        uint8_t numFloats;
+        bool hasData;
+    };
+
+    inline const Layout& getLayout(Opcode opcode)
+    {
+        static const Layout LAYOUTS[NUM_OPCODES] = {
+            { "FrameBegin", 0, 0, false },
+            { "FrameEnd", 0, 0, false },
+            // width, height
+            { "SurfaceSize", 2, 0, false },
+            { "glActiveTexture", 1, 0, false },
+            { "glAttachShader", 2, 0, false },
+            { "glBindBuffer", 2, 0, false },
+            { "glBindBufferRange", 5, 0, false },
+            { "glBindTexture", 2, 0, false },
+            { "glBindVertexArray", 1, 0, false },
+            { "glBindVertexBuffer", 4, 0, false },
+            { "glBlendFunc", 2, 0, false },
+            // target, size, usage, data
+            { "glBufferData", 3, 0, true },
+            // target, offset, size, data
+            { "glBufferSubData", 3, 0, true },
+            { "glClear", 1, 0, false },
+            { "glClearColor", 0, 4, false },
+            // sync number, flags, timeout
+            { "glClientWaitSync", 3, 0, false },
+            { "glCompileShader", 1, 0, false },
+            // target, level, x, y, z, width, height, depth, format, data
+            { "glCompressedTexSubImage3D", 9, 0, true },
+            // program
+            { "glCreateProgram", 1, 0, false },
+            // type, shader
+            { "glCreateShader", 2, 0, false },
+            { "glCullFace", 1, 0, false },
+            { "glDeleteBuffers", 1, 0, false },
+            { "glDeleteProgram", 1, 0, false },
+            { "glDeleteShader", 1, 0, false },
+            { "glDeleteSync", 1, 0, false },
+            { "glDeleteTextures", 1, 0, false },
+            { "glDeleteVertexArrays", 1, 0, false },
+            { "glDisable", 1, 0, false },
+            { "glDrawArrays", 3, 0, false },
+            // mode, count, type, offset
+            { "glDrawElements", 4, 0, false },
+            // mode, count, type, offset, instance count
+            { "glDrawElementsInstanced", 5, 0, false },
+            { "glEnable", 1, 0, false },
+            { "glEnableVertexAttribArray", 1, 0, false },
+            // condition, flags, sync number
+            { "glFenceSync", 3, 0, false },
+            // target, offset, length, bytes written to the range
+            { "glFlushMappedBufferRange", 3, 0, true },
+            { "glFrontFace", 1, 0, false },
+            { "glGenBuffers", 1, 0, false },
+            { "glGenTextures", 1, 0, false },
+            { "glGenVertexArrays", 1, 0, false },
+            { "glLineWidth", 0, 1, false },
+            { "glLinkProgram", 1, 0, false },
+            // target, offset, length, access
+            { "glMapBufferRange", 4, 0, false },
+            { "glPixelStorei", 2, 0, false },
+            { "glProgramParameteri", 3, 0, false },
+            { "glScissor", 4, 0, false },
+            // shader, the sources concatenated
+            { "glShaderSource", 1, 0, true },
+            // target, level, internal format, width, height, border, format, type, pixels
+            { "glTexImage2D", 8, 0, true },
+            { "glTexParameteri", 3, 0, false },
+            { "glTexStorage3D", 6, 0, false },
+            // target, level, x, y, z, width, height, depth, format, type, pixels
+            { "glTexSubImage3D", 10, 0, true },
+            { "glUniform1i", 2, 0, false },
+            // target, bytes written to the mapping unless it was flushed explicitly
+            { "glUnmapBuffer", 1, 0, true },
+            { "glUseProgram", 1, 0, false },
+            { "glVertexAttribBinding", 2, 0, false },
+            { "glVertexAttribFormat", 5, 0, false },
+            // index, size, type, normalized, stride, offset
+            { "glVertexAttribPointer", 6, 0, false },
+            { "glVertexBindingDivisor", 2, 0, false },
+            { "glViewport", 4, 0, false },
+            // target, framebuffer, 0 for the surface
+            { "glBindFramebuffer", 2, 0, false },
+            // source x0, y0, x1, y1, destination x0, y0, x1, y1, mask, filter
+            { "glBlitFramebuffer", 10, 0, false },
+            { "glDeleteFramebuffers", 1, 0, false },
+            // mode, first, count, instance count
+            { "glDrawArraysInstanced", 4, 0, false },
+            // target, attachment, texture, level, layer
+            { "glFramebufferTextureLayer", 5, 0, false },
+            // target, attachment, texture, level, base view, number of views
+            { "glFramebufferTextureMultiviewOVR", 6, 0, false },
+            { "glGenFramebuffers", 1, 0, false },
+            { "glBlendFuncSeparate", 4, 0, false },
+            // buffer, draw buffer, value, only the first of which is read for GL_DEPTH
+            { "glClearBufferfv", 2, 4, false },
+            // target, attachment, texture target, texture, level
+            { "glFramebufferTexture2D", 5, 0, false },
+            { "glTexStorage2D", 5, 0, false },
+            { "glUniform4f", 1, 4, false },
+        };
+        return LAYOUTS[opcode];
+    }
+
+    inline uint64_t zigzag(int64_t value)
+    {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    inline int64_t unzigzag(uint64_t value)
+    {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    inline void writeVarint(std::vector<uint8_t>& out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    /// Returns false if the data ends before the varint does
+    inline bool readVarint(const uint8_t*& in, const uint8_t* end, uint64_t& value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64 && in < end; shift += 7)
+        {
+            uint8_t byte = *in++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// Floats are copied as they are, both ends being little endian
+    inline void writeFloat(std::vector<uint8_t>& out, float value)
+    {
+        uint8_t bytes[sizeof(float)];
+        std::memcpy(bytes, &value, sizeof(bytes));
+        out.insert(out.end(), bytes, bytes + sizeof(bytes));
+    }
+
+    inline bool readFloat(const uint8_t*& in, const uint8_t* end, float& value)
+    {
+        if (end - in < static_cast<ptrdiff_t>(sizeof(float)))
+        {
+            return false;
+        }
+        std::memcpy(&value, in, sizeof(float));
+        in += sizeof(float);
+        return true;
+    }
+}
+
+#endif //_VUFORIA_GLESCOMMANDFORMAT_H_
@@ -0,0 +1,1075 @@
+/*===============================================================================
+Copyright (c) 2020 PTC Inc. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "GLESCommandRecorder.h"
+
+#include <Log.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+
+using namespace GLESCommandFormat;
+
+
+namespace
+{
+    /// Buffered commands are written out once there are this many bytes, as well as at the end of each frame
+    constexpr size_t FLUSH_BYTES = 1024 * 1024;
+
+    /// Bytes per pixel of an uncompressed format and type, 0 if unknown
+    size_t getPixelSize(GLenum format, GLenum type)
+    {
+        switch (type)
+        {
+            case GL_UNSIGNED_SHORT_5_6_5:
+            case GL_UNSIGNED_SHORT_4_4_4_4:
+            case GL_UNSIGNED_SHORT_5_5_5_1:
+                return 2;
+            default:
+                break;
+        }
+
+        size_t numComponents = 0;
+        switch (format)
+        {
+            case GL_RED:
+            case GL_ALPHA:
+            case GL_LUMINANCE:
+                numComponents = 1;
+                break;
+            case GL_RG:
+            case GL_LUMINANCE_ALPHA:
+                numComponents = 2;
+                break;
+            case GL_RGB:
+                numComponents = 3;
+                break;
+            case GL_RGBA:
+                numComponents = 4;
+                break;
+            default:
+                return 0;
+        }
+        switch (type)
+        {
+            case GL_UNSIGNED_BYTE:
+            case GL_BYTE:
+                return numComponents;
+            case GL_HALF_FLOAT:
+                return numComponents * 2;
+            case GL_FLOAT:
+                return numComponents * 4;
+            default:
+                return 0;
+        }
+    }
+
+    /// The recorder to write a call to, if recording
+    GLESCommandRecorder* getRecorder()
+    {
+        return GLESCommandRecorder::getActive();
+    }
+
+    int64_t getOffset(const void* pointer)
+    {
+        return static_cast<int64_t>(reinterpret_cast<intptr_t>(pointer));
+    }
+}
+
+
+/*===============================================================================
+GLESCommandRecorder public methods
+===============================================================================*/
+
+GLESCommandRecorder* GLESCommandRecorder::sActive = nullptr;
+
+
+GLESCommandRecorder::~GLESCommandRecorder()
+{
+    close();
+}
+
+
+bool GLESCommandRecorder::open(const std::string& path, unsigned int numFrames)
+{
+    close();
+    if (sActive != nullptr)
+    {
+        LOG("Error: Already recording GL commands to %s", sActive->mPath.c_str());
+        return false;
+    }
+
+    mFile = std::fopen(path.c_str(), "wb");
+    if (mFile == nullptr)
+    {
+        LOG("Error: Unable to create GL command recording %s", path.c_str());
+        return false;
+    }
+    mPath = path;
+    mBuffer.assign(MAGIC, MAGIC + sizeof(MAGIC));
+    mNumFrames = numFrames;
+    mNumFramesRecorded = 0;
+    mNumCommands = 0;
+    mNumBytesWritten = 0;
+    mSyncNumbers.clear();
+    mNextSyncNumber = 1;
+    // The defaults, the renderer sets the unpack state back to them after changing it
+    mUnpackAlignment = 4;
+    mUnpackRowLength = 0;
+    mMappings.clear();
+    sActive = this;
+
+    LOG("Recording GL commands to %s for %u frames", path.c_str(), numFrames);
+    return true;
+}
+
+
+void GLESCommandRecorder::close()
+{
+    if (mFile == nullptr)
+    {
+        return;
+    }
+
+    flush();
+    std::fclose(mFile);
+    mFile = nullptr;
+    sActive = nullptr;
+
+    LOG("GL command recording closed: %u frames, %zu commands, %zu bytes",
+        mNumFramesRecorded, mNumCommands, mNumBytesWritten);
+}
+
+
+void GLESCommandRecorder::beginFrame()
+{
+    if (mFile != nullptr)
+    {
+        write(OP_FRAME_BEGIN, {});
+    }
+}
+
+
+void GLESCommandRecorder::endFrame()
+{
+    if (mFile == nullptr)
+    {
+        return;
+    }
+
+    write(OP_FRAME_END, {});
+    flush();
+    if (++mNumFramesRecorded == mNumFrames)
+    {
+        close();
+    }
+}
+
+
+void GLESCommandRecorder::setSurfaceSize(int width, int height)
+{
+    if (mFile != nullptr)
+    {
+        write(OP_SURFACE_SIZE, { width, height });
+    }
+}
+
+
+void GLESCommandRecorder::write(Opcode opcode, std::initializer_list<int64_t> ints,
+                                std::initializer_list<float> floats, const void* data, size_t size)
+{
+    const Layout& layout = getLayout(opcode);
+    if (ints.size() != layout.numInts || floats.size() != layout.numFloats)
+    {
+        LOG("Error: %s recorded with %zu integers and %zu floats", layout.name, ints.size(), floats.size());
+        return;
+    }
+
+    mBuffer.push_back(opcode);
+    for (int64_t value : ints)
+    {
+        writeVarint(mBuffer, zigzag(value));
+    }
+    for (float value : floats)
+    {
+        writeFloat(mBuffer, value);
+    }
+    if (layout.hasData)
+    {
+        if (data == nullptr)
+        {
+            size = 0;
+        }
+        writeVarint(mBuffer, size);
+        auto bytes = static_cast<const uint8_t*>(data);
+        mBuffer.insert(mBuffer.end(), bytes, bytes + size);
+    }
+    ++mNumCommands;
+
+    // Texture uploads at init can be large, don't hold all of them
+    if (mBuffer.size() >= FLUSH_BYTES)
+    {
+        flush();
+    }
+}
+
+
+uint64_t GLESCommandRecorder::addSync(GLsync sync)
+{
+    // The driver may reuse the address of a deleted sync
+    uint64_t number = mNextSyncNumber++;
+    mSyncNumbers[sync] = number;
+    return number;
+}
+
+
+uint64_t GLESCommandRecorder::getSyncNumber(GLsync sync) const
+{
+    // Syncs created before the recording started are 0, which the replay skips
+    auto syncIt = mSyncNumbers.find(sync);
+    return syncIt != mSyncNumbers.end() ? syncIt->second : 0;
+}
+
+
+void GLESCommandRecorder::removeSync(GLsync sync)
+{
+    mSyncNumbers.erase(sync);
+}
+
+
+void GLESCommandRecorder::setPixelStore(GLenum name, GLint value)
+{
+    if (name == GL_UNPACK_ALIGNMENT)
+    {
+        mUnpackAlignment = value;
+    }
+    else if (name == GL_UNPACK_ROW_LENGTH)
+    {
+        mUnpackRowLength = value;
+    }
+}
+
+
+size_t GLESCommandRecorder::getImageSize(GLenum format, GLenum type, GLsizei width, GLsizei height,
+                                         GLsizei depth) const
+{
+    size_t pixelSize = getPixelSize(format, type);
+    if (pixelSize == 0 || width <= 0 || height <= 0 || depth <= 0)
+    {
+        return 0;
+    }
+
+    size_t rowPixels = static_cast<size_t>(mUnpackRowLength > 0 ? mUnpackRowLength : width);
+    size_t alignment = static_cast<size_t>(std::max(mUnpackAlignment, 1));
+    size_t rowSize = (rowPixels * pixelSize + alignment - 1) / alignment * alignment;
+    // The last row needn't be padded
+    size_t numRows = static_cast<size_t>(height) * static_cast<size_t>(depth);
+    return rowSize * (numRows - 1) + static_cast<size_t>(width) * pixelSize;
+}
+
+
+void GLESCommandRecorder::setMapping(GLenum target, const void* pointer, GLbitfield access)
+{
+    if (pointer == nullptr || (access & GL_MAP_WRITE_BIT) == 0)
+    {
+        mMappings.erase(target);
+        return;
+    }
+    mMappings[target] = { static_cast<const unsigned char*>(pointer), access };
+}
+
+
+const unsigned char* GLESCommandRecorder::getMapping(GLenum target, GLbitfield& access) const
+{
+    auto mappingIt = mMappings.find(target);
+    if (mappingIt == mMappings.end())
+    {
+        access = 0;
+        return nullptr;
+    }
+    access = mappingIt->second.access;
+    return mappingIt->second.pointer;
+}
+
+
+void GLESCommandRecorder::removeMapping(GLenum target)
+{
+    mMappings.erase(target);
+}
+
+
+/*===============================================================================
+GLESCommandRecorder private methods
+===============================================================================*/
+
+void GLESCommandRecorder::flush()
+{
+    if (mBuffer.empty())
+    {
+        return;
+    }
+    if (std::fwrite(mBuffer.data(), 1, mBuffer.size(), mFile) != mBuffer.size())
+    {
+        LOG("Error: Unable to write GL command recording %s", mPath.c_str());
+    }
+    mNumBytesWritten += mBuffer.size();
+    mBuffer.clear();
+}
+
+
+/*===============================================================================
+GLESRecordedCalls
+===============================================================================*/
+
+namespace GLESRecordedCalls
+{
+    void glActiveTexture(GLenum texture)
+    {
+        ::glActiveTexture(texture);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_ACTIVE_TEXTURE, { texture });
+        }
+    }
+
+
+    void glAttachShader(GLuint program, GLuint shader)
+    {
+        ::glAttachShader(program, shader);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_ATTACH_SHADER, { program, shader });
+        }
+    }
+
+
+    void glBindBuffer(GLenum target, GLuint buffer)
+    {
+        ::glBindBuffer(target, buffer);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_BIND_BUFFER, { target, buffer });
+        }
+    }
+
+
+    void glBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+    {
+        ::glBindBufferRange(target, index, buffer, offset, size);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_BIND_BUFFER_RANGE, { target, index, buffer, offset, size });
+        }
+    }
+
+
+    void glBindFramebuffer(GLenum target, GLuint framebuffer)
+    {
+        ::glBindFramebuffer(target, framebuffer);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_BIND_FRAMEBUFFER, { target, framebuffer });
+        }
+    }
+
+
+    void glBindTexture(GLenum target, GLuint texture)
+    {
+        ::glBindTexture(target, texture);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_BIND_TEXTURE, { target, texture });
+        }
+    }
+
+
+    void glBindVertexArray(GLuint array)
+    {
+        ::glBindVertexArray(array);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_BIND_VERTEX_ARRAY, { array });
+        }
+    }
+
+
+    void glBindVertexBuffer(GLuint bindingIndex, GLuint buffer, GLintptr offset, GLsizei stride)
+    {
+        ::glBindVertexBuffer(bindingIndex, buffer, offset, stride);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_BIND_VERTEX_BUFFER, { bindingIndex, buffer, offset, stride });
+        }
+    }
+
+
+    void glBlendFunc(GLenum sfactor, GLenum dfactor)
+    {
+        ::glBlendFunc(sfactor, dfactor);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_BLEND_FUNC, { sfactor, dfactor });
+        }
+    }
+
+
+    void glBlendFuncSeparate(GLenum sfactorRGB, GLenum dfactorRGB, GLenum sfactorAlpha, GLenum dfactorAlpha)
+    {
+        ::glBlendFuncSeparate(sfactorRGB, dfactorRGB, sfactorAlpha, dfactorAlpha);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_BLEND_FUNC_SEPARATE, { sfactorRGB, dfactorRGB, sfactorAlpha, dfactorAlpha });
+        }
+    }
+
+
+    void glBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0,
+                           GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter)
+    {
+        ::glBlitFramebuffer(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_BLIT_FRAMEBUFFER,
+                            { srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter });
+        }
+    }
+
+
+    void glBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+    {
+        ::glBufferData(target, size, data, usage);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_BUFFER_DATA, { target, size, usage }, {}, data, static_cast<size_t>(size));
+        }
+    }
+
+
+    void glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+    {
+        ::glBufferSubData(target, offset, size, data);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_BUFFER_SUB_DATA, { target, offset, size }, {}, data, static_cast<size_t>(size));
+        }
+    }
+
+
+    void glClear(GLbitfield mask)
+    {
+        ::glClear(mask);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_CLEAR, { mask });
+        }
+    }
+
+
+    void glClearBufferfv(GLenum buffer, GLint drawBuffer, const GLfloat* value)
+    {
+        ::glClearBufferfv(buffer, drawBuffer, value);
+        if (auto recorder = getRecorder())
+        {
+            // A depth clear passes a single value
+            if (buffer == GL_COLOR)
+            {
+                recorder->write(OP_CLEAR_BUFFERFV, { buffer, drawBuffer }, { value[0], value[1], value[2], value[3] });
+            }
+            else
+            {
+                recorder->write(OP_CLEAR_BUFFERFV, { buffer, drawBuffer }, { value[0], 0.0f, 0.0f, 0.0f });
+            }
+        }
+    }
+
+
+    void glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+    {
+        ::glClearColor(red, green, blue, alpha);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_CLEAR_COLOR, {}, { red, green, blue, alpha });
+        }
+    }
+
+
+    GLenum glClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+    {
+        GLenum result = ::glClientWaitSync(sync, flags, timeout);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_CLIENT_WAIT_SYNC,
+                            { static_cast<int64_t>(recorder->getSyncNumber(sync)), flags,
+                              static_cast<int64_t>(timeout) });
+        }
+        return result;
+    }
+
+
+    void glCompileShader(GLuint shader)
+    {
+        ::glCompileShader(shader);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_COMPILE_SHADER, { shader });
+        }
+    }
+
+
+    void glCompressedTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset,
+                                   GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLsizei imageSize,
+                                   const void* data)
+    {
+        ::glCompressedTexSubImage3D(target, level, xoffset, yoffset, zoffset, width, height, depth, format,
+                                    imageSize, data);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_COMPRESSED_TEX_SUB_IMAGE_3D,
+                            { target, level, xoffset, yoffset, zoffset, width, height, depth, format }, {},
+                            data, static_cast<size_t>(imageSize));
+        }
+    }
+
+
+    GLuint glCreateProgram()
+    {
+        GLuint program = ::glCreateProgram();
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_CREATE_PROGRAM, { program });
+        }
+        return program;
+    }
+
+
+    GLuint glCreateShader(GLenum type)
+    {
+        GLuint shader = ::glCreateShader(type);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_CREATE_SHADER, { type, shader });
+        }
+        return shader;
+    }
+
+
+    void glCullFace(GLenum mode)
+    {
+        ::glCullFace(mode);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_CULL_FACE, { mode });
+        }
+    }
+
+
+    void glDeleteBuffers(GLsizei n, const GLuint* buffers)
+    {
+        ::glDeleteBuffers(n, buffers);
+        if (auto recorder = getRecorder())
+        {
+            for (GLsizei i = 0; i < n; ++i)
+            {
+                recorder->write(OP_DELETE_BUFFER, { buffers[i] });
+            }
+        }
+    }
+
+
+    void glDeleteFramebuffers(GLsizei n, const GLuint* framebuffers)
+    {
+        ::glDeleteFramebuffers(n, framebuffers);
+        if (auto recorder = getRecorder())
+        {
+            for (GLsizei i = 0; i < n; ++i)
+            {
+                recorder->write(OP_DELETE_FRAMEBUFFER, { framebuffers[i] });
+            }
+        }
+    }
+
+
+    void glDeleteProgram(GLuint program)
+    {
+        ::glDeleteProgram(program);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_DELETE_PROGRAM, { program });
+        }
+    }
+
+
+    void glDeleteShader(GLuint shader)
+    {
+        ::glDeleteShader(shader);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_DELETE_SHADER, { shader });
+        }
+    }
+
+
+    void glDeleteSync(GLsync sync)
+    {
+        ::glDeleteSync(sync);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_DELETE_SYNC, { static_cast<int64_t>(recorder->getSyncNumber(sync)) });
+            recorder->removeSync(sync);
+        }
+    }
+
+
+    void glDeleteTextures(GLsizei n, const GLuint* textures)
+    {
+        ::glDeleteTextures(n, textures);
+        if (auto recorder = getRecorder())
+        {
+            for (GLsizei i = 0; i < n; ++i)
+            {
+                recorder->write(OP_DELETE_TEXTURE, { textures[i] });
+            }
+        }
+    }
+
+
+    void glDeleteVertexArrays(GLsizei n, const GLuint* arrays)
+    {
+        ::glDeleteVertexArrays(n, arrays);
+        if (auto recorder = getRecorder())
+        {
+            for (GLsizei i = 0; i < n; ++i)
+            {
+                recorder->write(OP_DELETE_VERTEX_ARRAY, { arrays[i] });
+            }
+        }
+    }
+
+
+    void glDisable(GLenum cap)
+    {
+        ::glDisable(cap);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_DISABLE, { cap });
+        }
+    }
+
+
+    void glDrawArrays(GLenum mode, GLint first, GLsizei count)
+    {
+        ::glDrawArrays(mode, first, count);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_DRAW_ARRAYS, { mode, first, count });
+        }
+    }
+
+
+    void glDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount)
+    {
+        ::glDrawArraysInstanced(mode, first, count, instanceCount);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_DRAW_ARRAYS_INSTANCED, { mode, first, count, instanceCount });
+        }
+    }
+
+
+    void glDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+    {
+        ::glDrawElements(mode, count, type, indices);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_DRAW_ELEMENTS, { mode, count, type, getOffset(indices) });
+        }
+    }
+
+
+    void glDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices,
+                                 GLsizei instanceCount)
+    {
+        ::glDrawElementsInstanced(mode, count, type, indices, instanceCount);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_DRAW_ELEMENTS_INSTANCED, { mode, count, type, getOffset(indices), instanceCount });
+        }
+    }
+
+
+    void glEnable(GLenum cap)
+    {
+        ::glEnable(cap);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_ENABLE, { cap });
+        }
+    }
+
+
+    void glEnableVertexAttribArray(GLuint index)
+    {
+        ::glEnableVertexAttribArray(index);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_ENABLE_VERTEX_ATTRIB_ARRAY, { index });
+        }
+    }
+
+
+    GLsync glFenceSync(GLenum condition, GLbitfield flags)
+    {
+        GLsync sync = ::glFenceSync(condition, flags);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_FENCE_SYNC, { condition, flags, static_cast<int64_t>(recorder->addSync(sync)) });
+        }
+        return sync;
+    }
+
+
+    void glFlushMappedBufferRange(GLenum target, GLintptr offset, GLsizeiptr length)
+    {
+        ::glFlushMappedBufferRange(target, offset, length);
+        if (auto recorder = getRecorder())
+        {
+            // The offset is from the start of the mapping, not of the buffer
+            GLbitfield access = 0;
+            const unsigned char* mapping = recorder->getMapping(target, access);
+            recorder->write(OP_FLUSH_MAPPED_BUFFER_RANGE, { target, offset, length }, {},
+                            mapping != nullptr ? mapping + offset : nullptr, static_cast<size_t>(length));
+        }
+    }
+
+
+    void glFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level)
+    {
+        ::glFramebufferTexture2D(target, attachment, textarget, texture, level);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_FRAMEBUFFER_TEXTURE_2D, { target, attachment, textarget, texture, level });
+        }
+    }
+
+
+    void glFramebufferTextureLayer(GLenum target, GLenum attachment, GLuint texture, GLint level, GLint layer)
+    {
+        ::glFramebufferTextureLayer(target, attachment, texture, level, layer);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_FRAMEBUFFER_TEXTURE_LAYER, { target, attachment, texture, level, layer });
+        }
+    }
+
+
+    void glFrontFace(GLenum mode)
+    {
+        ::glFrontFace(mode);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_FRONT_FACE, { mode });
+        }
+    }
+
+
+    void glGenBuffers(GLsizei n, GLuint* buffers)
+    {
+        ::glGenBuffers(n, buffers);
+        if (auto recorder = getRecorder())
+        {
+            for (GLsizei i = 0; i < n; ++i)
+            {
+                recorder->write(OP_GEN_BUFFER, { buffers[i] });
+            }
+        }
+    }
+
+
+    void glGenFramebuffers(GLsizei n, GLuint* framebuffers)
+    {
+        ::glGenFramebuffers(n, framebuffers);
+        if (auto recorder = getRecorder())
+        {
+            for (GLsizei i = 0; i < n; ++i)
+            {
+                recorder->write(OP_GEN_FRAMEBUFFER, { framebuffers[i] });
+            }
+        }
+    }
+
+
+    void glGenTextures(GLsizei n, GLuint* textures)
+    {
+        ::glGenTextures(n, textures);
+        if (auto recorder = getRecorder())
+        {
+            for (GLsizei i = 0; i < n; ++i)
+            {
+                recorder->write(OP_GEN_TEXTURE, { textures[i] });
+            }
+        }
+    }
+
+
+    void glGenVertexArrays(GLsizei n, GLuint* arrays)
+    {
+        ::glGenVertexArrays(n, arrays);
+        if (auto recorder = getRecorder())
+        {
+            for (GLsizei i = 0; i < n; ++i)
+            {
+                recorder->write(OP_GEN_VERTEX_ARRAY, { arrays[i] });
+            }
+        }
+    }
+
+
+    void glLineWidth(GLfloat width)
+    {
+        ::glLineWidth(width);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_LINE_WIDTH, {}, { width });
+        }
+    }
+
+
+    void glLinkProgram(GLuint program)
+    {
+        ::glLinkProgram(program);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_LINK_PROGRAM, { program });
+        }
+    }
+
+
+    void* glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+    {
+        void* pointer = ::glMapBufferRange(target, offset, length, access);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_MAP_BUFFER_RANGE, { target, offset, length, access });
+            recorder->setMapping(target, pointer, access);
+        }
+        return pointer;
+    }
+
+
+    void glPixelStorei(GLenum pname, GLint param)
+    {
+        ::glPixelStorei(pname, param);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_PIXEL_STOREI, { pname, param });
+            recorder->setPixelStore(pname, param);
+        }
+    }
+
+
+    void glProgramParameteri(GLuint program, GLenum pname, GLint value)
+    {
+        ::glProgramParameteri(program, pname, value);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_PROGRAM_PARAMETERI, { program, pname, value });
+        }
+    }
+
+
+    void glScissor(GLint x, GLint y, GLsizei width, GLsizei height)
+    {
+        ::glScissor(x, y, width, height);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_SCISSOR, { x, y, width, height });
+        }
+    }
+
+
+    void glShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length)
+    {
+        ::glShaderSource(shader, count, string, length);
+        if (auto recorder = getRecorder())
+        {
+            std::string source;
+            for (GLsizei i = 0; i < count; ++i)
+            {
+                if (length != nullptr && length[i] >= 0)
+                {
+                    source.append(string[i], static_cast<size_t>(length[i]));
+                }
+                else
+                {
+                    source.append(string[i]);
+                }
+            }
+            recorder->write(OP_SHADER_SOURCE, { shader }, {}, source.data(), source.size());
+        }
+    }
+
+
+    void glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+                      GLint border, GLenum format, GLenum type, const void* pixels)
+    {
+        ::glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_TEX_IMAGE_2D, { target, level, internalformat, width, height, border, format, type },
+                            {}, pixels, recorder->getImageSize(format, type, width, height, 1));
+        }
+    }
+
+
+    void glTexParameteri(GLenum target, GLenum pname, GLint param)
+    {
+        ::glTexParameteri(target, pname, param);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_TEX_PARAMETERI, { target, pname, param });
+        }
+    }
+
+
+    void glTexStorage2D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height)
+    {
+        ::glTexStorage2D(target, levels, internalformat, width, height);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_TEX_STORAGE_2D, { target, levels, internalformat, width, height });
+        }
+    }
+
+
+    void glTexStorage3D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height,
+                        GLsizei depth)
+    {
+        ::glTexStorage3D(target, levels, internalformat, width, height, depth);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_TEX_STORAGE_3D, { target, levels, internalformat, width, height, depth });
+        }
+    }
+
+
+    void glTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width,
+                         GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels)
+    {
+        ::glTexSubImage3D(target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, pixels);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_TEX_SUB_IMAGE_3D,
+                            { target, level, xoffset, yoffset, zoffset, width, height, depth, format, type }, {},
+                            pixels, recorder->getImageSize(format, type, width, height, depth));
+        }
+    }
+
+
+    void glUniform1i(GLint location, GLint v0)
+    {
+        ::glUniform1i(location, v0);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_UNIFORM_1I, { location, v0 });
+        }
+    }
+
+
+    void glUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3)
+    {
+        ::glUniform4f(location, v0, v1, v2, v3);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_UNIFORM_4F, { location }, { v0, v1, v2, v3 });
+        }
+    }
+
+
+    GLboolean glUnmapBuffer(GLenum target)
+    {
+        // Without explicit flushes the whole mapping is written back, record it before the driver takes it
+        auto recorder = getRecorder();
+        if (recorder != nullptr)
+        {
+            GLbitfield access = 0;
+            const unsigned char* mapping = recorder->getMapping(target, access);
+            GLint64 length = 0;
+            if (mapping != nullptr && (access & GL_MAP_FLUSH_EXPLICIT_BIT) == 0)
+            {
+                glGetBufferParameteri64v(target, GL_BUFFER_MAP_LENGTH, &length);
+            }
+            recorder->write(OP_UNMAP_BUFFER, { target }, {}, length > 0 ? mapping : nullptr,
+                            static_cast<size_t>(length));
+            recorder->removeMapping(target);
+        }
+        return ::glUnmapBuffer(target);
+    }
+
+
+    void glUseProgram(GLuint program)
+    {
+        ::glUseProgram(program);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_USE_PROGRAM, { program });
+        }
+    }
+
+
+    void glVertexAttribBinding(GLuint attribIndex, GLuint bindingIndex)
+    {
+        ::glVertexAttribBinding(attribIndex, bindingIndex);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_VERTEX_ATTRIB_BINDING, { attribIndex, bindingIndex });
+        }
+    }
+
+
+    void glVertexAttribFormat(GLuint attribIndex, GLint size, GLenum type, GLboolean normalized,
+                              GLuint relativeOffset)
+    {
+        ::glVertexAttribFormat(attribIndex, size, type, normalized, relativeOffset);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_VERTEX_ATTRIB_FORMAT, { attribIndex, size, type, normalized, relativeOffset });
+        }
+    }
+
+
+    void glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride,
+                               const void* pointer)
+    {
+        ::glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_VERTEX_ATTRIB_POINTER, { index, size, type, normalized, stride, getOffset(pointer) });
+        }
+    }
+
+
+    void glVertexBindingDivisor(GLuint bindingIndex, GLuint divisor)
+    {
+        ::glVertexBindingDivisor(bindingIndex, divisor);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_VERTEX_BINDING_DIVISOR, { bindingIndex, divisor });
+        }
+    }
+
+
+    void glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+    {
+        ::glViewport(x, y, width, height);
+        if (auto recorder = getRecorder())
+        {
+            recorder->write(OP_VIEWPORT, { x, y, width, height });
+        }
+    }
+}
@@ -0,0 +1,204 @@
+/*===============================================================================
+Copyright (c) 2020 PTC Inc. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef _VUFORIA_GLESCOMMANDRECORDER_H_
+#define _VUFORIA_GLESCOMMANDRECORDER_H_
+
+#include <GLES3/gl31.h>
+
+#include "GLESCommandFormat.h"
+
+#include <cstdio>
+#include <initializer_list>
+#include <map>
+#include <string>
+#include <vector>
+
+
+/// Records the renderer's GL calls, with the data they upload, to a file for replay on the desktop.
+/**
+ * The calls are intercepted by the functions in GLESRecordedCalls, which the
+ * macros in GLESRecordedCalls.h substitute for the GL functions in builds with
+ * VUFORIA_RECORD_GL_COMMANDS defined. Each makes the GL call then writes it
+ * to the open recorder, if there is one. Calls that only read state, such as
+ * glGetIntegerv, and the GPU timer's queries aren't recorded.
+ *
+ * A recording should start before the renderer creates anything, so that it
+ * holds every object its frames use. The calls are buffered and written to
+ * the file at the end of each frame. See GLESCommandFormat for the layout and
+ * Tools/GLCommandReplayer to play a recording back.
+ */
+class GLESCommandRecorder
+{
+public:
+    GLESCommandRecorder() = default;
+    ~GLESCommandRecorder();
+
+    GLESCommandRecorder(const GLESCommandRecorder&) = delete;
+    GLESCommandRecorder& operator=(const GLESCommandRecorder&) = delete;
+
+    /// Create the recording file, replacing any existing one, and record the
+    /// calls made from now until numFrames frames have ended. Only one recorder
+    /// can be open at a time. Returns false if the file can't be created.
+    bool open(const std::string& path, unsigned int numFrames);
+
+    /// Write the calls recorded so far and close the file
+    void close();
+
+    bool isOpen() const { return mFile != nullptr; }
+
+    /// The open recorder, which the intercepted calls are written to, or nullptr
+    static GLESCommandRecorder* getActive() { return sActive; }
+
+    /// Mark the calls of a frame, the recording closes once the last frame ends
+    void beginFrame();
+    void endFrame();
+
+    /// Record the size of the surface drawn to, for the replay to match
+    void setSurfaceSize(int width, int height);
+
+    // Used by GLESRecordedCalls
+
+    /// Append a command, with an empty data payload for a null data pointer
+    void write(GLESCommandFormat::Opcode opcode, std::initializer_list<int64_t> ints,
+               std::initializer_list<float> floats = {}, const void* data = nullptr, size_t size = 0);
+
+    /// Number a new sync object, or get the number of an existing one
+    uint64_t addSync(GLsync sync);
+    uint64_t getSyncNumber(GLsync sync) const;
+    void removeSync(GLsync sync);
+
+    /// Track the unpack state glTexImage2D and glTexSubImage3D read pixels with
+    void setPixelStore(GLenum name, GLint value);
+
+    /// Bytes glTexImage2D or glTexSubImage3D reads for an image, given the unpack state
+    size_t getImageSize(GLenum format, GLenum type, GLsizei width, GLsizei height, GLsizei depth) const;
+
+    /// Track the range mapped to a buffer target, so the bytes written to it can be recorded
+    void setMapping(GLenum target, const void* pointer, GLbitfield access);
+    /// The mapped pointer of a target, or nullptr if it isn't mapped for writing
+    const unsigned char* getMapping(GLenum target, GLbitfield& access) const;
+    void removeMapping(GLenum target);
+
+private: // types
+
+    struct Mapping
+    {
+        const unsigned char* pointer;
+        GLbitfield access;
+    };
+
+private: // methods
+
+    /// Write the buffered commands to the file
+    void flush();
+
+private: // data members
+
+    static GLESCommandRecorder* sActive;
+
+    std::FILE* mFile = nullptr;
+    std::string mPath;
+    std::vector<uint8_t> mBuffer;
+
+    unsigned int mNumFrames = 0;
+    unsigned int mNumFramesRecorded = 0;
+    size_t mNumCommands = 0;
+    size_t mNumBytesWritten = 0;
+
+    std::map<GLsync, uint64_t> mSyncNumbers;
+    uint64_t mNextSyncNumber = 1;
+
+    GLint mUnpackAlignment = 4;
+    GLint mUnpackRowLength = 0;
+
+    std::map<GLenum, Mapping> mMappings;
+};
+
+
+/// Replacements for the GL functions the renderer calls, which record each call to the active recorder.
+/// GLESRecordedCalls.h substitutes them for the GL functions when recording is built in.
+namespace GLESRecordedCalls
+{
+    void glActiveTexture(GLenum texture);
+    void glAttachShader(GLuint program, GLuint shader);
+    void glBindBuffer(GLenum target, GLuint buffer);
+    void glBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+    void glBindFramebuffer(GLenum target, GLuint framebuffer);
+    void glBindTexture(GLenum target, GLuint texture);
+    void glBindVertexArray(GLuint array);
+    void glBindVertexBuffer(GLuint bindingIndex, GLuint buffer, GLintptr offset, GLsizei stride);
+    void glBlendFunc(GLenum sfactor, GLenum dfactor);
+    void glBlendFuncSeparate(GLenum sfactorRGB, GLenum dfactorRGB, GLenum sfactorAlpha, GLenum dfactorAlpha);
+    void glBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0,
+                           GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter);
+    void glBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+    void glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data);
+    void glClear(GLbitfield mask);
+    void glClearBufferfv(GLenum buffer, GLint drawBuffer, const GLfloat* value);
+    void glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+    GLenum glClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout);
+    void glCompileShader(GLuint shader);
+    void glCompressedTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset,
+                                   GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLsizei imageSize,
+                                   const void* data);
+    GLuint glCreateProgram();
+    GLuint glCreateShader(GLenum type);
+    void glCullFace(GLenum mode);
+    void glDeleteBuffers(GLsizei n, const GLuint* buffers);
+    void glDeleteFramebuffers(GLsizei n, const GLuint* framebuffers);
+    void glDeleteProgram(GLuint program);
+    void glDeleteShader(GLuint shader);
+    void glDeleteSync(GLsync sync);
+    void glDeleteTextures(GLsizei n, const GLuint* textures);
+    void glDeleteVertexArrays(GLsizei n, const GLuint* arrays);
+    void glDisable(GLenum cap);
+    void glDrawArrays(GLenum mode, GLint first, GLsizei count);
+    void glDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount);
+    void glDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices);
+    void glDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices,
+                                 GLsizei instanceCount);
+    void glEnable(GLenum cap);
+    void glEnableVertexAttribArray(GLuint index);
+    GLsync glFenceSync(GLenum condition, GLbitfield flags);
+    void glFlushMappedBufferRange(GLenum target, GLintptr offset, GLsizeiptr length);
+    void glFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+    void glFramebufferTextureLayer(GLenum target, GLenum attachment, GLuint texture, GLint level, GLint layer);
+    void glFrontFace(GLenum mode);
+    void glGenBuffers(GLsizei n, GLuint* buffers);
+    void glGenFramebuffers(GLsizei n, GLuint* framebuffers);
+    void glGenTextures(GLsizei n, GLuint* textures);
+    void glGenVertexArrays(GLsizei n, GLuint* arrays);
+    void glLineWidth(GLfloat width);
+    void glLinkProgram(GLuint program);
+    void* glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+    void glPixelStorei(GLenum pname, GLint param);
+    void glProgramParameteri(GLuint program, GLenum pname, GLint value);
+    void glScissor(GLint x, GLint y, GLsizei width, GLsizei height);
+    void glShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length);
+    void glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+                      GLint border, GLenum format, GLenum type, const void* pixels);
+    void glTexParameteri(GLenum target, GLenum pname, GLint param);
+    void glTexStorage2D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+    void glTexStorage3D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height,
+                        GLsizei depth);
+    void glTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width,
+                         GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels);
+    void glUniform1i(GLint location, GLint v0);
+    void glUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3);
+    GLboolean glUnmapBuffer(GLenum target);
+    void glUseProgram(GLuint program);
+    void glVertexAttribBinding(GLuint attribIndex, GLuint bindingIndex);
+    void glVertexAttribFormat(GLuint attribIndex, GLint size, GLenum type, GLboolean normalized,
+                              GLuint relativeOffset);
+    void glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride,
+                               const void* pointer);
+    void glVertexBindingDivisor(GLuint bindingIndex, GLuint divisor);
+    void glViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+}
+
+#endif //_VUFORIA_GLESCOMMANDRECORDER_H_
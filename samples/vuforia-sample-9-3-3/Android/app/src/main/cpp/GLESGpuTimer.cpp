@@ -0,0 +1,272 @@
+/*===============================================================================
+Copyright (c) 2020 PTC Inc. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "GLESGpuTimer.h"
+
+#include <Log.h>
+
+#include <EGL/egl.h>
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace
+{
+    /// Frames of queries to keep waiting on before giving up on the oldest,
+    /// results normally arrive in two or three
+    constexpr size_t MAX_PENDING_FRAMES = 8;
+
+    double getMilliseconds(std::chrono::steady_clock::duration duration)
+    {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+}
+
+
+bool GLESGpuTimer::init()
+{
+    deinit();
+
+    const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    if (extensions != nullptr && std::strstr(extensions, "GL_EXT_disjoint_timer_query") != nullptr)
+    {
+        mGetQueryObjectui64v = reinterpret_cast<PFNGLGETQUERYOBJECTUI64VEXTPROC>(
+            eglGetProcAddress("glGetQueryObjectui64vEXT"));
+    }
+    mHasGpuTiming = mGetQueryObjectui64v != nullptr;
+    if (mHasGpuTiming)
+    {
+        // Clear any disjoint event from before the first frame
+        GLint disjoint = 0;
+        glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+    }
+    else
+    {
+        LOG("GL_EXT_disjoint_timer_query isn't supported, only CPU times will be measured");
+    }
+    return mHasGpuTiming;
+}
+
+
+void GLESGpuTimer::deinit()
+{
+    for (const Frame& frame : mPendingFrames)
+    {
+        for (const Scope& scope : frame.scopes)
+        {
+            mFreeQueries.push_back(scope.query);
+        }
+    }
+    for (const Scope& scope : mCurrentFrame)
+    {
+        mFreeQueries.push_back(scope.query);
+    }
+    mFreeQueries.erase(std::remove(mFreeQueries.begin(), mFreeQueries.end(), 0u), mFreeQueries.end());
+    if (!mFreeQueries.empty())
+    {
+        glDeleteQueries(static_cast<GLsizei>(mFreeQueries.size()), mFreeQueries.data());
+    }
+    mFreeQueries.clear();
+    mPendingFrames.clear();
+    mCurrentFrame.clear();
+    mIsScopeOpen = false;
+    mHasGpuTiming = false;
+    mGetQueryObjectui64v = nullptr;
+    mLastResults.clear();
+    mLastResultsFrameNumber = 0;
+    resetAverages();
+}
+
+
+void GLESGpuTimer::beginFrame()
+{
+    mCurrentFrame.clear();
+    mIsScopeOpen = false;
+    ++mFrameNumber;
+    if (mHasGpuTiming)
+    {
+        readFinishedFrames();
+    }
+}
+
+
+void GLESGpuTimer::endFrame()
+{
+    endScope();
+
+    if (!mHasGpuTiming)
+    {
+        // The CPU times are all there is, and they're known already
+        std::vector<ScopeTiming> results;
+        for (const Scope& scope : mCurrentFrame)
+        {
+            results.push_back({ scope.name, -1.0, scope.cpuMs });
+        }
+        addResults(results, mFrameNumber);
+        mCurrentFrame.clear();
+        return;
+    }
+
+    mPendingFrames.push_back({ mFrameNumber, std::move(mCurrentFrame) });
+    mCurrentFrame.clear();
+    if (mPendingFrames.size() > MAX_PENDING_FRAMES)
+    {
+        // Not expected to happen, but the pool mustn't grow without bound.
+        // Reusing a query object discards the result it was waiting on.
+        for (const Scope& scope : mPendingFrames.front().scopes)
+        {
+            mFreeQueries.push_back(scope.query);
+        }
+        mPendingFrames.pop_front();
+    }
+}
+
+
+void GLESGpuTimer::beginScope(const char* name)
+{
+    endScope();
+
+    Scope scope;
+    scope.name = name;
+    scope.query = 0;
+    scope.cpuMs = 0.0;
+    if (mHasGpuTiming)
+    {
+        scope.query = getQuery();
+        glBeginQuery(GL_TIME_ELAPSED_EXT, scope.query);
+    }
+    scope.cpuStart = std::chrono::steady_clock::now();
+    mCurrentFrame.push_back(scope);
+    mIsScopeOpen = true;
+}
+
+
+void GLESGpuTimer::endScope()
+{
+    if (!mIsScopeOpen)
+    {
+        return;
+    }
+
+    Scope& scope = mCurrentFrame.back();
+    scope.cpuMs = getMilliseconds(std::chrono::steady_clock::now() - scope.cpuStart);
+    if (mHasGpuTiming)
+    {
+        glEndQuery(GL_TIME_ELAPSED_EXT);
+    }
+    mIsScopeOpen = false;
+}
+
+
+void GLESGpuTimer::getAverages(std::vector<ScopeTiming>& averages) const
+{
+    averages = mTotals;
+    if (mNumTotalFrames == 0)
+    {
+        return;
+    }
+    for (ScopeTiming& average : averages)
+    {
+        if (average.gpuMs >= 0.0)
+        {
+            average.gpuMs /= mNumTotalFrames;
+        }
+        average.cpuMs /= mNumTotalFrames;
+    }
+}
+
+
+void GLESGpuTimer::resetAverages()
+{
+    mTotals.clear();
+    mNumTotalFrames = 0;
+}
+
+
+void GLESGpuTimer::readFinishedFrames()
+{
+    bool checkedDisjoint = false;
+    bool disjoint = false;
+    while (!mPendingFrames.empty())
+    {
+        const Frame& frame = mPendingFrames.front();
+        for (const Scope& scope : frame.scopes)
+        {
+            GLuint available = GL_FALSE;
+            glGetQueryObjectuiv(scope.query, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available == GL_FALSE)
+            {
+                // This frame and so every later one is still in flight
+                return;
+            }
+        }
+
+        // The flag covers every query since it was last read, so once per batch of frames is enough
+        if (!checkedDisjoint)
+        {
+            GLint disjointValue = 0;
+            glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjointValue);
+            disjoint = disjointValue != 0;
+            checkedDisjoint = true;
+        }
+
+        std::vector<ScopeTiming> results;
+        for (const Scope& scope : frame.scopes)
+        {
+            GLuint64 nanoseconds = 0;
+            mGetQueryObjectui64v(scope.query, GL_QUERY_RESULT, &nanoseconds);
+            results.push_back({ scope.name, static_cast<double>(nanoseconds) / 1.0e6, scope.cpuMs });
+            mFreeQueries.push_back(scope.query);
+        }
+        if (!disjoint)
+        {
+            addResults(results, frame.number);
+        }
+        mPendingFrames.pop_front();
+    }
+}
+
+
+void GLESGpuTimer::addResults(const std::vector<ScopeTiming>& results, uint64_t frameNumber)
+{
+    mLastResults = results;
+    mLastResultsFrameNumber = frameNumber;
+
+    // A scope can appear more than once in a frame, its times are added up
+    for (const ScopeTiming& result : results)
+    {
+        auto totalIt = std::find_if(mTotals.begin(), mTotals.end(), [&result](const ScopeTiming& total) {
+            return std::strcmp(total.name, result.name) == 0;
+        });
+        if (totalIt == mTotals.end())
+        {
+            mTotals.push_back({ result.name, result.gpuMs >= 0.0 ? 0.0 : -1.0, 0.0 });
+            totalIt = mTotals.end() - 1;
+        }
+        if (result.gpuMs >= 0.0)
+        {
+            totalIt->gpuMs += result.gpuMs;
+        }
+        totalIt->cpuMs += result.cpuMs;
+    }
+    ++mNumTotalFrames;
+}
+
+
+GLuint GLESGpuTimer::getQuery()
+{
+    if (mFreeQueries.empty())
+    {
+        GLuint query = 0;
+        glGenQueries(1, &query);
+        return query;
+    }
+    GLuint query = mFreeQueries.back();
+    mFreeQueries.pop_back();
+    return query;
+}
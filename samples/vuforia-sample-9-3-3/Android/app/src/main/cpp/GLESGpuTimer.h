@@ -0,0 +1,130 @@
+/*===============================================================================
+Copyright (c) 2020 PTC Inc. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef _VUFORIA_GLESGPUTIMER_H_
+#define _VUFORIA_GLESGPUTIMER_H_
+
+#include <GLES3/gl31.h>
+#include <GLES2/gl2ext.h>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+
+/// Measures the GPU and CPU time of named scopes within a frame.
+/**
+ * Each scope wraps a GL_TIME_ELAPSED_EXT query from GL_EXT_disjoint_timer_query.
+ * The queries of a frame are only read once the GPU has made all of their
+ * results available, normally a few frames later, so timing never waits for
+ * the GPU. Query objects are reused from a pool once read. Frames during
+ * which the GPU timer was disjoint, for example because the GPU changed
+ * clock, are dropped.
+ *
+ * Without the extension only the CPU time is measured, and results are
+ * available as soon as the frame ends.
+ *
+ * Only one time elapsed query can be active at a time, so scopes don't nest:
+ * beginning a scope ends the one open.
+ */
+class GLESGpuTimer
+{
+public:
+    /// Time spent in a scope over one frame, or averaged over several
+    struct ScopeTiming
+    {
+        /// As given to beginScope
+        const char* name;
+        /// Negative if the GPU time isn't known
+        double gpuMs;
+        /// Time between beginScope and endScope, that is the time to issue the GL calls
+        double cpuMs;
+    };
+
+    /// Check for GL_EXT_disjoint_timer_query, returns whether GPU times will be measured
+    bool init();
+    /// Delete the query objects, results not yet read are lost
+    void deinit();
+
+    bool hasGpuTiming() const { return mHasGpuTiming; }
+
+    /// Call around the scopes of each frame. beginFrame also reads the results
+    /// of earlier frames that the GPU has finished.
+    void beginFrame();
+    void endFrame();
+
+    /// Start timing a scope, ending any scope still open. name must outlive the
+    /// timer, normally it is a string literal.
+    void beginScope(const char* name);
+    void endScope();
+
+    /// Scopes of the latest frame whose results have been read
+    const std::vector<ScopeTiming>& getLastResults() const { return mLastResults; }
+
+    /// Number of the frame begun last, counting from 1, and of the frame the last
+    /// results are from, 0 if there are none. Lets a caller match the results with
+    /// what else it knows about that frame.
+    uint64_t getFrameNumber() const { return mFrameNumber; }
+    uint64_t getLastResultsFrameNumber() const { return mLastResultsFrameNumber; }
+
+    /// Average time of each scope over the frames read since resetAverages,
+    /// counting frames a scope wasn't in as zero
+    void getAverages(std::vector<ScopeTiming>& averages) const;
+    void resetAverages();
+
+private: // types
+
+    struct Scope
+    {
+        const char* name;
+        GLuint query;
+        std::chrono::steady_clock::time_point cpuStart;
+        double cpuMs;
+    };
+
+    struct Frame
+    {
+        uint64_t number;
+        std::vector<Scope> scopes;
+    };
+
+private: // methods
+
+    /// Read the frames whose queries have all finished, oldest first
+    void readFinishedFrames();
+
+    /// Make the results of a frame the latest and add them to the averages
+    void addResults(const std::vector<ScopeTiming>& results, uint64_t frameNumber);
+
+    /// Take a query object from the pool, creating one if it's empty
+    GLuint getQuery();
+
+private: // data members
+
+    bool mHasGpuTiming = false;
+    /// Only the EXT entry point reads 64 bit results on GLES
+    PFNGLGETQUERYOBJECTUI64VEXTPROC mGetQueryObjectui64v = nullptr;
+
+    /// Scopes of the frame being recorded, the last one may still be open
+    std::vector<Scope> mCurrentFrame;
+    bool mIsScopeOpen = false;
+
+    /// Frames ended but not yet read, oldest first
+    std::deque<Frame> mPendingFrames;
+    /// Query objects free for reuse
+    std::vector<GLuint> mFreeQueries;
+
+    uint64_t mFrameNumber = 0;
+
+    std::vector<ScopeTiming> mLastResults;
+    uint64_t mLastResultsFrameNumber = 0;
+    std::vector<ScopeTiming> mTotals;
+    unsigned int mNumTotalFrames = 0;
+};
+
+#endif //_VUFORIA_GLESGPUTIMER_H_
@@ -0,0 +1,177 @@
+/*===============================================================================
+Copyright (c) 2020 PTC Inc. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "GLESMultiviewTarget.h"
+
+#include <Log.h>
+
+#include <EGL/egl.h>
+
+#include <cstring>
+
+#include "GLESRecordedCalls.h"
+
+
+namespace
+{
+    /// Attach all layers of texture as the views of the draw framebuffer.
+    /// The call goes through a pointer, so it is recorded here rather than by GLESRecordedCalls.
+    void attachViews(PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC framebufferTextureMultiview, GLenum attachment,
+                     GLuint texture)
+    {
+        framebufferTextureMultiview(GL_DRAW_FRAMEBUFFER, attachment, texture, 0, 0, GLESMultiviewTarget::NUM_VIEWS);
+#ifdef VUFORIA_RECORD_GL_COMMANDS
+        if (auto recorder = GLESCommandRecorder::getActive())
+        {
+            recorder->write(GLESCommandFormat::OP_FRAMEBUFFER_TEXTURE_MULTIVIEW,
+                            { GL_DRAW_FRAMEBUFFER, attachment, texture, 0, 0, GLESMultiviewTarget::NUM_VIEWS });
+        }
+#endif
+    }
+}
+
+
+bool GLESMultiviewTarget::init()
+{
+    deinit();
+
+    const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    if (extensions == nullptr || std::strstr(extensions, "GL_OVR_multiview2") == nullptr)
+    {
+        LOG("GL_OVR_multiview2 isn't supported");
+        return false;
+    }
+
+    GLint maxViews = 0;
+    glGetIntegerv(GL_MAX_VIEWS_OVR, &maxViews);
+    if (maxViews < NUM_VIEWS)
+    {
+        LOG("GL_OVR_multiview2 supports %d views, %d are needed", maxViews, NUM_VIEWS);
+        return false;
+    }
+
+    mFramebufferTextureMultiview = reinterpret_cast<PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC>(
+        eglGetProcAddress("glFramebufferTextureMultiviewOVR"));
+    return mFramebufferTextureMultiview != nullptr;
+}
+
+
+void GLESMultiviewTarget::deinit()
+{
+    deleteLayers();
+    if (mFramebuffer != 0)
+    {
+        glDeleteFramebuffers(1, &mFramebuffer);
+        mFramebuffer = 0;
+    }
+    if (mResolveFramebuffer != 0)
+    {
+        glDeleteFramebuffers(1, &mResolveFramebuffer);
+        mResolveFramebuffer = 0;
+    }
+    mFramebufferTextureMultiview = nullptr;
+}
+
+
+bool GLESMultiviewTarget::resize(GLsizei width, GLsizei height)
+{
+    if (!isSupported())
+    {
+        return false;
+    }
+    if (width == mWidth && height == mHeight)
+    {
+        return true;
+    }
+
+    if (mFramebuffer == 0)
+    {
+        glGenFramebuffers(1, &mFramebuffer);
+        glGenFramebuffers(1, &mResolveFramebuffer);
+    }
+    GLint previousFramebuffer = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mFramebuffer);
+    bool created = createLayers(width, height);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousFramebuffer);
+    return created;
+}
+
+
+void GLESMultiviewTarget::bind()
+{
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &mPreviousFramebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mFramebuffer);
+}
+
+
+void GLESMultiviewTarget::resolve(const GLint viewports[NUM_VIEWS][4])
+{
+    // Depth isn't needed past the frame, so tiled GPUs needn't write it back to memory
+    const GLenum depthAttachment = GL_DEPTH_ATTACHMENT;
+    glInvalidateFramebuffer(GL_DRAW_FRAMEBUFFER, 1, &depthAttachment);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, mResolveFramebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mPreviousFramebuffer);
+    for (GLint layer = 0; layer < NUM_VIEWS; ++layer)
+    {
+        const GLint* viewport = viewports[layer];
+        glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, mColorTexture, 0, layer);
+        glBlitFramebuffer(0, 0, mWidth, mHeight,
+                          viewport[0], viewport[1], viewport[0] + viewport[2], viewport[1] + viewport[3],
+                          GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, mPreviousFramebuffer);
+}
+
+
+bool GLESMultiviewTarget::createLayers(GLsizei width, GLsizei height)
+{
+    deleteLayers();
+
+    // Immutable storage, as a multiview attachment can't be resized in place
+    glGenTextures(1, &mColorTexture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, mColorTexture);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, width, height, NUM_VIEWS);
+
+    glGenTextures(1, &mDepthTexture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, mDepthTexture);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT24, width, height, NUM_VIEWS);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    attachViews(mFramebufferTextureMultiview, GL_COLOR_ATTACHMENT0, mColorTexture);
+    attachViews(mFramebufferTextureMultiview, GL_DEPTH_ATTACHMENT, mDepthTexture);
+
+    GLenum status = glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        LOG("Error: multiview framebuffer of %dx%d is incomplete, status 0x%x", width, height, status);
+        deleteLayers();
+        return false;
+    }
+
+    mWidth = width;
+    mHeight = height;
+    return true;
+}
+
+
+void GLESMultiviewTarget::deleteLayers()
+{
+    if (mColorTexture != 0)
+    {
+        glDeleteTextures(1, &mColorTexture);
+        mColorTexture = 0;
+    }
+    if (mDepthTexture != 0)
+    {
+        glDeleteTextures(1, &mDepthTexture);
+        mDepthTexture = 0;
+    }
+    mWidth = 0;
+    mHeight = 0;
+}
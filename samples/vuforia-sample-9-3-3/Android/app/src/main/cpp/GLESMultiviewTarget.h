@@ -0,0 +1,71 @@
+/*===============================================================================
+Copyright (c) 2020 PTC Inc. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef _VUFORIA_GLESMULTIVIEWTARGET_H_
+#define _VUFORIA_GLESMULTIVIEWTARGET_H_
+
+#include <GLES3/gl31.h>
+#include <GLES2/gl2ext.h>
+
+
+/// Framebuffer rendering both eyes of a stereo frame in one pass with GL_OVR_multiview2.
+/**
+ * Color and depth are two-layer texture arrays attached with
+ * glFramebufferTextureMultiviewOVR, so each draw is broadcast to both layers
+ * with gl_ViewID_OVR telling the vertex shader which eye it is drawing.
+ * Layers can't be the default framebuffer, so once the frame is drawn
+ * resolve() blits each layer into its eye's viewport of the framebuffer that
+ * was bound before bind().
+ *
+ * Both eyes have to be the same size, the size of a layer.
+ */
+class GLESMultiviewTarget
+{
+public:
+    /// Layer 0 is the left eye, layer 1 the right
+    static constexpr GLsizei NUM_VIEWS = 2;
+
+    /// Check for GL_OVR_multiview2, returns false if it isn't supported
+    bool init();
+    /// Delete the framebuffers and textures
+    void deinit();
+
+    bool isSupported() const { return mFramebufferTextureMultiview != nullptr; }
+
+    /// Create or resize the layers to width x height, before any draws of the
+    /// frame are queued. Returns false if the framebuffer is incomplete.
+    bool resize(GLsizei width, GLsizei height);
+
+    /// Bind the framebuffer for drawing, with the layers resize made
+    void bind();
+
+    /// Copy each layer to viewports[layer], given as x, y, width and height, of
+    /// the framebuffer that was bound before bind, then bind that one again
+    void resolve(const GLint viewports[NUM_VIEWS][4]);
+
+private: // methods
+
+    bool createLayers(GLsizei width, GLsizei height);
+    void deleteLayers();
+
+private: // data members
+
+    PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC mFramebufferTextureMultiview = nullptr;
+
+    /// Multiview framebuffer drawn to, and the one each layer is read through in resolve
+    GLuint mFramebuffer = 0;
+    GLuint mResolveFramebuffer = 0;
+
+    GLuint mColorTexture = 0;
+    GLuint mDepthTexture = 0;
+    GLsizei mWidth = 0;
+    GLsizei mHeight = 0;
+
+    GLint mPreviousFramebuffer = 0;
+};
+
+#endif //_VUFORIA_GLESMULTIVIEWTARGET_H_
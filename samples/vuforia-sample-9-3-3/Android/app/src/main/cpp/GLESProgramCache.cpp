@@ -0,0 +1,351 @@
+/*===============================================================================
+Copyright (c) 2020 PTC Inc. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "GLESProgramCache.h"
+
+#include <Log.h>
+
+#include <EGL/egl.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "GLESRecordedCalls.h"
+
+
+namespace
+{
+    /// Start of a cache file, bump the last character when the layout changes
+    constexpr char CACHE_FILE_MAGIC[4] = { 'V', 'P', 'C', '1' };
+
+    constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+    constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+    /// Fold bytes into a 64-bit FNV-1a hash
+    uint64_t hashBytes(uint64_t hash, const void* bytes, size_t size)
+    {
+        auto data = static_cast<const unsigned char*>(bytes);
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= data[i];
+            hash *= FNV_PRIME;
+        }
+        return hash;
+    }
+
+    /// Fold a string and its terminator into a hash, so "ab" + "c" differs from "a" + "bc"
+    uint64_t hashString(uint64_t hash, const char* string)
+    {
+        if (string == nullptr)
+        {
+            string = "";
+        }
+        return hashBytes(hash, string, std::strlen(string) + 1);
+    }
+
+    /// Let the driver compile on as many threads as it likes, if it supports KHR_parallel_shader_compile
+    void enableParallelCompile()
+    {
+        GLint numExtensions = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+        for (GLint i = 0; i < numExtensions; ++i)
+        {
+            auto extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            if (extension != nullptr && std::strcmp(extension, "GL_KHR_parallel_shader_compile") == 0)
+            {
+                typedef void (GL_APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+                auto maxShaderCompilerThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(
+                    eglGetProcAddress("glMaxShaderCompilerThreadsKHR"));
+                if (maxShaderCompilerThreads != nullptr)
+                {
+                    maxShaderCompilerThreads(0xFFFFFFFF);
+                }
+                return;
+            }
+        }
+    }
+
+    void logShaderError(GLuint shader, const char* type)
+    {
+        GLint compiled = GL_FALSE;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+        if (compiled == GL_TRUE)
+        {
+            return;
+        }
+
+        GLint logLength = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
+        std::vector<char> log(static_cast<size_t>(std::max(logLength, 1)));
+        glGetShaderInfoLog(shader, static_cast<GLsizei>(log.size()), nullptr, log.data());
+        LOG("Error: Could not compile %s shader: %s", type, log.data());
+    }
+
+    void logProgramError(GLuint program)
+    {
+        GLint logLength = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
+        std::vector<char> log(static_cast<size_t>(std::max(logLength, 1)));
+        glGetProgramInfoLog(program, static_cast<GLsizei>(log.size()), nullptr, log.data());
+        LOG("Error: Could not link program: %s", log.data());
+    }
+
+    template<typename T>
+    bool readValue(std::FILE* file, T& value)
+    {
+        return std::fread(&value, sizeof(value), 1, file) == 1;
+    }
+
+    template<typename T>
+    bool writeValue(std::FILE* file, const T& value)
+    {
+        return std::fwrite(&value, sizeof(value), 1, file) == 1;
+    }
+}
+
+
+void GLESProgramCache::setPath(const std::string& path)
+{
+    if (path != mPath)
+    {
+        mPath = path;
+        mLoaded = false;
+    }
+}
+
+
+bool GLESProgramCache::createPrograms(const ProgramSource* sources, size_t numSources, GLuint* programs)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    mLastStats = Stats();
+
+    uint64_t driverHash = FNV_OFFSET_BASIS;
+    driverHash = hashString(driverHash, reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+    driverHash = hashString(driverHash, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    driverHash = hashString(driverHash, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+    if (driverHash != mDriverHash)
+    {
+        mDriverHash = driverHash;
+        mBinaries.clear();
+        mLoaded = false;
+    }
+    if (!mLoaded)
+    {
+        load();
+        mLoaded = true;
+    }
+
+    // A program being compiled
+    struct PendingProgram
+    {
+        size_t index;
+        uint64_t key;
+        GLuint vertexShader;
+        GLuint fragmentShader;
+    };
+    std::vector<PendingProgram> pendingPrograms;
+
+    for (size_t i = 0; i < numSources; ++i)
+    {
+        uint64_t key = hashString(mDriverHash, sources[i].vertexShader);
+        key = hashString(key, sources[i].fragmentShader);
+
+        programs[i] = glCreateProgram();
+
+        // A recording is replayed on other drivers, which can't load this one's binaries
+        auto binary = GLESCommandRecorder::getActive() == nullptr ? mBinaries.find(key) : mBinaries.end();
+        if (binary != mBinaries.end())
+        {
+            glProgramBinary(programs[i], binary->second.format, binary->second.data.data(),
+                            static_cast<GLsizei>(binary->second.data.size()));
+            GLint linked = GL_FALSE;
+            glGetProgramiv(programs[i], GL_LINK_STATUS, &linked);
+            if (linked == GL_TRUE)
+            {
+                ++mLastStats.numLoaded;
+                continue;
+            }
+
+            // The driver can refuse a binary it wrote, e.g. after an update that kept its version string
+            LOG("Program binary rejected, compiling from source");
+            mBinaries.erase(binary);
+            glDeleteProgram(programs[i]);
+            programs[i] = glCreateProgram();
+        }
+
+        pendingPrograms.push_back({ i, key, 0, 0 });
+    }
+
+    if (!pendingPrograms.empty())
+    {
+        enableParallelCompile();
+    }
+
+    // Issue everything before reading any status, which would wait for that compile to finish
+    for (PendingProgram& pending : pendingPrograms)
+    {
+        const ProgramSource& source = sources[pending.index];
+        GLuint program = programs[pending.index];
+
+        pending.vertexShader = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(pending.vertexShader, 1, &source.vertexShader, nullptr);
+        glCompileShader(pending.vertexShader);
+        pending.fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(pending.fragmentShader, 1, &source.fragmentShader, nullptr);
+        glCompileShader(pending.fragmentShader);
+
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glAttachShader(program, pending.vertexShader);
+        glAttachShader(program, pending.fragmentShader);
+        glLinkProgram(program);
+    }
+
+    bool success = true;
+    bool binariesAdded = false;
+    for (PendingProgram& pending : pendingPrograms)
+    {
+        GLuint& program = programs[pending.index];
+
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (linked == GL_TRUE)
+        {
+            ++mLastStats.numCompiled;
+
+            GLint binaryLength = 0;
+            glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+            if (binaryLength > 0)
+            {
+                Binary& binary = mBinaries[pending.key];
+                binary.data.resize(static_cast<size_t>(binaryLength));
+                glGetProgramBinary(program, binaryLength, nullptr, &binary.format, binary.data.data());
+                binariesAdded = true;
+            }
+        }
+        else
+        {
+            logShaderError(pending.vertexShader, "vertex");
+            logShaderError(pending.fragmentShader, "fragment");
+            logProgramError(program);
+            glDeleteProgram(program);
+            program = 0;
+            success = false;
+        }
+
+        // The program keeps what it needs, the shaders go once it stops referencing them
+        glDeleteShader(pending.vertexShader);
+        glDeleteShader(pending.fragmentShader);
+    }
+
+    if (binariesAdded)
+    {
+        save();
+    }
+
+    mLastStats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    return success;
+}
+
+
+void GLESProgramCache::load()
+{
+    if (mPath.empty())
+    {
+        return;
+    }
+
+    std::FILE* file = std::fopen(mPath.c_str(), "rb");
+    if (file == nullptr)
+    {
+        // Nothing saved yet
+        return;
+    }
+
+    char magic[sizeof(CACHE_FILE_MAGIC)];
+    uint64_t driverHash = 0;
+    uint32_t numBinaries = 0;
+    if (!readValue(file, magic) || std::memcmp(magic, CACHE_FILE_MAGIC, sizeof(magic)) != 0 ||
+        !readValue(file, driverHash) || !readValue(file, numBinaries))
+    {
+        LOG("Error: Program cache %s is not valid, ignoring it", mPath.c_str());
+        std::fclose(file);
+        return;
+    }
+    if (driverHash != mDriverHash)
+    {
+        // Saved by another driver, none of it will match
+        std::fclose(file);
+        return;
+    }
+
+    std::map<uint64_t, Binary> binaries;
+    for (uint32_t i = 0; i < numBinaries; ++i)
+    {
+        uint64_t key = 0;
+        uint32_t format = 0;
+        uint32_t size = 0;
+        if (!readValue(file, key) || !readValue(file, format) || !readValue(file, size))
+        {
+            break;
+        }
+
+        Binary& binary = binaries[key];
+        binary.format = format;
+        binary.data.resize(size);
+        if (std::fread(binary.data.data(), 1, size, file) != size)
+        {
+            break;
+        }
+    }
+    std::fclose(file);
+
+    if (binaries.size() != numBinaries)
+    {
+        LOG("Error: Program cache %s is truncated, ignoring it", mPath.c_str());
+        return;
+    }
+    mBinaries.swap(binaries);
+}
+
+
+void GLESProgramCache::save() const
+{
+    if (mPath.empty())
+    {
+        return;
+    }
+
+    // Write alongside and rename over, so a crash mid-write can't leave a truncated cache
+    std::string tempPath = mPath + ".tmp";
+    std::FILE* file = std::fopen(tempPath.c_str(), "wb");
+    if (file == nullptr)
+    {
+        LOG("Error: Unable to create program cache %s", tempPath.c_str());
+        return;
+    }
+
+    bool written = writeValue(file, CACHE_FILE_MAGIC) && writeValue(file, mDriverHash) &&
+                   writeValue(file, static_cast<uint32_t>(mBinaries.size()));
+    for (const auto& keyBinary : mBinaries)
+    {
+        const Binary& binary = keyBinary.second;
+        written = written &&
+                  writeValue(file, keyBinary.first) &&
+                  writeValue(file, static_cast<uint32_t>(binary.format)) &&
+                  writeValue(file, static_cast<uint32_t>(binary.data.size())) &&
+                  std::fwrite(binary.data.data(), 1, binary.data.size(), file) == binary.data.size();
+    }
+    written = std::fclose(file) == 0 && written;
+
+    if (!written || std::rename(tempPath.c_str(), mPath.c_str()) != 0)
+    {
+        LOG("Error: Unable to write program cache %s", mPath.c_str());
+        std::remove(tempPath.c_str());
+    }
+}
@@ -0,0 +1,86 @@
+/*===============================================================================
+Copyright (c) 2020 PTC Inc. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef _VUFORIA_GLESPROGRAMCACHE_H_
+#define _VUFORIA_GLESPROGRAMCACHE_H_
+
+#include <GLES3/gl31.h>
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+
+/// Creates shader programs from binaries saved by an earlier run where it can.
+/**
+ * Binaries are keyed on a hash of the shader sources and the GL vendor,
+ * renderer and version strings, so a driver update or a shader change just
+ * misses the cache. A binary the driver rejects is dropped and the program
+ * compiled from source instead.
+ *
+ * Binaries are kept in memory for a new GL context in the same process, and
+ * written to a file whenever a program had to be compiled.
+ *
+ * Programs that need compiling are compiled together, with every compile and
+ * link issued before any status is read. With KHR_parallel_shader_compile the
+ * driver can then spread them over its compiler threads.
+ */
+class GLESProgramCache
+{
+public:
+    /// Sources of one program
+    struct ProgramSource
+    {
+        const char* vertexShader;
+        const char* fragmentShader;
+    };
+
+    /// How the last createPrograms went
+    struct Stats
+    {
+        unsigned int numLoaded = 0;
+        unsigned int numCompiled = 0;
+        double ms = 0.0;
+    };
+
+    /// Set the file to keep binaries in, or an empty path to keep them in memory only
+    void setPath(const std::string& path);
+
+    /// Create a linked program for each source, from a cached binary if there is one.
+    /// programs[i] is 0 for each program that failed, and false is returned if any did.
+    bool createPrograms(const ProgramSource* sources, size_t numSources, GLuint* programs);
+
+    const Stats& getLastStats() const { return mLastStats; }
+
+private: // types
+    struct Binary
+    {
+        GLenum format = 0;
+        std::vector<unsigned char> data;
+    };
+
+private: // methods
+    /// Read the binaries in mPath, dropping them if they were saved by another driver
+    void load();
+
+    /// Write all binaries to mPath
+    void save() const;
+
+private: // data members
+    std::string mPath;
+    bool mLoaded = false;
+
+    /// Hash of the strings identifying the driver, 0 until a GL context is current
+    uint64_t mDriverHash = 0;
+    /// Binaries keyed on a hash of the driver and the sources
+    std::map<uint64_t, Binary> mBinaries;
+
+    Stats mLastStats;
+};
+
+#endif //_VUFORIA_GLESPROGRAMCACHE_H_
@@ -0,0 +1,87 @@
+/*===============================================================================
+Copyright (c) 2020 PTC Inc. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef _VUFORIA_GLESRECORDEDCALLS_H_
+#define _VUFORIA_GLESRECORDEDCALLS_H_
+
+// Include after every other header, in each source whose GL calls should be
+// recorded. In builds with VUFORIA_RECORD_GL_COMMANDS defined, the GL calls
+// that follow go through GLESRecordedCalls so that an open GLESCommandRecorder
+// records them. Other builds call GL directly.
+
+#include "GLESCommandRecorder.h"
+
+#ifdef VUFORIA_RECORD_GL_COMMANDS
+#define glActiveTexture GLESRecordedCalls::glActiveTexture
+#define glAttachShader GLESRecordedCalls::glAttachShader
+#define glBindBuffer GLESRecordedCalls::glBindBuffer
+#define glBindBufferRange GLESRecordedCalls::glBindBufferRange
+#define glBindFramebuffer GLESRecordedCalls::glBindFramebuffer
+#define glBindTexture GLESRecordedCalls::glBindTexture
+#define glBindVertexArray GLESRecordedCalls::glBindVertexArray
+#define glBindVertexBuffer GLESRecordedCalls::glBindVertexBuffer
+#define glBlendFunc GLESRecordedCalls::glBlendFunc
+#define glBlendFuncSeparate GLESRecordedCalls::glBlendFuncSeparate
+#define glBlitFramebuffer GLESRecordedCalls::glBlitFramebuffer
+#define glBufferData GLESRecordedCalls::glBufferData
+#define glBufferSubData GLESRecordedCalls::glBufferSubData
+#define glClear GLESRecordedCalls::glClear
+#define glClearBufferfv GLESRecordedCalls::glClearBufferfv
+#define glClearColor GLESRecordedCalls::glClearColor
+#define glClientWaitSync GLESRecordedCalls::glClientWaitSync
+#define glCompileShader GLESRecordedCalls::glCompileShader
+#define glCompressedTexSubImage3D GLESRecordedCalls::glCompressedTexSubImage3D
+#define glCreateProgram GLESRecordedCalls::glCreateProgram
+#define glCreateShader GLESRecordedCalls::glCreateShader
+#define glCullFace GLESRecordedCalls::glCullFace
+#define glDeleteBuffers GLESRecordedCalls::glDeleteBuffers
+#define glDeleteFramebuffers GLESRecordedCalls::glDeleteFramebuffers
+#define glDeleteProgram GLESRecordedCalls::glDeleteProgram
+#define glDeleteShader GLESRecordedCalls::glDeleteShader
+#define glDeleteSync GLESRecordedCalls::glDeleteSync
+#define glDeleteTextures GLESRecordedCalls::glDeleteTextures
+#define glDeleteVertexArrays GLESRecordedCalls::glDeleteVertexArrays
+#define glDisable GLESRecordedCalls::glDisable
+#define glDrawArrays GLESRecordedCalls::glDrawArrays
+#define glDrawArraysInstanced GLESRecordedCalls::glDrawArraysInstanced
+#define glDrawElements GLESRecordedCalls::glDrawElements
+#define glDrawElementsInstanced GLESRecordedCalls::glDrawElementsInstanced
+#define glEnable GLESRecordedCalls::glEnable
+#define glEnableVertexAttribArray GLESRecordedCalls::glEnableVertexAttribArray
+#define glFenceSync GLESRecordedCalls::glFenceSync
+#define glFlushMappedBufferRange GLESRecordedCalls::glFlushMappedBufferRange
+#define glFramebufferTexture2D GLESRecordedCalls::glFramebufferTexture2D
+#define glFramebufferTextureLayer GLESRecordedCalls::glFramebufferTextureLayer
+#define glFrontFace GLESRecordedCalls::glFrontFace
+#define glGenBuffers GLESRecordedCalls::glGenBuffers
+#define glGenFramebuffers GLESRecordedCalls::glGenFramebuffers
+#define glGenTextures GLESRecordedCalls::glGenTextures
+#define glGenVertexArrays GLESRecordedCalls::glGenVertexArrays
+#define glLineWidth GLESRecordedCalls::glLineWidth
+#define glLinkProgram GLESRecordedCalls::glLinkProgram
+#define glMapBufferRange GLESRecordedCalls::glMapBufferRange
+#define glPixelStorei GLESRecordedCalls::glPixelStorei
+#define glProgramParameteri GLESRecordedCalls::glProgramParameteri
+#define glScissor GLESRecordedCalls::glScissor
+#define glShaderSource GLESRecordedCalls::glShaderSource
+#define glTexImage2D GLESRecordedCalls::glTexImage2D
+#define glTexParameteri GLESRecordedCalls::glTexParameteri
+#define glTexStorage2D GLESRecordedCalls::glTexStorage2D
+#define glTexStorage3D GLESRecordedCalls::glTexStorage3D
+#define glTexSubImage3D GLESRecordedCalls::glTexSubImage3D
+#define glUniform1i GLESRecordedCalls::glUniform1i
+#define glUniform4f GLESRecordedCalls::glUniform4f
+#define glUnmapBuffer GLESRecordedCalls::glUnmapBuffer
+#define glUseProgram GLESRecordedCalls::glUseProgram
+#define glVertexAttribBinding GLESRecordedCalls::glVertexAttribBinding
+#define glVertexAttribFormat GLESRecordedCalls::glVertexAttribFormat
+#define glVertexAttribPointer GLESRecordedCalls::glVertexAttribPointer
+#define glVertexBindingDivisor GLESRecordedCalls::glVertexBindingDivisor
+#define glViewport GLESRecordedCalls::glViewport
+#endif
+
+#endif //_VUFORIA_GLESRECORDEDCALLS_H_
@@ -0,0 +1,260 @@
+/*===============================================================================
+Copyright (c) 2020 PTC Inc. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "GLESRenderQueue.h"
+
+#include <Log.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "GLESRecordedCalls.h"
+
+
+namespace
+{
+    constexpr unsigned int NUM_KEY_BYTES = sizeof(uint64_t);
+
+    /// Distance of the draw's origin from the camera, as 16 bits that sort like the distance
+    uint64_t quantizeDepth(GLfloat viewDepth)
+    {
+        float depth = std::max(viewDepth, 0.0f);
+
+        // The bits of a non-negative float sort like its value, keep the exponent and top of the mantissa
+        uint32_t bits;
+        std::memcpy(&bits, &depth, sizeof(bits));
+        return bits >> 16;
+    }
+}
+
+
+const char* GLESRenderQueue::getPassName(Pass pass)
+{
+    switch (pass)
+    {
+        case PASS_BACKGROUND:
+            return "Video background";
+        case PASS_OPAQUE:
+            return "Opaque";
+        case PASS_TRANSLUCENT:
+            return "Translucent";
+        default:
+            return "Overlay";
+    }
+}
+
+
+void GLESRenderQueue::clear()
+{
+    mCommands.clear();
+    mItems.clear();
+    mSorted = true;
+}
+
+
+void GLESRenderQueue::push(Pass pass, const DrawCommand& command)
+{
+    if (command.programRank > MAX_PROGRAM_RANK)
+    {
+        LOG("Error: program rank %u doesn't fit the sort key", command.programRank);
+        return;
+    }
+
+    mItems.push_back({ makeKey(pass, command), static_cast<uint32_t>(mCommands.size()) });
+    mCommands.push_back(command);
+    mSorted = false;
+}
+
+
+unsigned int GLESRenderQueue::submit(GLESStateCache& stateCache, GLuint streamBuffer, GLESGpuTimer* timer,
+                                     const SubmitOptions& options)
+{
+    if (!mSorted)
+    {
+        sortItems();
+        mSorted = true;
+    }
+
+    unsigned int numDrawCalls = 0;
+    // Past the last pass, so the first draw starts a scope
+    uint64_t currentPass = PASS_OVERLAY + 1;
+    for (const DrawItem& item : mItems)
+    {
+        const DrawCommand& command = mCommands[item.commandIndex];
+
+        uint64_t pass = item.key >> 62;
+        if (pass < options.firstPass || pass > options.lastPass)
+        {
+            continue;
+        }
+        if (timer != nullptr && pass != currentPass)
+        {
+            timer->beginScope(getPassName(static_cast<Pass>(pass)));
+            currentPass = pass;
+        }
+
+        stateCache.setEnabled(GL_DEPTH_TEST, (command.state & STATE_DEPTH_TEST) != 0);
+        stateCache.setEnabled(GL_BLEND, (command.state & STATE_BLEND) != 0);
+        if ((command.state & STATE_BLEND) && options.accumulateAlpha)
+        {
+            stateCache.blendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        }
+        else if (command.state & STATE_BLEND)
+        {
+            stateCache.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        }
+        stateCache.setEnabled(GL_CULL_FACE, (command.state & STATE_CULL_FACE) != 0);
+        if (command.state & STATE_CULL_FACE)
+        {
+            stateCache.cullFace(GL_BACK);
+            stateCache.frontFace(GL_CCW);
+        }
+        stateCache.setEnabled(GL_SCISSOR_TEST, (command.state & STATE_SCISSOR_TEST) != 0);
+        if (command.state & STATE_SCISSOR_TEST)
+        {
+            stateCache.scissor(command.scissorBox[0], command.scissorBox[1],
+                               command.scissorBox[2], command.scissorBox[3]);
+        }
+
+        stateCache.useProgram(command.program);
+        stateCache.bindVertexArray(command.vertexArray);
+        if (command.instanceCount > 0)
+        {
+            // Part of the vertex array's state, so set for every instanced draw
+            glBindVertexBuffer(INSTANCE_BUFFER_BINDING, streamBuffer, command.instanceOffset, sizeof(InstanceData));
+        }
+        if (command.texture != 0)
+        {
+            stateCache.bindTexture(0, command.texture, command.textureTarget);
+        }
+        if (command.mode == GL_LINES)
+        {
+            stateCache.lineWidth(std::max(command.lineWidth * options.lineWidthScale, 1.0f));
+        }
+
+        stateCache.bindUniformBufferRange(VIEW_CONSTANTS_BINDING, streamBuffer,
+                                          command.viewConstantsOffset + options.viewConstantsOffset,
+                                          options.viewConstantsSize);
+        if (command.instanceCount == 0)
+        {
+            stateCache.bindUniformBufferRange(OBJECT_CONSTANTS_BINDING, streamBuffer,
+                                              command.objectConstantsOffset, sizeof(ObjectConstants));
+        }
+        if (command.samplerLocation != -1)
+        {
+            glUniform1i(command.samplerLocation, command.samplerUnit);
+        }
+
+        const GLvoid* indices = reinterpret_cast<const GLvoid*>(command.firstIndex * sizeof(unsigned short));
+        if (command.instanceCount > 0)
+        {
+            glDrawElementsInstanced(command.mode, command.count, GL_UNSIGNED_SHORT, indices,
+                                    command.instanceCount * options.instancesPerView);
+        }
+        else if (options.instancesPerView > 1)
+        {
+            // One instance per view of a draw that has none of its own
+            if (command.firstIndex >= 0)
+            {
+                glDrawElementsInstanced(command.mode, command.count, GL_UNSIGNED_SHORT, indices,
+                                        options.instancesPerView);
+            }
+            else
+            {
+                glDrawArraysInstanced(command.mode, 0, command.count, options.instancesPerView);
+            }
+        }
+        else if (command.firstIndex >= 0)
+        {
+            glDrawElements(command.mode, command.count, GL_UNSIGNED_SHORT, indices);
+        }
+        else
+        {
+            glDrawArrays(command.mode, 0, command.count);
+        }
+        ++numDrawCalls;
+    }
+    if (timer != nullptr)
+    {
+        timer->endScope();
+    }
+
+    return numDrawCalls;
+}
+
+
+uint64_t GLESRenderQueue::makeKey(Pass pass, const DrawCommand& command)
+{
+    // Only the low bits of the object names go in the key. Names that collide
+    // just sort together, the command still binds the real object.
+    uint64_t materialBits =
+        (static_cast<uint64_t>(command.programRank) << 20) |
+        (static_cast<uint64_t>(command.state & 0xf) << 16) |
+        (static_cast<uint64_t>(command.texture & 0xff) << 8) |
+        static_cast<uint64_t>(command.vertexArray & 0xff);
+    uint64_t depthBits = quantizeDepth(command.viewDepth);
+
+    uint64_t key = static_cast<uint64_t>(pass) << 62;
+    if (pass == PASS_TRANSLUCENT)
+    {
+        // Farthest first
+        key |= (0xffff - depthBits) << 46;
+        key |= materialBits << 23;
+    }
+    else
+    {
+        key |= materialBits << 38;
+        key |= depthBits << 22;
+    }
+    return key;
+}
+
+
+void GLESRenderQueue::sortItems()
+{
+    if (mItems.size() < 2)
+    {
+        return;
+    }
+
+    // Count every digit in one sweep
+    size_t counts[NUM_KEY_BYTES][256] = {};
+    for (const DrawItem& item : mItems)
+    {
+        for (unsigned int digit = 0; digit < NUM_KEY_BYTES; ++digit)
+        {
+            ++counts[digit][(item.key >> (digit * 8)) & 0xff];
+        }
+    }
+
+    mSortBuffer.resize(mItems.size());
+    for (unsigned int digit = 0; digit < NUM_KEY_BYTES; ++digit)
+    {
+        size_t* digitCounts = counts[digit];
+
+        // A byte that is the same in every key doesn't change the order
+        uint8_t firstByte = (mItems.front().key >> (digit * 8)) & 0xff;
+        if (digitCounts[firstByte] == mItems.size())
+        {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (size_t& count : counts[digit])
+        {
+            size_t bucketSize = count;
+            count = offset;
+            offset += bucketSize;
+        }
+
+        for (const DrawItem& item : mItems)
+        {
+            mSortBuffer[digitCounts[(item.key >> (digit * 8)) & 0xff]++] = item;
+        }
+        mItems.swap(mSortBuffer);
+    }
+}
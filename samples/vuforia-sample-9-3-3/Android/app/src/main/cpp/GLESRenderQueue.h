@@ -0,0 +1,217 @@
+/*===============================================================================
+Copyright (c) 2020 PTC Inc. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef _VUFORIA_GLESRENDERQUEUE_H_
+#define _VUFORIA_GLESRENDERQUEUE_H_
+
+#include <GLES3/gl31.h>
+
+#include "GLESGpuTimer.h"
+#include "GLESStateCache.h"
+
+#include <cstdint>
+#include <vector>
+
+
+/// Per-frame list of draws, sorted to minimize state changes before submission.
+/**
+ * Draws are queued as a DrawCommand holding everything needed to issue them.
+ * Each gets a 64-bit sort key, and submit() radix sorts the keys and issues
+ * the draws in key order through a GLESStateCache.
+ *
+ * Per-view and per-object constants aren't set as uniforms but read from
+ * uniform blocks, with each command giving the offsets of its data in a
+ * stream buffer written ahead of submit(). Instanced draws take their
+ * per-object data from InstanceData vertex attributes in the same buffer.
+ *
+ * Key layout, most significant bits first:
+ *   pass (2 bits)
+ *   opaque passes:      program (3), state (4), texture (8), vertex array (8), depth front to back (16)
+ *   translucent pass:   depth back to front (16), program (3), state (4), texture (8), vertex array (8)
+ *
+ * Blended draws are sorted far to near so they composite correctly over each
+ * other and over the opaque scene. Draws with equal keys keep the order they
+ * were queued in, as the sort is stable.
+ */
+class GLESRenderQueue
+{
+public:
+    /// Passes are submitted in this order
+    enum Pass
+    {
+        /// Camera image, before any augmentation
+        PASS_BACKGROUND,
+        /// Augmentations without blending, grouped by state and drawn near to far
+        PASS_OPAQUE,
+        /// Blended augmentations, drawn far to near after the opaque ones
+        PASS_TRANSLUCENT,
+        /// Screen aligned guidance drawn over everything
+        PASS_OVERLAY,
+    };
+
+    /// Bits of DrawCommand::state
+    enum StateFlags : uint8_t
+    {
+        STATE_DEPTH_TEST = 1 << 0,
+        /// Alpha blending with GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA
+        STATE_BLEND = 1 << 1,
+        /// Back face culling with counter-clockwise front faces
+        STATE_CULL_FACE = 1 << 2,
+        /// Clip to DrawCommand::scissorBox
+        STATE_SCISSOR_TEST = 1 << 3,
+    };
+
+    /// Programs are ranked by the queue's caller, which keeps the key to 3 bits
+    static constexpr unsigned int MAX_PROGRAM_RANK = 7;
+
+    /// Uniform buffer binding points of the ViewConstants and ObjectConstants blocks
+    static constexpr GLuint VIEW_CONSTANTS_BINDING = 0;
+    static constexpr GLuint OBJECT_CONSTANTS_BINDING = 1;
+
+    /// std140 layout of the ViewConstants uniform block, shared by draws with the same projection
+    struct ViewConstants
+    {
+        GLfloat projectionMatrix[16];
+    };
+
+    /// Eyes of a stereo frame, left then right
+    static constexpr unsigned int NUM_STEREO_VIEWS = 2;
+
+    /// std140 layout of the ViewConstants uniform block in programs that draw every eye at once
+    struct StereoViewConstants
+    {
+        GLfloat projectionMatrices[NUM_STEREO_VIEWS][16];
+    };
+
+    /// std140 layout of the ObjectConstants uniform block
+    struct ObjectConstants
+    {
+        GLfloat modelViewMatrix[16];
+        GLfloat color[4];
+        /// Array layer, then the first and last level to sample, for FEATURE_TEXTURE_ARRAY
+        GLfloat textureLayer[4];
+    };
+
+    /// Vertex buffer binding index of the instance data, above any the per-vertex
+    /// attributes can take with glVertexAttribPointer
+    static constexpr GLuint INSTANCE_BUFFER_BINDING = 15;
+
+    /// Per-instance vertex attributes of an instanced draw
+    struct InstanceData
+    {
+        GLfloat modelViewMatrix[16];
+        GLfloat color[4];
+        /// xyz scale applied before modelViewMatrix, w is padding
+        GLfloat scale[4];
+    };
+
+    /// Everything needed to issue one draw
+    struct DrawCommand
+    {
+        GLuint program = 0;
+        /// Position of the program in the sort, up to MAX_PROGRAM_RANK
+        unsigned int programRank = 0;
+        GLuint vertexArray = 0;
+        /// Texture to bind to unit 0, or 0 to leave the bindings alone
+        GLuint texture = 0;
+        /// GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY
+        GLenum textureTarget = GL_TEXTURE_2D;
+        uint8_t state = 0;
+        GLfloat lineWidth = 1.0f;
+        /// x, y, width and height in window pixels, for STATE_SCISSOR_TEST
+        GLint scissorBox[4] = {};
+
+        /// GL_TRIANGLES or GL_LINES
+        GLenum mode = GL_TRIANGLES;
+        GLsizei count = 0;
+        /// First index into the bound element array, or -1 to draw arrays
+        GLint firstIndex = 0;
+
+        /// Distance of the draw's origin from the camera, for ordering within a pass
+        GLfloat viewDepth = 0.0f;
+        /// Where the draw's ViewConstants and ObjectConstants are in the stream buffer
+        GLintptr viewConstantsOffset = 0;
+        GLintptr objectConstantsOffset = 0;
+
+        /// Number of instances, 0 for a draw that uses ObjectConstants instead
+        GLsizei instanceCount = 0;
+        /// Where the draw's InstanceData array is in the stream buffer
+        GLintptr instanceOffset = 0;
+
+        /// Sampler uniform, skipped if the location is -1
+        GLint samplerLocation = -1;
+        GLint samplerUnit = 0;
+    };
+
+    /// How submit issues the draws, the defaults suiting a frame with a single view
+    struct SubmitOptions
+    {
+        /// Bytes of ViewConstants bound for each draw, sizeof(StereoViewConstants) for
+        /// programs that draw every eye at once
+        GLsizeiptr viewConstantsSize = sizeof(ViewConstants);
+        /// Added to each command's viewConstantsOffset, to read another eye's constants
+        /// when the eyes are drawn in turn
+        GLintptr viewConstantsOffset = 0;
+        /// Instances drawn for each one a command asks for, NUM_STEREO_VIEWS for
+        /// programs that draw an eye per instance
+        GLsizei instancesPerView = 1;
+        /// Passes to issue, so that passes can go to different framebuffers
+        Pass firstPass = PASS_BACKGROUND;
+        Pass lastPass = PASS_OVERLAY;
+        /// For a target cleared to transparent and later composited with premultiplied
+        /// alpha: blended draws also add their coverage to the target's alpha
+        bool accumulateAlpha = false;
+        /// Multiplies the width of lines, for a target drawn at a fraction of the resolution
+        GLfloat lineWidthScale = 1.0f;
+    };
+
+    /// Drop all queued draws
+    void clear();
+
+    /// Queue a draw for the next submit
+    void push(Pass pass, const DrawCommand& command);
+
+    size_t size() const { return mItems.size(); }
+
+    /// Name of the GPU timer scope a pass is timed as
+    static const char* getPassName(Pass pass);
+
+    /// Sort the queued draws and issue them with their constants read from
+    /// streamBuffer. Returns the number of draw calls made. The draws stay queued
+    /// until clear, so the eyes of a stereo frame can be submitted in turn.
+    /// With a timer, each pass that has draws is timed as a scope named after it.
+    unsigned int submit(GLESStateCache& stateCache, GLuint streamBuffer, GLESGpuTimer* timer,
+                        const SubmitOptions& options);
+    unsigned int submit(GLESStateCache& stateCache, GLuint streamBuffer, GLESGpuTimer* timer = nullptr)
+    {
+        return submit(stateCache, streamBuffer, timer, SubmitOptions());
+    }
+
+private: // types
+    /// What gets sorted, the command itself stays where it was queued
+    struct DrawItem
+    {
+        uint64_t key;
+        uint32_t commandIndex;
+    };
+
+private: // methods
+    static uint64_t makeKey(Pass pass, const DrawCommand& command);
+
+    /// Stable least significant digit radix sort of mItems on key, a byte at a time
+    void sortItems();
+
+private: // data members
+    std::vector<DrawCommand> mCommands;
+    std::vector<DrawItem> mItems;
+    /// Scratch space for sortItems, kept to avoid reallocating every frame
+    std::vector<DrawItem> mSortBuffer;
+    /// Whether mItems is in key order, so submitting again doesn't sort again
+    bool mSorted = true;
+};
+
+#endif //_VUFORIA_GLESRENDERQUEUE_H_
@@ -8,7 +8,7 @@ countries.
 #include "GLESRenderer.h"
 
 #include "GLESUtils.h"
-#include "Shaders.h"
+#include "GLESShaderPermutations.h"
 
 #include <MathUtils.h>
 #include <Models.h>
@@ -16,55 +16,186 @@ countries.
 
 #include <android/asset_manager.h>
 
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "GLESRecordedCalls.h"
+
+
+namespace
+{
+    /// How often to log the average frame stats, in frames
+    constexpr unsigned int FRAME_STATS_INTERVAL = 300;
+
+    /// Order of the programs within a pass of the render queue
+    enum ProgramRank : unsigned int
+    {
+        RANK_VIDEO_BACKGROUND,
+        RANK_UNIFORM_COLOR,
+        RANK_VERTEX_COLOR,
+        RANK_TEXTURE_ARRAY_UNIFORM_COLOR,
+    };
+
+    /// Bytes of uniform and instance data each frame can write, enough for about
+    /// a thousand augmentations
+    constexpr GLsizeiptr STREAM_RING_REGION_SIZE = 512 * 1024;
+
+    /// Bytes of texture mip levels to upload per frame, about 15 MB/s at 60 fps
+    constexpr GLsizeiptr TEXTURE_STREAM_BUDGET = 256 * 1024;
+
+    /// Program binaries saved between runs, in the directory given to setCacheDirectory
+    constexpr char PROGRAM_CACHE_FILE[] = "program_cache.bin";
+
+    /// GL command recordings for Tools/GLCommandReplayer, in the same directory
+    constexpr char COMMAND_RECORDING_FILE[] = "gl_commands.vgl";
+
+    /// GPU timer scope of clearing the resolution scaling target, counted as scaled work
+    constexpr char SCALED_CLEAR_SCOPE[] = "Scaled clear";
+
+    /// Compressed textures made by Tools/TextureEncoder, used in place of the PNGs when present
+    constexpr char ASTRONAUT_COMPRESSED_TEXTURE[] = "astronaut.ktx2";
+    constexpr char LANDER_COMPRESSED_TEXTURE[] = "lander.ktx2";
+    constexpr char ASTRONAUT_TEXTURE[] = "astronaut.png";
+    constexpr char LANDER_TEXTURE[] = "lander.png";
+
+    /// Create the program of every permutation with addedFeatures on top of its own
+    bool createPermutationPrograms(GLESProgramCache& programCache, uint32_t addedFeatures,
+                                   GLuint programs[NUM_SHADER_PERMUTATIONS])
+    {
+        std::vector<std::string> shaderSources;
+        for (uint32_t features : SHADER_PERMUTATION_FEATURES)
+        {
+            shaderSources.push_back(GLESShaderPermutations::getSource(GL_VERTEX_SHADER, features | addedFeatures));
+            shaderSources.push_back(GLESShaderPermutations::getSource(GL_FRAGMENT_SHADER, features | addedFeatures));
+        }
+        GLESProgramCache::ProgramSource programSources[NUM_SHADER_PERMUTATIONS];
+        for (size_t i = 0; i < NUM_SHADER_PERMUTATIONS; ++i)
+        {
+            programSources[i] = { shaderSources[i * 2].c_str(), shaderSources[i * 2 + 1].c_str() };
+        }
+        bool programsCreated = programCache.createPrograms(programSources, NUM_SHADER_PERMUTATIONS, programs);
+        const GLESProgramCache::Stats& programStats = programCache.getLastStats();
+        LOG("Shader setup took %.2f ms, %u programs loaded from binaries, %u compiled",
+            programStats.ms, programStats.numLoaded, programStats.numCompiled);
+        return programsCreated;
+    }
+
+    /// Squeeze a projection into the left or right half of clip space, for an eye
+    /// drawn into its half of a viewport covering both eyes: x becomes (x -/+ w) / 2
+    void squeezeIntoHalf(GLfloat* projectionMatrix, bool rightHalf)
+    {
+        const GLfloat sign = rightHalf ? 1.0f : -1.0f;
+        for (int column = 0; column < 4; ++column)
+        {
+            GLfloat* element = projectionMatrix + column * 4;
+            element[0] = 0.5f * (element[0] + sign * element[3]);
+        }
+    }
+
+    /// Clip space w of the model's origin, the projection's last row dotted with the translation
+    GLfloat getViewDepth(const GLfloat* projectionMatrix, const GLfloat* modelViewMatrix)
+    {
+        GLfloat depth = 0.0f;
+        for (int i = 0; i < 4; ++i)
+        {
+            depth += projectionMatrix[i * 4 + 3] * modelViewMatrix[12 + i];
+        }
+        return depth;
+    }
+}
+
+
+void GLESRenderer::setCacheDirectory(const std::string& directory)
+{
+    mCacheDirectory = directory;
+    mProgramCache.setPath(directory.empty() ? "" : directory + "/" + PROGRAM_CACHE_FILE);
+}
+
+
+bool GLESRenderer::startCommandRecording(unsigned int numFrames)
+{
+#ifdef VUFORIA_RECORD_GL_COMMANDS
+    if (mCacheDirectory.empty())
+    {
+        LOG("Error: No directory to record GL commands to");
+        return false;
+    }
+    if (!mCommandRecorder.open(mCacheDirectory + "/" + COMMAND_RECORDING_FILE, numFrames))
+    {
+        return false;
+    }
+    if (mSurfaceWidth > 0)
+    {
+        mCommandRecorder.setSurfaceSize(mSurfaceWidth, mSurfaceHeight);
+    }
+    return true;
+#else
+    (void)numFrames;
+    LOG("Error: GL command recording isn't built in, see VUFORIA_RECORD_GL_COMMANDS");
+    return false;
+#endif
+}
+
+
 bool GLESRenderer::init(AAssetManager* assetManager)
 {
-    // Setup for Video Background rendering
-    mVbShaderProgramID =
-        GLESUtils::createProgramFromBuffer(textureVertexShaderSrc, textureFragmentShaderSrc);
-    mVbVertexPositionHandle =
-        glGetAttribLocation(mVbShaderProgramID, "vertexPosition");
-    mVbTextureCoordHandle =
-        glGetAttribLocation(mVbShaderProgramID, "vertexTextureCoord");
-    mVbMvpMatrixHandle =
-        glGetUniformLocation(mVbShaderProgramID, "modelViewProjectionMatrix");
-    mVbTexSampler2DHandle =
-        glGetUniformLocation(mVbShaderProgramID, "texSampler2D");
-
-    // Setup for augmentation rendering
-    mUniformColorShaderProgramID =
-        GLESUtils::createProgramFromBuffer(uniformColorVertexShaderSrc, uniformColorFragmentShaderSrc);
-    mUniformColorVertexPositionHandle =
-        glGetAttribLocation(mUniformColorShaderProgramID, "vertexPosition");
-    mUniformColorMvpMatrixHandle =
-        glGetUniformLocation(mUniformColorShaderProgramID, "modelViewProjectionMatrix");
-    mUniformColorColorHandle =
-        glGetUniformLocation(mUniformColorShaderProgramID, "uniformColor");
-
-    // Setup for guide view rendering
-    mTextureUniformColorShaderProgramID =
-        GLESUtils::createProgramFromBuffer(textureColorVertexShaderSrc, textureColorFragmentShaderSrc);
-    mTextureUniformColorVertexPositionHandle =
-        glGetAttribLocation(mTextureUniformColorShaderProgramID, "vertexPosition");
-    mTextureUniformColorTextureCoordHandle =
-        glGetAttribLocation(mTextureUniformColorShaderProgramID, "vertexTextureCoord");
-    mTextureUniformColorMvpMatrixHandle =
-        glGetUniformLocation(mTextureUniformColorShaderProgramID, "modelViewProjectionMatrix");
-    mTextureUniformColorTexSampler2DHandle =
-        glGetUniformLocation(mTextureUniformColorShaderProgramID, "texSampler2D");
-    mTextureUniformColorColorHandle =
-        glGetUniformLocation(mTextureUniformColorShaderProgramID, "uniformColor");
-
-    // Setup for axis rendering
-    mVertexColorShaderProgramID =
-        GLESUtils::createProgramFromBuffer(vertexColorVertexShaderSrc, vertexColorFragmentShaderSrc);
-    mVertexColorVertexPositionHandle
-        = glGetAttribLocation(mVertexColorShaderProgramID, "vertexPosition");
-    mVertexColorColorHandle
-        = glGetAttribLocation(mVertexColorShaderProgramID, "vertexColor");
-    mVertexColorMvpMatrixHandle
-        = glGetUniformLocation(mVertexColorShaderProgramID, "modelViewProjectionMatrix");
-
-    mModelTargetGuideViewTextureUnit = -1;
+    // Nothing left from before is valid in this context, whether it was deinitialized or lost
+    abandonContextObjects();
+
+    // Create the shader permutations together, from binaries saved by an earlier run where possible
+    if (!createPermutationPrograms(mProgramCache, 0, mPrograms))
+    {
+        return false;
+    }
+    // Stereo frames are drawn in two passes if the programs for the mode asked for can't be created
+    createStereoPrograms();
+
+    if (!mStreamRing.init(STREAM_RING_REGION_SIZE) || !mTextureStreamer.init(TEXTURE_STREAM_BUDGET))
+    {
+        return false;
+    }
+    // Falls back to CPU times alone without the extension
+    mGpuTimer.init();
+    if (mResolutionScaling)
+    {
+        createScaledTarget();
+    }
+
+    // The compressed textures may be missing or unsupported, then the PNGs are used instead.
+    // The astronaut's is the bigger, so goes first to make room for the lander's levels in its array.
+    loadCompressedTexture(assetManager, ASTRONAUT_COMPRESSED_TEXTURE, mAstronautTexture);
+    if (!mAstronautTexture.isValid())
+    {
+        createImageTexture(assetManager, ASTRONAUT_TEXTURE, mAstronautImage, mAstronautTexture);
+    }
+    loadCompressedTexture(assetManager, LANDER_COMPRESSED_TEXTURE, mLanderTexture);
+    if (!mLanderTexture.isValid())
+    {
+        createImageTexture(assetManager, LANDER_TEXTURE, mLanderImage, mLanderTexture);
+    }
+    GLESTextureArrayAllocator::Stats textureStats = mTextureArrays.getStats();
+    LOG("Texture arrays: %u arrays, %u of %u layers used, %zu KB",
+        textureStats.numPages, textureStats.numLayersUsed, textureStats.numLayers, textureStats.bytes / 1024);
+
+    if (!loadModels(assetManager))
+    {
+        return false;
+    }
+
+    createStaticGeometry();
+    return true;
+}
+
+
+bool GLESRenderer::loadModels(AAssetManager* assetManager)
+{
+    if (mAstronautModel != nullptr && mAstronautModel->hasData() &&
+        mLanderModel != nullptr && mLanderModel->hasData())
+    {
+        // Already loaded and not yet uploaded, the models don't depend on the GL context
+        return true;
+    }
 
     std::vector<unsigned char> data; // for reading model files
 
@@ -73,382 +204,1286 @@ bool GLESRenderer::init(AAssetManager* assetManager)
     {
         return false;
     }
-    mAstronautModel = std::make_unique<Modelv3d>(data);
-    if (!mAstronautModel->isLoaded())
+    auto astronautModel = std::make_unique<Modelv3d>(data);
+    if (!astronautModel->isLoaded())
     {
         return false;
     }
     data.clear();
-    mAstronautTextureUnit = -1;
 
     // Load Lander model
     if (!readAsset(assetManager, "lander.v3d", data))
     {
         return false;
     }
-    mLanderModel = std::make_unique<Modelv3d>(data);
-    if (!mLanderModel->isLoaded())
+    auto landerModel = std::make_unique<Modelv3d>(data);
+    if (!landerModel->isLoaded())
     {
         return false;
     }
-    data.clear();
-    mLanderTextureUnit = -1;
 
+    mAstronautModel = std::move(astronautModel);
+    mLanderModel = std::move(landerModel);
     return true;
 }
 
 
 void GLESRenderer::deinit()
 {
-    if (mModelTargetGuideViewTextureUnit != -1)
+    mGuideViewTextures.clear();
+    mGuideViewGeneration = 0;
+    for (auto& generationBuffers : mVideoBackgroundBuffers)
     {
-        GLESUtils::destroyTexture(mModelTargetGuideViewTextureUnit);
-        mModelTargetGuideViewTextureUnit = -1;
+        destroyVideoBackgroundBuffers(generationBuffers.second);
     }
-    if (mAstronautTextureUnit != -1)
+    mVideoBackgroundBuffers.clear();
+    destroyStaticGeometry();
+    mStreamRing.deinit();
+    mGpuTimer.deinit();
+    mMultiviewTarget.deinit();
+    mScaledTarget.deinit();
+    // The next init creates the programs again, in what may be a new context
+    std::fill(std::begin(mPrograms), std::end(mPrograms), 0u);
+    std::fill(std::begin(mStereoPrograms), std::end(mStereoPrograms), 0u);
+    mStereoProgramFeature = 0;
+    // Deleting the arrays takes every texture with them
+    mTextureStreamer.deinit();
+    mTextureArrays.deinit();
+    mAstronautTexture = GLESTextureArrayAllocator::Allocation();
+    mLanderTexture = GLESTextureArrayAllocator::Allocation();
+}
+
+
+bool GLESRenderer::loadAstronautImage(AAssetManager* assetManager)
+{
+    return hasAsset(assetManager, ASTRONAUT_COMPRESSED_TEXTURE) ||
+           loadImage(assetManager, ASTRONAUT_TEXTURE, mAstronautImage);
+}
+
+
+bool GLESRenderer::loadLanderImage(AAssetManager* assetManager)
+{
+    return hasAsset(assetManager, LANDER_COMPRESSED_TEXTURE) ||
+           loadImage(assetManager, LANDER_TEXTURE, mLanderImage);
+}
+
+
+void GLESRenderer::setSurfaceSize(int width, int height)
+{
+    mSurfaceWidth = width;
+    mSurfaceHeight = height;
+    mCommandRecorder.setSurfaceSize(width, height);
+}
+
+
+void GLESRenderer::setViewport(const Vuforia::Vec4I& viewport)
+{
+    std::copy(viewport.data, viewport.data + 4, mViewport);
+    glViewport(mViewport[0], mViewport[1], mViewport[2], mViewport[3]);
+}
+
+
+bool GLESRenderer::setStereoMode(StereoMode mode)
+{
+    mStereoMode = mode;
+    if (!isInitialized())
     {
-        GLESUtils::destroyTexture(mAstronautTextureUnit);
-        mAstronautTextureUnit = -1;
+        // Not initialized, init creates the programs
+        return true;
     }
-    if (mLanderTextureUnit != -1)
+    return createStereoPrograms();
+}
+
+
+void GLESRenderer::setStereoViews(const StereoView& leftView, const StereoView& rightView)
+{
+    mIsStereoFrame = true;
+    mStereoViews[0] = leftView;
+    mStereoViews[1] = rightView;
+    // Nothing written so far is laid out for both eyes
+    mHasViewConstants = false;
+
+    const int* left = leftView.viewport.data;
+    const int* right = rightView.viewport.data;
+    bool isSameSize = left[2] == right[2] && left[3] == right[3];
+    bool isSideBySide = isSameSize && right[0] == left[0] + left[2] && right[1] == left[1];
+
+    mFrameStereoMode = mStereoMode;
+    if (mStereoProgramFeature == 0 ||
+        (mFrameStereoMode == STEREO_MULTIVIEW && !isSameSize) ||
+        (mFrameStereoMode == STEREO_INSTANCED && !isSideBySide))
     {
-        GLESUtils::destroyTexture(mLanderTextureUnit);
-        mLanderTextureUnit = -1;
+        mFrameStereoMode = STEREO_TWO_PASS;
+    }
+
+    // Decided before any draws are queued, as they are written for the mode the frame is drawn in
+    if (mFrameStereoMode == STEREO_MULTIVIEW && !mMultiviewTarget.resize(left[2], left[3]))
+    {
+        LOG("Error: Can't draw to the multiview target, drawing stereo frames in two passes");
+        mStereoMode = STEREO_TWO_PASS;
+        mFrameStereoMode = STEREO_TWO_PASS;
     }
 }
 
 
-void GLESRenderer::setAstronautTexture(int width, int height, unsigned char* bytes)
+void GLESRenderer::setResolutionScaling(bool enabled, GLESScaledTarget::Filter filter,
+                                        const ResolutionScaleController::Settings& settings)
 {
-    createTexture(width, height, bytes, mAstronautTextureUnit);
+    mResolutionScaling = enabled;
+    mUpscaleFilter = filter;
+    mResolutionScaleController.setSettings(settings);
+    mResolutionScaleController.reset();
+    if (!isInitialized())
+    {
+        // Not initialized, init creates the target
+        return;
+    }
+    if (enabled && !mScaledTarget.isInitialized())
+    {
+        createScaledTarget();
+    }
 }
 
 
-void GLESRenderer::setLanderTexture(int width, int height, unsigned char* bytes)
+void GLESRenderer::beginFrame()
 {
-    createTexture(width, height, bytes, mLanderTextureUnit);
+    mCommandRecorder.beginFrame();
+    mFrameStats = FrameStats();
+    mClearMask = GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT;
+    mIsStereoFrame = false;
+    mFrameStartTime = std::chrono::steady_clock::now();
+    mRenderQueue.clear();
+    mStateCache.resetCounters();
+    mGpuTimer.beginFrame();
+    updateResolutionScale();
+
+    if (mTextureStreamer.isStreaming())
+    {
+        mGpuTimer.beginScope("Texture streaming");
+        size_t streamedBytes = mTextureStreamer.update();
+        mGpuTimer.endScope();
+        if (streamedBytes > 0)
+        {
+            mFrameStats.uploadedBytes += streamedBytes;
+            mStateCache.invalidateTextures();
+        }
+    }
+
+    mStreamRing.beginFrame();
+    mHasViewConstants = false;
+    for (InstanceBatch* batch : { &mSquareBatch, &mSquareOutlineBatch, &mCubeBatch, &mAxisBatch })
+    {
+        batch->instances.clear();
+    }
+}
+
+
+void GLESRenderer::endFrame()
+{
+    // Vuforia may have changed GL state since the last frame
+    mStateCache.invalidate();
+
+    queueInstanceBatch(mSquareBatch);
+    queueInstanceBatch(mSquareOutlineBatch);
+    queueInstanceBatch(mCubeBatch);
+    queueInstanceBatch(mAxisBatch);
+    setInstanceDivisor(mIsStereoFrame && mFrameStereoMode == STEREO_INSTANCED ? GLESRenderQueue::NUM_STEREO_VIEWS : 1);
+
+    // Cleared here rather than at the start of the frame so the clear can be
+    // left to the video background. Scissoring applies to clears too.
+    mStateCache.setEnabled(GL_SCISSOR_TEST, false);
+    mGpuTimer.beginScope("Clear");
+    glClear(mClearMask);
+    mGpuTimer.endScope();
+
+    // Scaling is skipped for frames it couldn't learn the GPU time of, so the
+    // controller only ever sees frames drawn the way it expects
+    float scale = 0.0f;
+    if (mResolutionScaling && mScaledTarget.isInitialized() && !mIsStereoFrame &&
+        mSurfaceWidth > 0 && mSurfaceHeight > 0)
+    {
+        scale = mResolutionScaleController.getScale();
+    }
+    mFrameScales[mGpuTimer.getFrameNumber() % NUM_FRAME_SCALES] = scale;
+
+    // The draws can only read the constants once they are unmapped
+    mStreamRing.unmap();
+    if (mIsStereoFrame)
+    {
+        submitStereo();
+    }
+    else if (scale > 0.0f && scale < 1.0f)
+    {
+        submitScaled(scale);
+    }
+    else
+    {
+        // At full scale the target would only add a copy
+        mFrameStats.numDrawCalls += mRenderQueue.submit(mStateCache, mStreamRing.getBuffer(), &mGpuTimer);
+    }
+    mStreamRing.endFrame();
+    mGpuTimer.endFrame();
+    mFrameStats.uploadedBytes += mStreamRing.getBytesWritten();
+    GLESUtils::checkGlError("Submit render queue");
+
+    // Leave the default state for the Vuforia renderer and platform code
+    mStateCache.setEnabled(GL_DEPTH_TEST, false);
+    mStateCache.setEnabled(GL_CULL_FACE, false);
+    mStateCache.setEnabled(GL_BLEND, false);
+    mStateCache.setEnabled(GL_SCISSOR_TEST, false);
+    mStateCache.bindVertexArray(0);
+    mStateCache.useProgram(0);
+    mCommandRecorder.endFrame();
+
+    mFrameStats.numStateCallsRequested = mStateCache.getCounters().requested;
+    mFrameStats.numStateCallsIssued = mStateCache.getCounters().issued;
+    mFrameStats.cpuMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - mFrameStartTime).count();
+    mLastFrameStats = mFrameStats;
+
+    mAccumulatedStats.uploadedBytes += mFrameStats.uploadedBytes;
+    mAccumulatedStats.numDrawCalls += mFrameStats.numDrawCalls;
+    mAccumulatedStats.numStateCallsRequested += mFrameStats.numStateCallsRequested;
+    mAccumulatedStats.numStateCallsIssued += mFrameStats.numStateCallsIssued;
+    mAccumulatedStats.cpuMs += mFrameStats.cpuMs;
+    mAccumulatedResolutionScale += mFrameStats.resolutionScale;
+    if (++mNumAccumulatedFrames == FRAME_STATS_INTERVAL)
+    {
+        LOG("Renderer per frame: %.2f ms CPU, %.1f draw calls, %zu bytes uploaded, "
+            "%.1f of %.1f state changes issued",
+            mAccumulatedStats.cpuMs / mNumAccumulatedFrames,
+            static_cast<double>(mAccumulatedStats.numDrawCalls) / mNumAccumulatedFrames,
+            mAccumulatedStats.uploadedBytes / mNumAccumulatedFrames,
+            static_cast<double>(mAccumulatedStats.numStateCallsIssued) / mNumAccumulatedFrames,
+            static_cast<double>(mAccumulatedStats.numStateCallsRequested) / mNumAccumulatedFrames);
+        if (mResolutionScaling)
+        {
+            LOG("  Augmentations at %.2f of full resolution", mAccumulatedResolutionScale / mNumAccumulatedFrames);
+        }
+        mAccumulatedStats = FrameStats();
+        mAccumulatedResolutionScale = 0.0;
+        mNumAccumulatedFrames = 0;
+
+        std::vector<GLESGpuTimer::ScopeTiming> passTimings;
+        mGpuTimer.getAverages(passTimings);
+        for (const GLESGpuTimer::ScopeTiming& timing : passTimings)
+        {
+            if (timing.gpuMs >= 0.0)
+            {
+                LOG("  %s: %.3f ms GPU, %.3f ms CPU", timing.name, timing.gpuMs, timing.cpuMs);
+            }
+            else
+            {
+                LOG("  %s: %.3f ms CPU", timing.name, timing.cpuMs);
+            }
+        }
+        mGpuTimer.resetAverages();
+    }
 }
 
 
 void GLESRenderer::renderVideoBackground(
-    Vuforia::Matrix44F& projectionMatrix,
+    Vuforia::Matrix44F& projectionMatrix, const Vuforia::Vec4I& viewport,
     const float* vertices, const float* textureCoordinates,
     const int numTriangles, const unsigned short* indices,
-    int textureUnit)
+    unsigned int meshGeneration, int textureUnit)
 {
-    GLboolean depthTest = GL_FALSE;
-    GLboolean cullTest = GL_FALSE;
-
-    glGetBooleanv(GL_DEPTH_TEST, &depthTest);
-    glGetBooleanv(GL_CULL_FACE, &cullTest);
+    // Where the camera image lands in the viewport, nothing outside it needs drawing
+    Vuforia::Vec4I imageRect;
+    MathUtils::getScissorRect(projectionMatrix, viewport, imageRect);
+    GLint left = std::max(imageRect.data[0], viewport.data[0]);
+    GLint bottom = std::max(imageRect.data[1], viewport.data[1]);
+    GLint right = std::min(imageRect.data[0] + imageRect.data[2], viewport.data[0] + viewport.data[2]);
+    GLint top = std::min(imageRect.data[1] + imageRect.data[3], viewport.data[1] + viewport.data[3]);
+    if (right <= left || top <= bottom)
+    {
+        return;
+    }
 
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_CULL_FACE);
+    const VideoBackgroundBuffers& buffers =
+        getVideoBackgroundBuffers(vertices, textureCoordinates, numTriangles, indices, meshGeneration);
 
-    // Load the shader and upload the vertex/texcoord/index data
-    glUseProgram(mVbShaderProgramID);
-    glVertexAttribPointer(static_cast<GLuint>(mVbVertexPositionHandle), 3, GL_FLOAT,
-                          GL_FALSE, 0, vertices);
-    glVertexAttribPointer(static_cast<GLuint>(mVbTextureCoordHandle), 2, GL_FLOAT,
-                          GL_FALSE, 0, textureCoordinates);
+    // The camera texture is already bound to textureUnit by Vuforia
+    GLESRenderQueue::DrawCommand command;
+    const Vuforia::Vec4F white(1.0f, 1.0f, 1.0f, 1.0f);
+    if (!writeConstants(projectionMatrix, MathUtils::Matrix44FIdentity(), white, command))
+    {
+        return;
+    }
+    command.program = getProgram(SHADER_VideoBackground);
+    command.programRank = RANK_VIDEO_BACKGROUND;
+    command.vertexArray = buffers.vertexArray;
+    command.count = buffers.numIndices;
+    command.samplerLocation = VideoBackgroundShader::texSampler2D;
+    command.samplerUnit = textureUnit;
+    command.state = GLESRenderQueue::STATE_SCISSOR_TEST;
+    command.scissorBox[0] = left;
+    command.scissorBox[1] = bottom;
+    command.scissorBox[2] = right - left;
+    command.scissorBox[3] = top - bottom;
+    mRenderQueue.push(GLESRenderQueue::PASS_BACKGROUND, command);
+
+    // The opaque camera image overwrites every pixel it covers, so if that's
+    // the whole surface there's nothing for a color clear to do
+    if (left == 0 && bottom == 0 && right == mSurfaceWidth && top == mSurfaceHeight)
+    {
+        mClearMask &= ~GL_COLOR_BUFFER_BIT;
+    }
+}
 
-    glUniform1i(mVbTexSampler2DHandle, textureUnit);
 
-    // Render the video background with the custom shader
-    // First, we enable the vertex arrays
-    glEnableVertexAttribArray(static_cast<GLuint>(mVbVertexPositionHandle));
-    glEnableVertexAttribArray(static_cast<GLuint>(mVbTextureCoordHandle));
+void GLESRenderer::renderWorldOrigin(Vuforia::Matrix44F& projectionMatrix, Vuforia::Matrix44F& modelViewMatrix)
+{
+    Vuforia::Vec3F axis10cmSize = Vuforia::Vec3F(0.1f, 0.1f, 0.1f);
+    renderAxis(projectionMatrix, modelViewMatrix, axis10cmSize, 4.0f);
+    Vuforia::Vec4F cubeColor(0.8, 0.8, 0.8, 1.0);
+    renderCube(projectionMatrix, modelViewMatrix, 0.015f, cubeColor);
+}
 
-    // Pass the projection matrix to OpenGL
-    glUniformMatrix4fv(mVbMvpMatrixHandle, 1, GL_FALSE, projectionMatrix.data);
 
-    // Then, we issue the render call
-    glDrawElements(GL_TRIANGLES, numTriangles * 3, GL_UNSIGNED_SHORT,
-                   indices);
+void GLESRenderer::renderImageTarget(const Vuforia::Matrix44F& projectionMatrix,
+                                     const Vuforia::Matrix44F& modelViewMatrix,
+                                     const Vuforia::Matrix44F& scaledModelViewMatrix)
+{
+    const Vuforia::Vec3F unitScale(1.0f, 1.0f, 1.0f);
 
-    // Finally, we disable the vertex arrays
-    glDisableVertexAttribArray(static_cast<GLuint>(mVbVertexPositionHandle));
-    glDisableVertexAttribArray(static_cast<GLuint>(mVbTextureCoordHandle));
+    // Draw translucent solid overlay
+    addInstance(mSquareBatch, projectionMatrix, scaledModelViewMatrix, unitScale,
+                Vuforia::Vec4F(1.0f, 0.0f, 0.0f, 0.1f));
 
-    if(depthTest)
-        glEnable(GL_DEPTH_TEST);
+    // Draw solid outline, the wireframe indices follow the triangle indices.
+    // It is queued after the overlay with a matching key so it is drawn on top.
+    addInstance(mSquareOutlineBatch, projectionMatrix, scaledModelViewMatrix, unitScale,
+                Vuforia::Vec4F(1.0f, 0.0f, 0.0f, 1.0f), 4.0f);
 
-    if(cullTest)
-        glEnable(GL_CULL_FACE);
+    Vuforia::Vec3F axis2cmSize = Vuforia::Vec3F(0.02f, 0.02f, 0.02f);
+    renderAxis(projectionMatrix, modelViewMatrix, axis2cmSize, 4.0f);
 
-    GLESUtils::checkGlError("Render video background");
+    Vuforia::Matrix44F adjustedModelViewMatrix;
+    adjustedModelViewMatrix = MathUtils::Matrix44FRotate(90, { 1.0f, 0.f, 0.f }, modelViewMatrix); // Stand up
+    MathUtils::translateMatrix({ -0.03f, 0, -0.02f }, adjustedModelViewMatrix); // Move to center
+    renderModel(projectionMatrix, adjustedModelViewMatrix, mAstronautVertexArray, mAstronautModel->getNumVertices(),
+        mAstronautTexture);
 }
 
 
-void GLESRenderer::renderWorldOrigin(Vuforia::Matrix44F& projectionMatrix, Vuforia::Matrix44F& modelViewMatrix)
+void GLESRenderer::renderModelTarget(const Vuforia::Matrix44F& projectionMatrix,
+                                     const Vuforia::Matrix44F& modelViewMatrix,
+                                     const Vuforia::Matrix44F& /*scaledModelViewMatrix*/)
 {
+    renderModel(projectionMatrix, modelViewMatrix, mLanderVertexArray, mLanderModel->getNumVertices(),
+        mLanderTexture);
+
     Vuforia::Vec3F axis10cmSize = Vuforia::Vec3F(0.1f, 0.1f, 0.1f);
     renderAxis(projectionMatrix, modelViewMatrix, axis10cmSize, 4.0f);
-    Vuforia::Vec4F cubeColor(0.8, 0.8, 0.8, 1.0);
-    renderCube(projectionMatrix, modelViewMatrix, 0.015f, cubeColor);
 }
 
 
-void GLESRenderer::renderImageTarget(Vuforia::Matrix44F& projectionMatrix,
-                                     Vuforia::Matrix44F& modelViewMatrix,
-                                     Vuforia::Matrix44F& scaledModelViewMatrix)
+void GLESRenderer::updateGuideViewTextures(const GuideViewCache& guideViewCache)
 {
-    Vuforia::Matrix44F scaledModelViewProjectionMatrix;
-    MathUtils::multiplyMatrix(projectionMatrix, scaledModelViewMatrix, scaledModelViewProjectionMatrix);
+    unsigned int generation = guideViewCache.getGeneration();
+    if (generation == mGuideViewGeneration)
+    {
+        return;
+    }
+    mGuideViewGeneration = generation;
 
+    auto images = guideViewCache.getImages();
 
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    for (auto it = mGuideViewTextures.begin(); it != mGuideViewTextures.end();)
+    {
+        if (images.find(it->first) == images.end())
+        {
+            releaseTexture(it->second);
+            it = mGuideViewTextures.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
 
-    float stateLineWidth;
-    glGetFloatv(GL_LINE_WIDTH, &stateLineWidth);
+    for (const auto& idImage : images)
+    {
+        if (mGuideViewTextures.find(idImage.first) != mGuideViewTextures.end())
+        {
+            continue;
+        }
+
+        // Guide Views of one size and format share an array, and take the layers
+        // of those just released before any new array is created
+        const GuideViewCache::Image& image = *idImage.second;
+        GLenum internalFormat;
+        GLenum format;
+        GLenum type;
+        if (GLESUtils::getTextureFormat(image.format, internalFormat, format, type))
+        {
+            GLESTextureArrayAllocator::Allocation texture =
+                mTextureArrays.allocate(internalFormat, image.width, image.height, 1, GL_CLAMP_TO_EDGE);
+            uploadTextureLayer(texture, image.width, image.height, format, type, image.pixels.data());
+            mGuideViewTextures[idImage.first] = texture;
+            mFrameStats.uploadedBytes += image.pixels.size();
+        }
+    }
 
-    glUseProgram(mUniformColorShaderProgramID);
+    // Array creation and deletion changed the bindings behind the state cache
+    mStateCache.invalidateTextures();
+}
 
-    glVertexAttribPointer(mUniformColorVertexPositionHandle, 3, GL_FLOAT, GL_TRUE, 0,
-                          (const GLvoid *) &squareVertices[0]);
 
-    glEnableVertexAttribArray(mUniformColorVertexPositionHandle);
+void GLESRenderer::renderModelTargetGuideView(Vuforia::Matrix44F& projectionMatrix,
+                                              Vuforia::Matrix44F& modelViewMatrix,
+                                              GuideViewCache::GuideViewId guideViewId)
+{
+    auto textureIt = mGuideViewTextures.find(guideViewId);
+    if (textureIt == mGuideViewTextures.end())
+    {
+        // Not uploaded yet
+        return;
+    }
 
-    glUniformMatrix4fv(mUniformColorMvpMatrixHandle, 1, GL_FALSE,
-                       &scaledModelViewProjectionMatrix.data[0]);
+    GLESRenderQueue::DrawCommand command;
+    if (!writeConstants(projectionMatrix, modelViewMatrix, Vuforia::Vec4F(1.0f, 1.0f, 1.0f, 0.7f), command,
+                        &textureIt->second))
+    {
+        return;
+    }
+    command.program = getProgram(SHADER_TextureArrayUniformColor);
+    command.programRank = RANK_TEXTURE_ARRAY_UNIFORM_COLOR;
+    command.vertexArray = mTexturedSquareVertexArray;
+    command.state = GLESRenderQueue::STATE_BLEND;
+    command.count = NUM_SQUARE_INDEX;
+    command.samplerLocation = TextureArrayUniformColorShader::texSampler2DArray;
+    mRenderQueue.push(GLESRenderQueue::PASS_OVERLAY, command);
+}
 
-    // Draw translucent solid overlay
-    // Color RGBA
-    glUniform4f(mUniformColorColorHandle, 1.0, 0.0, 0.0, 0.1);
-    glDrawElements(GL_TRIANGLES, NUM_SQUARE_INDEX, GL_UNSIGNED_SHORT,
-                   (const GLvoid *) &squareIndices[0]);
 
-    // Draw solid outline
-    glUniform4f(mUniformColorColorHandle, 1.0, 0.0, 0.0, 1.0);
-    glLineWidth(4.0f);
-    glDrawElements(GL_LINES, NUM_SQUARE_WIREFRAME_INDEX, GL_UNSIGNED_SHORT,
-                   (const GLvoid *) &squareWireframeIndices[0]);
+void GLESRenderer::createTexture(int width, int height, const unsigned char* bytes,
+                                 GLESTextureArrayAllocator::Allocation& texture)
+{
+    releaseTexture(texture);
+    texture = mTextureArrays.allocate(GL_RGBA8, width, height, 1, GL_REPEAT);
+    uploadTextureLayer(texture, width, height, GL_RGBA, GL_UNSIGNED_BYTE, bytes);
+    mFrameStats.uploadedBytes += static_cast<size_t>(width) * height * 4;
+    mStateCache.invalidateTextures();
+}
 
-    glDisableVertexAttribArray(mUniformColorVertexPositionHandle);
 
-    GLESUtils::checkGlError("Render Image Target");
+void GLESRenderer::uploadTextureLayer(const GLESTextureArrayAllocator::Allocation& texture, int width, int height,
+                                      GLenum format, GLenum type, const void* pixels)
+{
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture.texture);
+    // Rows of RGB888 and GRAYSCALE images aren't necessarily 4 byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, texture.levelOffset, 0, 0, texture.layer, width, height, 1,
+                    format, type, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    GLESUtils::checkGlError("Uploading texture array layer");
+}
 
-    glLineWidth(stateLineWidth);
 
-    glDisable(GL_BLEND);
-    glDisable(GL_DEPTH_TEST);
+void GLESRenderer::releaseTexture(GLESTextureArrayAllocator::Allocation& texture)
+{
+    if (texture.isValid())
+    {
+        mTextureStreamer.removeTexture(texture);
+        mTextureArrays.release(texture);
+        texture = GLESTextureArrayAllocator::Allocation();
+    }
+}
 
-    Vuforia::Vec3F axis2cmSize = Vuforia::Vec3F(0.02f, 0.02f, 0.02f);
-    renderAxis(projectionMatrix, modelViewMatrix, axis2cmSize, 4.0f);
 
-    Vuforia::Matrix44F modelViewProjectionMatrix;
-    Vuforia::Matrix44F adjustedModelViewMatrix;
-    adjustedModelViewMatrix = MathUtils::Matrix44FRotate(90, { 1.0f, 0.f, 0.f }, modelViewMatrix); // Stand up
-    MathUtils::translateMatrix({ -0.03f, 0, -0.02f }, adjustedModelViewMatrix); // Move to center
-    MathUtils::multiplyMatrix(projectionMatrix, adjustedModelViewMatrix, modelViewProjectionMatrix);
-    renderModel(modelViewProjectionMatrix,
-        mAstronautModel->getNumVertices(), mAstronautModel->getVertices(), mAstronautModel->getTextureCoordinates(),
-        mAstronautTextureUnit);
+void GLESRenderer::loadCompressedTexture(AAssetManager* assetManager, const char* filename,
+                                         GLESTextureArrayAllocator::Allocation& texture)
+{
+    // Buffer mode maps uncompressed assets in place, the streamer reads from
+    // the mapping until the texture is complete
+    AAsset* asset = AAssetManager_open(assetManager, filename, AASSET_MODE_BUFFER);
+    if (asset == nullptr)
+    {
+        return;
+    }
+    size_t uploadedBytes = 0;
+    GLESTextureArrayAllocator::Allocation streamedTexture;
+    if (mTextureStreamer.addTexture(asset, mTextureArrays, streamedTexture, uploadedBytes))
+    {
+        releaseTexture(texture);
+        texture = streamedTexture;
+        mFrameStats.uploadedBytes += uploadedBytes;
+        mStateCache.invalidateTextures();
+    }
 }
 
 
-void GLESRenderer::renderModelTarget(Vuforia::Matrix44F& projectionMatrix,
-                                     Vuforia::Matrix44F& modelViewMatrix,
-                                     Vuforia::Matrix44F& /*scaledModelViewMatrix*/)
+void GLESRenderer::createImageTexture(AAssetManager* assetManager, const char* filename, PngDecoder::Image& image,
+                                      GLESTextureArrayAllocator::Allocation& texture)
 {
-    Vuforia::Matrix44F modelViewProjectionMatrix;
-    MathUtils::multiplyMatrix(projectionMatrix, modelViewMatrix, modelViewProjectionMatrix);
+    if (image.pixels.empty() && !loadImage(assetManager, filename, image))
+    {
+        LOG("Error: Failed to load texture %s", filename);
+        return;
+    }
+    createTexture(image.width, image.height, image.pixels.data(), texture);
+    image = PngDecoder::Image();
+}
 
-    renderModel(modelViewProjectionMatrix,
-        mLanderModel->getNumVertices(), mLanderModel->getVertices(), mLanderModel->getTextureCoordinates(),
-        mLanderTextureUnit);
 
-    Vuforia::Vec3F axis10cmSize = Vuforia::Vec3F(0.1f, 0.1f, 0.1f);
-    renderAxis(projectionMatrix, modelViewMatrix, axis10cmSize, 4.0f);
+void GLESRenderer::renderCube(const Vuforia::Matrix44F& projectionMatrix, const Vuforia::Matrix44F& modelViewMatrix,
+                              float scale, const Vuforia::Vec4F& color)
+{
+    // Render with const ambient diffuse light uniform color shader
+    addInstance(mCubeBatch, projectionMatrix, modelViewMatrix, Vuforia::Vec3F(scale, scale, scale), color);
 }
 
 
-void GLESRenderer::renderModelTargetGuideView(Vuforia::Matrix44F& projectionMatrix,
-                                              Vuforia::Matrix44F& modelViewMatrix,
-                                              const Vuforia::Image *image)
+void GLESRenderer::renderAxis(const Vuforia::Matrix44F& projectionMatrix, const Vuforia::Matrix44F& modelViewMatrix,
+                              const Vuforia::Vec3F& scale,
+                              float lineWidth)
 {
-    Vuforia::Matrix44F modelViewProjectionMatrix;
-    MathUtils::multiplyMatrix(projectionMatrix, modelViewMatrix, modelViewProjectionMatrix);
+    // Render with vertex color shader, the instance color is unused
+    addInstance(mAxisBatch, projectionMatrix, modelViewMatrix, scale, Vuforia::Vec4F(1.0f, 1.0f, 1.0f, 1.0f),
+                lineWidth);
+}
 
 
-    glDisable(GL_DEPTH_TEST);
+void GLESRenderer::renderModel(const Vuforia::Matrix44F& projectionMatrix, const Vuforia::Matrix44F& modelViewMatrix,
+    GLuint vertexArray, const int numVertices, const GLESTextureArrayAllocator::Allocation& texture)
+{
+    GLESRenderQueue::DrawCommand command;
+    if (!writeConstants(projectionMatrix, modelViewMatrix, Vuforia::Vec4F(1.0f, 1.0f, 1.0f, 1.0f), command,
+                        &texture))
+    {
+        return;
+    }
+    command.program = getProgram(SHADER_TextureArrayUniformColor);
+    command.programRank = RANK_TEXTURE_ARRAY_UNIFORM_COLOR;
+    command.vertexArray = vertexArray;
+    command.state = GLESRenderQueue::STATE_DEPTH_TEST | GLESRenderQueue::STATE_BLEND |
+                    GLESRenderQueue::STATE_CULL_FACE;
+    command.count = numVertices;
+    command.firstIndex = -1;
+    command.samplerLocation = TextureArrayUniformColorShader::texSampler2DArray;
+    queueAugmentation(command);
+}
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    glActiveTexture(GL_TEXTURE0);
+bool GLESRenderer::writeConstants(const Vuforia::Matrix44F& projectionMatrix,
+                                  const Vuforia::Matrix44F& modelViewMatrix,
+                                  const Vuforia::Vec4F& color, GLESRenderQueue::DrawCommand& command,
+                                  const GLESTextureArrayAllocator::Allocation* texture)
+{
+    if (!writeViewConstants(projectionMatrix, command.viewConstantsOffset))
+    {
+        return false;
+    }
 
-    if (mModelTargetGuideViewTextureUnit == -1)
+    GLESRenderQueue::ObjectConstants objectConstants;
+    std::copy(modelViewMatrix.data, modelViewMatrix.data + 16, objectConstants.modelViewMatrix);
+    std::copy(color.data, color.data + 4, objectConstants.color);
+    std::fill(objectConstants.textureLayer, objectConstants.textureLayer + 4, 0.0f);
+    if (texture != nullptr)
+    {
+        // Sample no level below the texture's level 0 in the array, or not yet streamed in,
+        // and none past its last level, which a texture with fewer levels than the array leaves undefined
+        objectConstants.textureLayer[0] = static_cast<GLfloat>(texture->layer);
+        objectConstants.textureLayer[1] =
+            static_cast<GLfloat>(texture->levelOffset + mTextureStreamer.getFirstLevel(*texture));
+        objectConstants.textureLayer[2] = static_cast<GLfloat>(texture->levelOffset + texture->numLevels - 1);
+        command.texture = texture->texture;
+        command.textureTarget = GL_TEXTURE_2D_ARRAY;
+    }
+    if (!mStreamRing.write(&objectConstants, sizeof(objectConstants), command.objectConstantsOffset))
     {
-        mModelTargetGuideViewTextureUnit = GLESUtils::createTexture(image);
+        return false;
     }
-    glBindTexture(GL_TEXTURE_2D, mModelTargetGuideViewTextureUnit);
 
-    glEnableVertexAttribArray(mTextureUniformColorVertexPositionHandle);
-    glVertexAttribPointer(mTextureUniformColorVertexPositionHandle, 3, GL_FLOAT, GL_FALSE, 0, (const GLvoid*)&squareVertices[0]);
+    command.viewDepth = getViewDepth(projectionMatrix.data, modelViewMatrix.data);
+    return true;
+}
 
-    glEnableVertexAttribArray(mTextureUniformColorTextureCoordHandle);
-    glVertexAttribPointer(mTextureUniformColorTextureCoordHandle, 2, GL_FLOAT, GL_FALSE, 0, (const GLvoid*)&squareTexCoords[0]);
 
-    glUseProgram(mTextureUniformColorShaderProgramID);
-    glUniformMatrix4fv(mTextureUniformColorMvpMatrixHandle, 1, GL_FALSE, (GLfloat*)modelViewProjectionMatrix.data);
-    glUniform4f(mTextureUniformColorColorHandle, 1.0f, 1.0f, 1.0f, 0.7f);
-    glUniform1i(mTextureUniformColorTexSampler2DHandle, 0); //texture unit, not handle
+bool GLESRenderer::writeViewConstants(const Vuforia::Matrix44F& projectionMatrix, GLintptr& offset)
+{
+    // Draws normally share one projection, so its constants are written once and reused
+    if (!mHasViewConstants ||
+        !std::equal(projectionMatrix.data, projectionMatrix.data + 16, mViewProjectionMatrix.data))
+    {
+        mHasViewConstants = false;
+        if (!mIsStereoFrame)
+        {
+            GLESRenderQueue::ViewConstants viewConstants;
+            std::copy(projectionMatrix.data, projectionMatrix.data + 16, viewConstants.projectionMatrix);
+            if (!mStreamRing.write(&viewConstants, sizeof(viewConstants), mViewConstantsOffset))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            // Draws in the left eye's projection follow the eyes, any other projection,
+            // like that of a screen aligned overlay, is the same in both
+            const Vuforia::Matrix44F& leftProjectionMatrix = mStereoViews[0].projectionMatrix;
+            bool followsEyes = std::equal(projectionMatrix.data, projectionMatrix.data + 16,
+                                          leftProjectionMatrix.data);
+            GLESRenderQueue::StereoViewConstants stereoConstants;
+            for (unsigned int view = 0; view < GLESRenderQueue::NUM_STEREO_VIEWS; ++view)
+            {
+                const GLfloat* eyeProjection = followsEyes ? mStereoViews[view].projectionMatrix.data
+                                                           : projectionMatrix.data;
+                std::copy(eyeProjection, eyeProjection + 16, stereoConstants.projectionMatrices[view]);
+                if (mFrameStereoMode == STEREO_INSTANCED)
+                {
+                    squeezeIntoHalf(stereoConstants.projectionMatrices[view], view == 1);
+                }
+            }
+
+            if (mFrameStereoMode == STEREO_TWO_PASS)
+            {
+                // A ViewConstants block per eye, consecutive writes landing getAlignedSize apart
+                for (unsigned int view = 0; view < GLESRenderQueue::NUM_STEREO_VIEWS; ++view)
+                {
+                    GLintptr viewOffset = 0;
+                    if (!mStreamRing.write(stereoConstants.projectionMatrices[view],
+                                           sizeof(GLESRenderQueue::ViewConstants), viewOffset))
+                    {
+                        return false;
+                    }
+                    if (view == 0)
+                    {
+                        mViewConstantsOffset = viewOffset;
+                    }
+                }
+            }
+            else if (!mStreamRing.write(&stereoConstants, sizeof(stereoConstants), mViewConstantsOffset))
+            {
+                return false;
+            }
+        }
+        mViewProjectionMatrix = projectionMatrix;
+        mHasViewConstants = true;
+    }
 
-    // Draw
-    glDrawElements(GL_TRIANGLES, NUM_SQUARE_INDEX, GL_UNSIGNED_SHORT, (const GLvoid*)&squareIndices[0]);
+    offset = mViewConstantsOffset;
+    return true;
+}
 
-    //disable input data structures
-    glDisableVertexAttribArray(mTextureUniformColorTextureCoordHandle);
-    glDisableVertexAttribArray(mTextureUniformColorVertexPositionHandle);
-    glUseProgram(0);
 
-    glBindTexture(GL_TEXTURE_2D, 0);
+GLuint GLESRenderer::getProgram(ShaderPermutation permutation) const
+{
+    return mIsStereoFrame && mFrameStereoMode != STEREO_TWO_PASS ? mStereoPrograms[permutation]
+                                                                 : mPrograms[permutation];
+}
 
-    GLESUtils::checkGlError("Render guide view");
 
-    glDisable(GL_BLEND);
-    glEnable(GL_DEPTH_TEST);
+bool GLESRenderer::createStereoPrograms()
+{
+    if (mStereoMode == STEREO_MULTIVIEW && !mMultiviewTarget.init())
+    {
+        LOG("Drawing stereo frames with instancing instead of multiview");
+        mStereoMode = STEREO_INSTANCED;
+    }
+
+    uint32_t feature = 0;
+    switch (mStereoMode)
+    {
+        case STEREO_TWO_PASS:
+            return true;
+        case STEREO_INSTANCED:
+            feature = FEATURE_INSTANCED_STEREO;
+            break;
+        case STEREO_MULTIVIEW:
+            feature = FEATURE_MULTIVIEW;
+            break;
+    }
+    if (feature == mStereoProgramFeature)
+    {
+        return true;
+    }
+
+    if (!createPermutationPrograms(mProgramCache, feature, mStereoPrograms))
+    {
+        LOG("Error: Failed to create the stereo programs, drawing stereo frames in two passes");
+        mStereoMode = STEREO_TWO_PASS;
+        mStereoProgramFeature = 0;
+        return false;
+    }
+    mStereoProgramFeature = feature;
+    return true;
 }
 
 
-void GLESRenderer::createTexture(int width, int height, unsigned char* bytes, int& textureId)
+void GLESRenderer::setInstanceDivisor(GLuint divisor)
 {
-    if (textureId != -1)
+    if (divisor == mInstanceDivisor)
+    {
+        return;
+    }
+    for (GLuint vertexArray : { mSquareVertexArray, mCubeVertexArray, mAxisVertexArray })
     {
-        GLESUtils::destroyTexture(textureId);
-        textureId = -1;
+        mStateCache.bindVertexArray(vertexArray);
+        glVertexBindingDivisor(GLESRenderQueue::INSTANCE_BUFFER_BINDING, divisor);
     }
-    textureId = GLESUtils::createTexture(width, height, bytes);
+    mStateCache.bindVertexArray(0);
+    mInstanceDivisor = divisor;
 }
 
 
-void GLESRenderer::renderCube(const Vuforia::Matrix44F& projectionMatrix, const Vuforia::Matrix44F& modelViewMatrix,
-                              float scale, const Vuforia::Vec4F& color)
+void GLESRenderer::submitStereo()
 {
-    Vuforia::Matrix44F scaledModelViewMatrix;
-    Vuforia::Matrix44F modelViewProjectionMatrix;
-    Vuforia::Vec3F scaleVec(scale, scale, scale);
+    const GLuint streamBuffer = mStreamRing.getBuffer();
+    const int* left = mStereoViews[0].viewport.data;
+    const int* right = mStereoViews[1].viewport.data;
 
-    scaledModelViewMatrix = MathUtils::Matrix44FScale(scaleVec, modelViewMatrix);
-    MathUtils::multiplyMatrix(projectionMatrix, scaledModelViewMatrix, modelViewProjectionMatrix);
+    GLESRenderQueue::SubmitOptions options;
+    switch (mFrameStereoMode)
+    {
+        case STEREO_TWO_PASS:
+            // The same draws twice, each reading its eye's ViewConstants
+            for (unsigned int view = 0; view < GLESRenderQueue::NUM_STEREO_VIEWS; ++view)
+            {
+                const int* viewport = mStereoViews[view].viewport.data;
+                glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+                options.viewConstantsOffset =
+                    view * mStreamRing.getAlignedSize(sizeof(GLESRenderQueue::ViewConstants));
+                mFrameStats.numDrawCalls += mRenderQueue.submit(mStateCache, streamBuffer, &mGpuTimer, options);
+            }
+            break;
+
+        case STEREO_INSTANCED:
+            // One viewport over both eyes, the projections squeezing each eye into its half
+            glViewport(left[0], left[1], left[2] + right[2], left[3]);
+            options.viewConstantsSize = sizeof(GLESRenderQueue::StereoViewConstants);
+            options.instancesPerView = GLESRenderQueue::NUM_STEREO_VIEWS;
+            mFrameStats.numDrawCalls += mRenderQueue.submit(mStateCache, streamBuffer, &mGpuTimer, options);
+            break;
+
+        case STEREO_MULTIVIEW:
+        {
+            mMultiviewTarget.bind();
+            glViewport(0, 0, left[2], left[3]);
+            mGpuTimer.beginScope("Clear");
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            mGpuTimer.endScope();
+            options.viewConstantsSize = sizeof(GLESRenderQueue::StereoViewConstants);
+            mFrameStats.numDrawCalls += mRenderQueue.submit(mStateCache, streamBuffer, &mGpuTimer, options);
+
+            mGpuTimer.beginScope("Multiview resolve");
+            const GLint viewports[GLESMultiviewTarget::NUM_VIEWS][4] = {
+                { left[0], left[1], left[2], left[3] },
+                { right[0], right[1], right[2], right[3] },
+            };
+            mMultiviewTarget.resolve(viewports);
+            mGpuTimer.endScope();
+            break;
+        }
+    }
 
-    ///////////////////////////////////////////////////////////////
-    // Render with const ambient diffuse light uniform color shader
-    glEnable(GL_DEPTH_TEST);
-    glUseProgram(mUniformColorShaderProgramID);
+    // Leave the viewport as setViewport left it before the eyes were set, or covering the surface
+    const GLint surfaceViewport[4] = { 0, 0, mSurfaceWidth, mSurfaceHeight };
+    const GLint* viewport = mViewport[2] > 0 ? mViewport : surfaceViewport;
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
 
-    glEnableVertexAttribArray(mUniformColorVertexPositionHandle);
 
-    glVertexAttribPointer(mUniformColorVertexPositionHandle, 3, GL_FLOAT, GL_FALSE, 0, (const GLvoid*)&cubeVertices[0]);
+void GLESRenderer::createScaledTarget()
+{
+    if (!mGpuTimer.hasGpuTiming())
+    {
+        LOG("Resolution scaling needs GL_EXT_disjoint_timer_query, drawing at full resolution");
+        return;
+    }
+    if (!mScaledTarget.init(mProgramCache))
+    {
+        LOG("Error: Can't create the resolution scaling target, drawing at full resolution");
+    }
+}
 
-    glUniformMatrix4fv(mUniformColorMvpMatrixHandle, 1, GL_FALSE, (GLfloat*)modelViewProjectionMatrix.data);
-    glUniform4f(mUniformColorColorHandle, color.data[0], color.data[1], color.data[2], color.data[3]);
 
-    // Draw
-    glDrawElements(GL_TRIANGLES, NUM_CUBE_INDEX, GL_UNSIGNED_SHORT, (const GLvoid*)&cubeIndices[0]);
+void GLESRenderer::updateResolutionScale()
+{
+    uint64_t frameNumber = mGpuTimer.getLastResultsFrameNumber();
+    if (frameNumber == 0 || frameNumber <= mResolutionScaleFrameNumber ||
+        mGpuTimer.getFrameNumber() - frameNumber >= NUM_FRAME_SCALES)
+    {
+        // Nothing new, or too old to know how it was drawn
+        return;
+    }
+    mResolutionScaleFrameNumber = frameNumber;
+    float scale = mFrameScales[frameNumber % NUM_FRAME_SCALES];
+    if (scale <= 0.0f)
+    {
+        return;
+    }
+
+    // Augmentation passes shrink with the scale, everything else in the frame doesn't
+    const char* opaqueName = GLESRenderQueue::getPassName(GLESRenderQueue::PASS_OPAQUE);
+    const char* translucentName = GLESRenderQueue::getPassName(GLESRenderQueue::PASS_TRANSLUCENT);
+    double scaledMs = 0.0;
+    double fixedMs = 0.0;
+    for (const GLESGpuTimer::ScopeTiming& timing : mGpuTimer.getLastResults())
+    {
+        if (timing.gpuMs < 0.0)
+        {
+            return;
+        }
+        bool isScaled = std::strcmp(timing.name, SCALED_CLEAR_SCOPE) == 0 ||
+                        std::strcmp(timing.name, opaqueName) == 0 ||
+                        std::strcmp(timing.name, translucentName) == 0;
+        (isScaled ? scaledMs : fixedMs) += timing.gpuMs;
+    }
+    mResolutionScaleController.addSample(scale, scaledMs, fixedMs);
+}
 
-    //disable input data structures
-    glDisableVertexAttribArray(mUniformColorVertexPositionHandle);
-    glUseProgram(0);
-    glDisable(GL_DEPTH_TEST);
 
-    GLESUtils::checkGlError("Render cube");
-    ///////////////////////////////////////////////////////
+void GLESRenderer::submitScaled(float scale)
+{
+    const GLuint streamBuffer = mStreamRing.getBuffer();
+    const GLint surfaceViewport[4] = { 0, 0, mSurfaceWidth, mSurfaceHeight };
+    const GLint* viewport = mViewport[2] > 0 ? mViewport : surfaceViewport;
+
+    // The video background stays sharp, it is already cleared over at full resolution
+    GLESRenderQueue::SubmitOptions options;
+    options.lastPass = GLESRenderQueue::PASS_BACKGROUND;
+    mFrameStats.numDrawCalls += mRenderQueue.submit(mStateCache, streamBuffer, &mGpuTimer, options);
+
+    mGpuTimer.beginScope(SCALED_CLEAR_SCOPE);
+    bool bound = mScaledTarget.bind(mSurfaceWidth, mSurfaceHeight, scale, mStateCache);
+    mGpuTimer.endScope();
+    options.firstPass = GLESRenderQueue::PASS_OPAQUE;
+    options.lastPass = GLESRenderQueue::PASS_OVERLAY;
+    if (!bound)
+    {
+        LOG("Error: Can't draw to the resolution scaling target, drawing at full resolution");
+        mScaledTarget.deinit();
+        mFrameStats.numDrawCalls += mRenderQueue.submit(mStateCache, streamBuffer, &mGpuTimer, options);
+        return;
+    }
+    mFrameStats.resolutionScale = scale;
+
+    GLint scaledViewport[4];
+    mScaledTarget.scaleViewport(viewport, scaledViewport);
+    glViewport(scaledViewport[0], scaledViewport[1], scaledViewport[2], scaledViewport[3]);
+    options.lastPass = GLESRenderQueue::PASS_TRANSLUCENT;
+    options.accumulateAlpha = true;
+    options.lineWidthScale = scale;
+    mFrameStats.numDrawCalls += mRenderQueue.submit(mStateCache, streamBuffer, &mGpuTimer, options);
+
+    mGpuTimer.beginScope("Upscale");
+    glViewport(0, 0, mSurfaceWidth, mSurfaceHeight);
+    mScaledTarget.composite(mUpscaleFilter, mStateCache);
+    mGpuTimer.endScope();
+    ++mFrameStats.numDrawCalls;
+
+    // Guide Views are screen aligned images, drawn at full resolution over the upscaled augmentations
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    options = GLESRenderQueue::SubmitOptions();
+    options.firstPass = GLESRenderQueue::PASS_OVERLAY;
+    mFrameStats.numDrawCalls += mRenderQueue.submit(mStateCache, streamBuffer, &mGpuTimer, options);
 }
 
 
-void GLESRenderer::renderAxis(const Vuforia::Matrix44F& projectionMatrix, const Vuforia::Matrix44F& modelViewMatrix,
-                              const Vuforia::Vec3F& scale,
-                              float lineWidth)
+void GLESRenderer::addInstance(InstanceBatch& batch,
+                               const Vuforia::Matrix44F& projectionMatrix,
+                               const Vuforia::Matrix44F& modelViewMatrix,
+                               const Vuforia::Vec3F& scale, const Vuforia::Vec4F& color, float lineWidth)
 {
-    Vuforia::Matrix44F scaledModelViewMatrix;
-    Vuforia::Matrix44F modelViewProjectionMatrix;
+    // A batch shares one projection and line width, queue what has been gathered if they change
+    if (!batch.instances.empty() &&
+        (batch.command.lineWidth != lineWidth ||
+         !std::equal(projectionMatrix.data, projectionMatrix.data + 16, batch.projectionMatrix.data)))
+    {
+        queueInstanceBatch(batch);
+    }
+    batch.projectionMatrix = projectionMatrix;
+    batch.command.lineWidth = lineWidth;
+
+    GLESRenderQueue::InstanceData instance;
+    std::copy(modelViewMatrix.data, modelViewMatrix.data + 16, instance.modelViewMatrix);
+    std::copy(color.data, color.data + 4, instance.color);
+    std::copy(scale.data, scale.data + 3, instance.scale);
+    instance.scale[3] = 1.0f;
+    batch.instances.push_back(instance);
+}
+
+
+void GLESRenderer::queueInstanceBatch(InstanceBatch& batch)
+{
+    if (batch.instances.empty())
+    {
+        return;
+    }
+
+    GLESRenderQueue::DrawCommand command = batch.command;
+    command.program = getProgram(batch.permutation);
+    auto viewDepth = [&batch](const GLESRenderQueue::InstanceData& instance)
+    {
+        return getViewDepth(batch.projectionMatrix.data, instance.modelViewMatrix);
+    };
+    if (command.state & GLESRenderQueue::STATE_BLEND)
+    {
+        // Blended instances are drawn far to near like any other translucent draw,
+        // and the batch is placed in the queue by its farthest instance
+        std::stable_sort(batch.instances.begin(), batch.instances.end(),
+                         [&viewDepth](const GLESRenderQueue::InstanceData& a, const GLESRenderQueue::InstanceData& b)
+                         {
+                             return viewDepth(a) > viewDepth(b);
+                         });
+        command.viewDepth = viewDepth(batch.instances.front());
+    }
+    else
+    {
+        command.viewDepth = viewDepth(batch.instances.front());
+        for (const auto& instance : batch.instances)
+        {
+            command.viewDepth = std::min(command.viewDepth, viewDepth(instance));
+        }
+    }
 
-    scaledModelViewMatrix = MathUtils::Matrix44FScale(scale, modelViewMatrix);
-    MathUtils::multiplyMatrix(projectionMatrix, scaledModelViewMatrix, modelViewProjectionMatrix);
+    command.instanceCount = static_cast<GLsizei>(batch.instances.size());
+    if (writeViewConstants(batch.projectionMatrix, command.viewConstantsOffset) &&
+        mStreamRing.write(batch.instances.data(), command.instanceCount * sizeof(GLESRenderQueue::InstanceData),
+                          command.instanceOffset))
+    {
+        queueAugmentation(command);
+    }
+    batch.instances.clear();
+}
 
-    ///////////////////////////////////////////////////////
-    // Render with vertex color shader
-    glEnable(GL_DEPTH_TEST);
-    glUseProgram(mVertexColorShaderProgramID);
 
-    glEnableVertexAttribArray(mVertexColorVertexPositionHandle);
-    glVertexAttribPointer(mVertexColorVertexPositionHandle, 3, GL_FLOAT, GL_FALSE, 0, (const GLvoid*)&axisVertices[0]);
+void GLESRenderer::queueAugmentation(const GLESRenderQueue::DrawCommand& command)
+{
+    mRenderQueue.push((command.state & GLESRenderQueue::STATE_BLEND) ? GLESRenderQueue::PASS_TRANSLUCENT
+                                                                       : GLESRenderQueue::PASS_OPAQUE,
+                      command);
+}
 
-    glEnableVertexAttribArray(mVertexColorColorHandle);
-    glVertexAttribPointer(mVertexColorColorHandle, 4, GL_FLOAT, GL_FALSE, 0, (const GLvoid*)&axisColors[0]);
 
-    glUniformMatrix4fv(mVertexColorMvpMatrixHandle, 1, GL_FALSE, (GLfloat*)modelViewProjectionMatrix.data);
+const GLESRenderer::VideoBackgroundBuffers&
+GLESRenderer::getVideoBackgroundBuffers(const float* vertices, const float* textureCoordinates,
+                                        const int numTriangles, const unsigned short* indices,
+                                        unsigned int meshGeneration)
+{
+    auto it = mVideoBackgroundBuffers.find(meshGeneration);
+    if (it != mVideoBackgroundBuffers.end())
+    {
+        return it->second;
+    }
+
+    // Keep buffers for as many configurations as the AppController caches, dropping the oldest
+    if (mVideoBackgroundBuffers.size() >= RenderingConfigCache::MAX_ENTRIES)
+    {
+        destroyVideoBackgroundBuffers(mVideoBackgroundBuffers.begin()->second);
+        mVideoBackgroundBuffers.erase(mVideoBackgroundBuffers.begin());
+    }
+
+    VideoBackgroundBuffers& buffers = mVideoBackgroundBuffers[meshGeneration];
+    buffers.numIndices = numTriangles * 3;
+
+    // The mesh doesn't give its vertex count, so derive it from the indices
+    GLsizei numVertices = 0;
+    for (GLsizei i = 0; i < buffers.numIndices; ++i)
+    {
+        numVertices = std::max(numVertices, static_cast<GLsizei>(indices[i]) + 1);
+    }
+
+    buffers.vertexBuffer = createBuffer(GL_ARRAY_BUFFER, numVertices * 3 * sizeof(float), vertices);
+    buffers.textureCoordBuffer = createBuffer(GL_ARRAY_BUFFER, numVertices * 2 * sizeof(float), textureCoordinates);
+    buffers.indexBuffer = createBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.numIndices * sizeof(unsigned short), indices);
+    buffers.vertexArray = createVertexArray({ { VideoBackgroundShader::vertexPosition, buffers.vertexBuffer, 3 },
+                                              { VideoBackgroundShader::vertexTextureCoord, buffers.textureCoordBuffer, 2 } },
+                                            buffers.indexBuffer);
+
+    GLESUtils::checkGlError("Uploading video background mesh");
+
+    return buffers;
+}
+
+
+void GLESRenderer::destroyVideoBackgroundBuffers(VideoBackgroundBuffers& buffers)
+{
+    // Deleting a bound vertex array reverts to array 0, keep the cache in step
+    mStateCache.bindVertexArray(0);
+    glDeleteVertexArrays(1, &buffers.vertexArray);
+    GLuint bufferIds[] = { buffers.vertexBuffer, buffers.textureCoordBuffer, buffers.indexBuffer };
+    glDeleteBuffers(3, bufferIds);
+    buffers = VideoBackgroundBuffers();
+}
+
+
+void GLESRenderer::createStaticGeometry()
+{
+    auto createStaticBuffer = [this](GLenum target, GLsizeiptr size, const void* data)
+    {
+        GLuint buffer = createBuffer(target, size, data);
+        mStaticBuffers.push_back(buffer);
+        return buffer;
+    };
+
+    // Square, the wireframe indices are stored after the triangle indices
+    GLuint squareVertexBuffer = createStaticBuffer(GL_ARRAY_BUFFER, sizeof(squareVertices), squareVertices);
+    GLuint squareTexCoordBuffer = createStaticBuffer(GL_ARRAY_BUFFER, sizeof(squareTexCoords), squareTexCoords);
+    GLuint squareIndexBuffer = createStaticBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                                                  sizeof(squareIndices) + sizeof(squareWireframeIndices), nullptr);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, squareIndexBuffer);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, sizeof(squareIndices), squareIndices);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, sizeof(squareIndices), sizeof(squareWireframeIndices),
+                    squareWireframeIndices);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    mFrameStats.uploadedBytes += sizeof(squareIndices) + sizeof(squareWireframeIndices);
+
+    mSquareVertexArray = createVertexArray({ { UniformColorShader::vertexPosition, squareVertexBuffer, 3 } },
+                                           squareIndexBuffer);
+    mTexturedSquareVertexArray = createVertexArray(
+        { { TextureArrayUniformColorShader::vertexPosition, squareVertexBuffer, 3 },
+          { TextureArrayUniformColorShader::vertexTextureCoord, squareTexCoordBuffer, 2 } },
+        squareIndexBuffer);
+
+    // Cube
+    GLuint cubeVertexBuffer = createStaticBuffer(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices);
+    GLuint cubeIndexBuffer = createStaticBuffer(GL_ELEMENT_ARRAY_BUFFER, sizeof(cubeIndices), cubeIndices);
+    mCubeVertexArray = createVertexArray({ { UniformColorShader::vertexPosition, cubeVertexBuffer, 3 } },
+                                         cubeIndexBuffer);
+
+    // Axis
+    GLuint axisVertexBuffer = createStaticBuffer(GL_ARRAY_BUFFER, sizeof(axisVertices), axisVertices);
+    GLuint axisColorBuffer = createStaticBuffer(GL_ARRAY_BUFFER, sizeof(axisColors), axisColors);
+    GLuint axisIndexBuffer = createStaticBuffer(GL_ELEMENT_ARRAY_BUFFER, sizeof(axisIndices), axisIndices);
+    mAxisVertexArray = createVertexArray({ { VertexColorShader::vertexPosition, axisVertexBuffer, 3 },
+                                           { VertexColorShader::vertexColor, axisColorBuffer, 4 } },
+                                         axisIndexBuffer);
+
+    // The square, cube and axis are drawn instanced, one draw call per primitive per frame
+    addInstanceAttributes<UniformColorShader>(mSquareVertexArray);
+    addInstanceAttributes<UniformColorShader>(mCubeVertexArray);
+    addInstanceAttributes<VertexColorShader>(mAxisVertexArray);
+
+    // A new vertex array draws each instance once
+    mInstanceDivisor = 1;
+
+    GLESRenderQueue::DrawCommand squareCommand;
+    squareCommand.programRank = RANK_UNIFORM_COLOR;
+    squareCommand.vertexArray = mSquareVertexArray;
+    squareCommand.state = GLESRenderQueue::STATE_DEPTH_TEST | GLESRenderQueue::STATE_BLEND;
+    squareCommand.count = NUM_SQUARE_INDEX;
+    mSquareBatch.command = squareCommand;
+    mSquareBatch.permutation = SHADER_UniformColor;
+
+    GLESRenderQueue::DrawCommand& outlineCommand = mSquareOutlineBatch.command;
+    outlineCommand = squareCommand;
+    outlineCommand.mode = GL_LINES;
+    outlineCommand.count = NUM_SQUARE_WIREFRAME_INDEX;
+    outlineCommand.firstIndex = NUM_SQUARE_INDEX;
+    mSquareOutlineBatch.permutation = SHADER_UniformColor;
+
+    GLESRenderQueue::DrawCommand& cubeCommand = mCubeBatch.command;
+    mCubeBatch.permutation = SHADER_UniformColor;
+    cubeCommand.programRank = RANK_UNIFORM_COLOR;
+    cubeCommand.vertexArray = mCubeVertexArray;
+    cubeCommand.state = GLESRenderQueue::STATE_DEPTH_TEST;
+    cubeCommand.count = NUM_CUBE_INDEX;
+
+    GLESRenderQueue::DrawCommand& axisCommand = mAxisBatch.command;
+    mAxisBatch.permutation = SHADER_VertexColor;
+    axisCommand.programRank = RANK_VERTEX_COLOR;
+    axisCommand.vertexArray = mAxisVertexArray;
+    axisCommand.state = GLESRenderQueue::STATE_DEPTH_TEST;
+    axisCommand.mode = GL_LINES;
+    axisCommand.count = NUM_AXIS_INDEX;
+
+    // Models, the v3d arrays hold 3 vertices per face
+    for (auto modelVertexArray : { std::make_pair(mAstronautModel.get(), &mAstronautVertexArray),
+                                   std::make_pair(mLanderModel.get(), &mLanderVertexArray) })
+    {
+        Modelv3d& model = *modelVertexArray.first;
+        GLsizeiptr numVertices = model.getNumFaces() * 3;
+        GLuint vertexBuffer = createStaticBuffer(GL_ARRAY_BUFFER, numVertices * 3 * sizeof(float),
+                                                 model.getVertices());
+        GLuint texCoordBuffer = createStaticBuffer(GL_ARRAY_BUFFER, numVertices * 2 * sizeof(float),
+                                                   model.getTextureCoordinates());
+        *modelVertexArray.second = createVertexArray(
+            { { TextureArrayUniformColorShader::vertexPosition, vertexBuffer, 3 },
+              { TextureArrayUniformColorShader::vertexTextureCoord, texCoordBuffer, 2 } },
+            0);
+
+        // The GPU copy is all that's needed from now on
+        model.releaseData();
+    }
+
+    GLESUtils::checkGlError("Uploading static geometry");
+}
 
-    // Draw
-    float stateLineWidth;
-    glGetFloatv(GL_LINE_WIDTH, &stateLineWidth);
 
-    glLineWidth(lineWidth);
+void GLESRenderer::destroyStaticGeometry()
+{
+    mStateCache.bindVertexArray(0);
+    GLuint vertexArrays[] = { mSquareVertexArray, mTexturedSquareVertexArray, mCubeVertexArray,
+                              mAxisVertexArray, mAstronautVertexArray, mLanderVertexArray };
+    glDeleteVertexArrays(sizeof(vertexArrays) / sizeof(vertexArrays[0]), vertexArrays);
+    mSquareVertexArray = 0;
+    mTexturedSquareVertexArray = 0;
+    mCubeVertexArray = 0;
+    mAxisVertexArray = 0;
+    mAstronautVertexArray = 0;
+    mLanderVertexArray = 0;
+
+    if (!mStaticBuffers.empty())
+    {
+        glDeleteBuffers(static_cast<GLsizei>(mStaticBuffers.size()), mStaticBuffers.data());
+        mStaticBuffers.clear();
+    }
+}
 
-    glDrawElements(GL_LINES, NUM_AXIS_INDEX, GL_UNSIGNED_SHORT, (const GLvoid*)&axisIndices[0]);
 
-    //disable input data structures
-    glDisableVertexAttribArray(mVertexColorVertexPositionHandle);
-    glDisableVertexAttribArray(mVertexColorColorHandle);
-    glUseProgram(0);
-    glDisable(GL_DEPTH_TEST);
+void GLESRenderer::abandonContextObjects()
+{
+    std::fill(std::begin(mPrograms), std::end(mPrograms), 0u);
+    std::fill(std::begin(mStereoPrograms), std::end(mStereoPrograms), 0u);
+    mStereoProgramFeature = 0;
+    mVideoBackgroundBuffers.clear();
+    mGuideViewTextures.clear();
+    mGuideViewGeneration = 0;
+    mAstronautTexture = GLESTextureArrayAllocator::Allocation();
+    mLanderTexture = GLESTextureArrayAllocator::Allocation();
+
+    mSquareVertexArray = 0;
+    mTexturedSquareVertexArray = 0;
+    mCubeVertexArray = 0;
+    mAxisVertexArray = 0;
+    mAstronautVertexArray = 0;
+    mLanderVertexArray = 0;
+    mStaticBuffers.clear();
+    mInstanceDivisor = 1;
+
+    // These make no GL calls when destroyed, so replacing them forgets their objects
+    mStreamRing = GLESBufferRing();
+    mTextureArrays = GLESTextureArrayAllocator();
+    mGpuTimer = GLESGpuTimer();
+    mMultiviewTarget = GLESMultiviewTarget();
+    mScaledTarget = GLESScaledTarget();
+    mTextureStreamer.abandon();
+    mStateCache.invalidate();
+}
 
-    glLineWidth(stateLineWidth);
 
-    GLESUtils::checkGlError("Render axis");
-    ///////////////////////////////////////////////////////
+GLuint GLESRenderer::createBuffer(GLenum target, GLsizeiptr size, const void* data)
+{
+    // GL_EXT_buffer_storage isn't universal on GLES 3.1, static buffers are never respecified
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(target, buffer);
+    glBufferData(target, size, data, GL_STATIC_DRAW);
+    glBindBuffer(target, 0);
+
+    if (data != nullptr)
+    {
+        mFrameStats.uploadedBytes += static_cast<size_t>(size);
+    }
+    return buffer;
 }
 
 
-void GLESRenderer::renderModel(Vuforia::Matrix44F modelViewProjectionMatrix,
-    const int numVertices, const float* vertices, const float* textureCoordinates,
-    GLint textureId)
+template<typename Shader>
+void GLESRenderer::addInstanceAttributes(GLuint vertexArray)
 {
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
-    glFrontFace(GL_CCW);
+    mStateCache.bindVertexArray(vertexArray);
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    auto addAttribute = [](GLint location, GLint numComponents, GLuint relativeOffset)
+    {
+        // Attributes the shader doesn't use have no location
+        if (location == -1)
+        {
+            return;
+        }
+        glEnableVertexAttribArray(static_cast<GLuint>(location));
+        glVertexAttribFormat(static_cast<GLuint>(location), numComponents, GL_FLOAT, GL_FALSE, relativeOffset);
+        glVertexAttribBinding(static_cast<GLuint>(location), GLESRenderQueue::INSTANCE_BUFFER_BINDING);
+    };
+
+    // A mat4 attribute takes a location per column
+    for (GLint column = 0; column < 4 && Shader::instanceModelViewMatrix != -1; ++column)
+    {
+        addAttribute(Shader::instanceModelViewMatrix + column, 4,
+                     offsetof(GLESRenderQueue::InstanceData, modelViewMatrix) + column * 4 * sizeof(GLfloat));
+    }
+    addAttribute(Shader::instanceColor, 4,
+                 offsetof(GLESRenderQueue::InstanceData, color));
+    addAttribute(Shader::instanceScale, 3,
+                 offsetof(GLESRenderQueue::InstanceData, scale));
 
-    glUseProgram(mTextureUniformColorShaderProgramID);
+    // The buffer itself is bound per draw by the render queue
+    glVertexBindingDivisor(GLESRenderQueue::INSTANCE_BUFFER_BINDING, 1);
 
-    glEnableVertexAttribArray(mTextureUniformColorVertexPositionHandle);
-    glVertexAttribPointer(mTextureUniformColorVertexPositionHandle, 3, GL_FLOAT, GL_FALSE, 0,
-                          (const GLvoid *) vertices);
+    mStateCache.bindVertexArray(0);
+}
 
-    glEnableVertexAttribArray(mTextureUniformColorTextureCoordHandle);
-    glVertexAttribPointer(mTextureUniformColorTextureCoordHandle, 2, GL_FLOAT, GL_FALSE, 0,
-                          (const GLvoid *) textureCoordinates);
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textureId);
+GLuint GLESRenderer::createVertexArray(std::initializer_list<VertexAttribute> attributes, GLuint indexBuffer)
+{
+    GLuint vertexArray = 0;
+    glGenVertexArrays(1, &vertexArray);
+    mStateCache.bindVertexArray(vertexArray);
 
-    glUniformMatrix4fv(mTextureUniformColorMvpMatrixHandle, 1, GL_FALSE,
-                       (GLfloat *) modelViewProjectionMatrix.data);
-    glUniform4f(mTextureUniformColorColorHandle, 1.0f, 1.0f, 1.0f, 1.0f);
-    glUniform1i(mTextureUniformColorTexSampler2DHandle, 0); //texture unit, not handle
+    for (const auto& attribute : attributes)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, attribute.buffer);
+        glVertexAttribPointer(static_cast<GLuint>(attribute.location), attribute.numComponents, GL_FLOAT,
+                              GL_FALSE, 0, nullptr);
+        glEnableVertexAttribArray(static_cast<GLuint>(attribute.location));
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    // Draw
-    glDrawArrays(GL_TRIANGLES, 0, numVertices);
+    // The element array binding is part of the vertex array state
+    if (indexBuffer != 0)
+    {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    }
 
-    //disable input data structures
-    glDisableVertexAttribArray(mTextureUniformColorTextureCoordHandle);
-    glDisableVertexAttribArray(mTextureUniformColorVertexPositionHandle);
-    glUseProgram(0);
+    mStateCache.bindVertexArray(0);
+    if (indexBuffer != 0)
+    {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+    return vertexArray;
+}
 
-    glBindTexture(GL_TEXTURE_2D, 0);
 
-    GLESUtils::checkGlError("Render model");
+bool GLESRenderer::loadImage(AAssetManager* assetManager, const char* filename, PngDecoder::Image& image)
+{
+    auto startTime = std::chrono::steady_clock::now();
 
-    glDisable(GL_BLEND);
-    glDisable(GL_CULL_FACE);
-    glDisable(GL_DEPTH_TEST);
+    // PNGs are stored uncompressed in the APK, so buffer mode maps them in place
+    AAsset* asset = AAssetManager_open(assetManager, filename, AASSET_MODE_BUFFER);
+    if (asset == nullptr)
+    {
+        LOG("Error opening asset file %s", filename);
+        return false;
+    }
+    auto data = static_cast<const unsigned char*>(AAsset_getBuffer(asset));
+    bool decoded = data != nullptr &&
+                   PngDecoder::decode(data, static_cast<size_t>(AAsset_getLength(asset)), image);
+    AAsset_close(asset);
+    if (!decoded)
+    {
+        LOG("Error decoding asset file %s", filename);
+        return false;
+    }
+
+    LOG("Decoded %s, %dx%d, in %.1f ms", filename, image.width, image.height,
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count());
+    return true;
+}
+
+
+bool GLESRenderer::hasAsset(AAssetManager* assetManager, const char* filename)
+{
+    AAsset* asset = AAssetManager_open(assetManager, filename, AASSET_MODE_UNKNOWN);
+    if (asset == nullptr)
+    {
+        return false;
+    }
+    AAsset_close(asset);
+    return true;
 }
 
 
@@ -12,12 +12,32 @@ countries.
 #include <GLES3/gl31.h>
 #include <GLES3/gl3ext.h>
 
+#include "GLESCommandRecorder.h"
+#include "GLESGpuTimer.h"
+#include "GLESMultiviewTarget.h"
+#include "GLESProgramCache.h"
+#include "GLESRenderQueue.h"
+#include "GLESScaledTarget.h"
+#include "GLESShaderPermutations.h"
+#include "GLESStateCache.h"
+#include "GLESBufferRing.h"
+#include "GLESTextureArrayAllocator.h"
+#include "GLESTextureStreamer.h"
+
+#include <GuideViewCache.h>
 #include <Modelv3d.h>
+#include <PngDecoder.h>
+#include <RenderingConfigCache.h>
+#include <ResolutionScaleController.h>
 
 #include <Vuforia/Image.h>
 #include <Vuforia/Matrices.h>
 #include <Vuforia/Vectors.h>
 
+#include <chrono>
+#include <initializer_list>
+#include <map>
+#include <string>
 #include <vector>
 
 
@@ -25,42 +45,197 @@ countries.
 class GLESRenderer
 {
 public:
-    /// Initialize the renderer ready for use
+    /// How the eyes of a stereo frame are drawn
+    enum StereoMode
+    {
+        /// Submit the queue once per eye, each with its own viewport and projections
+        STEREO_TWO_PASS,
+        /// One submission drawing every instance twice, once into each half of
+        /// a viewport covering both eyes. Needs the eyes side by side.
+        STEREO_INSTANCED,
+        /// One submission to a GL_OVR_multiview2 target, whose layers are then
+        /// copied to the eyes. Falls back to STEREO_INSTANCED without the extension.
+        STEREO_MULTIVIEW,
+    };
+
+    /// An eye of a stereo frame
+    struct StereoView
+    {
+        /// x, y, width and height in surface pixels
+        Vuforia::Vec4I viewport;
+        /// Projection of the eye, including its display adjustment
+        Vuforia::Matrix44F projectionMatrix;
+    };
+
+    /// Costs of rendering one frame
+    struct FrameStats
+    {
+        /// Bytes passed to the driver for buffers and textures
+        size_t uploadedBytes = 0;
+        unsigned int numDrawCalls = 0;
+        /// State changes requested from the state cache and how many reached GL
+        unsigned int numStateCallsRequested = 0;
+        unsigned int numStateCallsIssued = 0;
+        /// CPU time between beginFrame and endFrame
+        double cpuMs = 0.0;
+        /// Fraction of the surface's width and height augmentations were drawn at
+        float resolutionScale = 1.0f;
+    };
+
+    /// Parse the v3d models used for augmentations.
+    /// The vertex data is released once init has uploaded it, a later init
+    /// for a new GL context parses the models again.
+    /// Makes no GL calls so can run on a worker thread ahead of init.
+    bool loadModels(AAssetManager* assetManager);
+
+    /// Set where files that speed up the next init are kept, such as program binaries.
+    /// Without a directory they only last until the process exits.
+    void setCacheDirectory(const std::string& directory);
+
+    /// Record the GL calls made from now until numFrames frames have ended, to a
+    /// file in the cache directory for Tools/GLCommandReplayer. Call before init
+    /// so the recording creates everything its frames draw with. Only builds with
+    /// VUFORIA_RECORD_GL_COMMANDS defined can record.
+    bool startCommandRecording(unsigned int numFrames);
+
+    /// Initialize the renderer ready for use, in a newly created context
+    /// Loads the models first if loadModels hasn't already been called,
+    /// then uploads all static geometry to buffers. Objects of an earlier
+    /// context that wasn't deinitialized are abandoned rather than deleted.
     bool init(AAssetManager* assetManager);
     /// Clean up objects created during rendering
     void deinit();
+    /// Whether init has created the objects for rendering, and deinit hasn't deleted them since
+    bool isInitialized() const { return mPrograms[0] != 0; }
+
+    /// Decode the PNG version of a texture if it has no compressed version.
+    /// Like loadModels, makes no GL calls so can run on a worker thread ahead of init,
+    /// and the two textures can be decoded on separate threads.
+    bool loadAstronautImage(AAssetManager* assetManager);
+    bool loadLanderImage(AAssetManager* assetManager);
 
-    void setAstronautTexture(int width, int height, unsigned char* bytes);
-    void setLanderTexture(int width, int height, unsigned char* bytes);
+    /// Set the size of the surface rendered to, so that a video background
+    /// covering all of it can stand in for the color clear
+    void setSurfaceSize(int width, int height);
+    /// Set the viewport of the frame's single view, in place of glViewport, so
+    /// that frames drawn at a lower resolution can scale it without querying GL.
+    /// Covers the whole surface until called.
+    void setViewport(const Vuforia::Vec4I& viewport);
+
+    /// Choose how stereo frames are drawn, STEREO_TWO_PASS until called. Creates the
+    /// programs the mode needs if init has been called already, otherwise init does.
+    /// Returns false if they can't be created, leaving STEREO_TWO_PASS in use.
+    bool setStereoMode(StereoMode mode);
+    /// The mode asked for, after falling back from multiview if it isn't supported
+    StereoMode getStereoMode() const { return mStereoMode; }
+
+    /// Draw the frame begun last for both eyes, rather than the single view the
+    /// caller sets the viewport of. Call after beginFrame and before the render calls.
+    /// Draws given the left eye's projection are drawn with each eye's, draws with
+    /// any other projection the same in both. A frame whose eyes don't suit the
+    /// stereo mode is drawn in two passes.
+    void setStereoViews(const StereoView& leftView, const StereoView& rightView);
+
+    /// Draw augmentations at a resolution that keeps the frame's GPU time within
+    /// the controller's target, upscaling them over the full resolution video
+    /// background with filter. Off until called. Needs GL_EXT_disjoint_timer_query,
+    /// without it everything stays at full resolution. Stereo frames are always
+    /// drawn at full resolution.
+    void setResolutionScaling(bool enabled, GLESScaledTarget::Filter filter = GLESScaledTarget::FILTER_SHARPEN,
+                              const ResolutionScaleController::Settings& settings =
+                                  ResolutionScaleController::Settings());
+
+    /// Call before and after the render calls for a frame to measure its FrameStats.
+    /// The render calls only queue their draws, endFrame clears the color and
+    /// depth buffers then sorts and submits them.
+    void beginFrame();
+    void endFrame();
+
+    /// Get the stats of the last frame completed with endFrame
+    const FrameStats& getLastFrameStats() const { return mLastFrameStats; }
+
+    /// Get the GPU and CPU time of each pass of the latest frame the GPU has finished,
+    /// normally a few frames behind getLastFrameStats. GPU times are negative
+    /// where GL_EXT_disjoint_timer_query isn't supported.
+    const std::vector<GLESGpuTimer::ScopeTiming>& getLastPassTimings() const { return mGpuTimer.getLastResults(); }
 
     /// Render the video background
-    void renderVideoBackground(Vuforia::Matrix44F& projectionMatrix,
+    /// The mesh is uploaded to buffers once per meshGeneration, which must change whenever the mesh does.
+    /// The draw is clipped to the part of viewport the camera image covers.
+    void renderVideoBackground(Vuforia::Matrix44F& projectionMatrix, const Vuforia::Vec4I& viewport,
                                const float* vertices, const float* textureCoordinates,
                                const int numTriangles, const unsigned short* indices,
-                               int textureUnit);
+                               unsigned int meshGeneration, int textureUnit);
 
     /// Render augmentation for the world origin
     void renderWorldOrigin(Vuforia::Matrix44F& projectionMatrix,
                            Vuforia::Matrix44F& modelViewMatrix);
 
     /// Render a bounding box augmentation on an Image Target
-    void renderImageTarget(Vuforia::Matrix44F& projectionMatrix,
-                           Vuforia::Matrix44F& modelViewMatrix,
-                           Vuforia::Matrix44F& scaledModelViewMatrix);
+    void renderImageTarget(const Vuforia::Matrix44F& projectionMatrix,
+                           const Vuforia::Matrix44F& modelViewMatrix,
+                           const Vuforia::Matrix44F& scaledModelViewMatrix);
 
     /// Render a bounding cube augmentation on a Model Target
-    void renderModelTarget(Vuforia::Matrix44F& projectionMatrix,
-                           Vuforia::Matrix44F& modelViewMatrix,
-                           Vuforia::Matrix44F& scaledModelViewMatrix);
+    void renderModelTarget(const Vuforia::Matrix44F& projectionMatrix,
+                           const Vuforia::Matrix44F& modelViewMatrix,
+                           const Vuforia::Matrix44F& scaledModelViewMatrix);
+
+    /// Upload any Guide View images decoded since the last call
+    /// and release the textures of Guide Views no longer in the cache
+    void updateGuideViewTextures(const GuideViewCache& guideViewCache);
 
     /// Render the Guide View for a model target
     void renderModelTargetGuideView(Vuforia::Matrix44F& projectionMatrix,
                                     Vuforia::Matrix44F& modelViewMatrix,
-                                    const Vuforia::Image* Image);
+                                    GuideViewCache::GuideViewId guideViewId);
+
+private: // types
+
+    /// GPU copy of a video background mesh
+    struct VideoBackgroundBuffers
+    {
+        GLuint vertexBuffer = 0;
+        GLuint textureCoordBuffer = 0;
+        GLuint indexBuffer = 0;
+        GLuint vertexArray = 0;
+        GLsizei numIndices = 0;
+    };
+
+    /// A vertex attribute sourced from a buffer, for createVertexArray
+    struct VertexAttribute
+    {
+        GLint location;
+        GLuint buffer;
+        GLint numComponents;
+    };
+
+    /// Instances of one primitive gathered over a frame and drawn with a single call
+    struct InstanceBatch
+    {
+        /// Everything but the program, constants and instances, set up with the static geometry
+        GLESRenderQueue::DrawCommand command;
+        /// The program is chosen when the batch is queued, as it depends on how the frame is drawn
+        ShaderPermutation permutation = SHADER_UniformColor;
+        Vuforia::Matrix44F projectionMatrix;
+        std::vector<GLESRenderQueue::InstanceData> instances;
+    };
 
 private: // methods
-    /// Attempt to create a texture from bytes
-    void createTexture(int width, int height, unsigned char* bytes, int& textureId);
+    /// Attempt to create a texture array layer from RGBA bytes
+    void createTexture(int width, int height, const unsigned char* bytes,
+                       GLESTextureArrayAllocator::Allocation& texture);
+    /// Create texture from a KTX2 asset, leaving it unchanged if the asset is missing or unusable
+    void loadCompressedTexture(AAssetManager* assetManager, const char* filename,
+                               GLESTextureArrayAllocator::Allocation& texture);
+    /// Create texture from a decoded PNG, decoding it now if it hasn't been already, then release the pixels
+    void createImageTexture(AAssetManager* assetManager, const char* filename, PngDecoder::Image& image,
+                            GLESTextureArrayAllocator::Allocation& texture);
+    /// Upload the single level of a texture that isn't streamed
+    void uploadTextureLayer(const GLESTextureArrayAllocator::Allocation& texture, int width, int height,
+                            GLenum format, GLenum type, const void* pixels);
+    /// Stop streaming a texture and give its layer back, if it has one
+    void releaseTexture(GLESTextureArrayAllocator::Allocation& texture);
 
     /// Render a filled 3D cube
     /*
@@ -86,48 +261,207 @@ private: // methods
                     float lineWidth = 2.0f);
 
     /// Render a v3d model
-    void renderModel(Vuforia::Matrix44F modelViewProjectionMatrix,
-                     const int numVertices, const float* vertices, const float* textureCoordinates,
-                     GLint textureId);
+    void renderModel(const Vuforia::Matrix44F& projectionMatrix,
+                     const Vuforia::Matrix44F& modelViewMatrix,
+                     GLuint vertexArray, const int numVertices,
+                     const GLESTextureArrayAllocator::Allocation& texture);
+
+    /// Write the uniform block data for a draw to the uniform ring and set the
+    /// command's offsets and view depth. Returns false if the ring is full.
+    /// With a texture, also binds its array and passes the layer and levels to sample.
+    bool writeConstants(const Vuforia::Matrix44F& projectionMatrix,
+                        const Vuforia::Matrix44F& modelViewMatrix,
+                        const Vuforia::Vec4F& color, GLESRenderQueue::DrawCommand& command,
+                        const GLESTextureArrayAllocator::Allocation* texture = nullptr);
+
+    /// Write ViewConstants for a projection, unless they were already written this frame.
+    /// In stereo frames these are the constants of both eyes, laid out as the frame's mode reads them.
+    bool writeViewConstants(const Vuforia::Matrix44F& projectionMatrix, GLintptr& offset);
+
+    /// Program of a permutation for the way the current frame is drawn
+    GLuint getProgram(ShaderPermutation permutation) const;
+
+    /// Create mStereoPrograms for the stereo mode's shader feature
+    bool createStereoPrograms();
+
+    /// Set how many instances the square, cube and axis vertex arrays draw per
+    /// instance data, 2 when each instance is drawn once per eye
+    void setInstanceDivisor(GLuint divisor);
+
+    /// Submit the queued draws once per eye, or once for both with the single pass modes
+    void submitStereo();
+
+    /// Create mScaledTarget if the GPU times resolution scaling relies on can be measured
+    void createScaledTarget();
+
+    /// Pass the GPU time of the latest frame the timer has read to the resolution scale controller
+    void updateResolutionScale();
+
+    /// Submit the augmentation passes to mScaledTarget at scale and upscale them
+    /// between the background and overlay passes
+    void submitScaled(float scale);
+
+    /// Add an instance to a batch, queueing the batch first if the projection or line width changed
+    void addInstance(InstanceBatch& batch,
+                     const Vuforia::Matrix44F& projectionMatrix,
+                     const Vuforia::Matrix44F& modelViewMatrix,
+                     const Vuforia::Vec3F& scale, const Vuforia::Vec4F& color, float lineWidth = 1.0f);
+
+    /// Write a batch's instances to the stream ring and queue its draw, then empty it
+    void queueInstanceBatch(InstanceBatch& batch);
+
+    /// Queue a draw in the opaque or translucent pass, depending on whether it blends
+    void queueAugmentation(const GLESRenderQueue::DrawCommand& command);
+
+    /// Upload the square, cube, axis and model geometry and create a vertex array
+    /// for each mesh and shader combination, then release the CPU copies of the models
+    void createStaticGeometry();
+
+    /// Delete the objects created by createStaticGeometry
+    void destroyStaticGeometry();
+
+    /// Forget the GL objects left from a context that was lost without deinit,
+    /// without deleting them, as the new context may have given their names to
+    /// objects of its own
+    void abandonContextObjects();
+
+    /// Create a buffer holding size bytes of data
+    GLuint createBuffer(GLenum target, GLsizeiptr size, const void* data);
+
+    /// Add the InstanceData attributes used by the permutation with Shader's handles to a vertex array
+    template<typename Shader>
+    void addInstanceAttributes(GLuint vertexArray);
+
+    /// Create a vertex array reading float attributes from buffers, with an optional index buffer
+    GLuint createVertexArray(std::initializer_list<VertexAttribute> attributes, GLuint indexBuffer);
+
+    /// Get the buffers for a video background mesh, uploading it if it hasn't been seen before
+    const VideoBackgroundBuffers& getVideoBackgroundBuffers(const float* vertices, const float* textureCoordinates,
+                                                            const int numTriangles, const unsigned short* indices,
+                                                            unsigned int meshGeneration);
+
+    /// Delete the buffers of a video background mesh
+    void destroyVideoBackgroundBuffers(VideoBackgroundBuffers& buffers);
+
+    /// Decode a PNG asset, straight from the mapped asset where possible
+    bool loadImage(AAssetManager* assetManager, const char* filename, PngDecoder::Image& image);
+
+    /// Whether an asset exists
+    bool hasAsset(AAssetManager* assetManager, const char* filename);
 
     /// Read an asset file into a byte vector
     bool readAsset(AAssetManager* assetManager, const char* filename, std::vector<unsigned char>& data);
 
 private: // data members
 
-    // For video background rendering
-    unsigned int mVbShaderProgramID     = 0;
-    GLint mVbVertexPositionHandle       = 0;
-    GLint mVbTextureCoordHandle         = 0;
-    GLint mVbMvpMatrixHandle            = 0;
-    GLint mVbTexSampler2DHandle         = 0;
-
-    // For augmentation rendering
-    unsigned int mUniformColorShaderProgramID   = 0;
-    GLint mUniformColorVertexPositionHandle     = 0;
-    GLint mUniformColorMvpMatrixHandle          = 0;
-    GLint mUniformColorColorHandle              = 0;
-
-    // For model target guide view rendering
-    unsigned int mTextureUniformColorShaderProgramID    = 0;
-    GLint mTextureUniformColorVertexPositionHandle      = 0;
-    GLint mTextureUniformColorTextureCoordHandle        = 0;
-    GLint mTextureUniformColorMvpMatrixHandle           = 0;
-    GLint mTextureUniformColorTexSampler2DHandle        = 0;
-    GLint mTextureUniformColorColorHandle               = 0;
-    int mModelTargetGuideViewTextureUnit = -1;
-
-    // For axis rendering
-    unsigned int mVertexColorShaderProgramID    = 0;
-    GLint mVertexColorVertexPositionHandle      = 0;
-    GLint mVertexColorColorHandle               = 0;
-    GLint mVertexColorMvpMatrixHandle           = 0;
+    /// Programs for each shader permutation, created by init
+    GLuint mPrograms[NUM_SHADER_PERMUTATIONS] = {};
+    /// The same permutations drawing both eyes at once, for STEREO_INSTANCED or STEREO_MULTIVIEW
+    GLuint mStereoPrograms[NUM_SHADER_PERMUTATIONS] = {};
+    /// Shader feature mStereoPrograms were created with, 0 if there are none
+    uint32_t mStereoProgramFeature = 0;
+
+    /// Uploaded meshes for recently used rendering configurations, keyed on generation
+    std::map<unsigned int, VideoBackgroundBuffers> mVideoBackgroundBuffers;
+
+    /// Texture array layers for each decoded Guide View
+    std::map<GuideViewCache::GuideViewId, GLESTextureArrayAllocator::Allocation> mGuideViewTextures;
+    /// Cache generation the textures were last updated for
+    unsigned int mGuideViewGeneration = 0;
 
     std::unique_ptr<Modelv3d> mAstronautModel;
-    int mAstronautTextureUnit = -1;
+    GLESTextureArrayAllocator::Allocation mAstronautTexture;
+    /// Decoded by loadAstronautImage when there's no compressed texture, released once uploaded
+    PngDecoder::Image mAstronautImage;
 
     std::unique_ptr<Modelv3d> mLanderModel;
-    int mLanderTextureUnit = -1;
+    GLESTextureArrayAllocator::Allocation mLanderTexture;
+    PngDecoder::Image mLanderImage;
+
+    // Static geometry, created by init
+    std::vector<GLuint> mStaticBuffers;
+    /// Square with the uniform color shader, triangle indices followed by wireframe indices
+    GLuint mSquareVertexArray = 0;
+    /// Square with the texture shader
+    GLuint mTexturedSquareVertexArray = 0;
+    GLuint mCubeVertexArray = 0;
+    GLuint mAxisVertexArray = 0;
+    GLuint mAstronautVertexArray = 0;
+    GLuint mLanderVertexArray = 0;
+
+    // Instanced primitives gathered since beginFrame
+    InstanceBatch mSquareBatch;
+    InstanceBatch mSquareOutlineBatch;
+    InstanceBatch mCubeBatch;
+    InstanceBatch mAxisBatch;
+
+    /// Programs created by init, loaded from binaries where possible
+    GLESProgramCache mProgramCache;
+
+    /// Draws queued since beginFrame
+    GLESRenderQueue mRenderQueue;
+
+    /// Per-view and per-object constants and instance data of the queued draws
+    GLESBufferRing mStreamRing;
+    /// Projection whose ViewConstants were last written this frame, and where
+    bool mHasViewConstants = false;
+    Vuforia::Matrix44F mViewProjectionMatrix;
+    GLintptr mViewConstantsOffset = 0;
+
+    /// Model and Guide View textures, as layers of arrays shared by textures of the same format,
+    /// so that draws with textures of one format don't rebind between them
+    GLESTextureArrayAllocator mTextureArrays;
+
+    /// Uploads the compressed textures over the first frames, smallest mip levels first
+    GLESTextureStreamer mTextureStreamer;
+
+    /// All program, binding, enable, blend, cull and line width changes go through here
+    GLESStateCache mStateCache;
+
+    /// Times the texture streaming, clear and each pass of the render queue
+    GLESGpuTimer mGpuTimer;
+
+    std::string mCacheDirectory;
+    /// Open from startCommandRecording until the frames asked for have been recorded
+    GLESCommandRecorder mCommandRecorder;
+
+    StereoMode mStereoMode = STEREO_TWO_PASS;
+    /// Set by setStereoViews for the current frame
+    bool mIsStereoFrame = false;
+    /// Mode the current stereo frame is drawn in, mStereoMode unless the eyes don't suit it
+    StereoMode mFrameStereoMode = STEREO_TWO_PASS;
+    StereoView mStereoViews[GLESRenderQueue::NUM_STEREO_VIEWS];
+    /// Target of STEREO_MULTIVIEW frames
+    GLESMultiviewTarget mMultiviewTarget;
+    /// Divisor of the instance data binding of the instanced vertex arrays
+    GLuint mInstanceDivisor = 1;
+
+    bool mResolutionScaling = false;
+    GLESScaledTarget::Filter mUpscaleFilter = GLESScaledTarget::FILTER_SHARPEN;
+    /// Target of frames drawn below full resolution, created by init when scaling can be used
+    GLESScaledTarget mScaledTarget;
+    ResolutionScaleController mResolutionScaleController;
+    /// Scale each recent frame was drawn at, 0 if it wasn't scaled, indexed by the
+    /// timer's frame number. More frames than the timer keeps pending.
+    static constexpr size_t NUM_FRAME_SCALES = 16;
+    float mFrameScales[NUM_FRAME_SCALES] = {};
+    /// Timer frame number last passed to the controller
+    uint64_t mResolutionScaleFrameNumber = 0;
+
+    int mSurfaceWidth = 0;
+    int mSurfaceHeight = 0;
+    /// Set with setViewport, a width of 0 meaning the whole surface
+    GLint mViewport[4] = {};
+    /// Buffers endFrame clears, the color is left out once the video background covers the surface
+    GLbitfield mClearMask = GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT;
+
+    FrameStats mFrameStats;
+    FrameStats mLastFrameStats;
+    std::chrono::steady_clock::time_point mFrameStartTime;
+    /// Totals since stats were last logged
+    FrameStats mAccumulatedStats;
+    double mAccumulatedResolutionScale = 0.0;
+    unsigned int mNumAccumulatedFrames = 0;
 };
 
 #endif //_VUFORIA_GLESRENDERER_H_
@@ -0,0 +1,217 @@
+/*===============================================================================
+Copyright (c) 2020 PTC Inc. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "GLESScaledTarget.h"
+
+#include "GLESShaderPermutations.h"
+
+#include <Log.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#include "GLESRecordedCalls.h"
+
+
+namespace
+{
+    /// Uniform locations of the upscale shader in Shaders.h
+    constexpr GLint LOCATION_TARGET_SAMPLER = 0;
+    constexpr GLint LOCATION_SOURCE_RECT = 1;
+
+    /// Scale a coordinate along an axis, rounding to the nearest pixel
+    GLint scaleCoordinate(GLint coordinate, GLsizei scaledSize, GLsizei size)
+    {
+        return static_cast<GLint>(std::lround(static_cast<double>(coordinate) * scaledSize / size));
+    }
+}
+
+
+bool GLESScaledTarget::init(GLESProgramCache& programCache)
+{
+    deinit();
+
+    std::string shaderSources[NUM_FILTERS * 2];
+    GLESProgramCache::ProgramSource programSources[NUM_FILTERS];
+    for (int filter = 0; filter < NUM_FILTERS; ++filter)
+    {
+        bool sharpen = filter == FILTER_SHARPEN;
+        shaderSources[filter * 2] = GLESShaderPermutations::getUpscaleSource(GL_VERTEX_SHADER, sharpen);
+        shaderSources[filter * 2 + 1] = GLESShaderPermutations::getUpscaleSource(GL_FRAGMENT_SHADER, sharpen);
+        programSources[filter] = { shaderSources[filter * 2].c_str(), shaderSources[filter * 2 + 1].c_str() };
+    }
+    if (!programCache.createPrograms(programSources, NUM_FILTERS, mPrograms))
+    {
+        LOG("Error: Failed to create the upscale programs");
+        deinit();
+        return false;
+    }
+
+    glGenVertexArrays(1, &mVertexArray);
+    return true;
+}
+
+
+void GLESScaledTarget::deinit()
+{
+    deleteTextures();
+    if (mFramebuffer != 0)
+    {
+        glDeleteFramebuffers(1, &mFramebuffer);
+        mFramebuffer = 0;
+    }
+    if (mVertexArray != 0)
+    {
+        glDeleteVertexArrays(1, &mVertexArray);
+        mVertexArray = 0;
+    }
+    for (GLuint& program : mPrograms)
+    {
+        if (program != 0)
+        {
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+}
+
+
+bool GLESScaledTarget::bind(GLsizei width, GLsizei height, float scale, GLESStateCache& stateCache)
+{
+    if (!isInitialized())
+    {
+        return false;
+    }
+
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &mPreviousFramebuffer);
+
+    if (mFramebuffer == 0)
+    {
+        glGenFramebuffers(1, &mFramebuffer);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+
+    if (width != mWidth || height != mHeight)
+    {
+        bool created = createTextures(width, height);
+        // Creating the textures bound them behind the cache's back
+        stateCache.invalidateTextures();
+        if (!created)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, mPreviousFramebuffer);
+            return false;
+        }
+    }
+
+    scale = std::min(std::max(scale, 0.0f), 1.0f);
+    mScaledWidth = std::max(static_cast<GLsizei>(std::lround(mWidth * scale)), 1);
+    mScaledHeight = std::max(static_cast<GLsizei>(std::lround(mHeight * scale)), 1);
+
+    // Only the part drawn to is read back, clearing the rest would be wasted
+    const GLfloat transparent[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    const GLfloat farDepth = 1.0f;
+    stateCache.setEnabled(GL_SCISSOR_TEST, true);
+    stateCache.scissor(0, 0, mScaledWidth, mScaledHeight);
+    glClearBufferfv(GL_COLOR, 0, transparent);
+    glClearBufferfv(GL_DEPTH, 0, &farDepth);
+    stateCache.setEnabled(GL_SCISSOR_TEST, false);
+    return true;
+}
+
+
+void GLESScaledTarget::scaleViewport(const GLint viewport[4], GLint scaledViewport[4]) const
+{
+    // Scale the edges rather than the size, so the viewport stays where the edges land
+    GLint left = scaleCoordinate(viewport[0], mScaledWidth, mWidth);
+    GLint bottom = scaleCoordinate(viewport[1], mScaledHeight, mHeight);
+    GLint right = scaleCoordinate(viewport[0] + viewport[2], mScaledWidth, mWidth);
+    GLint top = scaleCoordinate(viewport[1] + viewport[3], mScaledHeight, mHeight);
+    scaledViewport[0] = left;
+    scaledViewport[1] = bottom;
+    scaledViewport[2] = std::max(right - left, 1);
+    scaledViewport[3] = std::max(top - bottom, 1);
+}
+
+
+void GLESScaledTarget::composite(Filter filter, GLESStateCache& stateCache)
+{
+    // Depth isn't needed past the frame, so tiled GPUs needn't write it back to memory
+    const GLenum depthAttachment = GL_DEPTH_ATTACHMENT;
+    glInvalidateFramebuffer(GL_FRAMEBUFFER, 1, &depthAttachment);
+    glBindFramebuffer(GL_FRAMEBUFFER, mPreviousFramebuffer);
+
+    stateCache.setEnabled(GL_DEPTH_TEST, false);
+    stateCache.setEnabled(GL_CULL_FACE, false);
+    stateCache.setEnabled(GL_SCISSOR_TEST, false);
+    stateCache.setEnabled(GL_BLEND, true);
+    stateCache.blendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    stateCache.useProgram(mPrograms[filter]);
+    stateCache.bindVertexArray(mVertexArray);
+    stateCache.bindTexture(0, mColorTexture);
+
+    glUniform1i(LOCATION_TARGET_SAMPLER, 0);
+    // The far corner of the part drawn to, and the last texel centers inside it
+    glUniform4f(LOCATION_SOURCE_RECT,
+                static_cast<GLfloat>(mScaledWidth) / mWidth, static_cast<GLfloat>(mScaledHeight) / mHeight,
+                (mScaledWidth - 0.5f) / mWidth, (mScaledHeight - 0.5f) / mHeight);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    // Unit 0 is where the camera image goes, don't leave the target for the next video background to read
+    stateCache.bindTexture(0, 0);
+}
+
+
+bool GLESScaledTarget::createTextures(GLsizei width, GLsizei height)
+{
+    deleteTextures();
+
+    glGenTextures(1, &mColorTexture);
+    glBindTexture(GL_TEXTURE_2D, mColorTexture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenTextures(1, &mDepthTexture);
+    glBindTexture(GL_TEXTURE_2D, mDepthTexture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, width, height);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mColorTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, mDepthTexture, 0);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        LOG("Error: scaled framebuffer of %dx%d is incomplete, status 0x%x", width, height, status);
+        deleteTextures();
+        return false;
+    }
+
+    mWidth = width;
+    mHeight = height;
+    return true;
+}
+
+
+void GLESScaledTarget::deleteTextures()
+{
+    if (mColorTexture != 0)
+    {
+        glDeleteTextures(1, &mColorTexture);
+        mColorTexture = 0;
+    }
+    if (mDepthTexture != 0)
+    {
+        glDeleteTextures(1, &mDepthTexture);
+        mDepthTexture = 0;
+    }
+    mWidth = 0;
+    mHeight = 0;
+}
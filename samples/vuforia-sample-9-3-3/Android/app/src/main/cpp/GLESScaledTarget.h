@@ -0,0 +1,85 @@
+/*===============================================================================
+Copyright (c) 2020 PTC Inc. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef _VUFORIA_GLESSCALEDTARGET_H_
+#define _VUFORIA_GLESSCALEDTARGET_H_
+
+#include <GLES3/gl31.h>
+
+#include "GLESProgramCache.h"
+#include "GLESStateCache.h"
+
+
+/// Offscreen framebuffer for drawing augmentations at a fraction of the surface's resolution.
+/**
+ * Color and depth are textures the size of the surface, and each frame draws
+ * to the bottom left part of them given by its scale, so the scale can change
+ * every frame without reallocating anything. composite() then upscales that
+ * part over the framebuffer that was bound before bind(), normally holding the
+ * video background drawn at full resolution.
+ *
+ * The target is cleared to transparent black, so its colors come out
+ * premultiplied by alpha as long as blended draws add their coverage to the
+ * alpha channel, see GLESRenderQueue::SubmitOptions::accumulateAlpha, and
+ * composite() blends them as such.
+ */
+class GLESScaledTarget
+{
+public:
+    /// How composite() upscales
+    enum Filter
+    {
+        FILTER_BILINEAR,
+        /// Bilinear, then sharpened to make up for some of the detail lost
+        FILTER_SHARPEN,
+        NUM_FILTERS
+    };
+
+    /// Create the upscale programs, returns false if they fail to compile
+    bool init(GLESProgramCache& programCache);
+    /// Delete the programs, framebuffer and textures
+    void deinit();
+
+    bool isInitialized() const { return mPrograms[FILTER_BILINEAR] != 0; }
+
+    /// Bind the framebuffer to draw at scale, from 0 to 1, of a width x height surface,
+    /// creating or resizing the textures, and clear the part drawn to.
+    /// Returns false if the framebuffer is incomplete.
+    bool bind(GLsizei width, GLsizei height, float scale, GLESStateCache& stateCache);
+
+    /// Scale a viewport of the surface, given as x, y, width and height, to the part drawn to
+    void scaleViewport(const GLint viewport[4], GLint scaledViewport[4]) const;
+
+    /// Bind the framebuffer that was bound before bind again and upscale the part drawn to
+    /// over the whole of it, which the viewport must cover
+    void composite(Filter filter, GLESStateCache& stateCache);
+
+private: // methods
+
+    bool createTextures(GLsizei width, GLsizei height);
+    void deleteTextures();
+
+private: // data members
+
+    GLuint mPrograms[NUM_FILTERS] = {};
+    /// Has no attributes, the upscale triangle comes from gl_VertexID
+    GLuint mVertexArray = 0;
+
+    GLuint mFramebuffer = 0;
+    GLuint mColorTexture = 0;
+    GLuint mDepthTexture = 0;
+    GLsizei mWidth = 0;
+    GLsizei mHeight = 0;
+
+    /// Part of the textures drawn to this frame
+    GLsizei mScaledWidth = 0;
+    GLsizei mScaledHeight = 0;
+
+    GLint mPreviousFramebuffer = 0;
+};
+
+#endif //_VUFORIA_GLESSCALEDTARGET_H_
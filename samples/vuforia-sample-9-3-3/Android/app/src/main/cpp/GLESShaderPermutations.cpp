@@ -0,0 +1,80 @@
+/*===============================================================================
+Copyright (c) 2020 PTC Inc. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "GLESShaderPermutations.h"
+
+#include "Shaders.h"
+
+
+namespace
+{
+    /// Define name as a value in a shader preamble
+    void addDefine(std::string& source, const char* name, long value)
+    {
+        source += "#define ";
+        source += name;
+        source += " ";
+        source += std::to_string(value);
+        source += "\n";
+    }
+}
+
+
+std::string GLESShaderPermutations::getSource(GLenum shaderType, uint32_t features)
+{
+    // Layout qualifiers on uniforms and samplers need GLSL ES 3.10, which the sample requires anyway
+    std::string source = "#version 310 es\n";
+    // Extensions have to come before anything but the version
+    if ((features & FEATURE_MULTIVIEW) && shaderType == GL_VERTEX_SHADER)
+    {
+        source += "#extension GL_OVR_multiview2 : require\n";
+    }
+    if (features & FEATURE_INSTANCED_STEREO)
+    {
+        // Clips the other eye's half in hardware where supported, the shaders discard it otherwise
+        source += "#extension GL_EXT_clip_cull_distance : enable\n";
+    }
+
+    addDefine(source, "FEATURE_TEXTURE", (features & FEATURE_TEXTURE) != 0);
+    addDefine(source, "FEATURE_VERTEX_COLOR", (features & FEATURE_VERTEX_COLOR) != 0);
+    addDefine(source, "FEATURE_UNIFORM_COLOR", (features & FEATURE_UNIFORM_COLOR) != 0);
+    addDefine(source, "FEATURE_LIGHTING", (features & FEATURE_LIGHTING) != 0);
+    addDefine(source, "FEATURE_INSTANCING", (features & FEATURE_INSTANCING) != 0);
+    addDefine(source, "FEATURE_QUANTIZED_INPUTS", (features & FEATURE_QUANTIZED_INPUTS) != 0);
+    addDefine(source, "FEATURE_TEXTURE_ARRAY", (features & FEATURE_TEXTURE_ARRAY) != 0);
+    addDefine(source, "FEATURE_MULTIVIEW", (features & FEATURE_MULTIVIEW) != 0);
+    addDefine(source, "FEATURE_INSTANCED_STEREO", (features & FEATURE_INSTANCED_STEREO) != 0);
+
+    addDefine(source, "LOCATION_VERTEX_POSITION", LOCATION_VERTEX_POSITION);
+    addDefine(source, "LOCATION_VERTEX_TEXTURE_COORD", LOCATION_VERTEX_TEXTURE_COORD);
+    addDefine(source, "LOCATION_VERTEX_COLOR", LOCATION_VERTEX_COLOR);
+    addDefine(source, "LOCATION_VERTEX_NORMAL", LOCATION_VERTEX_NORMAL);
+    addDefine(source, "LOCATION_INSTANCE_MODEL_VIEW_MATRIX", LOCATION_INSTANCE_MODEL_VIEW_MATRIX);
+    addDefine(source, "LOCATION_INSTANCE_COLOR", LOCATION_INSTANCE_COLOR);
+    addDefine(source, "LOCATION_INSTANCE_SCALE", LOCATION_INSTANCE_SCALE);
+    addDefine(source, "LOCATION_TEX_SAMPLER_2D", LOCATION_TEX_SAMPLER_2D);
+    addDefine(source, "LOCATION_TEX_SAMPLER_2D_ARRAY", LOCATION_TEX_SAMPLER_2D_ARRAY);
+    addDefine(source, "LOCATION_POSITION_SCALE", LOCATION_POSITION_SCALE);
+    addDefine(source, "VIEW_CONSTANTS_BINDING", GLESRenderQueue::VIEW_CONSTANTS_BINDING);
+    addDefine(source, "OBJECT_CONSTANTS_BINDING", GLESRenderQueue::OBJECT_CONSTANTS_BINDING);
+    addDefine(source, "NUM_STEREO_VIEWS", GLESRenderQueue::NUM_STEREO_VIEWS);
+
+    // Report errors against the lines of the uber shader
+    source += "#line 0\n";
+    source += shaderType == GL_VERTEX_SHADER ? uberVertexShaderSrc : uberFragmentShaderSrc;
+    return source;
+}
+
+
+std::string GLESShaderPermutations::getUpscaleSource(GLenum shaderType, bool sharpen)
+{
+    std::string source = "#version 310 es\n";
+    addDefine(source, "SHARPEN", sharpen);
+    source += "#line 0\n";
+    source += shaderType == GL_VERTEX_SHADER ? upscaleVertexShaderSrc : upscaleFragmentShaderSrc;
+    return source;
+}
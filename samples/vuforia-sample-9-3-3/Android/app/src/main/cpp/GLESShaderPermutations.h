@@ -0,0 +1,148 @@
+/*===============================================================================
+Copyright (c) 2020 PTC Inc. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef _VUFORIA_GLESSHADERPERMUTATIONS_H_
+#define _VUFORIA_GLESSHADERPERMUTATIONS_H_
+
+#include <GLES3/gl31.h>
+
+#include "GLESRenderQueue.h"
+
+#include <cstdint>
+#include <string>
+
+
+/// Optional parts of the uber shader in Shaders.h, each enabled by a FEATURE_ define
+enum ShaderFeature : uint32_t
+{
+    /// Sample texSampler2D at vertexTextureCoord
+    FEATURE_TEXTURE = 1 << 0,
+    /// Multiply by the vertexColor attribute
+    FEATURE_VERTEX_COLOR = 1 << 1,
+    /// Multiply by the object color, from ObjectConstants or the instance
+    FEATURE_UNIFORM_COLOR = 1 << 2,
+    /// Diffuse lighting from a light at the camera, using vertexNormal
+    FEATURE_LIGHTING = 1 << 3,
+    /// Take the model view matrix, color and scale from GLESRenderQueue::InstanceData
+    FEATURE_INSTANCING = 1 << 4,
+    /// Positions are normalized integers, scaled up by positionScale or the instance scale
+    FEATURE_QUANTIZED_INPUTS = 1 << 5,
+    /// Sample a layer of texSampler2DArray at vertexTextureCoord, the layer and
+    /// level range coming from ObjectConstants::textureLayer
+    FEATURE_TEXTURE_ARRAY = 1 << 6,
+    /// Draw both eyes of a stereo frame at once to the layers of a GL_OVR_multiview2
+    /// target, projecting with the eye's matrix from StereoViewConstants
+    FEATURE_MULTIVIEW = 1 << 7,
+    /// Draw both eyes of a stereo frame side by side as instances, the eye being
+    /// the low bit of the instance and the other eye's half of the viewport clipped
+    FEATURE_INSTANCED_STEREO = 1 << 8,
+};
+
+/// Features that draw every eye of a stereo frame in one draw call, added to a
+/// permutation's own features when the renderer draws stereo frames that way
+constexpr uint32_t STEREO_SHADER_FEATURES = FEATURE_MULTIVIEW | FEATURE_INSTANCED_STEREO;
+
+/// Fixed locations shared by every permutation, so nothing is looked up by name
+constexpr GLint LOCATION_VERTEX_POSITION = 0;
+constexpr GLint LOCATION_VERTEX_TEXTURE_COORD = 1;
+constexpr GLint LOCATION_VERTEX_COLOR = 2;
+constexpr GLint LOCATION_VERTEX_NORMAL = 3;
+/// A mat4 attribute takes a location per column, 4 to 7
+constexpr GLint LOCATION_INSTANCE_MODEL_VIEW_MATRIX = 4;
+constexpr GLint LOCATION_INSTANCE_COLOR = 8;
+constexpr GLint LOCATION_INSTANCE_SCALE = 9;
+
+constexpr GLint LOCATION_TEX_SAMPLER_2D = 0;
+constexpr GLint LOCATION_TEX_SAMPLER_2D_ARRAY = 0;
+constexpr GLint LOCATION_POSITION_SCALE = 1;
+
+/// Whether a set of features makes a valid program
+constexpr bool isValidShaderFeatureSet(uint32_t features)
+{
+    return features < (FEATURE_INSTANCED_STEREO << 1) &&
+           // Without any source of color every fragment would be white
+           (features & (FEATURE_TEXTURE | FEATURE_TEXTURE_ARRAY | FEATURE_VERTEX_COLOR | FEATURE_UNIFORM_COLOR)) != 0 &&
+           // Both textures would share a sampler location
+           (features & (FEATURE_TEXTURE | FEATURE_TEXTURE_ARRAY)) != (FEATURE_TEXTURE | FEATURE_TEXTURE_ARRAY) &&
+           // The layer is only passed per draw, InstanceData has no room for it
+           (features & (FEATURE_TEXTURE_ARRAY | FEATURE_INSTANCING)) != (FEATURE_TEXTURE_ARRAY | FEATURE_INSTANCING) &&
+           // Only one way of drawing the eyes at a time
+           (features & STEREO_SHADER_FEATURES) != STEREO_SHADER_FEATURES;
+}
+
+
+/// Attribute and uniform locations of the permutation with FEATURES, -1 for those it doesn't have
+template<uint32_t FEATURES>
+struct ShaderHandles
+{
+    static_assert(isValidShaderFeatureSet(FEATURES), "Invalid shader feature set");
+
+    static constexpr uint32_t features = FEATURES;
+
+    static constexpr GLint vertexPosition = LOCATION_VERTEX_POSITION;
+    static constexpr GLint vertexTextureCoord =
+        (FEATURES & (FEATURE_TEXTURE | FEATURE_TEXTURE_ARRAY)) ? LOCATION_VERTEX_TEXTURE_COORD : -1;
+    static constexpr GLint vertexColor = (FEATURES & FEATURE_VERTEX_COLOR) ? LOCATION_VERTEX_COLOR : -1;
+    static constexpr GLint vertexNormal = (FEATURES & FEATURE_LIGHTING) ? LOCATION_VERTEX_NORMAL : -1;
+
+    static constexpr GLint instanceModelViewMatrix =
+        (FEATURES & FEATURE_INSTANCING) ? LOCATION_INSTANCE_MODEL_VIEW_MATRIX : -1;
+    static constexpr GLint instanceColor =
+        ((FEATURES & FEATURE_INSTANCING) && (FEATURES & FEATURE_UNIFORM_COLOR)) ? LOCATION_INSTANCE_COLOR : -1;
+    static constexpr GLint instanceScale = (FEATURES & FEATURE_INSTANCING) ? LOCATION_INSTANCE_SCALE : -1;
+
+    static constexpr GLint texSampler2D = (FEATURES & FEATURE_TEXTURE) ? LOCATION_TEX_SAMPLER_2D : -1;
+    static constexpr GLint texSampler2DArray =
+        (FEATURES & FEATURE_TEXTURE_ARRAY) ? LOCATION_TEX_SAMPLER_2D_ARRAY : -1;
+    static constexpr GLint positionScale =
+        ((FEATURES & FEATURE_QUANTIZED_INPUTS) && !(FEATURES & FEATURE_INSTANCING)) ? LOCATION_POSITION_SCALE : -1;
+};
+
+
+/// The permutations the sample uses, as (name, features). Only these are ever compiled,
+/// along with each of them plus one of STEREO_SHADER_FEATURES when stereo frames need it.
+#define VUFORIA_SHADER_PERMUTATIONS(PERMUTATION) \
+    PERMUTATION(VideoBackground, FEATURE_TEXTURE) \
+    PERMUTATION(UniformColor, FEATURE_UNIFORM_COLOR | FEATURE_INSTANCING) \
+    PERMUTATION(TextureArrayUniformColor, FEATURE_TEXTURE_ARRAY | FEATURE_UNIFORM_COLOR) \
+    PERMUTATION(VertexColor, FEATURE_VERTEX_COLOR | FEATURE_INSTANCING)
+
+/// Index of each permutation, e.g. SHADER_VideoBackground
+enum ShaderPermutation
+{
+#define VUFORIA_SHADER_PERMUTATION_ENUM(name, features) SHADER_##name,
+    VUFORIA_SHADER_PERMUTATIONS(VUFORIA_SHADER_PERMUTATION_ENUM)
+#undef VUFORIA_SHADER_PERMUTATION_ENUM
+    NUM_SHADER_PERMUTATIONS
+};
+
+/// Handles of each permutation, e.g. VideoBackgroundShader::vertexTextureCoord
+#define VUFORIA_SHADER_PERMUTATION_HANDLES(name, features) using name##Shader = ShaderHandles<(features)>;
+VUFORIA_SHADER_PERMUTATIONS(VUFORIA_SHADER_PERMUTATION_HANDLES)
+#undef VUFORIA_SHADER_PERMUTATION_HANDLES
+
+/// Features of each permutation, indexed by ShaderPermutation
+constexpr uint32_t SHADER_PERMUTATION_FEATURES[NUM_SHADER_PERMUTATIONS] = {
+#define VUFORIA_SHADER_PERMUTATION_FEATURES(name, featureSet) (featureSet),
+    VUFORIA_SHADER_PERMUTATIONS(VUFORIA_SHADER_PERMUTATION_FEATURES)
+#undef VUFORIA_SHADER_PERMUTATION_FEATURES
+};
+
+
+/// Builds the source of a permutation from the uber shader
+class GLESShaderPermutations
+{
+public:
+    /// The uber shader of shaderType, GL_VERTEX_SHADER or GL_FRAGMENT_SHADER,
+    /// preceded by the defines for features and the fixed locations
+    static std::string getSource(GLenum shaderType, uint32_t features);
+
+    /// The upscale shader GLESScaledTarget composites with, sharpening or just bilinear
+    static std::string getUpscaleSource(GLenum shaderType, bool sharpen);
+};
+
+#endif //_VUFORIA_GLESSHADERPERMUTATIONS_H_
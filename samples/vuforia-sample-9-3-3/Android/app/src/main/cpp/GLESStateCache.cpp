@@ -0,0 +1,205 @@
+/*===============================================================================
+Copyright (c) 2020 PTC Inc. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "GLESStateCache.h"
+
+#include <Log.h>
+
+#include "GLESRecordedCalls.h"
+
+
+void GLESStateCache::invalidate()
+{
+    Counters counters = mCounters;
+    *this = GLESStateCache();
+    mCounters = counters;
+}
+
+
+void GLESStateCache::invalidateTextures()
+{
+    mActiveTextureUnit.known = false;
+    for (auto& texture : mTextures)
+    {
+        texture.known = false;
+    }
+    for (auto& texture : mArrayTextures)
+    {
+        texture.known = false;
+    }
+}
+
+
+void GLESStateCache::useProgram(GLuint program)
+{
+    if (count(mProgram.update(program)))
+    {
+        glUseProgram(program);
+    }
+}
+
+
+void GLESStateCache::bindVertexArray(GLuint vertexArray)
+{
+    if (count(mVertexArray.update(vertexArray)))
+    {
+        glBindVertexArray(vertexArray);
+    }
+}
+
+
+void GLESStateCache::bindTexture(GLuint unit, GLuint texture, GLenum target)
+{
+    if (unit >= MAX_TEXTURE_UNITS || (target != GL_TEXTURE_2D && target != GL_TEXTURE_2D_ARRAY))
+    {
+        LOG("Error: texture unit %u target 0x%x isn't shadowed", unit, target);
+        return;
+    }
+
+    // Each target of a unit has its own binding
+    Tracked<GLuint>& binding = target == GL_TEXTURE_2D ? mTextures[unit] : mArrayTextures[unit];
+    if (binding.known && binding.value == texture)
+    {
+        count(false);
+        return;
+    }
+
+    if (count(mActiveTextureUnit.update(unit)))
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+    if (count(binding.update(texture)))
+    {
+        glBindTexture(target, texture);
+    }
+}
+
+
+void GLESStateCache::bindUniformBufferRange(GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    if (index >= MAX_UNIFORM_BUFFER_BINDINGS)
+    {
+        LOG("Error: uniform buffer binding %u isn't shadowed", index);
+        return;
+    }
+
+    if (count(mUniformBuffers[index].update({ buffer, offset, size })))
+    {
+        glBindBufferRange(GL_UNIFORM_BUFFER, index, buffer, offset, size);
+    }
+}
+
+
+void GLESStateCache::setEnabled(GLenum capability, bool enabled)
+{
+    Capability index;
+    switch (capability)
+    {
+        case GL_DEPTH_TEST:
+            index = DEPTH_TEST;
+            break;
+        case GL_BLEND:
+            index = BLEND;
+            break;
+        case GL_CULL_FACE:
+            index = CULL_FACE;
+            break;
+        case GL_SCISSOR_TEST:
+            index = SCISSOR_TEST;
+            break;
+        default:
+            LOG("Error: capability 0x%x isn't shadowed", capability);
+            return;
+    }
+
+    if (count(mCapabilities[index].update(enabled)))
+    {
+        if (enabled)
+        {
+            glEnable(capability);
+        }
+        else
+        {
+            glDisable(capability);
+        }
+    }
+}
+
+
+void GLESStateCache::blendFunc(GLenum sourceFactor, GLenum destinationFactor)
+{
+    // All must be updated, don't short circuit
+    bool sourceChanged = mBlendSourceFactor.update(sourceFactor);
+    bool destinationChanged = mBlendDestinationFactor.update(destinationFactor);
+    bool sourceAlphaChanged = mBlendSourceAlphaFactor.update(sourceFactor);
+    bool destinationAlphaChanged = mBlendDestinationAlphaFactor.update(destinationFactor);
+    if (count(sourceChanged || destinationChanged || sourceAlphaChanged || destinationAlphaChanged))
+    {
+        glBlendFunc(sourceFactor, destinationFactor);
+    }
+}
+
+
+void GLESStateCache::blendFuncSeparate(GLenum sourceFactor, GLenum destinationFactor,
+                                       GLenum sourceAlphaFactor, GLenum destinationAlphaFactor)
+{
+    bool sourceChanged = mBlendSourceFactor.update(sourceFactor);
+    bool destinationChanged = mBlendDestinationFactor.update(destinationFactor);
+    bool sourceAlphaChanged = mBlendSourceAlphaFactor.update(sourceAlphaFactor);
+    bool destinationAlphaChanged = mBlendDestinationAlphaFactor.update(destinationAlphaFactor);
+    if (count(sourceChanged || destinationChanged || sourceAlphaChanged || destinationAlphaChanged))
+    {
+        glBlendFuncSeparate(sourceFactor, destinationFactor, sourceAlphaFactor, destinationAlphaFactor);
+    }
+}
+
+
+void GLESStateCache::cullFace(GLenum mode)
+{
+    if (count(mCullFace.update(mode)))
+    {
+        glCullFace(mode);
+    }
+}
+
+
+void GLESStateCache::frontFace(GLenum mode)
+{
+    if (count(mFrontFace.update(mode)))
+    {
+        glFrontFace(mode);
+    }
+}
+
+
+void GLESStateCache::scissor(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    if (count(mScissorBox.update({ x, y, width, height })))
+    {
+        glScissor(x, y, width, height);
+    }
+}
+
+
+void GLESStateCache::lineWidth(GLfloat width)
+{
+    if (count(mLineWidth.update(width)))
+    {
+        glLineWidth(width);
+    }
+}
+
+
+bool GLESStateCache::count(bool issue)
+{
+    ++mCounters.requested;
+    if (issue)
+    {
+        ++mCounters.issued;
+    }
+    return issue;
+}
@@ -0,0 +1,144 @@
+/*===============================================================================
+Copyright (c) 2020 PTC Inc. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef _VUFORIA_GLESSTATECACHE_H_
+#define _VUFORIA_GLESSTATECACHE_H_
+
+#include <GLES3/gl31.h>
+
+
+/// Shadows the GL state the renderer changes so redundant calls can be skipped.
+/**
+ * The cache never queries the driver. Anything it hasn't set since the last
+ * invalidate() is unknown and the next call for it always reaches GL, so call
+ * invalidate() whenever code outside the cache (for example the Vuforia
+ * renderer) may have changed state.
+ */
+class GLESStateCache
+{
+public:
+    /// Number of texture units whose bindings are shadowed
+    static constexpr GLuint MAX_TEXTURE_UNITS = 8;
+    /// Number of uniform buffer binding points whose ranges are shadowed
+    static constexpr GLuint MAX_UNIFORM_BUFFER_BINDINGS = 4;
+
+    /// Calls made through the cache and how many of them reached GL
+    struct Counters
+    {
+        unsigned int requested = 0;
+        unsigned int issued = 0;
+    };
+
+    /// Forget all shadowed state
+    void invalidate();
+
+    /// Forget texture bindings, after textures are created or deleted outside the cache
+    void invalidateTextures();
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vertexArray);
+    /// Bind a GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY texture to a texture unit, selecting the unit first if needed
+    void bindTexture(GLuint unit, GLuint texture, GLenum target = GL_TEXTURE_2D);
+    /// Bind a range of a buffer to a uniform buffer binding point
+    void bindUniformBufferRange(GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+    /// Enable or disable GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE or GL_SCISSOR_TEST
+    void setEnabled(GLenum capability, bool enabled);
+    void scissor(GLint x, GLint y, GLsizei width, GLsizei height);
+    void blendFunc(GLenum sourceFactor, GLenum destinationFactor);
+    /// Blend the alpha channel with factors of its own
+    void blendFuncSeparate(GLenum sourceFactor, GLenum destinationFactor,
+                           GLenum sourceAlphaFactor, GLenum destinationAlphaFactor);
+    void cullFace(GLenum mode);
+    void frontFace(GLenum mode);
+    void lineWidth(GLfloat width);
+
+    const Counters& getCounters() const { return mCounters; }
+    void resetCounters() { mCounters = Counters(); }
+
+private: // types
+    /// A shadowed value, unknown until first set
+    template<typename T>
+    struct Tracked
+    {
+        T value {};
+        bool known = false;
+
+        /// Record the new value, returns true if GL needs to be told
+        bool update(T newValue)
+        {
+            if (known && value == newValue)
+            {
+                return false;
+            }
+            value = newValue;
+            known = true;
+            return true;
+        }
+    };
+
+    /// What a uniform buffer binding point refers to
+    struct BufferRange
+    {
+        GLuint buffer;
+        GLintptr offset;
+        GLsizeiptr size;
+
+        bool operator==(const BufferRange& other) const
+        {
+            return buffer == other.buffer && offset == other.offset && size == other.size;
+        }
+    };
+
+    /// A glScissor rectangle
+    struct ScissorBox
+    {
+        GLint x;
+        GLint y;
+        GLsizei width;
+        GLsizei height;
+
+        bool operator==(const ScissorBox& other) const
+        {
+            return x == other.x && y == other.y && width == other.width && height == other.height;
+        }
+    };
+
+    enum Capability
+    {
+        DEPTH_TEST,
+        BLEND,
+        CULL_FACE,
+        SCISSOR_TEST,
+        NUM_CAPABILITIES
+    };
+
+private: // methods
+    /// Count a request, returns issue so calls read as if (count(tracked.update(x))) glX(x)
+    bool count(bool issue);
+
+private: // data members
+    Tracked<GLuint> mProgram;
+    Tracked<GLuint> mVertexArray;
+    Tracked<GLuint> mActiveTextureUnit;
+    Tracked<GLuint> mTextures[MAX_TEXTURE_UNITS];
+    Tracked<GLuint> mArrayTextures[MAX_TEXTURE_UNITS];
+    Tracked<BufferRange> mUniformBuffers[MAX_UNIFORM_BUFFER_BINDINGS];
+    Tracked<bool> mCapabilities[NUM_CAPABILITIES];
+    Tracked<GLenum> mBlendSourceFactor;
+    Tracked<GLenum> mBlendDestinationFactor;
+    Tracked<GLenum> mBlendSourceAlphaFactor;
+    Tracked<GLenum> mBlendDestinationAlphaFactor;
+    Tracked<GLenum> mCullFace;
+    Tracked<GLenum> mFrontFace;
+    Tracked<GLfloat> mLineWidth;
+    Tracked<ScissorBox> mScissorBox;
+
+    Counters mCounters;
+};
+
+#endif //_VUFORIA_GLESSTATECACHE_H_
@@ -0,0 +1,236 @@
+/*===============================================================================
+Copyright (c) 2020 PTC Inc. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "GLESTextureArrayAllocator.h"
+
+#include "GLESUtils.h"
+
+#include <Log.h>
+
+#include <GLES3/gl3ext.h>
+// ASTC formats, from KHR_texture_compression_astc_ldr
+#include <GLES2/gl2ext.h>
+
+#include <algorithm>
+
+#include "GLESRecordedCalls.h"
+
+
+namespace
+{
+    /// Size of the first page for a texture size, two 2048 ETC2 textures with their mip levels
+    constexpr size_t PAGE_BYTES = 8 * 1024 * 1024;
+
+    /// Texels per block and bytes per block of a format, uncompressed formats have 1x1 blocks
+    struct FormatBlock
+    {
+        GLsizei width;
+        GLsizei height;
+        size_t bytes;
+    };
+
+    FormatBlock getFormatBlock(GLenum internalFormat)
+    {
+        switch (internalFormat)
+        {
+            case GL_COMPRESSED_RGB8_ETC2:
+                return { 4, 4, 8 };
+            case GL_COMPRESSED_RGBA8_ETC2_EAC:
+            case GL_COMPRESSED_RGBA_ASTC_4x4_KHR:
+                return { 4, 4, 16 };
+            case GL_COMPRESSED_RGBA_ASTC_6x6_KHR:
+                return { 6, 6, 16 };
+            case GL_COMPRESSED_RGBA_ASTC_8x8_KHR:
+                return { 8, 8, 16 };
+            case GL_R8:
+                return { 1, 1, 1 };
+            case GL_RGB565:
+                return { 1, 1, 2 };
+            default:
+                // RGB8 is usually padded to 4 bytes by the driver anyway
+                return { 1, 1, 4 };
+        }
+    }
+}
+
+
+void GLESTextureArrayAllocator::deinit()
+{
+    for (const Page& page : mPages)
+    {
+        glDeleteTextures(1, &page.texture);
+    }
+    mPages.clear();
+}
+
+
+GLESTextureArrayAllocator::Allocation
+GLESTextureArrayAllocator::allocate(GLenum internalFormat, GLsizei width, GLsizei height, GLint numLevels,
+                                    GLenum wrapMode)
+{
+    // Prefer a page the texture fills from level 0, then the fullest page,
+    // so that pages freed of most of their textures can drain and be deleted
+    Page* bestPage = nullptr;
+    GLint bestLevelOffset = 0;
+    for (Page& page : mPages)
+    {
+        if (page.numLayersUsed == static_cast<GLsizei>(page.usedLayers.size()))
+        {
+            continue;
+        }
+        GLint levelOffset = getLevelOffset(page, internalFormat, width, height, numLevels, wrapMode);
+        if (levelOffset >= 0 &&
+            (bestPage == nullptr || levelOffset < bestLevelOffset ||
+             (levelOffset == bestLevelOffset && page.numLayersUsed > bestPage->numLayersUsed)))
+        {
+            bestPage = &page;
+            bestLevelOffset = levelOffset;
+        }
+    }
+    if (bestPage == nullptr)
+    {
+        bestPage = &createPage(internalFormat, width, height, numLevels, wrapMode);
+        bestLevelOffset = 0;
+    }
+
+    auto layerIt = std::find(bestPage->usedLayers.begin(), bestPage->usedLayers.end(), false);
+    *layerIt = true;
+    ++bestPage->numLayersUsed;
+
+    Allocation allocation;
+    allocation.texture = bestPage->texture;
+    allocation.layer = static_cast<GLint>(layerIt - bestPage->usedLayers.begin());
+    allocation.levelOffset = bestLevelOffset;
+    allocation.numLevels = numLevels;
+    return allocation;
+}
+
+
+void GLESTextureArrayAllocator::release(const Allocation& allocation)
+{
+    auto pageIt = std::find_if(mPages.begin(), mPages.end(),
+                               [&allocation](const Page& page) { return page.texture == allocation.texture; });
+    if (pageIt == mPages.end() || !pageIt->usedLayers[allocation.layer])
+    {
+        LOG("Error: Layer %d of texture array %u isn't allocated", allocation.layer, allocation.texture);
+        return;
+    }
+
+    // The layer's contents are left as they are, the next texture given it overwrites them
+    pageIt->usedLayers[allocation.layer] = false;
+    if (--pageIt->numLayersUsed == 0)
+    {
+        glDeleteTextures(1, &pageIt->texture);
+        mPages.erase(pageIt);
+    }
+}
+
+
+GLESTextureArrayAllocator::Stats GLESTextureArrayAllocator::getStats() const
+{
+    Stats stats;
+    for (const Page& page : mPages)
+    {
+        ++stats.numPages;
+        stats.numLayers += static_cast<unsigned int>(page.usedLayers.size());
+        stats.numLayersUsed += static_cast<unsigned int>(page.numLayersUsed);
+        stats.bytes += page.bytes;
+    }
+    return stats;
+}
+
+
+GLESTextureArrayAllocator::Page&
+GLESTextureArrayAllocator::createPage(GLenum internalFormat, GLsizei width, GLsizei height, GLint numLevels,
+                                      GLenum wrapMode)
+{
+    size_t layerSize = getLayerSize(internalFormat, width, height, numLevels);
+
+    // Twice the layers of the biggest page already holding textures of this size,
+    // so a growing number of textures needs only a logarithmic number of pages
+    GLsizei numLayers = 0;
+    for (const Page& page : mPages)
+    {
+        if (getLevelOffset(page, internalFormat, width, height, numLevels, wrapMode) == 0 &&
+            page.numLevels == numLevels)
+        {
+            numLayers = std::max(numLayers, static_cast<GLsizei>(page.usedLayers.size()) * 2);
+        }
+    }
+    if (numLayers == 0)
+    {
+        numLayers = static_cast<GLsizei>(std::max<size_t>(PAGE_BYTES / layerSize, 1));
+    }
+    GLint maxLayers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    numLayers = std::min(numLayers, static_cast<GLsizei>(maxLayers));
+
+    Page page;
+    page.internalFormat = internalFormat;
+    page.wrapMode = wrapMode;
+    page.width = width;
+    page.height = height;
+    page.numLevels = numLevels;
+    page.usedLayers.assign(static_cast<size_t>(numLayers), false);
+    page.numLayersUsed = 0;
+    page.bytes = layerSize * static_cast<size_t>(numLayers);
+
+    glGenTextures(1, &page.texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, page.texture);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, numLevels, internalFormat, width, height, numLayers);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, numLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, wrapMode);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, wrapMode);
+    if (internalFormat == GL_R8)
+    {
+        // Grayscale images, in place of the GL_LUMINANCE that can't be used with texture storage
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_G, GL_RED);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_B, GL_RED);
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    GLESUtils::checkGlError("Creating texture array");
+
+    LOG("Created texture array %u, %dx%d with %d levels and %d layers, %zu KB",
+        page.texture, width, height, numLevels, numLayers, page.bytes / 1024);
+
+    mPages.push_back(std::move(page));
+    return mPages.back();
+}
+
+
+GLint GLESTextureArrayAllocator::getLevelOffset(const Page& page, GLenum internalFormat, GLsizei width,
+                                                GLsizei height, GLint numLevels, GLenum wrapMode)
+{
+    if (page.internalFormat != internalFormat || page.wrapMode != wrapMode)
+    {
+        return -1;
+    }
+    for (GLint levelOffset = 0; levelOffset + numLevels <= page.numLevels; ++levelOffset)
+    {
+        if (std::max(page.width >> levelOffset, 1) == width && std::max(page.height >> levelOffset, 1) == height)
+        {
+            return levelOffset;
+        }
+    }
+    return -1;
+}
+
+
+size_t GLESTextureArrayAllocator::getLayerSize(GLenum internalFormat, GLsizei width, GLsizei height,
+                                               GLint numLevels)
+{
+    FormatBlock block = getFormatBlock(internalFormat);
+    size_t size = 0;
+    for (GLint level = 0; level < numLevels; ++level)
+    {
+        size_t blocksWide = static_cast<size_t>((std::max(width >> level, 1) + block.width - 1) / block.width);
+        size_t blocksHigh = static_cast<size_t>((std::max(height >> level, 1) + block.height - 1) / block.height);
+        size += blocksWide * blocksHigh * block.bytes;
+    }
+    return size;
+}
@@ -0,0 +1,107 @@
+/*===============================================================================
+Copyright (c) 2020 PTC Inc. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef _VUFORIA_GLESTEXTUREARRAYALLOCATOR_H_
+#define _VUFORIA_GLESTEXTUREARRAYALLOCATOR_H_
+
+#include <GLES3/gl31.h>
+
+#include <cstddef>
+#include <vector>
+
+
+/// Packs textures into the layers of shared GL_TEXTURE_2D_ARRAY textures, so draws using them need no rebinding.
+/**
+ * Arrays, called pages here, are grouped by internal format and wrap mode.
+ * A texture takes a layer of a page whose level 0 is its own size, or its
+ * size times 2^k as long as the page has k more levels than it needs. In
+ * that case the texture lives in levels k and up of the layer, and draws
+ * clamp the level of detail so the levels below are never sampled. Allocating
+ * the biggest textures first lets mipmapped textures of several sizes share
+ * one page.
+ *
+ * The first page for a size holds about PAGE_BYTES, each further page twice
+ * as many layers as the last, up to GL_MAX_ARRAY_TEXTURE_LAYERS. Freed layers
+ * are handed out again before any new page is created, and a page is deleted
+ * once its last layer is freed. Allocations never move, as GLES 3.1 can't
+ * copy compressed layers from one texture to another.
+ *
+ * The allocator only creates the storage, callers upload to the layer with
+ * glTexSubImage3D or glCompressedTexSubImage3D.
+ */
+class GLESTextureArrayAllocator
+{
+public:
+    /// A texture's place in a page
+    struct Allocation
+    {
+        /// The GL_TEXTURE_2D_ARRAY texture, 0 if the allocation failed
+        GLuint texture = 0;
+        GLint layer = 0;
+        /// Level of the page holding the texture's level 0
+        GLint levelOffset = 0;
+        GLint numLevels = 0;
+
+        bool isValid() const { return texture != 0; }
+    };
+
+    /// Layers and memory of all pages, for logging
+    struct Stats
+    {
+        unsigned int numPages = 0;
+        unsigned int numLayers = 0;
+        unsigned int numLayersUsed = 0;
+        size_t bytes = 0;
+    };
+
+    /// Delete every page, invalidating all allocations
+    void deinit();
+
+    /// Find a layer for a texture of numLevels levels, creating a page if none has room.
+    /// Single channel formats are swizzled to read as gray. Changes the
+    /// GL_TEXTURE_2D_ARRAY binding of the active unit when it creates a page.
+    Allocation allocate(GLenum internalFormat, GLsizei width, GLsizei height, GLint numLevels, GLenum wrapMode);
+
+    /// Release a layer for reuse, deleting its page if it was the last one in use
+    void release(const Allocation& allocation);
+
+    Stats getStats() const;
+
+private: // types
+
+    struct Page
+    {
+        GLuint texture;
+        GLenum internalFormat;
+        GLenum wrapMode;
+        GLsizei width;
+        GLsizei height;
+        GLint numLevels;
+        /// Which layers are allocated, one entry per layer
+        std::vector<bool> usedLayers;
+        GLsizei numLayersUsed;
+        size_t bytes;
+    };
+
+private: // methods
+
+    /// Create a page for textures like the one requested, sized from the pages already holding them
+    Page& createPage(GLenum internalFormat, GLsizei width, GLsizei height, GLint numLevels, GLenum wrapMode);
+
+    /// Level of a page that a texture's level 0 would go in, or -1 if the texture doesn't fit it
+    static GLint getLevelOffset(const Page& page, GLenum internalFormat, GLsizei width, GLsizei height,
+                                GLint numLevels, GLenum wrapMode);
+
+    /// Bytes of one layer with all its levels
+    static size_t getLayerSize(GLenum internalFormat, GLsizei width, GLsizei height, GLint numLevels);
+
+private: // data members
+
+    std::vector<Page> mPages;
+};
+
+#endif //_VUFORIA_GLESTEXTUREARRAYALLOCATOR_H_
@@ -0,0 +1,257 @@
+/*===============================================================================
+Copyright (c) 2020 PTC Inc. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "GLESTextureStreamer.h"
+
+#include "GLESUtils.h"
+
+#include <Log.h>
+
+#include <algorithm>
+
+#include "GLESRecordedCalls.h"
+
+
+namespace
+{
+    /// Levels no bigger than this across are uploaded by addTexture, the rest are streamed
+    constexpr uint32_t RESIDENT_LEVEL_SIZE = 128;
+}
+
+
+bool GLESTextureStreamer::init(GLsizeiptr frameBudget)
+{
+    deinit();
+    return mUploadRing.init(frameBudget);
+}
+
+
+void GLESTextureStreamer::deinit()
+{
+    for (StreamingTexture& texture : mTextures)
+    {
+        AAsset_close(texture.asset);
+    }
+    mTextures.clear();
+    mPendingUploads.clear();
+    mUploadRing.deinit();
+}
+
+
+void GLESTextureStreamer::abandon()
+{
+    for (StreamingTexture& texture : mTextures)
+    {
+        AAsset_close(texture.asset);
+    }
+    mTextures.clear();
+    mPendingUploads.clear();
+    mUploadRing = GLESBufferRing();
+}
+
+
+bool GLESTextureStreamer::addTexture(AAsset* asset, GLESTextureArrayAllocator& allocator,
+                                     GLESTextureArrayAllocator::Allocation& allocation, size_t& uploadedBytes)
+{
+    uploadedBytes = 0;
+
+    StreamingTexture texture;
+    texture.asset = asset;
+    texture.data = static_cast<const unsigned char*>(AAsset_getBuffer(asset));
+    if (texture.data == nullptr ||
+        !Ktx2Format::read(texture.data, static_cast<size_t>(AAsset_getLength(asset)), texture.header, texture.levels))
+    {
+        LOG("Error: Not a KTX2 texture the sample can load");
+        AAsset_close(asset);
+        return false;
+    }
+    texture.internalFormat = GLESUtils::getCompressedTextureFormat(texture.header.vkFormat);
+    if (texture.internalFormat == 0)
+    {
+        AAsset_close(asset);
+        return false;
+    }
+    texture.block = Ktx2Format::getBlockInfo(texture.header.vkFormat);
+    texture.blockRow = 0;
+    texture.numFrames = 0;
+
+    GLint numLevels = static_cast<GLint>(texture.levels.size());
+    texture.allocation = allocator.allocate(texture.internalFormat, getLevelWidth(texture, 0),
+                                            getLevelHeight(texture, 0), numLevels, GL_REPEAT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture.allocation.texture);
+
+    // Always upload the smallest level, then any others small enough, straight from the mapped asset
+    GLint level = numLevels - 1;
+    do
+    {
+        const Ktx2Format::LevelIndex& index = texture.levels[level];
+        glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, texture.allocation.levelOffset + level,
+                                  0, 0, texture.allocation.layer,
+                                  getLevelWidth(texture, level), getLevelHeight(texture, level), 1,
+                                  texture.internalFormat, static_cast<GLsizei>(index.byteLength),
+                                  texture.data + index.byteOffset);
+        uploadedBytes += index.byteLength;
+        --level;
+    }
+    while (level >= 0 && static_cast<uint32_t>(std::max(getLevelWidth(texture, level),
+                                                        getLevelHeight(texture, level))) <= RESIDENT_LEVEL_SIZE);
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    GLESUtils::checkGlError("Creating streamed texture");
+
+    allocation = texture.allocation;
+    if (level < 0)
+    {
+        AAsset_close(asset);
+    }
+    else
+    {
+        // Sampling is limited to the levels uploaded so far
+        texture.level = level;
+        texture.firstLevel = level + 1;
+        mTextures.push_back(std::move(texture));
+    }
+    return true;
+}
+
+
+void GLESTextureStreamer::removeTexture(const GLESTextureArrayAllocator::Allocation& allocation)
+{
+    auto textureIt = findTexture(allocation);
+    if (textureIt != mTextures.end())
+    {
+        AAsset_close(textureIt->asset);
+        mTextures.erase(textureIt);
+    }
+}
+
+
+GLint GLESTextureStreamer::getFirstLevel(const GLESTextureArrayAllocator::Allocation& allocation) const
+{
+    auto textureIt = findTexture(allocation);
+    return textureIt != mTextures.end() ? textureIt->firstLevel : 0;
+}
+
+
+size_t GLESTextureStreamer::update()
+{
+    if (mTextures.empty() || !mUploadRing.beginFrame())
+    {
+        return 0;
+    }
+
+    // Fill the budget with the smallest levels still to go, so every texture sharpens at a similar rate
+    mPendingUploads.clear();
+    std::vector<StreamingTexture*> queue;
+    for (StreamingTexture& texture : mTextures)
+    {
+        ++texture.numFrames;
+        queue.push_back(&texture);
+    }
+    while (!queue.empty())
+    {
+        auto nextIt = std::max_element(queue.begin(), queue.end(),
+                                       [](const StreamingTexture* a, const StreamingTexture* b) { return a->level < b->level; });
+        StreamingTexture& texture = **nextIt;
+
+        GLsizei width = getLevelWidth(texture, texture.level);
+        GLsizei height = getLevelHeight(texture, texture.level);
+        uint32_t numBlockRows = (static_cast<uint32_t>(height) + texture.block.height - 1) / texture.block.height;
+        GLsizeiptr rowSize = static_cast<GLsizeiptr>(
+            Ktx2Format::getLevelSize(texture.block, static_cast<uint32_t>(width), texture.block.height));
+        uint32_t numRows = std::min(numBlockRows - texture.blockRow,
+                                    static_cast<uint32_t>(mUploadRing.getBytesFree() / rowSize));
+        if (numRows == 0)
+        {
+            // The budget is spent, or too little is left for this texture
+            queue.erase(nextIt);
+            continue;
+        }
+
+        PendingUpload upload;
+        upload.textureIndex = static_cast<size_t>(&texture - mTextures.data());
+        upload.level = texture.level;
+        upload.yOffset = static_cast<GLint>(texture.blockRow * texture.block.height);
+        upload.width = width;
+        upload.height = std::min(static_cast<GLsizei>(numRows * texture.block.height), height - upload.yOffset);
+        upload.size = static_cast<GLsizei>(rowSize * numRows);
+        const unsigned char* source = texture.data + texture.levels[texture.level].byteOffset + rowSize * texture.blockRow;
+        if (!mUploadRing.write(source, upload.size, upload.offset))
+        {
+            break;
+        }
+
+        texture.blockRow += numRows;
+        upload.completesLevel = texture.blockRow == numBlockRows;
+        mPendingUploads.push_back(upload);
+        if (upload.completesLevel)
+        {
+            texture.blockRow = 0;
+            if (--texture.level < 0)
+            {
+                queue.erase(nextIt);
+            }
+        }
+    }
+    mUploadRing.unmap();
+
+    size_t uploadedBytes = 0;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mUploadRing.getBuffer());
+    for (const PendingUpload& upload : mPendingUploads)
+    {
+        StreamingTexture& texture = mTextures[upload.textureIndex];
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture.allocation.texture);
+        glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, texture.allocation.levelOffset + upload.level,
+                                  0, upload.yOffset, texture.allocation.layer, upload.width, upload.height, 1,
+                                  texture.internalFormat, upload.size, reinterpret_cast<const void*>(upload.offset));
+        if (upload.completesLevel)
+        {
+            texture.firstLevel = upload.level;
+        }
+        uploadedBytes += static_cast<size_t>(upload.size);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    mUploadRing.endFrame();
+    GLESUtils::checkGlError("Streaming textures");
+
+    // Release the assets of the textures now complete
+    auto completeIt = std::remove_if(mTextures.begin(), mTextures.end(), [](const StreamingTexture& texture) {
+        if (texture.level >= 0)
+        {
+            return false;
+        }
+        LOG("Texture in layer %d of array %u fully streamed after %u frames",
+            texture.allocation.layer, texture.allocation.texture, texture.numFrames);
+        AAsset_close(texture.asset);
+        return true;
+    });
+    mTextures.erase(completeIt, mTextures.end());
+
+    return uploadedBytes;
+}
+
+
+std::vector<GLESTextureStreamer::StreamingTexture>::const_iterator
+GLESTextureStreamer::findTexture(const GLESTextureArrayAllocator::Allocation& allocation) const
+{
+    return std::find_if(mTextures.begin(), mTextures.end(), [&allocation](const StreamingTexture& texture) {
+        return texture.allocation.texture == allocation.texture && texture.allocation.layer == allocation.layer;
+    });
+}
+
+
+GLsizei GLESTextureStreamer::getLevelWidth(const StreamingTexture& texture, GLint level)
+{
+    return std::max(static_cast<GLsizei>(texture.header.pixelWidth >> level), 1);
+}
+
+
+GLsizei GLESTextureStreamer::getLevelHeight(const StreamingTexture& texture, GLint level)
+{
+    return std::max(static_cast<GLsizei>(texture.header.pixelHeight >> level), 1);
+}
@@ -0,0 +1,125 @@
+/*===============================================================================
+Copyright (c) 2020 PTC Inc. All Rights Reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef _VUFORIA_GLESTEXTURESTREAMER_H_
+#define _VUFORIA_GLESTEXTURESTREAMER_H_
+
+#include <GLES3/gl31.h>
+
+#include "GLESBufferRing.h"
+#include "GLESTextureArrayAllocator.h"
+
+#include <Ktx2Format.h>
+
+#include <android/asset_manager.h>
+
+#include <cstddef>
+#include <vector>
+
+
+/// Uploads KTX2 textures a few mip levels at a time, smallest first.
+/**
+ * addTexture allocates a texture array layer for the texture and uploads the
+ * small levels straight away, so it can be drawn with, blurred, right away.
+ * Each update then copies the next levels into a GLESBufferRing bound as the
+ * pixel unpack buffer and uploads them from there, no more than the frame budget
+ * per frame. Levels bigger than the budget go up in bands of block rows over
+ * several frames.
+ *
+ * The layers of an array share its GL_TEXTURE_BASE_LEVEL, so rather than
+ * raising it the draws clamp their level of detail to getFirstLevel, the
+ * largest level uploaded so far.
+ *
+ * The asset of a texture stays open, with its data mapped, until it has been
+ * fully uploaded.
+ */
+class GLESTextureStreamer
+{
+public:
+    /// Set up to stream at most frameBudget bytes of texture data per frame
+    bool init(GLsizeiptr frameBudget);
+    /// Stop streaming and close the assets, the textures are left to their owners
+    void deinit();
+    /// Stop streaming and close the assets without any GL calls, forgetting the
+    /// upload buffer of a context that has been lost
+    void abandon();
+
+    /// Create a texture from a KTX2 asset in a layer from allocator and start streaming it,
+    /// taking ownership of the asset. Returns false and closes the asset if the file isn't
+    /// valid or the GL doesn't support its format. uploadedBytes is set to the size of
+    /// the levels uploaded now. The caller releases the allocation when done with it.
+    bool addTexture(AAsset* asset, GLESTextureArrayAllocator& allocator,
+                    GLESTextureArrayAllocator::Allocation& allocation, size_t& uploadedBytes);
+    /// Stop streaming a texture, call before releasing its allocation
+    void removeTexture(const GLESTextureArrayAllocator::Allocation& allocation);
+
+    /// Largest level of a texture uploaded so far, counted from the texture's own level 0.
+    /// 0 once the texture is complete or if it was never streamed.
+    GLint getFirstLevel(const GLESTextureArrayAllocator::Allocation& allocation) const;
+
+    /// Upload the next levels of the textures still streaming, call once per frame
+    /// before the draws that use them. Changes the GL_TEXTURE_2D_ARRAY binding of the active unit.
+    /// Returns the number of bytes uploaded.
+    size_t update();
+
+    /// Whether any texture hasn't been fully uploaded yet
+    bool isStreaming() const { return !mTextures.empty(); }
+
+private: // types
+
+    struct StreamingTexture
+    {
+        GLESTextureArrayAllocator::Allocation allocation;
+        AAsset* asset;
+        const unsigned char* data;
+        Ktx2Format::Header header;
+        std::vector<Ktx2Format::LevelIndex> levels;
+        GLenum internalFormat;
+        Ktx2Format::BlockInfo block;
+
+        /// Level being uploaded, and the first of its block rows still to go
+        GLint level;
+        uint32_t blockRow;
+        /// Largest complete level, the one the draws can sample from
+        GLint firstLevel;
+        /// Frames since addTexture, for the log once it completes
+        unsigned int numFrames;
+    };
+
+    /// A band of block rows copied into the ring, uploaded once the ring is unmapped
+    struct PendingUpload
+    {
+        size_t textureIndex;
+        GLint level;
+        GLint yOffset;
+        GLsizei width;
+        GLsizei height;
+        GLsizei size;
+        GLintptr offset;
+        bool completesLevel;
+    };
+
+private: // methods
+
+    /// Find a texture still streaming
+    std::vector<StreamingTexture>::const_iterator findTexture(
+        const GLESTextureArrayAllocator::Allocation& allocation) const;
+
+    /// Width and height of a mip level
+    static GLsizei getLevelWidth(const StreamingTexture& texture, GLint level);
+    static GLsizei getLevelHeight(const StreamingTexture& texture, GLint level);
+
+private: // data members
+
+    /// Staging for the uploads of the last few frames
+    GLESBufferRing mUploadRing;
+
+    std::vector<StreamingTexture> mTextures;
+    std::vector<PendingUpload> mPendingUploads;
+};
+
+#endif //_VUFORIA_GLESTEXTURESTREAMER_H_
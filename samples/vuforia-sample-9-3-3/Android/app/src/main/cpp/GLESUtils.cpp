@@ -7,10 +7,17 @@ countries.
 
 #include "GLESUtils.h"
 
+#include <Ktx2Format.h>
+
+#include <algorithm>
 #include <stdlib.h>
 
 #include <GLES3/gl31.h>
 #include <GLES3/gl3ext.h>
+// ASTC formats, from KHR_texture_compression_astc_ldr
+#include <GLES2/gl2ext.h>
+
+#include "GLESRecordedCalls.h"
 
 
 void
@@ -111,18 +118,17 @@ GLESUtils::createProgramFromBuffer(const char* vertexShaderBuffer,
 unsigned int
 GLESUtils::createTexture(const Vuforia::Image* image)
 {
-    GLuint gl_TextureID = 0;
-
-    glGenTextures(1, &gl_TextureID);
-
-    glBindTexture(GL_TEXTURE_2D, gl_TextureID);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    // Vuforia images may have padded rows
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, image->getBufferWidth());
+    unsigned int textureId = createTexture(image->getWidth(), image->getHeight(), image->getFormat(), image->getPixels());
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    return textureId;
+}
 
-    auto pixelFormat = image->getFormat();
 
+unsigned int
+GLESUtils::createTexture(int width, int height, Vuforia::PIXEL_FORMAT pixelFormat, const void* pixels)
+{
     GLenum format;
     GLenum type;
     switch (pixelFormat)
@@ -155,7 +161,20 @@ GLESUtils::createTexture(const Vuforia::Image* image)
             return -1;
     }
 
-    glTexImage2D(GL_TEXTURE_2D, 0, format, image->getWidth(), image->getHeight(), 0, format, type, image->getPixels());
+    GLuint gl_TextureID = 0;
+
+    glGenTextures(1, &gl_TextureID);
+
+    glBindTexture(GL_TEXTURE_2D, gl_TextureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // Rows of RGB888 and GRAYSCALE images aren't necessarily 4 byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, type, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
     glBindTexture(GL_TEXTURE_2D, 0);
 
@@ -194,6 +213,77 @@ GLESUtils::createTexture(int width, int height, unsigned char* data, GLenum form
 }
 
 
+bool
+GLESUtils::getTextureFormat(Vuforia::PIXEL_FORMAT pixelFormat, GLenum& internalFormat, GLenum& format, GLenum& type)
+{
+    switch (pixelFormat)
+    {
+        case Vuforia::RGB565:
+            internalFormat = GL_RGB565;
+            format = GL_RGB;
+            type = GL_UNSIGNED_SHORT_5_6_5;
+            return true;
+        case Vuforia::RGB888:
+            internalFormat = GL_RGB8;
+            format = GL_RGB;
+            type = GL_UNSIGNED_BYTE;
+            return true;
+        case Vuforia::RGBA8888:
+            internalFormat = GL_RGBA8;
+            format = GL_RGBA;
+            type = GL_UNSIGNED_BYTE;
+            return true;
+        case Vuforia::GRAYSCALE:
+            // GL_LUMINANCE has no sized format, the red channel is swizzled to gray instead
+            internalFormat = GL_R8;
+            format = GL_RED;
+            type = GL_UNSIGNED_BYTE;
+            return true;
+        default:
+            return false;
+    }
+}
+
+
+GLenum
+GLESUtils::getCompressedTextureFormat(uint32_t vkFormat)
+{
+    GLenum internalFormat;
+    switch (vkFormat)
+    {
+        case Ktx2Format::VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+            internalFormat = GL_COMPRESSED_RGB8_ETC2;
+            break;
+        case Ktx2Format::VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+            internalFormat = GL_COMPRESSED_RGBA8_ETC2_EAC;
+            break;
+        case Ktx2Format::VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+            internalFormat = GL_COMPRESSED_RGBA_ASTC_4x4_KHR;
+            break;
+        case Ktx2Format::VK_FORMAT_ASTC_6x6_UNORM_BLOCK:
+            internalFormat = GL_COMPRESSED_RGBA_ASTC_6x6_KHR;
+            break;
+        case Ktx2Format::VK_FORMAT_ASTC_8x8_UNORM_BLOCK:
+            internalFormat = GL_COMPRESSED_RGBA_ASTC_8x8_KHR;
+            break;
+        default:
+            return 0;
+    }
+
+    // ETC2 is core in GLES 3.0, ASTC needs KHR_texture_compression_astc_ldr
+    GLint numFormats = 0;
+    glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &numFormats);
+    std::vector<GLint> formats(static_cast<size_t>(numFormats));
+    glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.data());
+    if (std::find(formats.begin(), formats.end(), static_cast<GLint>(internalFormat)) == formats.end())
+    {
+        LOG("Compressed texture format 0x%x isn't supported", internalFormat);
+        return 0;
+    }
+    return internalFormat;
+}
+
+
 bool
 GLESUtils::destroyTexture(unsigned int textureId)
 {
@@ -13,6 +13,7 @@ countries.
 #include <Vuforia/Image.h>
 
 #include <GLES3/gl31.h>
+#include <cstdint>
 #include <vector>
 
 /// A utility class used by the Vuforia Engine samples.
@@ -38,10 +39,24 @@ public:
     /// Create a texture from a Vuforia Image
     static unsigned int createTexture(const Vuforia::Image* image);
 
+    /// Create a texture from tightly packed pixels in a Vuforia pixel format
+    static unsigned int createTexture(int width, int height,
+        Vuforia::PIXEL_FORMAT pixelFormat, const void* pixels);
+
     /// Create a texture from a byte vector
     static unsigned int createTexture(int width, int height,
         unsigned char* data, GLenum format = GL_RGBA);
 
+    /// Get the sized internal format, and the format and type of the pixels, for
+    /// texture storage in a Vuforia pixel format. GRAYSCALE is stored as GL_R8.
+    /// Returns false for formats GL can't store.
+    static bool getTextureFormat(Vuforia::PIXEL_FORMAT pixelFormat,
+        GLenum& internalFormat, GLenum& format, GLenum& type);
+
+    /// Get the GL internal format for a KTX2 vkFormat. Returns 0 if the GL
+    /// doesn't support it, so the caller can fall back to RGBA8.
+    static GLenum getCompressedTextureFormat(uint32_t vkFormat);
+
     /// Clean up texture
     static bool destroyTexture(unsigned int textureId);
 };
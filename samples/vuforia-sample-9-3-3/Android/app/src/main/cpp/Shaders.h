@@ -9,128 +9,272 @@ countries.
 #define _VUFORIA_SHADERS_H_
 
 /////////////////////////////////////////////////////////////////////////////////////////
-// texture shader: vertexTexCoord in vertex shader, texture2D sample
+// uber shader: every program is this source with a set of FEATURE_ defines in front,
+// see GLESShaderPermutations for the features and the locations the defines give
 /////////////////////////////////////////////////////////////////////////////////////////
-static const char* textureVertexShaderSrc = R"(
-    attribute vec4 vertexPosition;
-    attribute vec2 vertexTextureCoord;
-
-    uniform mat4 modelViewProjectionMatrix;
-
-    varying vec2 texCoord;
+static const char* uberVertexShaderSrc = R"(
+#if FEATURE_MULTIVIEW
+    layout(num_views = NUM_STEREO_VIEWS) in;
+#endif
+
+    // std140 layouts matching GLESRenderQueue::ViewConstants, or StereoViewConstants
+    // for the stereo features, and ObjectConstants
+    layout(std140, binding = VIEW_CONSTANTS_BINDING) uniform ViewConstants
+    {
+#if FEATURE_MULTIVIEW || FEATURE_INSTANCED_STEREO
+        mat4 projectionMatrices[NUM_STEREO_VIEWS];
+#else
+        mat4 projectionMatrix;
+#endif
+    };
+
+#if !FEATURE_INSTANCING
+    layout(std140, binding = OBJECT_CONSTANTS_BINDING) uniform ObjectConstants
+    {
+        mat4 modelViewMatrix;
+        vec4 objectColor;
+        // Layer, then the first and last level it may be sampled at, for FEATURE_TEXTURE_ARRAY
+        vec4 textureLayer;
+    };
+#endif
+
+    layout(location = LOCATION_VERTEX_POSITION) in vec4 vertexPosition;
+
+#if FEATURE_TEXTURE || FEATURE_TEXTURE_ARRAY
+    layout(location = LOCATION_VERTEX_TEXTURE_COORD) in vec2 vertexTextureCoord;
+    out vec2 texCoord;
+#endif
+
+#if FEATURE_TEXTURE_ARRAY
+    flat out vec3 textureLayerLods;
+#endif
+
+#if FEATURE_VERTEX_COLOR
+    layout(location = LOCATION_VERTEX_COLOR) in vec4 vertexColor;
+#endif
+
+#if FEATURE_LIGHTING
+    layout(location = LOCATION_VERTEX_NORMAL) in vec3 vertexNormal;
+    out vec3 normal;
+#endif
+
+#if FEATURE_INSTANCING
+    // Per instance, laid out as GLESRenderQueue::InstanceData
+    layout(location = LOCATION_INSTANCE_MODEL_VIEW_MATRIX) in mat4 instanceModelViewMatrix;
+    layout(location = LOCATION_INSTANCE_SCALE) in vec3 instanceScale;
+#if FEATURE_UNIFORM_COLOR
+    layout(location = LOCATION_INSTANCE_COLOR) in vec4 instanceColor;
+#endif
+#elif FEATURE_QUANTIZED_INPUTS
+    // Extent of the model, the normalized positions only span -1 to 1
+    layout(location = LOCATION_POSITION_SCALE) uniform vec3 positionScale;
+#endif
+
+#if FEATURE_VERTEX_COLOR
+    // Linear interpolated down at fragment shader
+    out vec4 color;
+#elif FEATURE_UNIFORM_COLOR
+    flat out vec4 color;
+#endif
+
+#if FEATURE_INSTANCED_STEREO && !defined(GL_EXT_clip_cull_distance)
+    // Positive on the instance's eye's side of the viewport, its left half for the left eye
+    out float eyeClipDistance;
+#endif
 
     void main()
     {
-        gl_Position = modelViewProjectionMatrix * vertexPosition;
+#if FEATURE_INSTANCING
+        // Instance scale is applied before the model view matrix
+        vec4 scaledPosition = vec4(vertexPosition.xyz * instanceScale, vertexPosition.w);
+        mat4 objectModelViewMatrix = instanceModelViewMatrix;
+#elif FEATURE_QUANTIZED_INPUTS
+        vec4 scaledPosition = vec4(vertexPosition.xyz * positionScale, 1.0);
+        mat4 objectModelViewMatrix = modelViewMatrix;
+#else
+        vec4 scaledPosition = vertexPosition;
+        mat4 objectModelViewMatrix = modelViewMatrix;
+#endif
+#if FEATURE_MULTIVIEW
+        mat4 viewProjectionMatrix = projectionMatrices[gl_ViewID_OVR];
+#elif FEATURE_INSTANCED_STEREO
+        // Each instance is drawn once per eye, the instance data advancing every NUM_STEREO_VIEWS instances
+        int eye = gl_InstanceID % NUM_STEREO_VIEWS;
+        mat4 viewProjectionMatrix = projectionMatrices[eye];
+#else
+        mat4 viewProjectionMatrix = projectionMatrix;
+#endif
+        gl_Position = viewProjectionMatrix * objectModelViewMatrix * scaledPosition;
+
+#if FEATURE_INSTANCED_STEREO
+        // The eyes' projections squeeze them into either half of one viewport, split at x = 0
+        float eyeDistance = eye == 0 ? -gl_Position.x : gl_Position.x;
+#ifdef GL_EXT_clip_cull_distance
+        gl_ClipDistance[0] = eyeDistance;
+#else
+        eyeClipDistance = eyeDistance;
+#endif
+#endif
+
+#if FEATURE_TEXTURE || FEATURE_TEXTURE_ARRAY
         texCoord = vertexTextureCoord;
-    }
-)";
-
+#endif
 
-static const char* textureFragmentShaderSrc = R"(
-    precision mediump float;
+#if FEATURE_TEXTURE_ARRAY
+        textureLayerLods = textureLayer.xyz;
+#endif
 
-    uniform sampler2D texSampler2D;
+#if FEATURE_LIGHTING
+        // View space, assuming the model view matrix scales uniformly
+        normal = mat3(objectModelViewMatrix) * vertexNormal;
+#endif
 
-    varying vec2 texCoord;
-
-    void main()
-    {
-        gl_FragColor = texture2D(texSampler2D, texCoord);
+#if FEATURE_VERTEX_COLOR || FEATURE_UNIFORM_COLOR
+#if FEATURE_VERTEX_COLOR
+        color = vertexColor;
+#else
+        color = vec4(1.0);
+#endif
+#if FEATURE_UNIFORM_COLOR && FEATURE_INSTANCING
+        color *= instanceColor;
+#elif FEATURE_UNIFORM_COLOR
+        color *= objectColor;
+#endif
+#endif
     }
 )";
 
 
-/////////////////////////////////////////////////////////////////////////////////////////
-// texture color shader: vertexTexCoord in vertex shader, uniform color, texture2D sample
-/////////////////////////////////////////////////////////////////////////////////////////
-static const char* textureColorVertexShaderSrc = R"(
-    attribute vec4 vertexPosition;
-    attribute vec2 vertexTextureCoord;
-
-    uniform mat4 modelViewProjectionMatrix;
-
-    varying vec2 texCoord;
+static const char* uberFragmentShaderSrc = R"(
+    precision mediump float;
 
-    void main()
-    {
-        gl_Position = modelViewProjectionMatrix * vertexPosition;
-        texCoord = vertexTextureCoord;
-    }
-)";
+#if FEATURE_TEXTURE
+    layout(location = LOCATION_TEX_SAMPLER_2D) uniform sampler2D texSampler2D;
+    in vec2 texCoord;
+#endif
 
+#if FEATURE_TEXTURE_ARRAY
+    layout(location = LOCATION_TEX_SAMPLER_2D_ARRAY) uniform mediump sampler2DArray texSampler2DArray;
+    // mediump coordinates are too coarse for the derivatives of a large texture
+    in highp vec2 texCoord;
+    flat in highp vec3 textureLayerLods;
+#endif
 
-static const char* textureColorFragmentShaderSrc = R"(
-    precision mediump float;
+#if FEATURE_LIGHTING
+    in vec3 normal;
+#endif
 
-    uniform sampler2D texSampler2D;
+#if FEATURE_VERTEX_COLOR
+    in vec4 color;
+#elif FEATURE_UNIFORM_COLOR
+    flat in vec4 color;
+#endif
 
-    varying vec2 texCoord;
+#if FEATURE_INSTANCED_STEREO && !defined(GL_EXT_clip_cull_distance)
+    in highp float eyeClipDistance;
+#endif
 
-    uniform vec4 uniformColor;
+    out vec4 fragColor;
 
     void main()
     {
-        vec4 texColor = texture2D(texSampler2D, texCoord);
-        gl_FragColor = texColor * uniformColor;
+#if FEATURE_INSTANCED_STEREO && !defined(GL_EXT_clip_cull_distance)
+        // Without clip distances the other eye's half is clipped here
+        if (eyeClipDistance < 0.0)
+        {
+            discard;
+        }
+#endif
+
+#if FEATURE_VERTEX_COLOR || FEATURE_UNIFORM_COLOR
+        fragColor = color;
+#else
+        fragColor = vec4(1.0);
+#endif
+
+#if FEATURE_TEXTURE
+        fragColor = texture(texSampler2D, texCoord) * fragColor;
+#endif
+
+#if FEATURE_TEXTURE_ARRAY
+        // The level of detail texture() would pick for the whole array, limited
+        // to the levels of the layer that hold this texture and have been uploaded
+        highp vec2 texelCoord = texCoord * vec2(textureSize(texSampler2DArray, 0).xy);
+        highp vec2 dx = dFdx(texelCoord);
+        highp vec2 dy = dFdy(texelCoord);
+        highp float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy)));
+        lod = clamp(lod, textureLayerLods.y, textureLayerLods.z);
+        fragColor = textureLod(texSampler2DArray, vec3(texCoord, textureLayerLods.x), lod) * fragColor;
+#endif
+
+#if FEATURE_LIGHTING
+        // Light at the camera, with enough ambient light that faces turned away don't go black
+        const float ambient = 0.3;
+        float diffuse = max(normalize(normal).z, 0.0);
+        fragColor.rgb *= ambient + (1.0 - ambient) * diffuse;
+#endif
     }
 )";
 
 
 /////////////////////////////////////////////////////////////////////////////////////////
-//uniform color shader: uniform color in frag shader
+// upscale: draws the part of GLESScaledTarget that augmentations were drawn to over the
+// whole viewport, SHARPEN defined to 1 or 0 in front picks the filter
 /////////////////////////////////////////////////////////////////////////////////////////
-static const char *uniformColorVertexShaderSrc = R"(
-    attribute vec4 vertexPosition;
+static const char* upscaleVertexShaderSrc = R"(
+    // Texture coordinates of the far corner of the part drawn to, then of the last texel centers inside it
+    layout(location = 1) uniform highp vec4 sourceRect;
 
-    uniform mat4 modelViewProjectionMatrix;
+    out highp vec2 texCoord;
 
     void main()
     {
-        gl_Position = modelViewProjectionMatrix * vertexPosition;
+        // One triangle covering the viewport, from the vertex index alone
+        vec2 corner = vec2(float((gl_VertexID & 1) << 2), float((gl_VertexID & 2) << 1));
+        gl_Position = vec4(corner - 1.0, 0.0, 1.0);
+        texCoord = corner * 0.5 * sourceRect.xy;
     }
 )";
 
 
-static const char *uniformColorFragmentShaderSrc = R"(
+static const char* upscaleFragmentShaderSrc = R"(
     precision mediump float;
 
-    uniform vec4 uniformColor;
+    layout(location = 0) uniform sampler2D targetSampler;
+    layout(location = 1) uniform highp vec4 sourceRect;
 
-    void main()
-    {
-        gl_FragColor = uniformColor;
-    }
-)";
+    in highp vec2 texCoord;
 
+    // Colors are premultiplied by alpha, the target having been cleared to transparent
+    out vec4 fragColor;
 
-/////////////////////////////////////////////////////////////////////////////////////////
-// vertex color shader: attribute color in vertex shader
-/////////////////////////////////////////////////////////////////////////////////////////
-static const char *vertexColorVertexShaderSrc = R"(
-    attribute vec4 vertexPosition;
-    attribute vec4 vertexColor;
-
-    uniform mat4 modelViewProjectionMatrix;
-
-    // Color to use per vertex, linear interpolated down at fragment shader
-    varying vec4 color;
-
-    void main()
+    // Filtering mustn't reach past the part drawn to, the rest of the target is stale
+    vec4 sampleTarget(highp vec2 coord)
     {
-        gl_Position = modelViewProjectionMatrix * vertexPosition;
-        color = vertexColor;
+        return texture(targetSampler, min(coord, sourceRect.zw));
     }
-)";
-
-static const char *vertexColorFragmentShaderSrc = R"(
-    precision mediump float;
-
-    varying vec4 color;
 
     void main()
     {
-        gl_FragColor = color;
+#if SHARPEN
+        // Bilinear, then sharpened against the four neighbours at the target's resolution.
+        // Clamping to the neighbourhood's range stops edges ringing.
+        const float sharpness = 0.5;
+        highp vec2 texelSize = 1.0 / vec2(textureSize(targetSampler, 0));
+        vec4 center = sampleTarget(texCoord);
+        vec4 left = sampleTarget(texCoord - vec2(texelSize.x, 0.0));
+        vec4 right = sampleTarget(texCoord + vec2(texelSize.x, 0.0));
+        vec4 down = sampleTarget(texCoord - vec2(0.0, texelSize.y));
+        vec4 up = sampleTarget(texCoord + vec2(0.0, texelSize.y));
+        vec4 minColor = min(center, min(min(left, right), min(down, up)));
+        vec4 maxColor = max(center, max(max(left, right), max(down, up)));
+        fragColor = center + sharpness * (center - 0.25 * (left + right + down + up));
+        fragColor = clamp(fragColor, minColor, maxColor);
+        // Keep it a valid premultiplied color
+        fragColor.rgb = min(fragColor.rgb, vec3(fragColor.a));
+#else
+        fragColor = sampleTarget(texCoord);
+#endif
     }
 )";
 
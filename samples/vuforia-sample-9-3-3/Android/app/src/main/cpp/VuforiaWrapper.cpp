@@ -8,18 +8,30 @@ countries.
 #include <jni.h>
 
 #include <AppController.h>
+#include <AugmentationRegistry.h>
 #include <Log.h>
 #include "GLESRenderer.h"
 
 #include <Vuforia/Tool.h>
 #include <Vuforia/GLRenderer.h>
+#include <Vuforia/ImageTargetResult.h>
+#include <Vuforia/ModelTargetResult.h>
 
 #include <GLES3/gl31.h>
 #include <android/asset_manager.h>
 #include <android/asset_manager_jni.h>
 
+#include <functional>
+#include <string>
 #include <vector>
 
+#include "GLESRecordedCalls.h"
+
+
+#ifdef VUFORIA_RECORD_GL_COMMANDS
+// Frames of GL commands to record after each initRendering, ten seconds at 30 fps
+constexpr unsigned int RECORDED_FRAMES = 300;
+#endif
 
 // Cross-platform AppController providing high level Vuforia Engine operations
 AppController controller;
@@ -35,9 +47,81 @@ struct
     jmethodID initDoneMethodID = nullptr;
 
     GLESRenderer renderer;
+    AugmentationRegistry augmentations;
 } gWrapperData;
 
 
+// Route each type of tracked result to the renderer method that draws its augmentation
+static void registerAugmentations()
+{
+    auto& augmentations = gWrapperData.augmentations;
+    if (augmentations.getNumHandlers() > 0)
+    {
+        return;
+    }
+
+    auto imageTargetHandler = augmentations.addHandler(
+        [](const Vuforia::Matrix44F& projectionMatrix, const AugmentationRegistry::Batch& batch)
+        {
+            for (const auto& augmentation : batch)
+            {
+                gWrapperData.renderer.renderImageTarget(projectionMatrix, augmentation.modelViewMatrix,
+                                                        augmentation.scaledModelViewMatrix);
+            }
+        });
+    augmentations.registerType(Vuforia::ImageTargetResult::getClassType(), imageTargetHandler);
+
+    auto modelTargetHandler = augmentations.addHandler(
+        [](const Vuforia::Matrix44F& projectionMatrix, const AugmentationRegistry::Batch& batch)
+        {
+            for (const auto& augmentation : batch)
+            {
+                gWrapperData.renderer.renderModelTarget(projectionMatrix, augmentation.modelViewMatrix,
+                                                        augmentation.scaledModelViewMatrix);
+            }
+        });
+    augmentations.registerType(Vuforia::ModelTargetResult::getClassType(), modelTargetHandler);
+}
+
+
+// Run a function with a JNIEnv for the calling thread. The init callbacks are invoked
+// on AppController's worker threads, which are only attached to the VM for the call.
+static void withJNIEnv(const std::function<void(JNIEnv*)>& function)
+{
+    JNIEnv* env = nullptr;
+    jint status = gWrapperData.vm->GetEnv((void**)&env, JNI_VERSION_1_6);
+    if (status == JNI_OK)
+    {
+        function(env);
+    }
+    else if (status == JNI_EDETACHED && gWrapperData.vm->AttachCurrentThread(&env, nullptr) == 0)
+    {
+        function(env);
+        gWrapperData.vm->DetachCurrentThread();
+    }
+}
+
+
+// Read an asset end to end and discard the contents.
+// Used to pull dataset files into the page cache while the engine initializes.
+static bool prefetchAsset(const std::string& filename)
+{
+    AAsset* asset = AAssetManager_open(gWrapperData.assetManager, filename.c_str(), AASSET_MODE_STREAMING);
+    if (asset == nullptr)
+    {
+        LOG("Error opening asset file %s", filename.c_str());
+        return false;
+    }
+    char buf[BUFSIZ];
+    int nb_read = 0;
+    while ((nb_read = AAsset_read(asset, buf, BUFSIZ)) > 0)
+    {
+    }
+    AAsset_close(asset);
+    return nb_read == 0;
+}
+
+
 // JNI Implementation
 #ifdef __cplusplus
 extern "C"
@@ -50,7 +134,9 @@ Java_com_vuforia_engine_NativeSample_VuforiaActivity_initAR(
     jobject /* this */,
     jobject activity,
     jobject assetManager,
-    jint target)
+    jint target,
+    jstring storagePath,
+    jstring deviceModel)
 {
     // Store the Java VM pointer so we can get a JNIEnv in callbacks
     if (env->GetJavaVM(&gWrapperData.vm) != 0)
@@ -65,29 +151,41 @@ Java_com_vuforia_engine_NativeSample_VuforiaActivity_initAR(
 
     AppController::InitConfig initConfig;
     initConfig.vuforiaInitFlags = Vuforia::INIT_FLAGS::GL_30;
-    initConfig.appData = activity;
+    // Initialization continues on a worker thread after this returns, so the local reference won't do
+    initConfig.appData = gWrapperData.activity;
 
     // Setup callbacks
     initConfig.showErrorCallback = [](const char *errorString)
     {
         LOG("Error callback invoked. Message: %s", errorString);
-        JNIEnv* env = nullptr;
-        if (gWrapperData.vm->GetEnv((void**)&env, JNI_VERSION_1_6) == 0)
+        withJNIEnv([errorString](JNIEnv* env)
         {
             jstring error = env->NewStringUTF(errorString);
             env->CallVoidMethod(gWrapperData.activity, gWrapperData.presentErrorMethodID, error);
             env->DeleteLocalRef(error);
-        }
+        });
     };
     initConfig.initDoneCallback = []()
     {
         LOG("InitDone callback");
-        JNIEnv* env = nullptr;
-        if (gWrapperData.vm->GetEnv((void**)&env, JNI_VERSION_1_6) == 0)
+        withJNIEnv([](JNIEnv* env)
         {
             env->CallVoidMethod(gWrapperData.activity, gWrapperData.initDoneMethodID);
-        }
+        });
     };
+    initConfig.initProgressCallback = [](int progress, const char* stageName)
+    {
+        LOG("Initialization progress %d%% (%s)", progress, stageName);
+    };
+
+    // Where the calibrated camera video mode is kept
+    const char* storagePathChars = env->GetStringUTFChars(storagePath, nullptr);
+    initConfig.storagePath = storagePathChars;
+    env->ReleaseStringUTFChars(storagePath, storagePathChars);
+    gWrapperData.renderer.setCacheDirectory(initConfig.storagePath);
+    const char* deviceModelChars = env->GetStringUTFChars(deviceModel, nullptr);
+    initConfig.deviceModel = deviceModelChars;
+    env->ReleaseStringUTFChars(deviceModel, deviceModelChars);
 
     // Get a native AAssetManager
     gWrapperData.assetManagerJava = env->NewGlobalRef(assetManager);
@@ -98,11 +196,67 @@ Java_com_vuforia_engine_NativeSample_VuforiaActivity_initAR(
         return;
     }
 
-    // Start Vuforia initialization
+    // Work that doesn't depend on the engine runs alongside Vuforia initialization.
+    // Every target's dataset is loaded, the initial target's first and the others
+    // for switching, so prefetch them all in that order.
+    std::vector<std::string> dataSetNames = { AppController::getDataSetName(target) };
+    for (int otherTarget : { AppController::IMAGE_TARGET_ID, AppController::MODEL_TARGET_ID })
+    {
+        if (otherTarget != target)
+        {
+            dataSetNames.push_back(AppController::getDataSetName(otherTarget));
+        }
+    }
+    initConfig.preloadTasks.push_back({ "Dataset prefetch", [dataSetNames]()
+    {
+        for (const auto& dataSetName : dataSetNames)
+        {
+            if (!prefetchAsset(dataSetName + ".xml") || !prefetchAsset(dataSetName + ".dat"))
+            {
+                return false;
+            }
+        }
+        return true;
+    }});
+    initConfig.preloadTasks.push_back({ "Model parse", []()
+    {
+        return gWrapperData.renderer.loadModels(gWrapperData.assetManager);
+    }});
+    // Separate tasks so the two textures decode on different workers
+    initConfig.preloadTasks.push_back({ "Astronaut texture decode", []()
+    {
+        return gWrapperData.renderer.loadAstronautImage(gWrapperData.assetManager);
+    }});
+    initConfig.preloadTasks.push_back({ "Lander texture decode", []()
+    {
+        return gWrapperData.renderer.loadLanderImage(gWrapperData.assetManager);
+    }});
+    initConfig.assetSizeCallback = [](const char* filename) -> size_t
+    {
+        AAsset* asset = AAssetManager_open(gWrapperData.assetManager, filename, AASSET_MODE_UNKNOWN);
+        if (asset == nullptr)
+        {
+            return 0;
+        }
+        auto assetSize = AAsset_getLength(asset);
+        AAsset_close(asset);
+        return static_cast<size_t>(assetSize);
+    };
+
+    // Start Vuforia initialization, initDone or presentError is called when it completes
     controller.initAR(initConfig, target);
 }
 
 
+JNIEXPORT void JNICALL
+Java_com_vuforia_engine_NativeSample_VuforiaActivity_cancelInitAR(
+        JNIEnv *env,
+        jobject /* this */)
+{
+    controller.cancelInitAR();
+}
+
+
 JNIEXPORT jboolean JNICALL
 Java_com_vuforia_engine_NativeSample_VuforiaActivity_startAR(
         JNIEnv *env,
@@ -154,6 +308,34 @@ Java_com_vuforia_engine_NativeSample_VuforiaActivity_deinitAR(
 }
 
 
+JNIEXPORT jboolean JNICALL
+Java_com_vuforia_engine_NativeSample_VuforiaActivity_switchTarget(
+    JNIEnv *env,
+    jobject /* this */,
+    jint target)
+{
+    return controller.switchTarget(target) ? JNI_TRUE : JNI_FALSE;
+}
+
+
+JNIEXPORT jint JNICALL
+Java_com_vuforia_engine_NativeSample_VuforiaActivity_getTarget(
+    JNIEnv *env,
+    jobject /* this */)
+{
+    return controller.getTarget();
+}
+
+
+JNIEXPORT jdouble JNICALL
+Java_com_vuforia_engine_NativeSample_VuforiaActivity_getTargetSwitchLatency(
+    JNIEnv *env,
+    jobject /* this */)
+{
+    return controller.getTargetSwitchLatencyMs();
+}
+
+
 JNIEXPORT void JNICALL
 Java_com_vuforia_engine_NativeSample_VuforiaActivity_cameraPerformAutoFocus(
     JNIEnv *env,
@@ -177,38 +359,46 @@ Java_com_vuforia_engine_NativeSample_VuforiaActivity_initRendering(
         JNIEnv *env,
         jobject /* this */)
 {
+#ifdef VUFORIA_RECORD_GL_COMMANDS
+    // Before anything is created, so the recording holds all its frames use
+    gWrapperData.renderer.startCommandRecording(RECORDED_FRAMES);
+#endif
+
     // Define clear color
     glClearColor(0.0f, 0.0f, 0.0f, Vuforia::requiresAlpha() ? 0.0f : 1.0f);
 
+    // Eyewear frames are drawn in a single pass where the driver allows, the
+    // renderer falls back to instancing without GL_OVR_multiview2
+    gWrapperData.renderer.setStereoMode(GLESRenderer::STEREO_MULTIVIEW);
+
+    // Augmentations drop below full resolution when the GPU can't keep up,
+    // on drivers that can time the frame
+    gWrapperData.renderer.setResolutionScaling(true, GLESScaledTarget::FILTER_SHARPEN);
+
     if (!gWrapperData.renderer.init(gWrapperData.assetManager))
     {
         LOG("Error initialising rendering");
     }
+
+    registerAugmentations();
 }
 
 
 JNIEXPORT void JNICALL
-Java_com_vuforia_engine_NativeSample_VuforiaActivity_setTextures(
+Java_com_vuforia_engine_NativeSample_VuforiaActivity_deinitRendering(
     JNIEnv *env,
-    jobject /* this */,
-    jint astronautWidth, jint astronautHeight, jobject astronautByteBuffer,
-    jint landerWidth, jint landerHeight, jobject landerByteBuffer)
+    jobject /* this */)
 {
-    // Textures are loaded using the BitmapFactory which isn't available from the NDK.
-    // They are loaded in the Kotlin code and passed to this method to create GLES textures.
-    auto astronautBytes = static_cast<unsigned char*>(env->GetDirectBufferAddress(astronautByteBuffer));
-    gWrapperData.renderer.setAstronautTexture(astronautWidth, astronautHeight, astronautBytes);
-    auto landerBytes = static_cast<unsigned char*>(env->GetDirectBufferAddress(landerByteBuffer));
-    gWrapperData.renderer.setLanderTexture(landerWidth, landerHeight, landerBytes);
+    gWrapperData.renderer.deinit();
 }
 
 
-JNIEXPORT void JNICALL
-Java_com_vuforia_engine_NativeSample_VuforiaActivity_deinitRendering(
+JNIEXPORT jboolean JNICALL
+Java_com_vuforia_engine_NativeSample_VuforiaActivity_isRenderingInitialized(
     JNIEnv *env,
     jobject /* this */)
 {
-    gWrapperData.renderer.deinit();
+    return gWrapperData.renderer.isInitialized() ? JNI_TRUE : JNI_FALSE;
 }
 
 
@@ -219,6 +409,7 @@ Java_com_vuforia_engine_NativeSample_VuforiaActivity_configureRendering(
         jint width, jint height,
         jint orientation)
 {
+    gWrapperData.renderer.setSurfaceSize(width, height);
     return controller.configureRendering(width, height, orientation) ? 1 : 0;
 }
 
@@ -233,8 +424,13 @@ Java_com_vuforia_engine_NativeSample_VuforiaActivity_renderFrame(
         return JNI_FALSE;
     }
 
-    // Clear colour and depth buffers
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // The renderer clears the colour and depth buffers when it submits the frame
+    gWrapperData.renderer.beginFrame();
+
+    // Pick up any Guide Views decoded in the background since the last frame.
+    // Uploading binds textures, so do it before Vuforia binds the camera texture
+    // that the renderer's queued draws rely on.
+    gWrapperData.renderer.updateGuideViewTextures(*controller.getGuideViewCache());
 
     Vuforia::GLTextureUnit vbTextureUnit;
     vbTextureUnit.mTextureUnit = 0;
@@ -242,16 +438,31 @@ Java_com_vuforia_engine_NativeSample_VuforiaActivity_renderFrame(
     if (controller.prepareToRender(viewport, nullptr, &vbTextureUnit))
     {
         // Set viewport for current view
-        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
-
-        auto renderingPrimitives = controller.getRenderingPrimitives();
-        Vuforia::Matrix44F vbProjectionMatrix = Vuforia::Tool::convert2GLMatrix(
-            renderingPrimitives->getVideoBackgroundProjectionMatrix(Vuforia::VIEW_SINGULAR));
-        const Vuforia::Mesh& vbMesh = renderingPrimitives->getVideoBackgroundMesh(Vuforia::VIEW_SINGULAR);
-        gWrapperData.renderer.renderVideoBackground(vbProjectionMatrix,
-            vbMesh.getPositionCoordinates(), vbMesh.getUVCoordinates(),
-            vbMesh.getNumTriangles(), vbMesh.getTriangles(),
-            vbTextureUnit.mTextureUnit);
+        const int viewportInts[4] = { static_cast<int>(viewport[0]), static_cast<int>(viewport[1]),
+                                      static_cast<int>(viewport[2]), static_cast<int>(viewport[3]) };
+        Vuforia::Vec4I frameViewport(viewportInts);
+        gWrapperData.renderer.setViewport(frameViewport);
+
+        Vuforia::Vec4I eyeViewports[2];
+        Vuforia::Matrix44F eyeProjectionMatrices[2];
+        if (controller.getStereoViews(eyeViewports, eyeProjectionMatrices))
+        {
+            // Eyewear is see-through, so there's no video background, and every
+            // augmentation is drawn for both eyes
+            gWrapperData.renderer.setStereoViews({ eyeViewports[0], eyeProjectionMatrices[0] },
+                                                 { eyeViewports[1], eyeProjectionMatrices[1] });
+        }
+        else
+        {
+            auto renderingPrimitives = controller.getRenderingPrimitives();
+            Vuforia::Matrix44F vbProjectionMatrix = Vuforia::Tool::convert2GLMatrix(
+                renderingPrimitives->getVideoBackgroundProjectionMatrix(Vuforia::VIEW_SINGULAR));
+            const Vuforia::Mesh& vbMesh = renderingPrimitives->getVideoBackgroundMesh(Vuforia::VIEW_SINGULAR);
+            gWrapperData.renderer.renderVideoBackground(vbProjectionMatrix, frameViewport,
+                vbMesh.getPositionCoordinates(), vbMesh.getUVCoordinates(),
+                vbMesh.getNumTriangles(), vbMesh.getTriangles(),
+                controller.getRenderingConfigGeneration(), vbTextureUnit.mTextureUnit);
+        }
 
         Vuforia::Matrix44F worldOriginProjection;
         Vuforia::Matrix44F worldOriginModelView;
@@ -262,28 +473,47 @@ Java_com_vuforia_engine_NativeSample_VuforiaActivity_renderFrame(
 
         Vuforia::Matrix44F trackableProjection;
         Vuforia::Matrix44F trackableModelView;
-        Vuforia::Matrix44F trackableModelViewScaled;
-        Vuforia::Image* modelTargetGuideViewImage = nullptr;
-        if (controller.getImageTargetResult(trackableProjection, trackableModelView, trackableModelViewScaled))
+        GuideViewCache::GuideViewId guideViewId;
+        if (controller.getTrackableResults(gWrapperData.augmentations, trackableProjection))
         {
-            gWrapperData.renderer.renderImageTarget(trackableProjection, trackableModelView, trackableModelViewScaled);
+            gWrapperData.augmentations.dispatch(trackableProjection);
         }
-        else if (controller.getModelTargetResult(trackableProjection, trackableModelView, trackableModelViewScaled))
+        else if (controller.getModelTargetGuideView(trackableProjection, trackableModelView, guideViewId))
         {
-            gWrapperData.renderer.renderModelTarget(trackableProjection, trackableModelView, trackableModelViewScaled);
+            gWrapperData.renderer.renderModelTargetGuideView(trackableProjection, trackableModelView, guideViewId);
         }
-        else if (controller.getModelTargetGuideView(trackableProjection, trackableModelView, &modelTargetGuideViewImage))
+    }
+
+    gWrapperData.renderer.endFrame();
+
+    // The pass timings are of a frame a few before this one, near enough for an average
+    const auto& passTimings = gWrapperData.renderer.getLastPassTimings();
+    double gpuMs = passTimings.empty() ? -1.0 : 0.0;
+    for (const GLESGpuTimer::ScopeTiming& timing : passTimings)
+    {
+        if (timing.gpuMs < 0.0)
         {
-            gWrapperData.renderer.renderModelTargetGuideView(trackableProjection, trackableModelView, modelTargetGuideViewImage);
+            gpuMs = -1.0;
+            break;
         }
+        gpuMs += timing.gpuMs;
     }
-
+    controller.addFrameCost(gWrapperData.renderer.getLastFrameStats().cpuMs, gpuMs);
     controller.finishRender(nullptr);
 
     return JNI_TRUE;
 }
 
 
+JNIEXPORT jboolean JNICALL
+Java_com_vuforia_engine_NativeSample_VuforiaActivity_needsRender(
+        JNIEnv *env,
+        jobject /* this */)
+{
+    return controller.needsRender() ? JNI_TRUE : JNI_FALSE;
+}
+
+
 JNIEXPORT jint JNICALL
 Java_com_vuforia_engine_NativeSample_VuforiaActivity_00024Companion_getImageTargetId(
     JNIEnv *env,
@@ -11,6 +11,7 @@ import android.app.Activity
 import android.content.DialogInterface
 import android.content.res.AssetManager
 import android.opengl.GLSurfaceView
+import android.os.Build
 import android.os.Bundle
 import android.support.v4.app.NavUtils
 import android.support.v4.view.GestureDetectorCompat
@@ -21,7 +22,6 @@ import android.view.*
 import android.view.GestureDetector.SimpleOnGestureListener
 import android.widget.RelativeLayout
 import kotlinx.coroutines.*
-import java.nio.ByteBuffer
 import java.util.*
 import javax.microedition.khronos.egl.EGLConfig
 import javax.microedition.khronos.opengles.GL10
@@ -46,8 +46,21 @@ class VuforiaActivity : AppCompatActivity(), GLSurfaceView.Renderer, SurfaceHold
 
     private var mGestureDetector : GestureDetectorCompat? = null
 
+    // Requests a render on each display refresh where the frame would differ from the last one,
+    // the display often refreshes faster than the camera delivers frames
+    private val mFrameCallback = object : Choreographer.FrameCallback {
+        override fun doFrame(frameTimeNanos: Long) {
+            if (mVuforiaStarted && (mSurfaceChanged || needsRender())) {
+                mGLView.requestRender()
+            }
+            Choreographer.getInstance().postFrameCallback(this)
+        }
+    }
+
     // Native methods
-    external fun initAR(activity : Activity, assetManager : AssetManager, target : Int)
+    external fun initAR(activity : Activity, assetManager : AssetManager, target : Int,
+                        storagePath : String, deviceModel : String)
+    external fun cancelInitAR()
     external fun deinitAR()
 
     external fun startAR() : Boolean
@@ -56,15 +69,19 @@ class VuforiaActivity : AppCompatActivity(), GLSurfaceView.Renderer, SurfaceHold
     external fun pauseAR()
     external fun resumeAR()
 
+    external fun switchTarget(target : Int) : Boolean
+    external fun getTarget() : Int
+    external fun getTargetSwitchLatency() : Double
+
     external fun cameraPerformAutoFocus()
     external fun cameraRestoreAutoFocus()
 
     external fun initRendering()
-    external fun setTextures(astronautWidth: Int, astronautHeight: Int, astronautBytes: ByteBuffer,
-                             landerWidth: Int, landerHeight: Int, landerBytes: ByteBuffer)
     external fun deinitRendering()
+    external fun isRenderingInitialized() : Boolean
     external fun configureRendering(width : Int, height : Int, orientation : Int) : Boolean
     external fun renderFrame() : Boolean
+    external fun needsRender() : Boolean
 
 
     // Activity methods
@@ -80,6 +97,7 @@ class VuforiaActivity : AppCompatActivity(), GLSurfaceView.Renderer, SurfaceHold
         mGLView.holder.addCallback(this)
         mGLView.setEGLContextClientVersion(3)
         mGLView.setRenderer(this)
+        mGLView.renderMode = GLSurfaceView.RENDERMODE_WHEN_DIRTY
         addContentView(mGLView, ViewGroup.LayoutParams(
             ViewGroup.LayoutParams.MATCH_PARENT,
             ViewGroup.LayoutParams.MATCH_PARENT)
@@ -123,6 +141,7 @@ class VuforiaActivity : AppCompatActivity(), GLSurfaceView.Renderer, SurfaceHold
 
 
     override fun onPause() {
+        Choreographer.getInstance().removeFrameCallback(mFrameCallback)
         pauseAR()
         super.onPause()
     }
@@ -130,6 +149,7 @@ class VuforiaActivity : AppCompatActivity(), GLSurfaceView.Renderer, SurfaceHold
 
     override fun onResume() {
         super.onResume()
+        Choreographer.getInstance().postFrameCallback(mFrameCallback)
 
         if (mVuforiaStarted) {
             GlobalScope.launch(Dispatchers.Unconfined) {
@@ -140,8 +160,12 @@ class VuforiaActivity : AppCompatActivity(), GLSurfaceView.Renderer, SurfaceHold
 
 
     override fun onBackPressed() {
+        // Stop any initialization still in progress before tearing down
+        cancelInitAR()
         stopAR()
         mVuforiaStarted = false;
+        // GL objects can only be deleted on the GL thread, with the context current
+        mGLView.queueEvent { deinitRendering() }
         deinitAR()
         super.onBackPressed()
     }
@@ -184,12 +208,24 @@ class VuforiaActivity : AppCompatActivity(), GLSurfaceView.Renderer, SurfaceHold
             onBackPressed()
             return true
         }
+
+        override fun onLongPress(e: MotionEvent) {
+            // Switch between the Image Target and Model Target, both datasets stay loaded
+            // so this takes effect on the next camera frame without reinitializing Vuforia
+            val newTarget = if (getTarget() == getImageTargetId()) getModelTargetId() else getImageTargetId()
+            if (switchTarget(newTarget)) {
+                Timer("ReportSwitchLatency", false).schedule(500) {
+                    Log.i("VuforiaSample", "Target switch latency %.1f ms".format(getTargetSwitchLatency()))
+                }
+            }
+        }
     }
 
 
     private suspend fun initializeVuforia() {
         return GlobalScope.async(Dispatchers.Default) {
-            initAR(this@VuforiaActivity, this@VuforiaActivity.assets, mTarget)
+            initAR(this@VuforiaActivity, this@VuforiaActivity.assets, mTarget,
+                   filesDir.absolutePath, Build.MODEL)
         }.await()
     }
 
@@ -261,16 +297,10 @@ class VuforiaActivity : AppCompatActivity(), GLSurfaceView.Renderer, SurfaceHold
         mWidth = width
         mHeight = height
 
-        // Re-load textures in case they got destroyed
-        var astronautTexture = Texture.loadTextureFromApk("astronaut.png", assets)
-        var landerTexture = Texture.loadTextureFromApk("lander.png", assets)
-        if (astronautTexture != null && landerTexture != null) {
-            setTextures(
-                astronautTexture.width, astronautTexture.height, astronautTexture.data!!,
-                landerTexture.width, landerTexture.height, landerTexture.data!!
-            )
-        } else {
-            Log.e("VuforiaSample", "Failed to load astronaut or lander texture");
+        // GLSurfaceView keeps its context when the surface is recreated, so the renderer's
+        // objects are normally still there, onSurfaceCreated only runs for a new context
+        if (!isRenderingInitialized()) {
+            initRendering()
         }
 
         // Update flag to tell us we need to update Vuforia configuration
@@ -285,9 +315,7 @@ class VuforiaActivity : AppCompatActivity(), GLSurfaceView.Renderer, SurfaceHold
     override fun surfaceChanged(var1: SurfaceHolder?, var2: Int, var3: Int, var4: Int) {}
 
 
-    override fun surfaceDestroyed(var1: SurfaceHolder?) {
-        deinitRendering()
-    }
+    override fun surfaceDestroyed(var1: SurfaceHolder?) {}
 
 
     companion object {
@@ -31,7 +31,7 @@ countries.
 #include <Vuforia/RenderingPrimitives.h>
 #include <Vuforia/PositionalDeviceTracker.h>
 #include <Vuforia/DeviceTrackableResult.h>
-#include <Vuforia/GuideView.h>
+#include <Vuforia/Frame.h>
 #include <Vuforia/Image.h>
 
 #if defined(ANDROID) || defined (__ANDROID__)  // ANDROID
@@ -57,6 +57,22 @@ namespace
 
     constexpr float NEAR_PLANE = 0.01f;
     constexpr float FAR_PLANE = 5.f;
+
+    /// Number of worker threads, one runs initAR's engine stages while the others take the preload tasks
+    constexpr unsigned int INIT_WORKER_THREADS = 3;
+    /// Relative share of the overall init progress taken by Vuforia::init()
+    constexpr int ENGINE_INIT_WEIGHT = 4;
+
+    /// Estimated memory the resident datasets may occupy before the least recently used are unloaded
+    constexpr size_t DATASET_MEMORY_BUDGET = 64 * 1024 * 1024;
+
+    /// Frame time the calibrated video mode must achieve, 30 frames per second
+    constexpr double VIDEO_MODE_FRAME_BUDGET_MS = 1000.0 / 30.0;
+    /// File in the storage path holding the calibrated video mode for each device model
+    constexpr char VIDEO_MODE_SELECTION_FILE[] = "VideoModeSelection.txt";
+
+    /// How often to log rendered and skipped frame counts, in rendered frames
+    constexpr size_t FRAME_STATS_INTERVAL = 300;
 }
 
 
@@ -66,38 +82,114 @@ AppController public methods
 
 void AppController::initAR(const InitConfig& initConfig, int target)
 {
+    std::lock_guard<std::mutex> initLock(mInitMutex);
+
     mVuforiaInitFlags = initConfig.vuforiaInitFlags;
     mShowErrorCallback = initConfig.showErrorCallback;
     mInitDoneCallback = initConfig.initDoneCallback;
+    mInitProgressCallback = initConfig.initProgressCallback;
+    mAssetSizeCallback = initConfig.assetSizeCallback;
+    mVideoModeSelectionPath = initConfig.storagePath.empty() ? "" :
+                              initConfig.storagePath + "/" + VIDEO_MODE_SELECTION_FILE;
+    mDeviceModel = initConfig.deviceModel;
     mTarget = target;
+    mRenderedTarget = target;
 
     mDoneOneTimeRenderingConfiguration = false;
     mCameraIsActive = false;
     mCameraIsStarted = false;
+    mFirstFrameRendered = false;
+    mNumFramesRendered = 0;
+    mNumFramesSkipped = 0;
+    mRenderCpuMs = 0.0;
+    mRenderGpuMs = 0.0;
+    mNumFramesCosted = 0;
+    mNumFramesGpuTimed = 0;
 
     mGuideViewModelTarget = nullptr;
-    
-    if (!initVuforiaInternal(initConfig.appData))
+
+    if (mExecutor == nullptr)
     {
-        return;
+        mExecutor = std::make_unique<TaskExecutor>(INIT_WORKER_THREADS);
+        mGuideViewCache = std::make_unique<GuideViewCache>();
     }
-    
-    if (!initTrackers())
+
+    {
+        std::lock_guard<std::mutex> lock(mInitPipelineMutex);
+        mInitPipeline = std::make_unique<InitPipeline>(*mExecutor);
+        if (mInitCancelled)
+        {
+            mInitPipeline->cancel();
+        }
+    }
+    InitPipeline& pipeline = *mInitPipeline;
+
+    void* appData = initConfig.appData;
+    pipeline.addStage("Engine init", InitPipeline::LANE::ENGINE,
+                      [this, appData](InitPipeline::StageContext& context) { return initVuforiaInternal(appData, context); },
+                      ENGINE_INIT_WEIGHT);
+    pipeline.addStage("Trackers init", InitPipeline::LANE::ENGINE,
+                      [this](InitPipeline::StageContext&) { return initTrackers(); });
+    pipeline.addStage("Dataset load", InitPipeline::LANE::ENGINE,
+                      [this](InitPipeline::StageContext&) { return loadTrackerData(); });
+
+    for (const auto& task : initConfig.preloadTasks)
     {
-        return;
+        auto function = task.function;
+        pipeline.addStage(task.name.c_str(), InitPipeline::LANE::BACKGROUND,
+                          [function](InitPipeline::StageContext&) { return function(); });
     }
 
-    if (!loadTrackerData())
+    if (mInitProgressCallback)
     {
-        return;
+        pipeline.setProgressCallback(mInitProgressCallback);
+    }
+
+    // The caller is often the UI thread, the outcome is reported through the callbacks
+    mExecutor->submit([this] { runInitPipeline(); });
+}
+
+
+void AppController::cancelInitAR()
+{
+    mInitCancelled = true;
+
+    std::lock_guard<std::mutex> lock(mInitPipelineMutex);
+    if (mInitPipeline != nullptr)
+    {
+        mInitPipeline->cancel();
     }
-    
-    mInitDoneCallback();
+}
+
+
+bool AppController::switchTarget(int target)
+{
+    if (mDataSetManager == nullptr)
+    {
+        return false;
+    }
+
+    invalidateRender();
+    return mDataSetManager->requestSwitch(target);
+}
+
+
+double AppController::getTargetSwitchLatencyMs() const
+{
+    return mDataSetManager != nullptr ? mDataSetManager->getLastSwitchLatencyMs() : 0.0;
+}
+
+
+const char* AppController::getDataSetName(int target)
+{
+    return target == IMAGE_TARGET_ID ? "StonesAndChips" : "VuforiaMars_ModelTarget";
 }
 
 
 bool AppController::startAR()
 {
+    std::lock_guard<std::mutex> cameraLock(mCameraMutex);
+
     if (mCameraIsStarted || mCameraIsActive)
     {
         LOG("Application logic error, attempt to startAR when already started");
@@ -111,8 +203,8 @@ bool AppController::startAR()
         return false;
     }
 
-    // select the default video mode
-    if(! Vuforia::CameraDevice::getInstance().selectVideoMode(mCameraMode))
+    // select the calibrated video mode, or the default one
+    if(! selectInitialVideoMode())
     {
         mShowErrorCallback("Failed to set the camera mode");
         return false;
@@ -140,6 +232,9 @@ bool AppController::startAR()
         LOG("Failed to set camera to continuous autofocus, camera may not support this");
     }
 
+    // Dataset switches are applied from the update callback
+    Vuforia::registerCallback(&mUpdateCallback);
+
     mCameraIsActive = true;
     mCameraIsStarted = true;
     return true;
@@ -154,6 +249,7 @@ void AppController::pauseAR()
     bool successfullyPaused = true;
     std::string cameraErrorMessage;
     
+    std::unique_lock<std::mutex> cameraLock(mCameraMutex);
     if (mCameraIsActive)
     {
         // Stop and deinit the camera
@@ -169,7 +265,11 @@ void AppController::pauseAR()
         }
         mCameraIsActive = false;
     }
+    cameraLock.unlock();
     Vuforia::onPause();
+
+    // Don't count the paused time as tracking time
+    mLastUpdateTicks = 0;
     
    if(!successfullyPaused)
    {
@@ -186,6 +286,7 @@ void AppController::resumeAR()
     Vuforia::onResume();
     std::string cameraErrorMessage;
     bool successfullyResumed = true;
+    std::lock_guard<std::mutex> cameraLock(mCameraMutex);
     // if the camera was previously started, but not currently active, then
     // we restart it
     if ((mCameraIsStarted) && (!mCameraIsActive))
@@ -197,6 +298,14 @@ void AppController::resumeAR()
             cameraErrorMessage = "Failed to initialize the camera.";
             successfullyResumed = false;
         }
+
+        // reinitializing the camera resets the video mode
+        else if (!Vuforia::CameraDevice::getInstance().selectVideoMode(
+                     mVideoModeIndex != VideoModeSelector::NO_MODE ? mVideoModeIndex : mCameraMode))
+        {
+            cameraErrorMessage = "Failed to set the camera mode.";
+            successfullyResumed = false;
+        }
         
         else if (!Vuforia::CameraDevice::getInstance().start()) // start the camera
         {
@@ -217,31 +326,49 @@ void AppController::resumeAR()
 
     if(mCameraIsStarted)
     {
-        updateRenderingPrimitives();
+        // The camera is restarted in the same video mode so this is normally a cache hit
+        applyRenderingConfiguration();
     }
+
+    invalidateRender();
 }
 
 
 void AppController::stopAR()
 {
-    // Stop the camera
-    if (mCameraIsActive)
     {
-        // Stop and deinit the camera
-        Vuforia::CameraDevice::getInstance().stop();
-        Vuforia::CameraDevice::getInstance().deinit();
-        mCameraIsActive = false;
+        std::lock_guard<std::mutex> cameraLock(mCameraMutex);
+
+        // Stop the camera
+        if (mCameraIsActive)
+        {
+            // Stop and deinit the camera
+            Vuforia::CameraDevice::getInstance().stop();
+            Vuforia::CameraDevice::getInstance().deinit();
+            mCameraIsActive = false;
+        }
+        mCameraIsStarted = false;
     }
-    mCameraIsStarted = false;
 
     // Stop trackers
     stopTrackers();
+
+    stopSessionRecording();
 }
 
 
 void AppController::deinitAR()
 {
+    // Wait for any initialization in progress, cancelInitAR should be called first
+    // to make this quick, and let a queued video mode switch finish
+    if (mExecutor != nullptr)
+    {
+        mExecutor->waitIdle();
+    }
+    std::lock_guard<std::mutex> initLock(mInitMutex);
+
     Vuforia::onPause();
+    Vuforia::registerCallback(nullptr);
 
     // ask the application to unload the data associated to the trackers
     if(!unloadTrackerData())
@@ -253,6 +380,12 @@ void AppController::deinitAR()
     deinitTrackers();
 
     Vuforia::deinit();
+
+    // The RenderingPrimitives belong to this engine session, the next one calculates its own
+    mRenderingConfigCache.clear();
+    mCurrentRenderingPrimitives.reset();
+
+    mInitCancelled = false;
 }
 
 
@@ -270,7 +403,9 @@ void AppController::cameraRestoreAutoFocus()
 
 void AppController::updateRenderingPrimitives()
 {
-    mCurrentRenderingPrimitives.reset(new Vuforia::RenderingPrimitives(Vuforia::Device::getInstance().getRenderingPrimitives()));
+    mRenderingConfigCache.clear();
+    applyRenderingConfiguration();
+    invalidateRender();
 }
 
 
@@ -281,8 +416,14 @@ bool AppController::configureRendering(int width, int height, int orientation)
         return false;
     }
 
+    mReconfigureStartTime = std::chrono::steady_clock::now();
+    mAwaitingReconfiguredFrame = true;
+    invalidateRender();
+
     mOrientation = orientation;
     mDisplayAspectRatio = (float)width / height;
+    mViewWidth = width;
+    mViewHeight = height;
 
     setVuforiaOrientation(orientation);
 
@@ -304,7 +445,7 @@ bool AppController::configureRendering(int width, int height, int orientation)
         Vuforia::onSurfaceChanged(largerSize, smallerSize);
     }
 
-    configureVideoBackground(float(width), float(height));
+    applyRenderingConfiguration();
 
     return true;
 }
@@ -313,7 +454,33 @@ bool AppController::configureRendering(int width, int height, int orientation)
 bool AppController::prepareToRender(double* viewport, Vuforia::RenderData* renderData,
                                     Vuforia::TextureUnit* videoBackgroundTextureUnit, Vuforia::TextureData* videoBackgroundTexture)
 {
+    // Read before fetching the state so an update that lands in between is rendered next time
+    mRenderedStateVersion = mStateVersion.load();
+    mRenderInvalidated = false;
+    if (mGuideViewCache != nullptr)
+    {
+        mRenderedGuideViewGeneration = mGuideViewCache->getGeneration();
+    }
+
     mVuforiaState = Vuforia::TrackerManager::getInstance().getStateUpdater().updateState();
+
+    if (mSessionRecorder.isOpen())
+    {
+        FrameSnapshot snapshot;
+        captureFrameSnapshot(mVuforiaState, snapshot);
+        mSessionRecorder.record(std::move(snapshot));
+    }
+
+    // A target switch invalidates any Guide View from the previous dataset
+    int target = mTarget;
+    if (target != mRenderedTarget)
+    {
+        mRenderedTarget = target;
+        mGuideViewModelTarget = nullptr;
+    }
+
+    mRenderStartTime = std::chrono::steady_clock::now();
+
     auto& renderer = Vuforia::Renderer::getInstance();
     renderer.begin(mVuforiaState, renderData);
 
@@ -321,6 +488,11 @@ bool AppController::prepareToRender(double* viewport, Vuforia::RenderData* rende
     {
         updateRenderingPrimitives();
     }
+    else if (mRenderingConfigurationStale.exchange(false))
+    {
+        // The video mode has changed, and with it the video background
+        applyRenderingConfiguration();
+    }
     
     // Set up the viewport
     Vuforia::Vec4I viewportInfo;
@@ -345,6 +517,65 @@ bool AppController::prepareToRender(double* viewport, Vuforia::RenderData* rende
 void AppController::finishRender(Vuforia::RenderData* renderData)
 {
     Vuforia::Renderer::getInstance().end(renderData);
+
+    if (mVideoModeSwitchFailed.exchange(false))
+    {
+        // The remaining modes can't be measured reliably, calibrate again next time AR starts
+        LOG("Video mode calibration abandoned");
+        mVideoModeSelector.reset();
+    }
+
+    // Frames rendered while a switch is queued may come from either mode, so aren't sampled
+    if (mVideoModeSelector != nullptr && mVideoModeSelector->isCalibrating() && !mVideoModeSwitchPending)
+    {
+        double renderMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mRenderStartTime).count();
+        int nextMode = mVideoModeSelector->addSample(mTrackingPeriodMs, renderMs);
+        bool calibrationFinished = !mVideoModeSelector->isCalibrating();
+        if (nextMode != VideoModeSelector::NO_MODE)
+        {
+            queueVideoModeSwitch(nextMode, calibrationFinished);
+        }
+        if (calibrationFinished)
+        {
+            mVideoModeSelector.reset();
+        }
+    }
+
+    if (mAwaitingReconfiguredFrame)
+    {
+        mAwaitingReconfiguredFrame = false;
+        mReconfigureLatencyMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - mReconfigureStartTime).count();
+        LOG("First frame after rendering reconfiguration in %.1f ms", mReconfigureLatencyMs);
+    }
+
+    size_t numFramesRendered = ++mNumFramesRendered;
+    if (numFramesRendered % FRAME_STATS_INTERVAL == 0)
+    {
+        size_t numFramesSkipped = mNumFramesSkipped;
+        LOG("Rendered %zu frames, skipped %zu unchanged frames (%.0f%%)", numFramesRendered, numFramesSkipped,
+            100.0 * numFramesSkipped / (numFramesRendered + numFramesSkipped));
+        // A skipped frame would have cost what the rendered ones did on average,
+        // leaving out the buffer swap and composition, which aren't measured
+        if (mNumFramesCosted > 0)
+        {
+            double cpuMs = mRenderCpuMs / mNumFramesCosted;
+            LOG("  Skipping saved an estimated %.0f ms of renderer CPU time, at %.2f ms a frame",
+                cpuMs * numFramesSkipped, cpuMs);
+        }
+        if (mNumFramesGpuTimed > 0)
+        {
+            double gpuMs = mRenderGpuMs / mNumFramesGpuTimed;
+            LOG("  Skipping saved an estimated %.0f ms of GPU time, at %.2f ms a frame",
+                gpuMs * numFramesSkipped, gpuMs);
+        }
+    }
+
+    if (!mFirstFrameRendered && mInitPipeline != nullptr)
+    {
+        mFirstFrameRendered = true;
+        LOG("Startup timeline: first frame rendered at %.1f ms", mInitPipeline->getElapsedMs());
+    }
 }
 
 
@@ -360,10 +591,7 @@ bool AppController::getOrigin(Vuforia::Matrix44F& projectionMatrix,
             Vuforia::Matrix44F viewMatrix = Vuforia::Tool::convertPose2GLMatrix(origin->getPose());
             modelViewMatrix = MathUtils::Matrix44FTranspose(MathUtils::Matrix44FInverse(viewMatrix));
 
-            projectionMatrix = Vuforia::Tool::convertPerspectiveProjection2GLMatrix(
-                mCurrentRenderingPrimitives->getProjectionMatrix(Vuforia::VIEW_SINGULAR,
-                                                                 mVuforiaState.getCameraCalibration()),
-                NEAR_PLANE, FAR_PLANE);
+            projectionMatrix = getViewProjectionMatrix(isStereo() ? Vuforia::VIEW_LEFTEYE : Vuforia::VIEW_SINGULAR);
 
             return true;
         }
@@ -373,194 +601,283 @@ bool AppController::getOrigin(Vuforia::Matrix44F& projectionMatrix,
 }
 
 
-bool AppController::getImageTargetResult(Vuforia::Matrix44F& projectionMatrix,
-                                         Vuforia::Matrix44F& modelViewMatrix,
-                                         Vuforia::Matrix44F& scaledModelViewMatrix)
+bool AppController::getTrackableResults(AugmentationRegistry& registry, Vuforia::Matrix44F& projectionMatrix)
 {
+    registry.beginFrame();
+
+    auto deviceResult = mVuforiaState.getDeviceTrackableResult();
+    if (deviceResult == nullptr)
+    {
+        // Nothing can be placed without the device pose, including a Guide View
+        mGuideViewModelTarget = nullptr;
+        return false;
+    }
+
+    // The view and projection matrices are shared by every result in the frame
+    Vuforia::Matrix44F viewMatrix = Vuforia::Tool::convertPose2GLMatrix(deviceResult->getPose());
+    viewMatrix = MathUtils::Matrix44FTranspose(MathUtils::Matrix44FInverse(viewMatrix));
+
+    projectionMatrix = getViewProjectionMatrix(isStereo() ? Vuforia::VIEW_LEFTEYE : Vuforia::VIEW_SINGULAR);
+
+    AugmentationRegistry::Augmentation augmentation;
     const auto& trackableResultList = mVuforiaState.getTrackableResults();
     for (const auto* result : trackableResultList)
     {
-
-        if (result->isOfType(Vuforia::ImageTargetResult::getClassType()) && mTarget == IMAGE_TARGET_ID)
+        // The device pose is already in the view matrix, it has no augmentation of its own
+        if (result->isOfType(Vuforia::DeviceTrackableResult::getClassType()))
         {
-            const Vuforia::ImageTargetResult* itResult = static_cast<const Vuforia::ImageTargetResult*>(result);
-            const Vuforia::ImageTarget& target = itResult->getTrackable();
+            continue;
+        }
 
-            Vuforia::Matrix44F viewMatrix = Vuforia::Tool::convertPose2GLMatrix(mVuforiaState.getDeviceTrackableResult()->getPose());
-            viewMatrix = MathUtils::Matrix44FTranspose(MathUtils::Matrix44FInverse(viewMatrix));
+        if (result->isOfType(Vuforia::ModelTargetResult::getClassType()))
+        {
+            const Vuforia::ModelTargetResult* mtResult = static_cast<const Vuforia::ModelTargetResult*>(result);
+            if (mtResult->getStatus() == Vuforia::TrackableResult::NO_POSE)
+            {
+                if (mtResult->getStatusInfo() == Vuforia::TrackableResult::NO_DETECTION_RECOMMENDING_GUIDANCE)
+                {
+                    mGuideViewModelTarget = &mtResult->getTrackable();
+                }
+                continue;
+            }
+            mGuideViewModelTarget = nullptr;
+        }
+        else if (result->getStatus() == Vuforia::TrackableResult::NO_POSE)
+        {
+            continue;
+        }
 
-            // Get the projection matrix
-            projectionMatrix = Vuforia::Tool::convertPerspectiveProjection2GLMatrix(
-                mCurrentRenderingPrimitives->getProjectionMatrix(Vuforia::VIEW_SINGULAR,
-                                                                 mVuforiaState.getCameraCalibration()),
-                NEAR_PLANE, FAR_PLANE);
+        const Vuforia::Trackable& trackable = result->getTrackable();
+        augmentation.trackableId = trackable.getId();
 
-            // Get object pose and populate modelViewMatrix
-            modelViewMatrix = Vuforia::Tool::convertPose2GLMatrix(result->getPose());
-            MathUtils::multiplyMatrix(viewMatrix, modelViewMatrix, modelViewMatrix);
+        // Get object pose and populate modelViewMatrix
+        augmentation.modelViewMatrix = Vuforia::Tool::convertPose2GLMatrix(result->getPose());
+        MathUtils::multiplyMatrix(viewMatrix, augmentation.modelViewMatrix, augmentation.modelViewMatrix);
 
-            // Calculate a scaled modelViewMatrix for rendering a unit bounding box
-            auto targetSize = target.getSize();
+        // Calculate a scaled modelViewMatrix for rendering a unit bounding box
+        if (result->isOfType(Vuforia::ImageTargetResult::getClassType()))
+        {
+            auto targetSize = static_cast<const Vuforia::ImageTarget&>(trackable).getSize();
             // z-dimension will be zero for planar target
             // set it here to the larger dimension so that
             // a 3D augmentation can be shown
             targetSize.data[2] = std::max(targetSize.data[0], targetSize.data[1]);
-            scaledModelViewMatrix = MathUtils::Matrix44FScale(targetSize, modelViewMatrix);
+            augmentation.scaledModelViewMatrix = MathUtils::Matrix44FScale(targetSize, augmentation.modelViewMatrix);
+        }
+        else if (result->isOfType(Vuforia::ModelTargetResult::getClassType()))
+        {
+            const auto& target = static_cast<const Vuforia::ModelTarget&>(trackable);
+            Vuforia::Obb3D boundingBox = target.getBoundingBox();
+            Vuforia::Vec3F translateCenter = Vuforia::Vec3F(boundingBox.getCenter().data[0], boundingBox.getCenter().data[1], boundingBox.getCenter().data[2]);
 
-            return true;
+            Vuforia::Matrix44F scaleMatrix;
+            Vuforia::Vec3F targetScale = target.getSize();
+            MathUtils::makeScalingMatrix(targetScale, scaleMatrix);
+
+            Vuforia::Matrix44F translateMatrix;
+            MathUtils::makeTranslationMatrix(translateCenter, translateMatrix);
+
+            MathUtils::multiplyMatrix(translateMatrix, scaleMatrix, augmentation.scaledModelViewMatrix);
+            MathUtils::multiplyMatrix(augmentation.modelViewMatrix, augmentation.scaledModelViewMatrix,
+                                      augmentation.scaledModelViewMatrix);
         }
+        else
+        {
+            augmentation.scaledModelViewMatrix = augmentation.modelViewMatrix;
+        }
+
+        registry.submit(result->getType(), augmentation);
     }
-    
-    return false;
+
+    return registry.getNumSubmitted() > 0;
 }
 
 
-bool AppController::getModelTargetResult(Vuforia::Matrix44F& projectionMatrix,
-                                         Vuforia::Matrix44F& modelViewMatrix,
-                                         Vuforia::Matrix44F& scaledModelViewMatrix)
+bool AppController::needsRender()
 {
-    const auto& trackableResultList = mVuforiaState.getTrackableResults();
-    for (const auto* result : trackableResultList)
+    bool guideViewsChanged = mGuideViewCache != nullptr &&
+                             mGuideViewCache->getGeneration() != mRenderedGuideViewGeneration;
+    if (mRenderInvalidated || guideViewsChanged || mStateVersion != mRenderedStateVersion)
     {
+        return true;
+    }
 
-        if (result->isOfType(Vuforia::ModelTargetResult::getClassType()) && mTarget == MODEL_TARGET_ID)
-        {
-            const Vuforia::ModelTargetResult* mtResult = static_cast<const Vuforia::ModelTargetResult*>(result);
-            const Vuforia::ModelTarget& target = mtResult->getTrackable();
-            
-            if(mtResult->getStatus() == Vuforia::TrackableResult::NO_POSE)
-            {
-                if(mtResult->getStatusInfo() == Vuforia::TrackableResult::NO_DETECTION_RECOMMENDING_GUIDANCE)
-                {
-                    mGuideViewModelTarget = &target;
-                }
-                continue;
-            }
-            else
-            {
-                mGuideViewModelTarget = nullptr;
+    ++mNumFramesSkipped;
+    return false;
+}
 
-                Vuforia::Matrix44F viewMatrix = Vuforia::Tool::convertPose2GLMatrix(mVuforiaState.getDeviceTrackableResult()->getPose());
-                viewMatrix = MathUtils::Matrix44FTranspose(MathUtils::Matrix44FInverse(viewMatrix));
 
-                // Get the projection matrix
-                projectionMatrix = Vuforia::Tool::convertPerspectiveProjection2GLMatrix(
-                    mCurrentRenderingPrimitives->getProjectionMatrix(Vuforia::VIEW_SINGULAR,
-                                                                     mVuforiaState.getCameraCalibration()),
-                    NEAR_PLANE, FAR_PLANE);
+void AppController::addFrameCost(double cpuMs, double gpuMs)
+{
+    mRenderCpuMs += cpuMs;
+    ++mNumFramesCosted;
+    if (gpuMs >= 0.0)
+    {
+        mRenderGpuMs += gpuMs;
+        ++mNumFramesGpuTimed;
+    }
+}
 
-                // Get object pose and populate modelViewMatrix
-                modelViewMatrix = Vuforia::Tool::convertPose2GLMatrix(result->getPose());
-                MathUtils::multiplyMatrix(viewMatrix, modelViewMatrix, modelViewMatrix);
 
-                // Calculate a scaled modelViewMatrix for rendering a unit bounding box
-                Vuforia::Obb3D boundingBox = target.getBoundingBox();
-                Vuforia::Vec3F translateCenter = Vuforia::Vec3F(boundingBox.getCenter().data[0], boundingBox.getCenter().data[1], boundingBox.getCenter().data[2]);
-                
-                Vuforia::Matrix44F scaleMatrix;
-                Vuforia::Vec3F targetScale = target.getSize();
-                MathUtils::makeScalingMatrix(targetScale, scaleMatrix);
+bool AppController::startSessionRecording(const std::string& path)
+{
+    if (!mSessionRecorder.open(path))
+    {
+        mShowErrorCallback("Unable to create session recording");
+        return false;
+    }
+    return true;
+}
 
-                Vuforia::Matrix44F translateMatrix;
-                MathUtils::makeTranslationMatrix(translateCenter, translateMatrix);
 
-                MathUtils::multiplyMatrix(translateMatrix, scaleMatrix, scaledModelViewMatrix);
-                MathUtils::multiplyMatrix(modelViewMatrix, scaledModelViewMatrix, scaledModelViewMatrix);
+void AppController::stopSessionRecording()
+{
+    mSessionRecorder.close();
+}
 
-                return true;
-            }
-        }
+
+bool AppController::getStereoViews(Vuforia::Vec4I viewports[2], Vuforia::Matrix44F projectionMatrices[2])
+{
+    if (!isStereo())
+    {
+        return false;
     }
 
-    return false;
+    const Vuforia::VIEW eyes[2] = { Vuforia::VIEW_LEFTEYE, Vuforia::VIEW_RIGHTEYE };
+    for (int i = 0; i < 2; ++i)
+    {
+        viewports[i] = mCurrentRenderingPrimitives->getViewport(eyes[i]);
+        projectionMatrices[i] = getViewProjectionMatrix(eyes[i]);
+    }
+    return true;
 }
 
 
 bool AppController::getModelTargetGuideView(Vuforia::Matrix44F& projectionMatrix,
                                             Vuforia::Matrix44F& modelViewMatrix,
-                                            Vuforia::Image **guideViewImage)
+                                            GuideViewCache::GuideViewId& guideViewId)
 {
-    if (mGuideViewModelTarget == nullptr)
+    if (mGuideViewModelTarget == nullptr || mGuideViewCache == nullptr)
     {
         return false;
     }
-    
-    auto guideViewList = mGuideViewModelTarget->getGuideViews();
-    if(guideViewList.size() !=0)
+
+    int guideViewIndex = mGuideViewModelTarget->getActiveGuideViewIndex();
+    if (guideViewIndex < 0)
     {
-        auto guideViewTarget = guideViewList.at(0);
-        
-        auto guideImage = guideViewTarget->getImage();
-        
-        const Vuforia::CameraCalibration* cameraCalibration = mVuforiaState.getCameraCalibration();
-        if(cameraCalibration != nullptr)
-        {
-            modelViewMatrix = MathUtils::Matrix44FIdentity();
-            projectionMatrix = MathUtils::Matrix44FIdentity();
+        return false;
+    }
 
-            Vuforia::Vec2F scale;
+    const Vuforia::CameraCalibration* cameraCalibration = mVuforiaState.getCameraCalibration();
+    if (cameraCalibration == nullptr)
+    {
+        return false;
+    }
 
-            float guideViewAspectRatio = (float)guideImage->getWidth() / guideImage->getHeight();
+    // Layouts are only recalculated if the display or camera have changed
+    mGuideViewCache->setDisplay(mDisplayAspectRatio, cameraCalibration->getFieldOfViewRads().data[1]);
 
-            float planeDistance = 0.01f;
-            float fieldOfView = mVuforiaState.getCameraCalibration()->getFieldOfViewRads().data[1];
-            float nearPlaneHeight = 1.0f * planeDistance * std::tanf(fieldOfView * 0.5f);
-            float nearPlaneWidth = nearPlaneHeight * mDisplayAspectRatio;
-            float planeWidth;
-            float planeHeight;
+    guideViewId = GuideViewCache::makeId(mGuideViewModelTarget->getId(), guideViewIndex);
+    if (!mGuideViewCache->getLayout(guideViewId, mDisplayAspectRatio < 1.0f, modelViewMatrix))
+    {
+        // Not decoded yet
+        return false;
+    }
 
+    projectionMatrix = MathUtils::Matrix44FIdentity();
+    return true;
+}
 
-            if(guideViewAspectRatio >= 1.0f && mDisplayAspectRatio >= 1.0f) // guideview landscape, camera landscape
-            {
-                // scale so that the long side of the camera (width)
-                // is the same length as guideview width
-                planeWidth = nearPlaneWidth;
-                planeHeight = planeWidth / guideViewAspectRatio;
-            }
 
-            else if(guideViewAspectRatio < 1.0f && mDisplayAspectRatio < 1.0f) // guideview portrait, camera portrait
-            {
-                // scale so that the long side of the camera (height)
-                // is the same length as guideview height
-                planeHeight = nearPlaneHeight;
-                planeWidth = planeHeight * guideViewAspectRatio;
-            }
-            else if (mDisplayAspectRatio < 1.0f) // guideview landscape, camera portrait
-            {
-                // scale so that the long side of the camera (height)
-                // is the same length as guideview width
-                planeWidth = nearPlaneHeight;
-                planeHeight = planeWidth / guideViewAspectRatio;
-            }
-            else // guideview portrait, camera landscape
+bool AppController::setGuideView(int guideViewIndex)
+{
+    if (mGuideViewModelTarget == nullptr)
+    {
+        return false;
+    }
+
+    // The State only hands out const trackables, this is the same object the dataset owns
+    auto modelTarget = const_cast<Vuforia::ModelTarget*>(mGuideViewModelTarget);
+    invalidateRender();
+    return modelTarget->setActiveGuideViewIndex(guideViewIndex);
+}
+
+
+/*===============================================================================
+AppController private methods
+===============================================================================*/
+
+void AppController::runInitPipeline()
+{
+    std::lock_guard<std::mutex> initLock(mInitMutex);
+
+    InitPipeline& pipeline = *mInitPipeline;
+    auto state = pipeline.run();
+    pipeline.logTimeline();
+
+    switch (state)
+    {
+        case InitPipeline::STATE::SUCCEEDED:
+            mInitDoneCallback();
+            break;
+
+        case InitPipeline::STATE::CANCELLED:
+            LOG("Initialization cancelled after %.1f ms", pipeline.getElapsedMs());
+            break;
+
+        default:
+        {
+            // Engine stages report their own errors, background stages can't
+            // safely call back into the platform layer so report them here
+            for (const auto& entry : pipeline.getTimeline())
             {
-                // scale so that the long side of the camera (width)
-                // is the same length as guideview height
-                planeHeight = nearPlaneWidth;
-                planeWidth = planeHeight * guideViewAspectRatio;
+                if (!entry.succeeded && entry.lane == InitPipeline::LANE::BACKGROUND)
+                {
+                    std::string errorMessage = "Error preparing application data: " + entry.name;
+                    mShowErrorCallback(errorMessage.c_str());
+                    break;
+                }
             }
+            break;
+        }
+    }
+}
+
 
-            // normalize world space plane sizes into view space again
-            scale = Vuforia::Vec2F( 2 * planeWidth / nearPlaneWidth, 2 * planeHeight / nearPlaneHeight);
 
-            modelViewMatrix = MathUtils::Matrix44FScale(Vuforia::Vec3F(scale.data[0], scale.data[1], 1.0f), modelViewMatrix);
 
-            *guideViewImage = const_cast<Vuforia::Image*>(guideImage);
-            return true;
-        }
 
+bool AppController::isStereo() const
+{
+    if (mCurrentRenderingPrimitives == nullptr)
+    {
         return false;
     }
-
-    return false;
+    const Vuforia::ViewList& views = mCurrentRenderingPrimitives->getRenderingViews();
+    return views.contains(Vuforia::VIEW_LEFTEYE) && views.contains(Vuforia::VIEW_RIGHTEYE);
 }
 
 
-/*===============================================================================
-AppController private methods
-===============================================================================*/
+Vuforia::Matrix44F AppController::getViewProjectionMatrix(Vuforia::VIEW view)
+{
+    Vuforia::Matrix44F projectionMatrix = Vuforia::Tool::convertPerspectiveProjection2GLMatrix(
+        mCurrentRenderingPrimitives->getProjectionMatrix(view, mVuforiaState.getCameraCalibration()),
+        NEAR_PLANE, FAR_PLANE);
+    if (view == Vuforia::VIEW_SINGULAR)
+    {
+        return projectionMatrix;
+    }
 
-bool AppController::initVuforiaInternal(void* appData)
+    // The adjustment applies to eye space, ahead of the projection
+    Vuforia::Matrix44F eyeAdjustmentMatrix =
+        Vuforia::Tool::convert2GLMatrix(mCurrentRenderingPrimitives->getEyeDisplayAdjustmentMatrix(view));
+    Vuforia::Matrix44F adjustedProjectionMatrix;
+    MathUtils::multiplyMatrix(projectionMatrix, eyeAdjustmentMatrix, adjustedProjectionMatrix);
+    return adjustedProjectionMatrix;
+}
+
+
+bool AppController::initVuforiaInternal(void* appData, InitPipeline::StageContext& context)
 {
 #if defined (__ANDROID__)  // ANDROID
     Vuforia::setInitParameters(jobject(appData), mVuforiaInitFlags, licenseKey);
@@ -581,7 +898,12 @@ bool AppController::initVuforiaInternal(void* appData)
     int progress = 0;
     while (progress >= 0 && progress < 100)
     {
+        if (context.isCancelled())
+        {
+            return false;
+        }
         progress = Vuforia::init();
+        context.reportProgress(progress);
     }
     
     if (progress == 100)
@@ -642,7 +964,8 @@ bool AppController::initVuforiaInternal(void* appData)
 void AppController::setVuforiaOrientation(int orientation) const
 {
 #if defined(ANDROID) || defined (__ANDROID__)  // ANDROID
-    
+    (void)orientation;
+
 #elif defined(WINAPI_FAMILY) // UWP
     switch (orientation)
     {
@@ -707,28 +1030,43 @@ bool AppController::initTrackers()
 
 bool AppController::loadTrackerData()
 {
-    if (mCurrentDataSet != nullptr)
+    if (mDataSetManager != nullptr && mDataSetManager->getActiveDataSetId() != DataSetManager::NO_DATASET)
     {
         mShowErrorCallback("Attempt to load a dataset when one is already loaded");
         return false;
     }
 
-    if (mTarget == IMAGE_TARGET_ID)
+    mDataSetManager = std::make_unique<DataSetManager>(*mExecutor, DATASET_MEMORY_BUDGET);
+    // Decode Guide Views as each dataset is loaded, before it can be activated, so switching views never waits
+    GuideViewCache* guideViewCache = mGuideViewCache.get();
+    mDataSetManager->setResidencyCallbacks(
+        [guideViewCache](int id, Vuforia::DataSet* dataSet) { guideViewCache->addDataSet(id, dataSet); },
+        [guideViewCache](int id, Vuforia::DataSet*) { guideViewCache->removeDataSet(id); });
+    for (int target : { IMAGE_TARGET_ID, MODEL_TARGET_ID })
     {
-        mCurrentDataSet = loadAndActivateDataSet("StonesAndChips.xml");
-        if (mCurrentDataSet == nullptr)
+        std::string name = getDataSetName(target);
+        size_t estimatedSize = 0;
+        if (mAssetSizeCallback)
         {
-            mShowErrorCallback("Error loading dataset for Image Target");
-            return false;
+            estimatedSize = mAssetSizeCallback((name + ".xml").c_str()) + mAssetSizeCallback((name + ".dat").c_str());
         }
+        mDataSetManager->addDataSet(target, name + ".xml", estimatedSize);
     }
-    else
+
+    // The selected target is needed before we can start, the others are only
+    // needed if the user switches so can load while the session starts up
+    if (!mDataSetManager->load(mTarget) || !mDataSetManager->activate(mTarget))
     {
-        mCurrentDataSet = loadAndActivateDataSet("VuforiaMars_ModelTarget.xml");
-        if (mCurrentDataSet == nullptr)
+        mShowErrorCallback(mTarget == IMAGE_TARGET_ID ? "Error loading dataset for Image Target" :
+                                                        "Error loading dataset for Model Target");
+        return false;
+    }
+
+    for (int target : { IMAGE_TARGET_ID, MODEL_TARGET_ID })
+    {
+        if (target != mTarget)
         {
-            mShowErrorCallback("Error loading dataset for Model Target");
-            return false;
+            mDataSetManager->preload(target);
         }
     }
 
@@ -738,30 +1076,185 @@ bool AppController::loadTrackerData()
 
 bool AppController::unloadTrackerData()
 {
-    // Get the image tracker:
-    Vuforia::TrackerManager& trackerManager = Vuforia::TrackerManager::getInstance();
-    Vuforia::ObjectTracker* objectTracker = static_cast<Vuforia::ObjectTracker*>(trackerManager.getTracker(Vuforia::ObjectTracker::getClassType()));
-    if (objectTracker == nullptr)
+    // Nothing was loaded if initialization failed or was cancelled before the dataset load
+    if (mDataSetManager == nullptr)
     {
-        return false;
+        return true;
     }
-    
-    if (!objectTracker->deactivateDataSet(mCurrentDataSet))
+
+    mDataSetManager->unloadAll();
+    mDataSetManager.reset();
+
+    return true;
+}
+
+
+void AppController::onVuforiaUpdate(Vuforia::State& state)
+{
+    // Only a new camera frame or different results change what is rendered
+    captureFrameSnapshot(state, mUpdateSnapshot);
+    if (!mUpdateSnapshot.isUnchangedFrom(mLastUpdateSnapshot))
     {
-        LOG("Warning: Failed to deactivate the data set.");
+        std::swap(mUpdateSnapshot, mLastUpdateSnapshot);
+        ++mStateVersion;
     }
-    
-    if (!objectTracker->destroyDataSet(mCurrentDataSet))
+
+    // The time between updates is how long the trackers take per camera frame,
+    // bounded below by the camera frame rate
+    using Clock = std::chrono::steady_clock;
+    Clock::rep now = Clock::now().time_since_epoch().count();
+    Clock::rep last = mLastUpdateTicks.exchange(now);
+    if (last != 0)
     {
-        LOG("Warning: Failed to destory the data set.");
+        mTrackingPeriodMs = std::chrono::duration<double, std::milli>(Clock::duration(now - last)).count();
     }
-    
-    mCurrentDataSet = nullptr;
 
+    if (mDataSetManager != nullptr && mDataSetManager->onUpdate())
+    {
+        mTarget = mDataSetManager->getActiveDataSetId();
+        LOG("Switched to target %d in %.1f ms", mTarget.load(), mDataSetManager->getLastSwitchLatencyMs());
+    }
+}
+
+
+bool AppController::selectInitialVideoMode()
+{
+    Vuforia::CameraDevice& cameraDevice = Vuforia::CameraDevice::getInstance();
+    if (mVideoModeSelectionPath.empty())
+    {
+        return cameraDevice.selectVideoMode(mCameraMode);
+    }
+
+    VideoModeSelector::Mode savedMode;
+    if (VideoModeSelector::loadSelection(mVideoModeSelectionPath, mDeviceModel, savedMode))
+    {
+        // Match on the mode itself, indices may differ between engine versions. The frame
+        // rate is saved with every digit, so it compares exactly.
+        for (int i = 0; i < cameraDevice.getNumVideoModes(); ++i)
+        {
+            Vuforia::VideoMode videoMode = cameraDevice.getVideoMode(i);
+            if (videoMode.mWidth == savedMode.width && videoMode.mHeight == savedMode.height &&
+                videoMode.mFramerate == savedMode.framerate)
+            {
+                LOG("Using calibrated video mode %dx%d@%.0f", videoMode.mWidth, videoMode.mHeight, videoMode.mFramerate);
+                mVideoModeIndex = i;
+                return cameraDevice.selectVideoMode(i);
+            }
+        }
+    }
+
+    std::vector<VideoModeSelector::Mode> modes;
+    for (int i = 0; i < cameraDevice.getNumVideoModes(); ++i)
+    {
+        Vuforia::VideoMode videoMode = cameraDevice.getVideoMode(i);
+        modes.push_back({ i, videoMode.mWidth, videoMode.mHeight, videoMode.mFramerate });
+    }
+
+    mVideoModeSelector = std::make_unique<VideoModeSelector>(std::move(modes), VIDEO_MODE_FRAME_BUDGET_MS);
+    int firstMode = mVideoModeSelector->startCalibration();
+    if (firstMode == VideoModeSelector::NO_MODE)
+    {
+        mVideoModeSelector.reset();
+        return cameraDevice.selectVideoMode(mCameraMode);
+    }
+
+    LOG("Calibrating video modes for %s", mDeviceModel.c_str());
+    mVideoModeIndex = firstMode;
+    return cameraDevice.selectVideoMode(firstMode);
+}
+
+
+void AppController::queueVideoModeSwitch(int videoModeIndex, bool calibrationFinished)
+{
+    // Read while the camera is known to be running, the switch may find it stopped
+    Vuforia::VideoMode videoMode = Vuforia::CameraDevice::getInstance().getVideoMode(videoModeIndex);
+    VideoModeSelector::Mode mode = { videoModeIndex, videoMode.mWidth, videoMode.mHeight, videoMode.mFramerate };
+
+    mVideoModeSwitchPending = true;
+    mExecutor->submit([this, mode, calibrationFinished]
+    {
+        if (switchVideoMode(mode.index))
+        {
+            if (calibrationFinished)
+            {
+                saveVideoModeSelection(mode);
+            }
+        }
+        else
+        {
+            mVideoModeSwitchFailed = true;
+        }
+        mVideoModeSwitchPending = false;
+        invalidateRender();
+    });
+}
+
+
+bool AppController::switchVideoMode(int videoModeIndex)
+{
+    std::lock_guard<std::mutex> cameraLock(mCameraMutex);
+
+    int previousIndex = mVideoModeIndex;
+    if (videoModeIndex == previousIndex)
+    {
+        return true;
+    }
+
+    if (!mCameraIsActive)
+    {
+        // Paused or stopped, resumeAR selects the mode when it restarts the camera
+        mVideoModeIndex = videoModeIndex;
+        return true;
+    }
+
+    bool switched = restartCamera(videoModeIndex);
+    if (switched)
+    {
+        mVideoModeIndex = videoModeIndex;
+    }
+    else
+    {
+        LOG("Error: Failed to switch to video mode %d, restoring the previous mode", videoModeIndex);
+        if (!restartCamera(previousIndex != VideoModeSelector::NO_MODE ? previousIndex : mCameraMode))
+        {
+            mCameraIsActive = false;
+            mShowErrorCallback("Failed to restart the camera");
+            return false;
+        }
+    }
+
+    // The video background depends on the video mode, the render thread reapplies it
+    mRenderingConfigurationStale = true;
+    return switched;
+}
+
+
+bool AppController::restartCamera(int videoModeIndex)
+{
+    // The video mode can only be selected between init and start
+    Vuforia::CameraDevice& cameraDevice = Vuforia::CameraDevice::getInstance();
+    cameraDevice.stop();
+    cameraDevice.deinit();
+    if (!cameraDevice.init() || !cameraDevice.selectVideoMode(videoModeIndex) || !cameraDevice.start())
+    {
+        return false;
+    }
+
+    if (!cameraDevice.setFocusMode(Vuforia::CameraDevice::FOCUS_MODE_CONTINUOUSAUTO))
+    {
+        LOG("Failed to set camera to continuous autofocus, camera may not support this");
+    }
     return true;
 }
 
 
+void AppController::saveVideoModeSelection(const VideoModeSelector::Mode& mode)
+{
+    LOG("Calibration selected video mode %dx%d@%.0f", mode.width, mode.height, mode.framerate);
+    VideoModeSelector::saveSelection(mVideoModeSelectionPath, mDeviceModel, mode);
+}
+
+
 bool AppController::startTrackers()
 {
     Vuforia::TrackerManager& trackerManager = Vuforia::TrackerManager::getInstance();
@@ -820,12 +1313,9 @@ void AppController::deinitTrackers()
 }
 
 
-void AppController::configureVideoBackground(float viewWidth, float viewHeight)
+Vuforia::VideoBackgroundConfig AppController::calculateVideoBackgroundConfig(float viewWidth, float viewHeight,
+                                                                             const Vuforia::VideoMode& videoMode) const
 {
-    // Get the default video mode
-    Vuforia::CameraDevice& cameraDevice = Vuforia::CameraDevice::getInstance();
-    Vuforia::VideoMode videoMode = cameraDevice.getCurrentVideoMode();
-    
     // Configure the video background
     Vuforia::VideoBackgroundConfig config;
     config.mPosition.data[0] = 0;
@@ -937,52 +1427,90 @@ void AppController::configureVideoBackground(float viewWidth, float viewHeight)
         
     }
     
-    // Set the config
-    Vuforia::Renderer::getInstance().setVideoBackgroundConfig(config);
-    updateRenderingPrimitives();
+    return config;
 }
 
 
-Vuforia::DataSet* AppController::loadAndActivateDataSet(std::string path)
+void AppController::applyRenderingConfiguration()
 {
-    LOG("Loading data set from %s", path.c_str());
-    Vuforia::DataSet* dataSet = nullptr;
-    
-    // Get the Vuforia tracker manager image tracker
-    Vuforia::TrackerManager& trackerManager = Vuforia::TrackerManager::getInstance();
-    Vuforia::ObjectTracker* objectTracker = static_cast<Vuforia::ObjectTracker*>(trackerManager.getTracker(Vuforia::ObjectTracker::getClassType()));
-    
-    if (objectTracker == nullptr)
+    RenderingConfigCache::Key key;
+    key.width = mViewWidth;
+    key.height = mViewHeight;
+    key.orientation = mOrientation;
+    key.videoMode = Vuforia::CameraDevice::getInstance().getCurrentVideoMode();
+
+    auto& renderer = Vuforia::Renderer::getInstance();
+    const RenderingConfigCache::Config* config = mRenderingConfigCache.find(key);
+    if (config != nullptr)
     {
-        LOG("Error: Failed to get the ObjectTracker from the TrackerManager");
+        // Vuforia still needs the configuration, but the primitives don't need copying again
+        renderer.setVideoBackgroundConfig(config->videoBackgroundConfig);
     }
     else
     {
-        dataSet = objectTracker->createDataSet();
-        if (dataSet == nullptr)
+        Vuforia::VideoBackgroundConfig videoBackgroundConfig = renderer.getVideoBackgroundConfig();
+        if (mViewWidth > 0 && mViewHeight > 0)
         {
-            LOG("Error: Failed to create data set");
+            videoBackgroundConfig = calculateVideoBackgroundConfig(float(mViewWidth), float(mViewHeight), key.videoMode);
+            renderer.setVideoBackgroundConfig(videoBackgroundConfig);
         }
-        else
+
+        auto renderingPrimitives = std::make_shared<Vuforia::RenderingPrimitives>(
+            Vuforia::Device::getInstance().getRenderingPrimitives());
+        config = &mRenderingConfigCache.insert(key, videoBackgroundConfig, std::move(renderingPrimitives));
+    }
+
+    mCurrentRenderingPrimitives = config->renderingPrimitives;
+    mRenderingConfigGeneration = config->generation;
+}
+
+
+void AppController::captureFrameSnapshot(const Vuforia::State& state, FrameSnapshot& snapshot) const
+{
+    snapshot.timestamp = state.getFrame().getTimeStamp();
+
+    auto deviceResult = state.getDeviceTrackableResult();
+    snapshot.hasDevicePose = false;
+    if (deviceResult != nullptr)
+    {
+        snapshot.hasDevicePose = true;
+        snapshot.deviceStatus = static_cast<uint8_t>(deviceResult->getStatus());
+        snapshot.deviceStatusInfo = static_cast<uint8_t>(deviceResult->getStatusInfo());
+        snapshot.devicePose = deviceResult->getPose();
+    }
+
+    const auto& trackableResultList = state.getTrackableResults();
+    snapshot.trackables.clear();
+    for (const auto* result : trackableResultList)
+    {
+        // The device pose is recorded separately
+        if (result->isOfType(Vuforia::DeviceTrackableResult::getClassType()))
         {
-            // Load the data set from the app's resources
-            if (!dataSet->load(path.c_str(), Vuforia::STORAGE_APPRESOURCE))
-            {
-                LOG("Error: Failed to load data set");
-                objectTracker->destroyDataSet(dataSet);
-                dataSet = nullptr;
-            }
-            else
-            {
-                if (!objectTracker->activateDataSet(dataSet))
-                {
-                    LOG("Error: Failed to activate data set");
-                    objectTracker->destroyDataSet(dataSet);
-                    dataSet = nullptr;
-                }
-            }
+            continue;
         }
+
+        TrackableSnapshot trackable;
+        trackable.type = result->getType().getData();
+        trackable.id = result->getTrackable().getId();
+        trackable.status = static_cast<uint8_t>(result->getStatus());
+        trackable.statusInfo = static_cast<uint8_t>(result->getStatusInfo());
+        trackable.pose = result->getPose();
+
+        // Record the same box getTrackableResults scales the augmentation to
+        trackable.size = Vuforia::Vec3F(1.0f, 1.0f, 1.0f);
+        trackable.center = Vuforia::Vec3F(0.0f, 0.0f, 0.0f);
+        if (result->isOfType(Vuforia::ImageTargetResult::getClassType()))
+        {
+            trackable.size = static_cast<const Vuforia::ImageTarget&>(result->getTrackable()).getSize();
+            trackable.size.data[2] = std::max(trackable.size.data[0], trackable.size.data[1]);
+        }
+        else if (result->isOfType(Vuforia::ModelTargetResult::getClassType()))
+        {
+            const auto& target = static_cast<const Vuforia::ModelTarget&>(result->getTrackable());
+            trackable.size = target.getSize();
+            trackable.center = target.getBoundingBox().getCenter();
+        }
+
+        snapshot.trackables.push_back(trackable);
     }
-    
-    return dataSet;
 }
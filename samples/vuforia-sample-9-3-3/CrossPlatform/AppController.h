@@ -15,11 +15,25 @@ countries.
 #include <Vuforia/ModelTarget.h>
 #include <Vuforia/Renderer.h>
 #include <Vuforia/RenderingPrimitives.h>
+#include <Vuforia/UpdateCallback.h>
 
+#include "AugmentationRegistry.h"
+#include "DataSetManager.h"
+#include "GuideViewCache.h"
+#include "InitPipeline.h"
+#include "RenderingConfigCache.h"
+#include "SessionRecorder.h"
+#include "TaskExecutor.h"
+#include "VideoModeSelector.h"
+
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 
 /// The AppController provides a platform independent encapsulation of the  Vuforia lifecycle
@@ -36,6 +50,16 @@ public:
     // Type definitions
     using ErrorCallback = std::function<void(const char* errorString)>;
     using InitDoneCallback = std::function<void()>;
+    using InitProgressCallback = std::function<void(int progress, const char* stageName)>;
+    using AssetSizeCallback = std::function<size_t(const char* filename)>;
+
+    /// Platform work to overlap with engine initialization, for example reading and
+    /// parsing rendering assets. Runs on a worker thread, returning false fails initialization.
+    using PreloadTask = struct
+    {
+        std::string name;
+        std::function<bool()> function;
+    };
 
     /// Struct to group initialization parameters passed to initAR
     using InitConfig = struct
@@ -44,13 +68,30 @@ public:
         void* appData {};
         ErrorCallback showErrorCallback {};
         InitDoneCallback initDoneCallback {};
+        InitProgressCallback initProgressCallback {};
+        std::vector<PreloadTask> preloadTasks {};
+        /// Optional, used to estimate how much memory each dataset will occupy
+        AssetSizeCallback assetSizeCallback {};
+        /// Optional, a writable directory. When set the camera video mode is calibrated on first
+        /// use and the selection for deviceModel saved here, otherwise the default mode is used.
+        std::string storagePath {};
+        std::string deviceModel {};
     };
 
 
     /// Initialize Vuforia. When the initialization is completed successfully the callback method initDone callback will be invoked.
     /// If initialization fails the error callback will be invoked.
-    /// On Android the appData pointer should be a pointer to the Activity object.
+    /// On Android the appData pointer should be a global reference to the Activity object.
+    /// Engine initialization and the preload tasks run on worker threads, this method returns
+    /// straight away and the callbacks are invoked from one of the workers.
     void initAR(const InitConfig& initConfig, int target);
+
+    /// Request that an initialization in progress stops as soon as possible.
+    /// May be called from any thread, neither callback is invoked for a cancelled initialization.
+    void cancelInitAR();
+
+    /// Get the name of the dataset (without file extension) used for a target
+    static const char* getDataSetName(int target);
     
     /// Start the AR session
     bool startAR();
@@ -64,17 +105,28 @@ public:
     /// Stop the AR session
     void stopAR();
 
-    /// Clean up and deinitialize Vuforia.
+    /// Clean up and deinitialize Vuforia, waiting for any initialization in progress to finish.
     void deinitAR();
 
+    /// Switch the active target without reinitializing Vuforia.
+    /// The datasets for all targets are kept resident, the switch is applied
+    /// on the next camera frame. Returns false if the target is unknown.
+    bool switchTarget(int target);
+
+    /// Get the target whose dataset is currently active
+    int getTarget() const { return mTarget; }
+
+    /// Get the time taken by the last switchTarget call to take effect, in milliseconds
+    double getTargetSwitchLatencyMs() const;
+
     /// Request that the camera refocuses in the current position
     void cameraPerformAutoFocus();
 
     /// Restore the camera to continuous autofocus mode
     void cameraRestoreAutoFocus();
 
-    /// Force an update of the cached RenderingPrimitives
-    /// Call if the screen dimensions or orientation change
+    /// Force an update of the cached RenderingPrimitives, discarding all cached configurations
+    /// Screen dimension and orientation changes are handled by configureRendering
     void updateRenderingPrimitives();
     
     /// Configure Vuforia rendering.
@@ -98,30 +150,84 @@ public:
     /// Will return nullptr until configureRendering has been called
     const Vuforia::RenderingPrimitives* getRenderingPrimitives() { return mCurrentRenderingPrimitives.get(); }
 
+    /// Get an id for the current rendering configuration.
+    /// Changes whenever getRenderingPrimitives returns different data, so can key resources derived from them.
+    unsigned int getRenderingConfigGeneration() const { return mRenderingConfigGeneration; }
+
+    /// Get the time from the last configureRendering call to the first frame rendered with it, in milliseconds
+    double getReconfigureLatencyMs() const { return mReconfigureLatencyMs; }
+
+    /// Check whether a new frame would look different from the last one rendered.
+    /// Returns false when Vuforia has produced no new camera frame or results and nothing
+    /// else affecting rendering has changed, so the platform can skip the frame.
+    /// May be called from any thread, each false return is counted as a skipped frame.
+    bool needsRender();
+
+    /// Force the next needsRender call to return true, for changes made outside the AppController
+    void invalidateRender() { mRenderInvalidated = true; }
+
+    /// Get the number of frames rendered and skipped since initAR
+    size_t getNumFramesRendered() const { return mNumFramesRendered; }
+    size_t getNumFramesSkipped() const { return mNumFramesSkipped; }
+
+    /// Report the CPU and GPU time the platform renderer spent on the frame being
+    /// rendered, gpuMs negative where it isn't measured. Call before finishRender on the
+    /// render thread. The averages estimate the time skipped frames saved, which is
+    /// logged with the frame counts. Power isn't reported, Android has no measure of
+    /// an app's own power draw without an external meter.
+    void addFrameCost(double cpuMs, double gpuMs);
+
     /// Get rendering information for the world origin position.
     /// Returns false if the world origin position is not currently available.
     bool getOrigin(Vuforia::Matrix44F& projectionMatrix, Vuforia::Matrix44F& modelViewMatrix);
 
-    /// Get rendering information for the Image Target.
-    /// Returns false if Vuforia isn't currently tracking the Image Target.
-    bool getImageTargetResult(Vuforia::Matrix44F& projectionMatrix,
-                              Vuforia::Matrix44F& modelViewMatrix, Vuforia::Matrix44F& scaledModelViewMatrix);
+    /// Get rendering information for every trackable Vuforia is currently tracking.
+    /// All results are computed in one pass and submitted to the registry,
+    /// call registry.dispatch(projectionMatrix) to render them.
+    /// Returns false if no results were submitted.
+    bool getTrackableResults(AugmentationRegistry& registry, Vuforia::Matrix44F& projectionMatrix);
 
-    /// Get rendering information for the Model Target.
-    /// Returns false if Vuforia isn't currently tracking the Model Target.
-    bool getModelTargetResult(Vuforia::Matrix44F& projectionMatrix,
-                              Vuforia::Matrix44F& modelViewMatrix, Vuforia::Matrix44F& scaledModelViewMatrix);
+    /// Get the viewport and projection of each eye, left then right, when the
+    /// rendering views are those of stereo eyewear. The projections include the
+    /// eye display adjustment, and getOrigin and getTrackableResults return the
+    /// left eye's. Returns false if rendering has a single view.
+    bool getStereoViews(Vuforia::Vec4I viewports[2], Vuforia::Matrix44F projectionMatrices[2]);
 
-    /// Get rendering information for the Model Target Giide View.
-    /// Returns false if Guide View rendering isn't required for the current frame.
+    /// Get rendering information for the Model Target Guide View.
+    /// Returns false if Guide View rendering isn't required for the current frame,
+    /// or the Guide View image is still being decoded.
     bool getModelTargetGuideView(Vuforia::Matrix44F& projectionMatrix,
-                                 Vuforia::Matrix44F& modelViewMatrix, Vuforia::Image** guideViewImage);
+                                 Vuforia::Matrix44F& modelViewMatrix, GuideViewCache::GuideViewId& guideViewId);
+
+    /// Switch the Guide View shown for the Model Target currently awaiting detection.
+    /// All Guide Views are decoded in advance so the switch takes effect on the next frame.
+    bool setGuideView(int guideViewIndex);
+
+    /// Get the cache holding the decoded Guide View images
+    /// Will return nullptr until initAR has been called
+    const GuideViewCache* getGuideViewCache() const { return mGuideViewCache.get(); }
+
+    /// Start writing the tracking results of every rendered frame to a session log at path,
+    /// replacing any recording in progress. The log can be replayed with SessionReplayer.
+    bool startSessionRecording(const std::string& path);
+
+    /// Finish writing the session log, also called by stopAR
+    void stopSessionRecording();
     
 private: // methods
     
+    /// Run the pipeline set up by initAR on a worker thread and report its outcome through the callbacks
+    void runInitPipeline();
+
     /// Used by initAR to prepare and invoke Vuforia initialization.
-    bool initVuforiaInternal(void* appData);
+    bool initVuforiaInternal(void* appData, InitPipeline::StageContext& context);
     
+    /// Whether the rendering views are a left and right eye
+    bool isStereo() const;
+
+    /// Projection of a view for the augmentations, with the eye display adjustment for an eye
+    Vuforia::Matrix44F getViewProjectionMatrix(Vuforia::VIEW view);
+
     /// Convert orientation parameter to platform specific value and pass to Vuforia.
     void setVuforiaOrientation(int orientation) const;
     
@@ -131,11 +237,15 @@ private: // methods
     /// Clean up Trackers created by initTrackers
     void deinitTrackers();
     
-    /// Load and activate the dataset for the currently selected target.
+    /// Load and activate the dataset for the currently selected target,
+    /// then preload the datasets for the other targets in the background.
     bool loadTrackerData();
 
-    /// Deactivate and unload the currently selected target.
+    /// Deactivate and unload all datasets. Succeeds if none are loaded.
     bool unloadTrackerData();
+
+    /// Called on the camera thread after Vuforia has processed each frame
+    void onVuforiaUpdate(Vuforia::State& state);
     
     /// Start Vuforia trackers
     bool startTrackers();
@@ -146,30 +256,108 @@ private: // methods
     /// Convenience method, returns trye if the screen is in portrait orientation.
     bool isScreenPortrait() const { return mOrientation == 0 || mOrientation == 1; }
     
+    /// Select the video mode saved for this device, starting calibration if there isn't one
+    bool selectInitialVideoMode();
+
+    /// Have mExecutor switch the camera to a different video mode, away from the render thread.
+    /// If calibration has finished the mode is saved once the switch succeeds.
+    void queueVideoModeSwitch(int videoModeIndex, bool calibrationFinished);
+
+    /// Restart the camera in a different video mode, restoring the previous one if that fails.
+    /// Returns false if the camera isn't in the new mode.
+    bool switchVideoMode(int videoModeIndex);
+
+    /// Stop, deinit and init the camera, then select the video mode and start it again
+    bool restartCamera(int videoModeIndex);
+
+    /// Persist the video mode chosen by calibration
+    void saveVideoModeSelection(const VideoModeSelector::Mode& mode);
+
     /// Calculate the video background configuration to pass to Vuforia.
-    void configureVideoBackground(float viewWidth, float viewHeight);
-    
-    /// Utility method to load and activate datasets
-    /// Can be used before trackers are started.
-    /// During an active Vuforia session dataset activation is only allowed in the Vuforia_onUpdate() callback.
-    Vuforia::DataSet* loadAndActivateDataSet(std::string path);
+    Vuforia::VideoBackgroundConfig calculateVideoBackgroundConfig(float viewWidth, float viewHeight,
+                                                                  const Vuforia::VideoMode& videoMode) const;
+
+    /// Set the video background configuration and RenderingPrimitives for the current
+    /// view size, orientation and video mode, reusing a cached configuration if there is one
+    void applyRenderingConfiguration();
+
+    /// Copy the tracking results from a Vuforia state, reusing the storage in snapshot
+    void captureFrameSnapshot(const Vuforia::State& state, FrameSnapshot& snapshot) const;
     
+private: // types
+
+    /// Forwards Vuforia update callbacks to the AppController
+    class UpdateCallback : public Vuforia::UpdateCallback
+    {
+    public:
+        explicit UpdateCallback(AppController& controller) : mController(controller) {}
+        void Vuforia_onUpdate(Vuforia::State& state) override { mController.onVuforiaUpdate(state); }
+
+    private:
+        AppController& mController;
+    };
+
 private: // data members
 
     /// Callback to inform the user of an error
     ErrorCallback mShowErrorCallback;
     /// Callback to inform the user that initialization is complete
     InitDoneCallback mInitDoneCallback;
+    /// Callback to inform the user about initialization progress
+    InitProgressCallback mInitProgressCallback;
     /// Vuforia initialization flags
     int mVuforiaInitFlags = 0;
     /// The target to use, either IMAGE_TARGET_ID or MODEL_TARGET_ID
-    int mTarget = IMAGE_TARGET_ID;
+    /// Updated on the camera thread when a switch takes effect.
+    std::atomic<int> mTarget { IMAGE_TARGET_ID };
+    /// The target the render thread last saw, used to spot switches
+    int mRenderedTarget = IMAGE_TARGET_ID;
+    /// Used to estimate dataset memory use
+    AssetSizeCallback mAssetSizeCallback;
+
+    /// Worker threads for initialization and other background work
+    std::unique_ptr<TaskExecutor> mExecutor;
+    /// Decoded Guide View images for every loaded Model Target
+    std::unique_ptr<GuideViewCache> mGuideViewCache;
+    /// The pipeline used by the last call to initAR, kept for its timeline
+    std::unique_ptr<InitPipeline> mInitPipeline;
+    /// Held while initAR sets up the pipeline and while it runs, so deinitAR waits for it to finish
+    std::mutex mInitMutex;
+    /// Guards access to mInitPipeline from cancelInitAR
+    std::mutex mInitPipelineMutex;
+    /// Set by cancelInitAR, cleared once the session has been deinitialized
+    std::atomic<bool> mInitCancelled { false };
+    /// True once the first frame of the session has been rendered
+    bool mFirstFrameRendered = false;
 
     /// Local cache of current screen orientation for calculating rendering data
     int mOrientation = 0;
 
     /// The Vuforia camera mode to use, either DEFAULT, SPEED or QUALITY.
     Vuforia::CameraDevice::MODE mCameraMode = Vuforia::CameraDevice::MODE_DEFAULT;
+    /// Index of the selected video mode when not using mCameraMode, guarded by mCameraMutex
+    int mVideoModeIndex = VideoModeSelector::NO_MODE;
+    /// Video mode calibration state, only exists while calibrating
+    std::unique_ptr<VideoModeSelector> mVideoModeSelector;
+    /// Where calibrated video modes are saved, empty to disable calibration
+    std::string mVideoModeSelectionPath;
+    std::string mDeviceModel;
+    /// Time between the last two Vuforia updates, written on the camera thread
+    std::atomic<double> mTrackingPeriodMs { 0.0 };
+    /// steady_clock ticks of the last Vuforia update, 0 before the first after a pause.
+    /// Read on the camera thread and reset by pauseAR, so kept atomic
+    std::atomic<std::chrono::steady_clock::rep> mLastUpdateTicks { 0 };
+    /// Time prepareToRender was called for the current frame
+    std::chrono::steady_clock::time_point mRenderStartTime;
+    /// Held while the camera is started, stopped or switched to a different video mode,
+    /// which happens on the platform's threads and on mExecutor
+    std::mutex mCameraMutex;
+    /// Set by the render thread when it queues a video mode switch, cleared once the switch is done
+    std::atomic<bool> mVideoModeSwitchPending { false };
+    /// Set when a video mode switch fails, calibration is then abandoned on the render thread
+    std::atomic<bool> mVideoModeSwitchFailed { false };
+    /// Set when the camera's video mode has changed, the render thread then reapplies the configuration
+    std::atomic<bool> mRenderingConfigurationStale { false };
     /// True when the Vuforia camera is currently started.
     bool mCameraIsActive = false;
     /// True when the Vuforia camera has been started. The camera may currently
@@ -179,18 +367,51 @@ private: // data members
     /// Flag to ensure we only perform once-per-session rendering setup the first time
     /// configureRendering is called
     bool mDoneOneTimeRenderingConfiguration = false;
-    /// Local copy of current RenderingPrimitives
-    std::unique_ptr<Vuforia::RenderingPrimitives> mCurrentRenderingPrimitives;
+    /// Local copy of current RenderingPrimitives, shared with mRenderingConfigCache
+    std::shared_ptr<Vuforia::RenderingPrimitives> mCurrentRenderingPrimitives;
+    /// Generation of the configuration mCurrentRenderingPrimitives belongs to
+    unsigned int mRenderingConfigGeneration = 0;
+    /// Configurations for previously seen view sizes, orientations and video modes
+    RenderingConfigCache mRenderingConfigCache;
+    /// View size passed to the last configureRendering call
+    int mViewWidth = 0;
+    int mViewHeight = 0;
+    /// Time of the last configureRendering call, used to measure reconfiguration latency
+    std::chrono::steady_clock::time_point mReconfigureStartTime;
+    bool mAwaitingReconfiguredFrame = false;
+    double mReconfigureLatencyMs = 0.0;
     /// Remember the display aspect ratio for later configuration of Guide View rendering
     float mDisplayAspectRatio;
 
     /// After the first call to prepareToRender this holds a copy of the Vuforia state.
     Vuforia::State mVuforiaState;
-    /// The currently activated Vuforia DataSet.
-    Vuforia::DataSet*  mCurrentDataSet = nullptr;
+    /// Owns the loaded Vuforia DataSets and controls which one is active.
+    std::unique_ptr<DataSetManager> mDataSetManager;
+    /// Receives camera frame notifications from Vuforia
+    UpdateCallback mUpdateCallback { *this };
     /// If a Model Target Guide View should be displayed this points to the object providing
     /// details of what the App should render.
     const Vuforia::ModelTarget* mGuideViewModelTarget = nullptr;
+    /// Writes each rendered frame's tracking results to a session log when recording
+    SessionRecorder mSessionRecorder;
+
+    /// Incremented on the camera thread for each update that changes the frame or results
+    std::atomic<unsigned int> mStateVersion { 0 };
+    /// mStateVersion and Guide View cache generation when the last frame was rendered
+    std::atomic<unsigned int> mRenderedStateVersion { 0 };
+    std::atomic<unsigned int> mRenderedGuideViewGeneration { 0 };
+    /// Set by changes that need a redraw without a new camera frame
+    std::atomic<bool> mRenderInvalidated { true };
+    /// Results of the last two Vuforia updates, only used on the camera thread
+    FrameSnapshot mLastUpdateSnapshot;
+    FrameSnapshot mUpdateSnapshot;
+    std::atomic<size_t> mNumFramesRendered { 0 };
+    std::atomic<size_t> mNumFramesSkipped { 0 };
+    /// Render thread totals of the costs given to addFrameCost since initAR
+    double mRenderCpuMs = 0.0;
+    double mRenderGpuMs = 0.0;
+    size_t mNumFramesCosted = 0;
+    size_t mNumFramesGpuTimed = 0;
 };
 
 #endif /* __APPCONTROLLER_H__ */
@@ -0,0 +1,105 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "AugmentationRegistry.h"
+
+
+AugmentationRegistry::HandlerId AugmentationRegistry::addHandler(Handler handler)
+{
+    mHandlers.push_back(std::move(handler));
+    mBatches.emplace_back();
+    return static_cast<HandlerId>(mHandlers.size() - 1);
+}
+
+
+void AugmentationRegistry::registerType(Vuforia::Type resultType, HandlerId handler)
+{
+    mTypeRegistrations.emplace_back(resultType, handler);
+    // Resolved types may now map to a different handler
+    mTypeHandlers.clear();
+}
+
+
+void AugmentationRegistry::registerTrackable(int trackableId, HandlerId handler)
+{
+    mTrackableHandlers[trackableId] = handler;
+}
+
+
+void AugmentationRegistry::unregisterTrackable(int trackableId)
+{
+    mTrackableHandlers.erase(trackableId);
+}
+
+
+AugmentationRegistry::HandlerId AugmentationRegistry::findHandler(int trackableId, Vuforia::Type resultType)
+{
+    if (!mTrackableHandlers.empty())
+    {
+        auto trackableIt = mTrackableHandlers.find(trackableId);
+        if (trackableIt != mTrackableHandlers.end())
+        {
+            return trackableIt->second;
+        }
+    }
+
+    auto typeIt = mTypeHandlers.find(resultType.getData());
+    if (typeIt != mTypeHandlers.end())
+    {
+        return typeIt->second;
+    }
+
+    // First time this concrete type is seen, resolve it against the registered
+    // types (which may be base types) and remember the answer
+    HandlerId handler = NO_HANDLER;
+    for (auto it = mTypeRegistrations.rbegin(); it != mTypeRegistrations.rend(); ++it)
+    {
+        if (resultType.isOfType(it->first))
+        {
+            handler = it->second;
+            break;
+        }
+    }
+    mTypeHandlers[resultType.getData()] = handler;
+    return handler;
+}
+
+
+void AugmentationRegistry::beginFrame()
+{
+    for (auto& batch : mBatches)
+    {
+        batch.clear();
+    }
+    mNumSubmitted = 0;
+}
+
+
+bool AugmentationRegistry::submit(Vuforia::Type resultType, const Augmentation& augmentation)
+{
+    HandlerId handler = findHandler(augmentation.trackableId, resultType);
+    if (handler == NO_HANDLER)
+    {
+        return false;
+    }
+
+    mBatches[handler].push_back(augmentation);
+    ++mNumSubmitted;
+    return true;
+}
+
+
+void AugmentationRegistry::dispatch(const Vuforia::Matrix44F& projectionMatrix)
+{
+    for (size_t i = 0; i < mHandlers.size(); ++i)
+    {
+        if (!mBatches[i].empty())
+        {
+            mHandlers[i](projectionMatrix, mBatches[i]);
+        }
+    }
+}
@@ -0,0 +1,90 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __AUGMENTATIONREGISTRY_H__
+#define __AUGMENTATIONREGISTRY_H__
+
+#include <Vuforia/Matrices.h>
+#include <Vuforia/Type.h>
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+
+/// Maps tracked trackables to the handler that renders their augmentation.
+/**
+ * Handlers are registered for a TrackableResult type, and can be overridden for
+ * individual trackable ids. Each frame every tracked result is routed to its
+ * handler with a constant time lookup and collected into a per-handler batch.
+ * dispatch() then calls each handler once with its whole batch, so a handler
+ * can set up state once and draw all of its targets together.
+ */
+class AugmentationRegistry
+{
+public:
+    using HandlerId = int;
+    static constexpr HandlerId NO_HANDLER = -1;
+
+    /// Per-trackable rendering information for one frame
+    struct Augmentation
+    {
+        int trackableId;
+        Vuforia::Matrix44F modelViewMatrix;
+        /// Model view matrix scaled to the extents of the trackable
+        Vuforia::Matrix44F scaledModelViewMatrix;
+    };
+
+    using Batch = std::vector<Augmentation>;
+    using Handler = std::function<void(const Vuforia::Matrix44F& projectionMatrix, const Batch& batch)>;
+
+    /// Add a handler, returning the id to pass to the register methods
+    HandlerId addHandler(Handler handler);
+
+    /// Route all results of the given TrackableResult type, and types derived from it, to a handler
+    void registerType(Vuforia::Type resultType, HandlerId handler);
+
+    /// Route the result for a specific trackable to a handler, taking priority over its type
+    void registerTrackable(int trackableId, HandlerId handler);
+
+    /// Remove a handler override for a specific trackable
+    void unregisterTrackable(int trackableId);
+
+    /// Find the handler for a result, or NO_HANDLER if nothing is registered for it
+    HandlerId findHandler(int trackableId, Vuforia::Type resultType);
+
+    /// Clear the batches collected for the previous frame
+    void beginFrame();
+
+    /// Queue an augmentation for its handler, returns false if there is no handler for it
+    bool submit(Vuforia::Type resultType, const Augmentation& augmentation);
+
+    /// Call each handler that received augmentations this frame with its batch
+    void dispatch(const Vuforia::Matrix44F& projectionMatrix);
+
+    /// Get the number of handlers added
+    size_t getNumHandlers() const { return mHandlers.size(); }
+
+    /// Get the number of augmentations submitted since beginFrame
+    size_t getNumSubmitted() const { return mNumSubmitted; }
+
+private: // data members
+
+    std::vector<Handler> mHandlers;
+    /// One batch per handler, reused across frames to avoid reallocation
+    std::vector<Batch> mBatches;
+
+    std::unordered_map<int, HandlerId> mTrackableHandlers;
+    /// Handlers registered explicitly for a type
+    std::vector<std::pair<Vuforia::Type, HandlerId>> mTypeRegistrations;
+    /// Resolved handler for each concrete result type seen, keyed on the type data
+    std::unordered_map<Vuforia::UInt16, HandlerId> mTypeHandlers;
+
+    size_t mNumSubmitted = 0;
+};
+
+#endif // __AUGMENTATIONREGISTRY_H__
@@ -0,0 +1,481 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "DataSetManager.h"
+
+#include "Log.h"
+
+#include <Vuforia/ObjectTracker.h>
+#include <Vuforia/TrackerManager.h>
+
+#include <algorithm>
+
+
+namespace
+{
+    Vuforia::ObjectTracker* getObjectTracker()
+    {
+        Vuforia::TrackerManager& trackerManager = Vuforia::TrackerManager::getInstance();
+        return static_cast<Vuforia::ObjectTracker*>(trackerManager.getTracker(Vuforia::ObjectTracker::getClassType()));
+    }
+}
+
+
+/*===============================================================================
+DataSetManager public methods
+===============================================================================*/
+
+DataSetManager::DataSetManager(TaskExecutor& executor, size_t memoryBudgetBytes)
+    : mExecutor(executor), mMemoryBudgetBytes(memoryBudgetBytes)
+{
+}
+
+
+DataSetManager::~DataSetManager()
+{
+    unloadAll();
+}
+
+
+void DataSetManager::addDataSet(int id, const std::string& path, size_t estimatedSizeBytes)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    Entry& entry = mEntries[id];
+    entry.path = path;
+    entry.estimatedSizeBytes = estimatedSizeBytes;
+}
+
+
+void DataSetManager::setResidencyCallbacks(DataSetCallback onLoaded, DataSetCallback onUnloading)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mOnLoaded = std::move(onLoaded);
+    mOnUnloading = std::move(onUnloading);
+}
+
+
+bool DataSetManager::load(int id)
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    auto it = mEntries.find(id);
+    if (it == mEntries.end())
+    {
+        LOG("Error: Attempt to load unknown dataset %d", id);
+        return false;
+    }
+
+    // A background load may already be in flight, just wait for it, or for an evicted copy to be destroyed
+    mLoadFinished.wait(lock, [it]
+    {
+        return it->second.state != STATE::LOADING && it->second.state != STATE::UNLOADING;
+    });
+    if (it->second.state == STATE::RESIDENT)
+    {
+        touch(id);
+        return true;
+    }
+
+    it->second.state = STATE::LOADING;
+    std::string path = it->second.path;
+    DataSetCallback onLoaded = mOnLoaded;
+    lock.unlock();
+
+    Vuforia::DataSet* dataSet = createAndLoad(path);
+    if (dataSet != nullptr && onLoaded)
+    {
+        onLoaded(id, dataSet);
+    }
+
+    lock.lock();
+    if (dataSet == nullptr)
+    {
+        it->second.state = STATE::UNLOADED;
+        mLoadFinished.notify_all();
+        return false;
+    }
+
+    it->second.dataSet = dataSet;
+    it->second.state = STATE::RESIDENT;
+    mResidentBytes += it->second.estimatedSizeBytes;
+    touch(id);
+    std::vector<Unload> unloads;
+    evict(id, unloads);
+    DataSetCallback onUnloading = mOnUnloading;
+    mLoadFinished.notify_all();
+    lock.unlock();
+
+    unload(unloads, onUnloading);
+    return true;
+}
+
+
+void DataSetManager::preload(int id)
+{
+    std::string path;
+    DataSetCallback onLoaded;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mEntries.find(id);
+        if (it == mEntries.end() || it->second.state != STATE::UNLOADED)
+        {
+            return;
+        }
+        it->second.state = STATE::LOADING;
+        path = it->second.path;
+        onLoaded = mOnLoaded;
+        ++mNumLoading;
+    }
+
+    mExecutor.submit([this, id, path, onLoaded]()
+    {
+        auto startTime = Clock::now();
+        Vuforia::DataSet* dataSet = createAndLoad(path);
+        if (dataSet != nullptr && onLoaded)
+        {
+            onLoaded(id, dataSet);
+        }
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        Entry& entry = mEntries[id];
+        std::vector<Unload> unloads;
+        if (dataSet == nullptr)
+        {
+            entry.state = STATE::UNLOADED;
+            // A switch waiting on this dataset can never complete
+            if (mPendingId == id)
+            {
+                mPendingId = NO_DATASET;
+            }
+        }
+        else
+        {
+            entry.dataSet = dataSet;
+            entry.state = STATE::RESIDENT;
+            mResidentBytes += entry.estimatedSizeBytes;
+            // Preloaded sets go to the back, they haven't been used yet
+            mUsage.push_back(id);
+            evict(mPendingId == id ? id : mActiveId, unloads);
+            LOG("Preloaded data set %s in %.1f ms", path.c_str(),
+                std::chrono::duration<double, std::milli>(Clock::now() - startTime).count());
+        }
+
+        --mNumLoading;
+        DataSetCallback onUnloading = mOnUnloading;
+        mLoadFinished.notify_all();
+        lock.unlock();
+
+        unload(unloads, onUnloading);
+    });
+}
+
+
+bool DataSetManager::activate(int id)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    auto it = mEntries.find(id);
+    if (it == mEntries.end() || it->second.state != STATE::RESIDENT)
+    {
+        LOG("Error: Attempt to activate data set %d which is not loaded", id);
+        return false;
+    }
+
+    Vuforia::ObjectTracker* objectTracker = getObjectTracker();
+    if (objectTracker == nullptr)
+    {
+        LOG("Error: Failed to get the ObjectTracker from the TrackerManager");
+        return false;
+    }
+
+    if (mActiveId != NO_DATASET && mActiveId != id)
+    {
+        if (!objectTracker->deactivateDataSet(mEntries[mActiveId].dataSet))
+        {
+            LOG("Warning: Failed to deactivate the data set.");
+        }
+        mActiveId = NO_DATASET;
+    }
+
+    if (mActiveId != id && !objectTracker->activateDataSet(it->second.dataSet))
+    {
+        LOG("Error: Failed to activate data set");
+        return false;
+    }
+
+    mActiveId = id;
+    mPendingId = NO_DATASET;
+    touch(id);
+    return true;
+}
+
+
+bool DataSetManager::requestSwitch(int id)
+{
+    bool needsLoad = false;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        auto it = mEntries.find(id);
+        if (it == mEntries.end())
+        {
+            LOG("Error: Attempt to switch to unknown data set %d", id);
+            return false;
+        }
+        if (id == mActiveId)
+        {
+            mPendingId = NO_DATASET;
+            return true;
+        }
+
+        mPendingId = id;
+        mSwitchRequestTime = Clock::now();
+        needsLoad = it->second.state == STATE::UNLOADED;
+    }
+
+    if (needsLoad)
+    {
+        preload(id);
+    }
+    return true;
+}
+
+
+bool DataSetManager::onUpdate()
+{
+    std::unique_lock<std::mutex> lock(mMutex, std::try_to_lock);
+    if (!lock.owns_lock() || mPendingId == NO_DATASET)
+    {
+        // Never block the camera thread, a busy manager is checked again next frame
+        return false;
+    }
+
+    Entry& pending = mEntries[mPendingId];
+    if (pending.state != STATE::RESIDENT)
+    {
+        return false;
+    }
+
+    Vuforia::ObjectTracker* objectTracker = getObjectTracker();
+    if (objectTracker == nullptr)
+    {
+        return false;
+    }
+
+    if (mActiveId != NO_DATASET)
+    {
+        objectTracker->deactivateDataSet(mEntries[mActiveId].dataSet);
+    }
+
+    int previousId = mActiveId;
+    if (objectTracker->activateDataSet(pending.dataSet))
+    {
+        mActiveId = mPendingId;
+    }
+    else
+    {
+        LOG("Error: Failed to activate data set %s", pending.path.c_str());
+        mActiveId = NO_DATASET;
+        // Fall back to the set that was active before
+        if (previousId != NO_DATASET && objectTracker->activateDataSet(mEntries[previousId].dataSet))
+        {
+            mActiveId = previousId;
+        }
+    }
+
+    mPendingId = NO_DATASET;
+    mLastSwitchLatencyMs = std::chrono::duration<double, std::milli>(Clock::now() - mSwitchRequestTime).count();
+
+    if (mActiveId == previousId)
+    {
+        return false;
+    }
+
+    touch(mActiveId);
+    // Keep the previous set too, its trackables may still be referenced by
+    // the State being rendered this frame
+    std::vector<Unload> unloads;
+    evict(previousId, unloads);
+    if (!unloads.empty())
+    {
+        // The callbacks and Vuforia may take a while, so never destroy on the camera thread
+        DataSetCallback onUnloading = mOnUnloading;
+        mExecutor.submit([this, unloads, onUnloading]() { unload(unloads, onUnloading); });
+    }
+    return true;
+}
+
+
+void DataSetManager::unloadAll()
+{
+    std::vector<Unload> unloads;
+    DataSetCallback onUnloading;
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mLoadFinished.wait(lock, [this] { return mNumLoading == 0 && mNumUnloading == 0; });
+
+        for (auto& idEntry : mEntries)
+        {
+            Entry& entry = idEntry.second;
+            if (entry.dataSet == nullptr)
+            {
+                continue;
+            }
+            unloads.push_back({ idEntry.first, entry.dataSet, idEntry.first == mActiveId });
+            entry.dataSet = nullptr;
+            entry.state = STATE::UNLOADING;
+            ++mNumUnloading;
+        }
+
+        mUsage.clear();
+        mResidentBytes = 0;
+        mActiveId = NO_DATASET;
+        mPendingId = NO_DATASET;
+        onUnloading = mOnUnloading;
+    }
+
+    unload(unloads, onUnloading);
+}
+
+
+int DataSetManager::getActiveDataSetId() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mActiveId;
+}
+
+
+double DataSetManager::getLastSwitchLatencyMs() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mLastSwitchLatencyMs;
+}
+
+
+size_t DataSetManager::getResidentBytes() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mResidentBytes;
+}
+
+
+/*===============================================================================
+DataSetManager private methods
+===============================================================================*/
+
+Vuforia::DataSet* DataSetManager::createAndLoad(const std::string& path)
+{
+    LOG("Loading data set from %s", path.c_str());
+
+    Vuforia::ObjectTracker* objectTracker = getObjectTracker();
+    if (objectTracker == nullptr)
+    {
+        LOG("Error: Failed to get the ObjectTracker from the TrackerManager");
+        return nullptr;
+    }
+
+    Vuforia::DataSet* dataSet = objectTracker->createDataSet();
+    if (dataSet == nullptr)
+    {
+        LOG("Error: Failed to create data set");
+        return nullptr;
+    }
+
+    // Load the data set from the app's resources
+    if (!dataSet->load(path.c_str(), Vuforia::STORAGE_APPRESOURCE))
+    {
+        LOG("Error: Failed to load data set");
+        objectTracker->destroyDataSet(dataSet);
+        return nullptr;
+    }
+
+    return dataSet;
+}
+
+
+void DataSetManager::touch(int id)
+{
+    mUsage.remove(id);
+    mUsage.push_front(id);
+}
+
+
+void DataSetManager::evict(int keepId, std::vector<Unload>& unloads)
+{
+    // Walk from the least recently used end
+    auto it = mUsage.end();
+    while (mResidentBytes > mMemoryBudgetBytes && it != mUsage.begin())
+    {
+        --it;
+        int id = *it;
+        if (id == keepId || id == mActiveId || id == mPendingId)
+        {
+            continue;
+        }
+
+        Entry& entry = mEntries[id];
+        LOG("Evicting data set %s to stay within the memory budget", entry.path.c_str());
+        unloads.push_back({ id, entry.dataSet, false });
+        entry.dataSet = nullptr;
+        entry.state = STATE::UNLOADING;
+        ++mNumUnloading;
+        mResidentBytes -= std::min(mResidentBytes, entry.estimatedSizeBytes);
+        it = mUsage.erase(it);
+    }
+}
+
+
+void DataSetManager::unload(const std::vector<Unload>& unloads, const DataSetCallback& onUnloading)
+{
+    if (unloads.empty())
+    {
+        return;
+    }
+
+    Vuforia::ObjectTracker* objectTracker = getObjectTracker();
+    for (const Unload& unloaded : unloads)
+    {
+        if (onUnloading)
+        {
+            onUnloading(unloaded.id, unloaded.dataSet);
+        }
+        if (objectTracker != nullptr)
+        {
+            if (unloaded.deactivate && !objectTracker->deactivateDataSet(unloaded.dataSet))
+            {
+                LOG("Warning: Failed to deactivate the data set.");
+            }
+            if (!objectTracker->destroyDataSet(unloaded.dataSet))
+            {
+                LOG("Warning: Failed to destroy the data set.");
+            }
+        }
+    }
+
+    std::vector<int> reloadIds;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (const Unload& unloaded : unloads)
+        {
+            mEntries[unloaded.id].state = STATE::UNLOADED;
+            // A switch to the dataset was requested while it was being destroyed
+            if (unloaded.id == mPendingId)
+            {
+                reloadIds.push_back(unloaded.id);
+            }
+        }
+    }
+
+    // Started before the unloads count as finished, so unloadAll waits for them too
+    for (int id : reloadIds)
+    {
+        preload(id);
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mNumUnloading -= static_cast<int>(unloads.size());
+    mLoadFinished.notify_all();
+}
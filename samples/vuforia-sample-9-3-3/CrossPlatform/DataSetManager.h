@@ -0,0 +1,161 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __DATASETMANAGER_H__
+#define __DATASETMANAGER_H__
+
+#include "TaskExecutor.h"
+
+#include <Vuforia/DataSet.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+/// Keeps several Vuforia DataSets loaded and switches which one is active.
+/**
+ * DataSets are registered up front with an id and an estimate of their resident
+ * size. They can then be loaded on the executor in the background and stay
+ * resident, within the memory budget, so that switching between them is just a
+ * deactivate/activate pair rather than a full reload.
+ *
+ * While the ObjectTracker is running Vuforia only allows dataset activation from
+ * the Vuforia_onUpdate() callback. Switches are therefore requested with
+ * requestSwitch() and applied by onUpdate(), which must be called from that callback.
+ *
+ * When the resident datasets exceed the budget the least recently used inactive
+ * ones are destroyed, on the executor when onUpdate evicts them.
+ */
+class DataSetManager
+{
+public:
+    static constexpr int NO_DATASET = -1;
+
+    /// Notified when a dataset becomes resident or is about to be destroyed
+    using DataSetCallback = std::function<void(int id, Vuforia::DataSet* dataSet)>;
+
+    DataSetManager(TaskExecutor& executor, size_t memoryBudgetBytes);
+    ~DataSetManager();
+
+    DataSetManager(const DataSetManager&) = delete;
+    DataSetManager& operator=(const DataSetManager&) = delete;
+
+    /// Register a dataset. The path is relative to the app resources.
+    void addDataSet(int id, const std::string& path, size_t estimatedSizeBytes);
+
+    /// Set callbacks for datasets being loaded and destroyed.
+    /// Both are called without the manager's lock held, and never from onUpdate. onLoaded is
+    /// called on the loading thread before the dataset becomes resident, so before it can be
+    /// activated. onUnloading is called before the dataset is destroyed.
+    void setResidencyCallbacks(DataSetCallback onLoaded, DataSetCallback onUnloading);
+
+    /// Load a dataset on the calling thread. Returns true if the dataset is resident.
+    bool load(int id);
+
+    /// Load a dataset on the executor, returns immediately.
+    void preload(int id);
+
+    /// Activate a resident dataset immediately, deactivating the current one.
+    /// Only valid while the ObjectTracker is stopped, use requestSwitch otherwise.
+    bool activate(int id);
+
+    /// Request that a dataset becomes the active one.
+    /// The switch happens on the next onUpdate, once the dataset is resident,
+    /// loading it in the background first if required.
+    bool requestSwitch(int id);
+
+    /// Apply any pending switch. Must be called from Vuforia_onUpdate().
+    /// Returns true if the active dataset changed.
+    bool onUpdate();
+
+    /// Deactivate and destroy all datasets, waiting for any background loads to finish.
+    void unloadAll();
+
+    /// Get the id of the active dataset, or NO_DATASET
+    int getActiveDataSetId() const;
+
+    /// Get the time between the last requestSwitch call and the switch being applied, in milliseconds
+    double getLastSwitchLatencyMs() const;
+
+    /// Get the estimated memory used by resident datasets, in bytes
+    size_t getResidentBytes() const;
+
+private: // methods
+    using Clock = std::chrono::steady_clock;
+
+    enum class STATE
+    {
+        UNLOADED,
+        LOADING,
+        RESIDENT,
+        /// Taken out of the manager, waiting to be destroyed
+        UNLOADING,
+    };
+
+    struct Entry
+    {
+        std::string path;
+        size_t estimatedSizeBytes = 0;
+        STATE state = STATE::UNLOADED;
+        Vuforia::DataSet* dataSet = nullptr;
+    };
+
+    /// A dataset taken out of the manager, destroyed once the lock has been released
+    struct Unload
+    {
+        int id;
+        Vuforia::DataSet* dataSet;
+        /// Whether it was the active dataset
+        bool deactivate;
+    };
+
+    /// Create and load a DataSet, called without the lock held
+    static Vuforia::DataSet* createAndLoad(const std::string& path);
+
+    /// Mark a dataset as most recently used. Caller must hold mMutex.
+    void touch(int id);
+
+    /// Take least recently used inactive datasets out until within budget, adding them to
+    /// unloads. The dataset in keepId is never evicted. Caller must hold mMutex.
+    void evict(int keepId, std::vector<Unload>& unloads);
+
+    /// Call onUnloading for each dataset then destroy it, and reload any a switch has
+    /// been requested to since. Called without the lock held.
+    void unload(const std::vector<Unload>& unloads, const DataSetCallback& onUnloading);
+
+private: // data members
+    TaskExecutor& mExecutor;
+    const size_t mMemoryBudgetBytes;
+
+    mutable std::mutex mMutex;
+    /// Signalled whenever a background load finishes or datasets have been destroyed
+    std::condition_variable mLoadFinished;
+    int mNumLoading = 0;
+    int mNumUnloading = 0;
+
+    std::map<int, Entry> mEntries;
+    /// Resident dataset ids, most recently used first
+    std::list<int> mUsage;
+    size_t mResidentBytes = 0;
+
+    DataSetCallback mOnLoaded;
+    DataSetCallback mOnUnloading;
+
+    int mActiveId = NO_DATASET;
+    int mPendingId = NO_DATASET;
+    Clock::time_point mSwitchRequestTime;
+    double mLastSwitchLatencyMs = 0.0;
+};
+
+#endif // __DATASETMANAGER_H__
@@ -0,0 +1,81 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __FRAMESNAPSHOT_H__
+#define __FRAMESNAPSHOT_H__
+
+#include <Vuforia/Matrices.h>
+#include <Vuforia/Vectors.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+
+/// What the trackers produced for one trackable in one frame
+struct TrackableSnapshot
+{
+    /// Vuforia::Type data of the TrackableResult
+    uint16_t type = 0;
+    int32_t id = 0;
+    /// Vuforia::TrackableResult::STATUS and STATUS_INFO
+    uint8_t status = 0;
+    uint8_t statusInfo = 0;
+    Vuforia::Matrix34F pose;
+    /// Extents and centre of the trackable, used to place the unit augmentation
+    Vuforia::Vec3F size;
+    Vuforia::Vec3F center;
+};
+
+
+/// Copy of the parts of a Vuforia::State needed to render a frame.
+/**
+ * Plain data with no dependency on the Vuforia engine, so frames can be recorded
+ * to a file and replayed later without a camera or the engine running.
+ */
+struct FrameSnapshot
+{
+    /// Camera frame timestamp, in seconds
+    double timestamp = 0.0;
+
+    bool hasDevicePose = false;
+    uint8_t deviceStatus = 0;
+    uint8_t deviceStatusInfo = 0;
+    Vuforia::Matrix34F devicePose;
+
+    std::vector<TrackableSnapshot> trackables;
+
+    /// True if both snapshots are of the same camera frame with identical results,
+    /// in which case rendering one after the other produces the same image
+    bool isUnchangedFrom(const FrameSnapshot& other) const
+    {
+        if (timestamp != other.timestamp || hasDevicePose != other.hasDevicePose ||
+            trackables.size() != other.trackables.size())
+        {
+            return false;
+        }
+        if (hasDevicePose &&
+            (deviceStatus != other.deviceStatus || deviceStatusInfo != other.deviceStatusInfo ||
+             std::memcmp(devicePose.data, other.devicePose.data, sizeof(devicePose.data)) != 0))
+        {
+            return false;
+        }
+        for (size_t i = 0; i < trackables.size(); ++i)
+        {
+            const TrackableSnapshot& a = trackables[i];
+            const TrackableSnapshot& b = other.trackables[i];
+            if (a.type != b.type || a.id != b.id || a.status != b.status || a.statusInfo != b.statusInfo ||
+                std::memcmp(a.pose.data, b.pose.data, sizeof(a.pose.data)) != 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+#endif // __FRAMESNAPSHOT_H__
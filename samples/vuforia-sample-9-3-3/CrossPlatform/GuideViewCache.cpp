@@ -0,0 +1,268 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "GuideViewCache.h"
+
+#include "MathUtils.h"
+#include "Log.h"
+
+#include <Vuforia/GuideView.h>
+#include <Vuforia/ModelTarget.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+
+/*===============================================================================
+GuideViewCache public methods
+===============================================================================*/
+
+void GuideViewCache::addDataSet(int dataSetId, Vuforia::DataSet* dataSet)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    int numDecoded = 0;
+
+    for (auto* trackable : dataSet->getTrackables())
+    {
+        if (!trackable->isOfType(Vuforia::ModelTarget::getClassType()))
+        {
+            continue;
+        }
+
+        auto* modelTarget = static_cast<Vuforia::ModelTarget*>(trackable);
+        int activeIndex = modelTarget->getActiveGuideViewIndex();
+        if (activeIndex < 0)
+        {
+            // Advanced Model Targets show no Guide View, and activating one would change how they are recognized
+            continue;
+        }
+
+        auto guideViews = modelTarget->getGuideViews();
+        for (int index = 0; index < guideViews.size(); ++index)
+        {
+            // Vuforia only generates the image for the active Guide View
+            if (index != modelTarget->getActiveGuideViewIndex() && !modelTarget->setActiveGuideViewIndex(index))
+            {
+                continue;
+            }
+
+            const Vuforia::Image* vuforiaImage = guideViews.at(index)->getImage();
+            std::shared_ptr<Image> image = vuforiaImage != nullptr ? copyImage(*vuforiaImage) : nullptr;
+            if (image == nullptr)
+            {
+                LOG("Warning: Unable to copy Guide View %d of %s", index, modelTarget->getName());
+                continue;
+            }
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            Entry& entry = mEntries[makeId(modelTarget->getId(), index)];
+            entry.dataSetId = dataSetId;
+            entry.image = std::move(image);
+            computeLayouts(entry);
+            ++mGeneration;
+            ++numDecoded;
+        }
+
+        if (activeIndex != modelTarget->getActiveGuideViewIndex() && !modelTarget->setActiveGuideViewIndex(activeIndex))
+        {
+            LOG("Warning: Unable to restore Guide View %d of %s", activeIndex, modelTarget->getName());
+        }
+    }
+
+    if (numDecoded > 0)
+    {
+        LOG("Decoded %d Guide Views in %.1f ms", numDecoded,
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count());
+    }
+}
+
+
+void GuideViewCache::removeDataSet(int dataSetId)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    bool removed = false;
+    for (auto it = mEntries.begin(); it != mEntries.end();)
+    {
+        if (it->second.dataSetId == dataSetId)
+        {
+            it = mEntries.erase(it);
+            removed = true;
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    if (removed)
+    {
+        ++mGeneration;
+    }
+}
+
+
+void GuideViewCache::setDisplay(float displayAspectRatio, float fieldOfViewY)
+{
+    if (displayAspectRatio < 1.0f)
+    {
+        displayAspectRatio = 1.0f / displayAspectRatio;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (displayAspectRatio == mDisplayAspectRatio && fieldOfViewY == mFieldOfViewY)
+    {
+        return;
+    }
+
+    mDisplayAspectRatio = displayAspectRatio;
+    mFieldOfViewY = fieldOfViewY;
+    for (auto& idEntry : mEntries)
+    {
+        computeLayouts(idEntry.second);
+    }
+}
+
+
+bool GuideViewCache::getLayout(GuideViewId id, bool portrait, Vuforia::Matrix44F& modelViewMatrix) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mEntries.find(id);
+    if (it == mEntries.end() || mDisplayAspectRatio == 0.0f)
+    {
+        return false;
+    }
+
+    modelViewMatrix = it->second.layouts[portrait ? 1 : 0];
+    return true;
+}
+
+
+std::shared_ptr<const GuideViewCache::Image> GuideViewCache::getImage(GuideViewId id) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mEntries.find(id);
+    return it != mEntries.end() ? it->second.image : nullptr;
+}
+
+
+std::map<GuideViewCache::GuideViewId, std::shared_ptr<const GuideViewCache::Image>> GuideViewCache::getImages() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::map<GuideViewId, std::shared_ptr<const Image>> images;
+    for (const auto& idEntry : mEntries)
+    {
+        images[idEntry.first] = idEntry.second.image;
+    }
+    return images;
+}
+
+
+/*===============================================================================
+GuideViewCache private methods
+===============================================================================*/
+
+std::shared_ptr<GuideViewCache::Image> GuideViewCache::copyImage(const Vuforia::Image& vuforiaImage)
+{
+    int bytesPerPixel = 0;
+    switch (vuforiaImage.getFormat())
+    {
+        case Vuforia::GRAYSCALE:
+            bytesPerPixel = 1;
+            break;
+        case Vuforia::RGB565:
+            bytesPerPixel = 2;
+            break;
+        case Vuforia::RGB888:
+            bytesPerPixel = 3;
+            break;
+        case Vuforia::RGBA8888:
+            bytesPerPixel = 4;
+            break;
+        default:
+            return nullptr;
+    }
+
+    auto image = std::make_shared<Image>();
+    image->width = vuforiaImage.getWidth();
+    image->height = vuforiaImage.getHeight();
+    image->format = vuforiaImage.getFormat();
+
+    // The Vuforia buffer may be padded, copy the rows without the padding
+    const size_t rowSize = static_cast<size_t>(image->width * bytesPerPixel);
+    const auto* source = static_cast<const unsigned char*>(vuforiaImage.getPixels());
+    if (source == nullptr)
+    {
+        return nullptr;
+    }
+
+    image->pixels.resize(rowSize * image->height);
+    for (int row = 0; row < image->height; ++row)
+    {
+        memcpy(&image->pixels[row * rowSize], source + row * vuforiaImage.getStride(), rowSize);
+    }
+
+    return image;
+}
+
+
+void GuideViewCache::computeLayouts(Entry& entry) const
+{
+    if (mDisplayAspectRatio == 0.0f || entry.image->height == 0)
+    {
+        return;
+    }
+
+    float guideViewAspectRatio = (float)entry.image->width / entry.image->height;
+
+    for (int portrait = 0; portrait < 2; ++portrait)
+    {
+        float displayAspectRatio = portrait ? 1.0f / mDisplayAspectRatio : mDisplayAspectRatio;
+
+        float planeDistance = 0.01f;
+        float nearPlaneHeight = 1.0f * planeDistance * std::tan(mFieldOfViewY * 0.5f);
+        float nearPlaneWidth = nearPlaneHeight * displayAspectRatio;
+        float planeWidth;
+        float planeHeight;
+
+        if (guideViewAspectRatio >= 1.0f && displayAspectRatio >= 1.0f) // guideview landscape, camera landscape
+        {
+            // scale so that the long side of the camera (width)
+            // is the same length as guideview width
+            planeWidth = nearPlaneWidth;
+            planeHeight = planeWidth / guideViewAspectRatio;
+        }
+        else if (guideViewAspectRatio < 1.0f && displayAspectRatio < 1.0f) // guideview portrait, camera portrait
+        {
+            // scale so that the long side of the camera (height)
+            // is the same length as guideview height
+            planeHeight = nearPlaneHeight;
+            planeWidth = planeHeight * guideViewAspectRatio;
+        }
+        else if (displayAspectRatio < 1.0f) // guideview landscape, camera portrait
+        {
+            // scale so that the long side of the camera (height)
+            // is the same length as guideview width
+            planeWidth = nearPlaneHeight;
+            planeHeight = planeWidth / guideViewAspectRatio;
+        }
+        else // guideview portrait, camera landscape
+        {
+            // scale so that the long side of the camera (width)
+            // is the same length as guideview height
+            planeHeight = nearPlaneWidth;
+            planeWidth = planeHeight * guideViewAspectRatio;
+        }
+
+        // normalize world space plane sizes into view space again
+        Vuforia::Vec2F scale = Vuforia::Vec2F(2 * planeWidth / nearPlaneWidth, 2 * planeHeight / nearPlaneHeight);
+
+        entry.layouts[portrait] = MathUtils::Matrix44FScale(Vuforia::Vec3F(scale.data[0], scale.data[1], 1.0f),
+                                                            MathUtils::Matrix44FIdentity());
+    }
+}
@@ -0,0 +1,118 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __GUIDEVIEWCACHE_H__
+#define __GUIDEVIEWCACHE_H__
+
+#include <Vuforia/DataSet.h>
+#include <Vuforia/Image.h>
+#include <Vuforia/Matrices.h>
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+/// Keeps a decoded copy of every Guide View image of every loaded Model Target.
+/**
+ * Vuforia only provides the image for the active Guide View of a Model Target,
+ * generating it on demand. When a dataset is added the cache walks all of its
+ * Model Targets, activating each Guide View in turn and copying its image, so
+ * any view can later be shown without waiting for Vuforia. Switching the active
+ * view would disturb tracking, so datasets are added while they are loaded in
+ * the background, before they can be activated.
+ *
+ * The layout of each image on screen depends only on the image and display
+ * aspect ratios and the camera field of view, so it is computed up front for
+ * both portrait and landscape and recomputed only when the display changes.
+ *
+ * The cache holds CPU copies of the images, the renderer checks getGeneration()
+ * each frame and uploads anything new.
+ */
+class GuideViewCache
+{
+public:
+    /// Identifies a Guide View by trackable id and Guide View index
+    using GuideViewId = uint64_t;
+
+    /// A tightly packed copy of a Guide View image
+    struct Image
+    {
+        int width = 0;
+        int height = 0;
+        Vuforia::PIXEL_FORMAT format = Vuforia::UNKNOWN_FORMAT;
+        std::vector<unsigned char> pixels;
+    };
+
+    static GuideViewId makeId(int trackableId, int guideViewIndex)
+    {
+        return (static_cast<GuideViewId>(static_cast<uint32_t>(trackableId)) << 32) | static_cast<uint32_t>(guideViewIndex);
+    }
+
+    GuideViewCache() = default;
+
+    GuideViewCache(const GuideViewCache&) = delete;
+    GuideViewCache& operator=(const GuideViewCache&) = delete;
+
+    /// Decode the Guide Views of all Model Targets in a dataset on the calling thread.
+    /// The dataset must not be active, and nothing else may change its Guide Views meanwhile.
+    /// Advanced Model Targets, with no active Guide View, are skipped.
+    void addDataSet(int dataSetId, Vuforia::DataSet* dataSet);
+
+    /// Drop the images for a dataset
+    void removeDataSet(int dataSetId);
+
+    /// Set the display and camera parameters the layouts depend on.
+    /// Does nothing if they have not changed.
+    void setDisplay(float displayAspectRatio, float fieldOfViewY);
+
+    /// Get the model view matrix to render a Guide View with an identity projection.
+    /// Returns false if the Guide View has not been decoded yet.
+    bool getLayout(GuideViewId id, bool portrait, Vuforia::Matrix44F& modelViewMatrix) const;
+
+    /// Get a decoded image, or nullptr if it is not available
+    std::shared_ptr<const Image> getImage(GuideViewId id) const;
+
+    /// Get all decoded images
+    std::map<GuideViewId, std::shared_ptr<const Image>> getImages() const;
+
+    /// Incremented each time images are added or removed
+    unsigned int getGeneration() const { return mGeneration; }
+
+private: // types
+
+    struct Entry
+    {
+        int dataSetId;
+        std::shared_ptr<const Image> image;
+        /// Landscape and portrait layouts
+        Vuforia::Matrix44F layouts[2];
+    };
+
+private: // methods
+
+    /// Copy a Vuforia image, returns nullptr for unsupported formats
+    static std::shared_ptr<Image> copyImage(const Vuforia::Image& image);
+
+    /// Calculate the layouts of an image for the current display. Caller must hold mMutex.
+    void computeLayouts(Entry& entry) const;
+
+private: // data members
+    mutable std::mutex mMutex;
+
+    std::map<GuideViewId, Entry> mEntries;
+    std::atomic<unsigned int> mGeneration { 0 };
+
+    /// Landscape aspect ratio, always >= 1
+    float mDisplayAspectRatio = 0.0f;
+    float mFieldOfViewY = 0.0f;
+};
+
+#endif // __GUIDEVIEWCACHE_H__
@@ -0,0 +1,242 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "InitPipeline.h"
+
+#include "Log.h"
+
+#include <algorithm>
+#include <condition_variable>
+
+
+/*===============================================================================
+InitPipeline::StageContext methods
+===============================================================================*/
+
+void InitPipeline::StageContext::reportProgress(int progress)
+{
+    mPipeline.setStageProgress(mStageIndex, progress);
+}
+
+
+bool InitPipeline::StageContext::isCancelled() const
+{
+    return mPipeline.mCancelled || mPipeline.mFailed;
+}
+
+
+/*===============================================================================
+InitPipeline public methods
+===============================================================================*/
+
+InitPipeline::InitPipeline(TaskExecutor& executor)
+    : mExecutor(executor)
+{
+}
+
+
+void InitPipeline::addStage(const char* name, LANE lane, StageFunction function, int weight)
+{
+    Stage stage;
+    stage.name = name;
+    stage.lane = lane;
+    stage.function = std::move(function);
+    stage.weight = std::max(weight, 1);
+    stage.progress = 0;
+    stage.started = false;
+    stage.timelineEntry = { name, lane, 0.0, 0.0, false };
+
+    mTotalWeight += stage.weight;
+    mStages.push_back(std::move(stage));
+}
+
+
+InitPipeline::STATE InitPipeline::run()
+{
+    mStartTime = std::chrono::steady_clock::now();
+    mState = STATE::RUNNING;
+
+    // Kick off every background stage straight away, they complete independently
+    std::mutex backgroundMutex;
+    std::condition_variable backgroundDone;
+    size_t backgroundRemaining = 0;
+
+    for (size_t i = 0; i < mStages.size(); ++i)
+    {
+        if (mStages[i].lane != LANE::BACKGROUND)
+        {
+            continue;
+        }
+
+        ++backgroundRemaining;
+        mExecutor.submit([this, i, &backgroundMutex, &backgroundDone, &backgroundRemaining]()
+        {
+            if (!runStage(i) && !mCancelled)
+            {
+                mFailed = true;
+            }
+
+            std::lock_guard<std::mutex> lock(backgroundMutex);
+            if (--backgroundRemaining == 0)
+            {
+                backgroundDone.notify_all();
+            }
+        });
+    }
+
+    // Engine stages run in order on this thread
+    for (size_t i = 0; i < mStages.size(); ++i)
+    {
+        if (mStages[i].lane != LANE::ENGINE)
+        {
+            continue;
+        }
+
+        if (mCancelled || mFailed)
+        {
+            break;
+        }
+
+        if (!runStage(i) && !mCancelled)
+        {
+            mFailed = true;
+        }
+    }
+
+    // The background stages reference locals of this method so must all finish first
+    {
+        std::unique_lock<std::mutex> lock(backgroundMutex);
+        backgroundDone.wait(lock, [&backgroundRemaining] { return backgroundRemaining == 0; });
+    }
+
+    if (mFailed)
+    {
+        mState = STATE::FAILED;
+    }
+    else if (mCancelled)
+    {
+        mState = STATE::CANCELLED;
+    }
+    else
+    {
+        mState = STATE::SUCCEEDED;
+    }
+
+    return mState;
+}
+
+
+std::vector<InitPipeline::TimelineEntry> InitPipeline::getTimeline() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    std::vector<TimelineEntry> timeline;
+    for (const auto& stage : mStages)
+    {
+        if (stage.started)
+        {
+            timeline.push_back(stage.timelineEntry);
+        }
+    }
+
+    std::sort(timeline.begin(), timeline.end(),
+              [](const TimelineEntry& a, const TimelineEntry& b) { return a.startMs < b.startMs; });
+    return timeline;
+}
+
+
+double InitPipeline::getElapsedMs() const
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mStartTime).count();
+}
+
+
+void InitPipeline::logTimeline() const
+{
+    LOG("Startup timeline:");
+    for (const auto& entry : getTimeline())
+    {
+        LOG("  %-10s %-24s %8.1f ms -> %8.1f ms (%7.1f ms)%s",
+            entry.lane == LANE::ENGINE ? "[engine]" : "[async]",
+            entry.name.c_str(), entry.startMs, entry.endMs, entry.endMs - entry.startMs,
+            entry.succeeded ? "" : (mCancelled ? " CANCELLED" : " FAILED"));
+    }
+}
+
+
+/*===============================================================================
+InitPipeline private methods
+===============================================================================*/
+
+bool InitPipeline::runStage(size_t stageIndex)
+{
+    Stage& stage = mStages[stageIndex];
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        stage.started = true;
+        stage.timelineEntry.startMs = getElapsedMs();
+    }
+
+    // Stages that start after a failure or cancellation are skipped
+    bool skipped = mCancelled || mFailed;
+    bool succeeded = false;
+    if (!skipped)
+    {
+        StageContext context(*this, stageIndex);
+        succeeded = stage.function(context);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        stage.timelineEntry.endMs = getElapsedMs();
+        stage.timelineEntry.succeeded = succeeded;
+    }
+
+    if (succeeded)
+    {
+        setStageProgress(stageIndex, 100);
+    }
+    else if (!skipped && !mCancelled)
+    {
+        LOG("Initialization stage '%s' failed", stage.name.c_str());
+    }
+
+    return succeeded;
+}
+
+
+void InitPipeline::setStageProgress(size_t stageIndex, int progress)
+{
+    int overallProgress = 0;
+    const char* stageName = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        Stage& stage = mStages[stageIndex];
+        stage.progress = std::min(std::max(progress, stage.progress), 100);
+
+        int weightedProgress = 0;
+        for (const auto& s : mStages)
+        {
+            weightedProgress += s.progress * s.weight;
+        }
+        overallProgress = mTotalWeight > 0 ? weightedProgress / mTotalWeight : 100;
+
+        // Only report forward movement so callers see a monotonic progress value
+        if (overallProgress <= mLastReportedProgress)
+        {
+            return;
+        }
+        mLastReportedProgress = overallProgress;
+        stageName = stage.name.c_str();
+    }
+
+    if (mProgressCallback)
+    {
+        mProgressCallback(overallProgress, stageName);
+    }
+}
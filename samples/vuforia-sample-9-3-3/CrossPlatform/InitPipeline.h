@@ -0,0 +1,149 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __INITPIPELINE_H__
+#define __INITPIPELINE_H__
+
+#include "TaskExecutor.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+/// Staged state machine that drives application startup.
+/**
+ * Stages are added to one of two lanes:
+ * - ENGINE stages run one after another, in the order they were added, on the
+ *   thread that calls run(). Vuforia Engine lifecycle calls belong here.
+ * - BACKGROUND stages are independent of the engine and of each other. They are
+ *   submitted to the executor as soon as run() starts so that asset I/O and
+ *   parsing overlap with engine initialization.
+ *
+ * run() returns once every stage has finished. A failing stage, or a call to
+ * cancel(), stops any ENGINE stages that have not yet started, running stages
+ * are expected to poll StageContext::isCancelled() at convenient points.
+ *
+ * Stage functions are plain callables, the pipeline itself has no dependency on
+ * Vuforia so the orchestration can be driven with stub stages.
+ */
+class InitPipeline
+{
+public:
+    enum class LANE
+    {
+        ENGINE,
+        BACKGROUND,
+    };
+
+    enum class STATE
+    {
+        IDLE,
+        RUNNING,
+        SUCCEEDED,
+        FAILED,
+        CANCELLED,
+    };
+
+    /// Handed to each stage so it can report progress and observe cancellation
+    class StageContext
+    {
+    public:
+        /// Report progress of the running stage, in the range 0..100
+        void reportProgress(int progress);
+
+        /// Returns true once the pipeline has been cancelled or another stage failed
+        bool isCancelled() const;
+
+    private:
+        friend class InitPipeline;
+        StageContext(InitPipeline& pipeline, size_t stageIndex) : mPipeline(pipeline), mStageIndex(stageIndex) {}
+
+        InitPipeline& mPipeline;
+        size_t mStageIndex;
+    };
+
+    using StageFunction = std::function<bool(StageContext& context)>;
+    using ProgressCallback = std::function<void(int progress, const char* stageName)>;
+
+    /// Start and end of a stage, in milliseconds relative to the start of run()
+    struct TimelineEntry
+    {
+        std::string name;
+        LANE lane;
+        double startMs;
+        double endMs;
+        bool succeeded;
+    };
+
+    explicit InitPipeline(TaskExecutor& executor);
+
+    /// Add a stage to the pipeline. The weight determines how much of the overall
+    /// progress the stage accounts for. Must be called before run().
+    void addStage(const char* name, LANE lane, StageFunction function, int weight = 1);
+
+    /// Set a callback that receives the overall progress (0..100) as stages advance.
+    /// The callback may be invoked from any thread taking part in the pipeline.
+    void setProgressCallback(ProgressCallback callback) { mProgressCallback = std::move(callback); }
+
+    /// Execute all stages, blocking until they have all finished.
+    /// Returns the final state of the pipeline.
+    STATE run();
+
+    /// Request that the pipeline stops as soon as possible. Safe to call from any thread.
+    void cancel() { mCancelled = true; }
+
+    /// Get the current state of the pipeline
+    STATE getState() const { return mState; }
+
+    /// Get the per-stage timeline recorded by the last call to run()
+    std::vector<TimelineEntry> getTimeline() const;
+
+    /// Time elapsed since the start of run(), in milliseconds
+    double getElapsedMs() const;
+
+    /// Write the timeline to the log
+    void logTimeline() const;
+
+private: // methods
+    /// Execute a single stage, recording its timeline entry
+    bool runStage(size_t stageIndex);
+
+    void setStageProgress(size_t stageIndex, int progress);
+
+private: // data members
+    struct Stage
+    {
+        std::string name;
+        LANE lane;
+        StageFunction function;
+        int weight;
+        int progress;
+        bool started;
+        TimelineEntry timelineEntry;
+    };
+
+    TaskExecutor& mExecutor;
+
+    std::vector<Stage> mStages;
+    int mTotalWeight = 0;
+    int mLastReportedProgress = -1;
+    ProgressCallback mProgressCallback;
+
+    std::atomic<STATE> mState { STATE::IDLE };
+    std::atomic<bool> mCancelled { false };
+    std::atomic<bool> mFailed { false };
+
+    /// Guards stage progress and timeline entries, which are written from several threads
+    mutable std::mutex mMutex;
+    std::chrono::steady_clock::time_point mStartTime;
+};
+
+#endif // __INITPIPELINE_H__
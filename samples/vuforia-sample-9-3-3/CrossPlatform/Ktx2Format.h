@@ -0,0 +1,163 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __KTX2FORMAT_H__
+#define __KTX2FORMAT_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+
+/// Layout of the KTX2 texture files written by Tools/TextureEncoder and read by the renderer.
+/**
+ * Only the subset the sample needs is covered: a single 2D image with a full
+ * or partial mip chain of a block compressed format, without supercompression.
+ *
+ * File:
+ *   Header
+ *   LevelIndex per level, level 0 (the largest) first
+ *   data format descriptor, key/value data
+ *   level data, smallest level first, each aligned to its block size
+ *
+ * Textures are stored with the bottom row first, as glTexImage2D expects,
+ * and say so with KTXorientation "ru".
+ */
+namespace Ktx2Format
+{
+    constexpr unsigned char IDENTIFIER[12] = {
+        0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'
+    };
+
+    /// Vulkan format numbers of the formats the sample encodes
+    enum VkFormat : uint32_t
+    {
+        VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK = 147,
+        VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK = 151,
+        VK_FORMAT_ASTC_4x4_UNORM_BLOCK = 157,
+        VK_FORMAT_ASTC_6x6_UNORM_BLOCK = 165,
+        VK_FORMAT_ASTC_8x8_UNORM_BLOCK = 171,
+    };
+
+    /// Data format descriptor values, from the Khronos Data Format Specification
+    constexpr uint8_t KHR_DF_MODEL_ETC2 = 161;
+    constexpr uint8_t KHR_DF_MODEL_ASTC = 162;
+    constexpr uint8_t KHR_DF_CHANNEL_ETC2_COLOR = 2;
+    constexpr uint8_t KHR_DF_CHANNEL_ETC2_ALPHA = 15;
+    constexpr uint8_t KHR_DF_CHANNEL_ASTC_DATA = 0;
+    constexpr uint8_t KHR_DF_PRIMARIES_BT709 = 1;
+    constexpr uint8_t KHR_DF_TRANSFER_LINEAR = 1;
+    constexpr uint16_t KHR_DF_VERSION = 2;
+
+    struct Header
+    {
+        unsigned char identifier[12];
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+    static_assert(sizeof(Header) == 80, "Header must match the file layout");
+
+    struct LevelIndex
+    {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+    static_assert(sizeof(LevelIndex) == 24, "LevelIndex must match the file layout");
+
+    /// Size of a compressed block and how many texels it covers
+    struct BlockInfo
+    {
+        uint32_t width;
+        uint32_t height;
+        uint32_t bytes;
+    };
+
+    /// Block layout of a format, all zero for formats the sample doesn't use
+    inline BlockInfo getBlockInfo(uint32_t vkFormat)
+    {
+        switch (vkFormat)
+        {
+            case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK: return { 4, 4, 8 };
+            case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK: return { 4, 4, 16 };
+            case VK_FORMAT_ASTC_4x4_UNORM_BLOCK: return { 4, 4, 16 };
+            case VK_FORMAT_ASTC_6x6_UNORM_BLOCK: return { 6, 6, 16 };
+            case VK_FORMAT_ASTC_8x8_UNORM_BLOCK: return { 8, 8, 16 };
+            default: return { 0, 0, 0 };
+        }
+    }
+
+    /// Bytes of one mip level of a width x height image
+    inline uint64_t getLevelSize(const BlockInfo& block, uint32_t width, uint32_t height)
+    {
+        uint64_t blocksWide = (width + block.width - 1) / block.width;
+        uint64_t blocksHigh = (height + block.height - 1) / block.height;
+        return blocksWide * blocksHigh * block.bytes;
+    }
+
+    /// Check that data holds a file the sample can use and read its header and level index.
+    /// Returns false if anything is malformed or out of bounds.
+    inline bool read(const unsigned char* data, size_t size, Header& header, std::vector<LevelIndex>& levels)
+    {
+        if (size < sizeof(Header))
+        {
+            return false;
+        }
+        std::memcpy(&header, data, sizeof(Header));
+        if (std::memcmp(header.identifier, IDENTIFIER, sizeof(IDENTIFIER)) != 0 ||
+            header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth != 0 ||
+            header.layerCount > 1 || header.faceCount != 1 || header.supercompressionScheme != 0)
+        {
+            return false;
+        }
+
+        BlockInfo block = getBlockInfo(header.vkFormat);
+        if (block.bytes == 0)
+        {
+            return false;
+        }
+
+        // 0 asks the loader to generate mips, which can't be done for compressed formats
+        uint32_t numLevels = header.levelCount == 0 ? 1 : header.levelCount;
+        if (numLevels > 32 || sizeof(Header) + numLevels * sizeof(LevelIndex) > size)
+        {
+            return false;
+        }
+        levels.resize(numLevels);
+        std::memcpy(levels.data(), data + sizeof(Header), numLevels * sizeof(LevelIndex));
+
+        for (uint32_t level = 0; level < numLevels; ++level)
+        {
+            uint32_t width = header.pixelWidth >> level;
+            uint32_t height = header.pixelHeight >> level;
+            uint64_t expectedSize = getLevelSize(block, width == 0 ? 1 : width, height == 0 ? 1 : height);
+            const LevelIndex& index = levels[level];
+            if (index.byteLength != expectedSize || index.byteOffset > size || index.byteLength > size - index.byteOffset)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+#endif // __KTX2FORMAT_H__
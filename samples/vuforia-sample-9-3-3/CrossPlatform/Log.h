@@ -21,7 +21,7 @@
  #  include <windows.h>
  #  define LOG(...) do { char str[1024]; snprintf(str, 1024, __VA_ARGS__); OutputDebugStringA(str); OutputDebugStringA("\n"); } while (0)
 
- #elif defined(__APPLE__) // iOS
+ #else // iOS, and desktop builds of the tools
  #  define LOG(...) do { printf(__VA_ARGS__); printf("\n"); } while (0)
  #endif
 
@@ -670,6 +670,19 @@ MathUtils::copyMatrix(const Vuforia::Matrix44F& m)
 }
 
 
+Vuforia::Matrix44F
+MathUtils::Matrix44FFromPose(const Vuforia::Matrix34F& pose)
+{
+    Vuforia::Matrix44F r = Matrix44FIdentity();
+
+    for (int row = 0; row < 3; row++)
+        for (int col = 0; col < 4; col++)
+            r.data[col * 4 + row] = pose.data[row * 4 + col];
+
+    return r;
+}
+
+
 void
 MathUtils::makeRotationMatrix(float angle, const Vuforia::Vec3F& axis, Vuforia::Matrix44F& m)
 {
@@ -160,6 +160,10 @@ public:
     /// Create copy of the 4x4 matrix and return the result
     static Vuforia::Matrix44F copyMatrix(const Vuforia::Matrix44F& m);
 
+    /// Convert a 3x4 row-major pose to a 4x4 column-major OpenGL matrix and return the result.
+    /// Equivalent to Vuforia::Tool::convertPose2GLMatrix, for use without the Vuforia library.
+    static Vuforia::Matrix44F Matrix44FFromPose(const Vuforia::Matrix34F& pose);
+
     // ARGUMENT METHODS (result always returned in argument)
 
     /// Print a 4x4 matrix.
@@ -152,15 +152,8 @@ Modelv3d::~Modelv3d()
 }
 
 
-void Modelv3d::clearData()
+void Modelv3d::releaseData()
 {
-    mIsLoaded = false;
-
-    mNumVertices = 0;
-    mNumFaces = 0;
-    mNumGroups = 0;
-    mNumMaterials = 0;
-
     delete[] mVertices;
     mVertices = nullptr;
     delete[] mNormals;
@@ -180,6 +173,19 @@ void Modelv3d::clearData()
 }
 
 
+void Modelv3d::clearData()
+{
+    mIsLoaded = false;
+
+    mNumVertices = 0;
+    mNumFaces = 0;
+    mNumGroups = 0;
+    mNumMaterials = 0;
+
+    releaseData();
+}
+
+
 int Modelv3d::readInt(const std::vector<unsigned char>& data, unsigned int& location)
 {
     int result;
@@ -29,6 +29,12 @@ public:
 
     const float* getTextureCoordinates() const { return mTextureCoordinates; }
 
+    /// Free the parsed vertex data once it has been uploaded, the counts remain valid
+    void releaseData();
+
+    /// False after releaseData
+    bool hasData() const { return mVertices != nullptr; }
+
 private: // methods
     void clearData();
     static unsigned int readUint(const std::vector<unsigned char>& data, unsigned int& location);
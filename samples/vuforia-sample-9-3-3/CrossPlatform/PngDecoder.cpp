@@ -0,0 +1,475 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "PngDecoder.h"
+
+#include "Log.h"
+
+#include <zlib.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+
+namespace
+{
+    constexpr unsigned char SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+    /// Refuse anything bigger than any GLES 3 device can hold as a texture
+    constexpr uint32_t MAX_DIMENSION = 16384;
+
+    enum ColorType : uint8_t
+    {
+        COLOR_GRAY = 0,
+        COLOR_RGB = 2,
+        COLOR_PALETTE = 3,
+        COLOR_GRAY_ALPHA = 4,
+        COLOR_RGBA = 6,
+    };
+
+    enum FilterType : uint8_t
+    {
+        FILTER_NONE = 0,
+        FILTER_SUB = 1,
+        FILTER_UP = 2,
+        FILTER_AVERAGE = 3,
+        FILTER_PAETH = 4,
+    };
+
+    /// Fields of the IHDR chunk, plus what follows from them
+    struct Header
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint8_t bitDepth = 0;
+        uint8_t colorType = 0;
+        uint8_t interlaceMethod = 0;
+
+        unsigned int numChannels = 0;
+        /// Bytes of one row after the filter type byte
+        size_t rowSize = 0;
+        /// Distance back to the corresponding byte of the previous pixel, for unfiltering
+        size_t filterStride = 0;
+    };
+
+    /// Palette expanded to RGBA, and the transparent color of gray and RGB images
+    struct ColorTable
+    {
+        unsigned char palette[256 * 4];
+        bool hasColorKey = false;
+        uint16_t colorKey[3] = {};
+    };
+
+    uint32_t readUint32(const unsigned char* data)
+    {
+        return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) |
+               (static_cast<uint32_t>(data[2]) << 8) | static_cast<uint32_t>(data[3]);
+    }
+
+    uint16_t readUint16(const unsigned char* data)
+    {
+        return static_cast<uint16_t>((data[0] << 8) | data[1]);
+    }
+
+    bool readHeader(const unsigned char* data, uint32_t length, Header& header)
+    {
+        if (length != 13)
+        {
+            return false;
+        }
+        header.width = readUint32(data);
+        header.height = readUint32(data + 4);
+        header.bitDepth = data[8];
+        header.colorType = data[9];
+        header.interlaceMethod = data[12];
+        // data[10] and data[11], the compression and filter methods, have only one defined value
+        if (header.width == 0 || header.height == 0 || header.width > MAX_DIMENSION ||
+            header.height > MAX_DIMENSION || data[10] != 0 || data[11] != 0)
+        {
+            return false;
+        }
+
+        bool validBitDepth;
+        uint8_t depth = header.bitDepth;
+        switch (header.colorType)
+        {
+            case COLOR_GRAY:
+                header.numChannels = 1;
+                validBitDepth = depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16;
+                break;
+            case COLOR_PALETTE:
+                header.numChannels = 1;
+                validBitDepth = depth == 1 || depth == 2 || depth == 4 || depth == 8;
+                break;
+            case COLOR_RGB:
+                header.numChannels = 3;
+                validBitDepth = depth == 8 || depth == 16;
+                break;
+            case COLOR_GRAY_ALPHA:
+                header.numChannels = 2;
+                validBitDepth = depth == 8 || depth == 16;
+                break;
+            case COLOR_RGBA:
+                header.numChannels = 4;
+                validBitDepth = depth == 8 || depth == 16;
+                break;
+            default:
+                return false;
+        }
+        if (!validBitDepth)
+        {
+            return false;
+        }
+
+        size_t bitsPerPixel = header.numChannels * header.bitDepth;
+        header.rowSize = (header.width * bitsPerPixel + 7) / 8;
+        header.filterStride = bitsPerPixel < 8 ? 1 : bitsPerPixel / 8;
+        return true;
+    }
+
+    unsigned char paethPredictor(int left, int above, int aboveLeft)
+    {
+        int estimate = left + above - aboveLeft;
+        int distanceLeft = std::abs(estimate - left);
+        int distanceAbove = std::abs(estimate - above);
+        int distanceAboveLeft = std::abs(estimate - aboveLeft);
+        if (distanceLeft <= distanceAbove && distanceLeft <= distanceAboveLeft)
+        {
+            return static_cast<unsigned char>(left);
+        }
+        return static_cast<unsigned char>(distanceAbove <= distanceAboveLeft ? above : aboveLeft);
+    }
+
+    /// Undo the filter of a row in place, previous is the unfiltered row above, all zero for the first row
+    bool unfilterRow(uint8_t filterType, unsigned char* row, const unsigned char* previous, size_t size, size_t stride)
+    {
+        switch (filterType)
+        {
+            case FILTER_NONE:
+                break;
+            case FILTER_SUB:
+                for (size_t i = stride; i < size; ++i)
+                {
+                    row[i] = static_cast<unsigned char>(row[i] + row[i - stride]);
+                }
+                break;
+            case FILTER_UP:
+                for (size_t i = 0; i < size; ++i)
+                {
+                    row[i] = static_cast<unsigned char>(row[i] + previous[i]);
+                }
+                break;
+            case FILTER_AVERAGE:
+                for (size_t i = 0; i < stride; ++i)
+                {
+                    row[i] = static_cast<unsigned char>(row[i] + (previous[i] >> 1));
+                }
+                for (size_t i = stride; i < size; ++i)
+                {
+                    row[i] = static_cast<unsigned char>(row[i] + ((row[i - stride] + previous[i]) >> 1));
+                }
+                break;
+            case FILTER_PAETH:
+                for (size_t i = 0; i < stride; ++i)
+                {
+                    row[i] = static_cast<unsigned char>(row[i] + previous[i]);
+                }
+                for (size_t i = stride; i < size; ++i)
+                {
+                    row[i] = static_cast<unsigned char>(
+                        row[i] + paethPredictor(row[i - stride], previous[i], previous[i - stride]));
+                }
+                break;
+            default:
+                return false;
+        }
+        return true;
+    }
+
+    /// Sample of a row at index, unscaled, for any bit depth
+    uint16_t getSample(const unsigned char* row, size_t index, uint8_t bitDepth)
+    {
+        switch (bitDepth)
+        {
+            case 16:
+                return readUint16(row + index * 2);
+            case 8:
+                return row[index];
+            default:
+            {
+                size_t bit = index * bitDepth;
+                unsigned int shift = 8 - bitDepth - (bit & 7);
+                return static_cast<uint16_t>((row[bit >> 3] >> shift) & ((1 << bitDepth) - 1));
+            }
+        }
+    }
+
+    /// Scale a sample of bitDepth bits to 8 bits
+    unsigned char toByte(uint16_t sample, uint8_t bitDepth)
+    {
+        switch (bitDepth)
+        {
+            case 16:
+                return static_cast<unsigned char>(sample >> 8);
+            case 8:
+                return static_cast<unsigned char>(sample);
+            default:
+                return static_cast<unsigned char>(sample * 255 / ((1 << bitDepth) - 1));
+        }
+    }
+
+    /// Convert an unfiltered row to RGBA
+    void convertRow(const Header& header, const ColorTable& colors, const unsigned char* row, unsigned char* out)
+    {
+        uint32_t width = header.width;
+
+        // The 8 bit color formats are by far the most common, so get their own loops
+        if (header.bitDepth == 8 && !colors.hasColorKey)
+        {
+            switch (header.colorType)
+            {
+                case COLOR_RGBA:
+                    std::memcpy(out, row, width * 4);
+                    return;
+                case COLOR_RGB:
+                    for (uint32_t x = 0; x < width; ++x, row += 3, out += 4)
+                    {
+                        out[0] = row[0];
+                        out[1] = row[1];
+                        out[2] = row[2];
+                        out[3] = 255;
+                    }
+                    return;
+                case COLOR_PALETTE:
+                    for (uint32_t x = 0; x < width; ++x, out += 4)
+                    {
+                        std::memcpy(out, &colors.palette[row[x] * 4], 4);
+                    }
+                    return;
+                default:
+                    break;
+            }
+        }
+
+        uint8_t depth = header.bitDepth;
+        for (uint32_t x = 0; x < width; ++x, out += 4)
+        {
+            switch (header.colorType)
+            {
+                case COLOR_GRAY:
+                {
+                    uint16_t gray = getSample(row, x, depth);
+                    out[0] = out[1] = out[2] = toByte(gray, depth);
+                    out[3] = colors.hasColorKey && gray == colors.colorKey[0] ? 0 : 255;
+                    break;
+                }
+                case COLOR_PALETTE:
+                    std::memcpy(out, &colors.palette[getSample(row, x, depth) * 4], 4);
+                    break;
+                case COLOR_RGB:
+                {
+                    uint16_t red = getSample(row, x * 3, depth);
+                    uint16_t green = getSample(row, x * 3 + 1, depth);
+                    uint16_t blue = getSample(row, x * 3 + 2, depth);
+                    out[0] = toByte(red, depth);
+                    out[1] = toByte(green, depth);
+                    out[2] = toByte(blue, depth);
+                    out[3] = colors.hasColorKey && red == colors.colorKey[0] && green == colors.colorKey[1] &&
+                             blue == colors.colorKey[2] ? 0 : 255;
+                    break;
+                }
+                case COLOR_GRAY_ALPHA:
+                    out[0] = out[1] = out[2] = toByte(getSample(row, x * 2, depth), depth);
+                    out[3] = toByte(getSample(row, x * 2 + 1, depth), depth);
+                    break;
+                case COLOR_RGBA:
+                    for (unsigned int channel = 0; channel < 4; ++channel)
+                    {
+                        out[channel] = toByte(getSample(row, x * 4 + channel, depth), depth);
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    /// A slice of the compressed image data, which can be split over many IDAT chunks
+    struct DataChunk
+    {
+        const unsigned char* data;
+        uint32_t length;
+    };
+}
+
+
+bool
+PngDecoder::decode(const unsigned char* data, size_t size, Image& image)
+{
+    image = Image();
+    if (size < sizeof(SIGNATURE) || std::memcmp(data, SIGNATURE, sizeof(SIGNATURE)) != 0)
+    {
+        LOG("Error: Not a PNG file");
+        return false;
+    }
+
+    // Find the header, palette and image data
+    Header header;
+    ColorTable colors;
+    for (unsigned int i = 0; i < 256; ++i)
+    {
+        colors.palette[i * 4] = colors.palette[i * 4 + 1] = colors.palette[i * 4 + 2] = 0;
+        colors.palette[i * 4 + 3] = 255;
+    }
+    std::vector<DataChunk> imageData;
+    bool hasHeader = false;
+    bool hasEnd = false;
+    size_t position = sizeof(SIGNATURE);
+    while (!hasEnd && size - position >= 12)
+    {
+        uint32_t length = readUint32(data + position);
+        const unsigned char* type = data + position + 4;
+        const unsigned char* chunkData = data + position + 8;
+        if (length > size - position - 12)
+        {
+            break;
+        }
+        position += 12 + static_cast<size_t>(length);
+
+        if (std::memcmp(type, "IHDR", 4) == 0)
+        {
+            hasHeader = readHeader(chunkData, length, header);
+            if (!hasHeader)
+            {
+                LOG("Error: Invalid or unsupported PNG header");
+                return false;
+            }
+        }
+        else if (!hasHeader)
+        {
+            // IHDR must come first
+            break;
+        }
+        else if (std::memcmp(type, "PLTE", 4) == 0)
+        {
+            for (uint32_t i = 0; i < length / 3 && i < 256; ++i)
+            {
+                std::memcpy(&colors.palette[i * 4], chunkData + i * 3, 3);
+            }
+        }
+        else if (std::memcmp(type, "tRNS", 4) == 0)
+        {
+            if (header.colorType == COLOR_PALETTE)
+            {
+                for (uint32_t i = 0; i < length && i < 256; ++i)
+                {
+                    colors.palette[i * 4 + 3] = chunkData[i];
+                }
+            }
+            else if (header.colorType == COLOR_GRAY && length >= 2)
+            {
+                colors.hasColorKey = true;
+                colors.colorKey[0] = readUint16(chunkData);
+            }
+            else if (header.colorType == COLOR_RGB && length >= 6)
+            {
+                colors.hasColorKey = true;
+                for (unsigned int channel = 0; channel < 3; ++channel)
+                {
+                    colors.colorKey[channel] = readUint16(chunkData + channel * 2);
+                }
+            }
+        }
+        else if (std::memcmp(type, "IDAT", 4) == 0)
+        {
+            imageData.push_back({ chunkData, length });
+        }
+        else if (std::memcmp(type, "IEND", 4) == 0)
+        {
+            hasEnd = true;
+        }
+    }
+    if (!hasHeader || imageData.empty())
+    {
+        LOG("Error: Truncated or malformed PNG file");
+        return false;
+    }
+    if (header.interlaceMethod != 0)
+    {
+        LOG("Error: Interlaced PNG files aren't supported");
+        return false;
+    }
+
+    z_stream stream = {};
+    if (inflateInit(&stream) != Z_OK)
+    {
+        LOG("Error: Failed to initialize zlib");
+        return false;
+    }
+
+    std::vector<unsigned char> pixels(static_cast<size_t>(header.width) * header.height * 4);
+    size_t outputRowSize = static_cast<size_t>(header.width) * 4;
+
+    // The filter type byte followed by the row, for this row and the one above
+    std::vector<unsigned char> rowBuffers((header.rowSize + 1) * 2, 0);
+    unsigned char* current = rowBuffers.data();
+    unsigned char* previous = current + header.rowSize + 1;
+
+    size_t nextChunk = 0;
+    bool succeeded = true;
+    for (uint32_t y = 0; y < header.height && succeeded; ++y)
+    {
+        stream.next_out = current;
+        stream.avail_out = static_cast<uInt>(header.rowSize + 1);
+        while (stream.avail_out > 0)
+        {
+            if (stream.avail_in == 0)
+            {
+                if (nextChunk == imageData.size())
+                {
+                    succeeded = false;
+                    break;
+                }
+                stream.next_in = const_cast<Bytef*>(imageData[nextChunk].data);
+                stream.avail_in = imageData[nextChunk].length;
+                ++nextChunk;
+                continue;
+            }
+            int result = inflate(&stream, Z_NO_FLUSH);
+            if (result == Z_STREAM_END ? stream.avail_out > 0 : result != Z_OK)
+            {
+                succeeded = false;
+                break;
+            }
+        }
+
+        if (succeeded)
+        {
+            succeeded = unfilterRow(current[0], current + 1, previous + 1, header.rowSize, header.filterStride);
+        }
+        if (succeeded)
+        {
+            // Bottom row first
+            convertRow(header, colors, current + 1, &pixels[(header.height - 1 - y) * outputRowSize]);
+            std::swap(current, previous);
+        }
+    }
+    inflateEnd(&stream);
+
+    if (!succeeded)
+    {
+        LOG("Error: Corrupt PNG image data");
+        return false;
+    }
+
+    image.width = static_cast<int>(header.width);
+    image.height = static_cast<int>(header.height);
+    image.pixels = std::move(pixels);
+    return true;
+}
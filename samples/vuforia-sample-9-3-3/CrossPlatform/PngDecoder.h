@@ -0,0 +1,43 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __PNGDECODER_H__
+#define __PNGDECODER_H__
+
+#include <cstddef>
+#include <vector>
+
+
+/// Decodes PNG files to RGBA8 ready for glTexImage2D, using zlib for the compressed data.
+/**
+ * Each scanline is inflated, unfiltered and converted to RGBA in a single
+ * pass, and written to the output bottom row first so textures need no
+ * separate flip or swizzle. Only one row and the row above it are kept in
+ * the PNG's own format.
+ *
+ * Every color type is supported, at bit depths up to 8, or 16 where the low
+ * byte of each sample is dropped. Interlaced images aren't supported.
+ *
+ * decode keeps no state, so images can be decoded on several threads at once.
+ */
+class PngDecoder
+{
+public:
+    struct Image
+    {
+        int width = 0;
+        int height = 0;
+        /// Tightly packed RGBA8 rows, bottom row first
+        std::vector<unsigned char> pixels;
+    };
+
+    /// Decode a PNG file held in memory.
+    /// Returns false, leaving image empty, if the data isn't a PNG the decoder can read.
+    static bool decode(const unsigned char* data, size_t size, Image& image);
+};
+
+#endif // __PNGDECODER_H__
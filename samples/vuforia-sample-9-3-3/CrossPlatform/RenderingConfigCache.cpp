@@ -0,0 +1,64 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "RenderingConfigCache.h"
+
+#include <algorithm>
+
+
+bool RenderingConfigCache::Key::operator==(const Key& other) const
+{
+    return width == other.width && height == other.height && orientation == other.orientation &&
+           videoMode.mWidth == other.videoMode.mWidth && videoMode.mHeight == other.videoMode.mHeight &&
+           videoMode.mFramerate == other.videoMode.mFramerate;
+}
+
+
+const RenderingConfigCache::Config* RenderingConfigCache::find(const Key& key)
+{
+    // Only a handful of entries, a linear search is quicker than hashing
+    auto it = std::find_if(mEntries.begin(), mEntries.end(),
+                           [&key](const std::pair<Key, Config>& entry) { return entry.first == key; });
+    if (it == mEntries.end())
+    {
+        return nullptr;
+    }
+
+    std::rotate(mEntries.begin(), it, it + 1);
+    return &mEntries.front().second;
+}
+
+
+const RenderingConfigCache::Config& RenderingConfigCache::insert(const Key& key,
+                                                                 const Vuforia::VideoBackgroundConfig& videoBackgroundConfig,
+                                                                 std::shared_ptr<Vuforia::RenderingPrimitives> renderingPrimitives)
+{
+    auto it = std::find_if(mEntries.begin(), mEntries.end(),
+                           [&key](const std::pair<Key, Config>& entry) { return entry.first == key; });
+    if (it != mEntries.end())
+    {
+        mEntries.erase(it);
+    }
+    else if (mEntries.size() >= MAX_ENTRIES)
+    {
+        mEntries.pop_back();
+    }
+
+    Config config;
+    config.videoBackgroundConfig = videoBackgroundConfig;
+    config.renderingPrimitives = std::move(renderingPrimitives);
+    config.generation = mNextGeneration++;
+
+    mEntries.insert(mEntries.begin(), std::make_pair(key, config));
+    return mEntries.front().second;
+}
+
+
+void RenderingConfigCache::clear()
+{
+    mEntries.clear();
+}
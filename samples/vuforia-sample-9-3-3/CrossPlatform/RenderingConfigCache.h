@@ -0,0 +1,71 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __RENDERINGCONFIGCACHE_H__
+#define __RENDERINGCONFIGCACHE_H__
+
+#include <Vuforia/RenderingPrimitives.h>
+#include <Vuforia/VideoBackgroundConfig.h>
+#include <Vuforia/VideoMode.h>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+
+/// Remembers the rendering configuration for each view size, orientation and video mode.
+/**
+ * Rotating the device or resuming the app reconfigures rendering. Configurations
+ * that have been seen before are returned from here instead of recalculating the
+ * video background and copying the RenderingPrimitives again.
+ *
+ * Every configuration gets a unique generation id. Renderers can use the id to
+ * key GPU resources derived from the configuration, such as the video background
+ * mesh buffers, so those are also only built once.
+ */
+class RenderingConfigCache
+{
+public:
+    /// Most configurations kept, enough for each orientation of a couple of view sizes
+    static constexpr size_t MAX_ENTRIES = 8;
+
+    struct Key
+    {
+        int width;
+        int height;
+        int orientation;
+        Vuforia::VideoMode videoMode;
+
+        bool operator==(const Key& other) const;
+    };
+
+    struct Config
+    {
+        Vuforia::VideoBackgroundConfig videoBackgroundConfig;
+        std::shared_ptr<Vuforia::RenderingPrimitives> renderingPrimitives;
+        /// Unique for the lifetime of the cache, never 0
+        unsigned int generation;
+    };
+
+    /// Get a configuration, or nullptr if it isn't cached.
+    /// A successful lookup marks the configuration as most recently used.
+    const Config* find(const Key& key);
+
+    /// Add or replace a configuration, evicting the least recently used if the cache is full
+    const Config& insert(const Key& key, const Vuforia::VideoBackgroundConfig& videoBackgroundConfig,
+                         std::shared_ptr<Vuforia::RenderingPrimitives> renderingPrimitives);
+
+    /// Remove all configurations
+    void clear();
+
+private: // data members
+    /// Most recently used first
+    std::vector<std::pair<Key, Config>> mEntries;
+    unsigned int mNextGeneration = 1;
+};
+
+#endif // __RENDERINGCONFIGCACHE_H__
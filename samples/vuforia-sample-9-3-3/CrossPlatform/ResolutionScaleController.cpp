@@ -0,0 +1,104 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "ResolutionScaleController.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+/*===============================================================================
+ResolutionScaleController public methods
+===============================================================================*/
+
+ResolutionScaleController::ResolutionScaleController()
+    : ResolutionScaleController(Settings())
+{
+}
+
+
+ResolutionScaleController::ResolutionScaleController(const Settings& settings)
+    : mSettings(settings), mScale(settings.maxScale)
+{
+}
+
+
+void ResolutionScaleController::setSettings(const Settings& settings)
+{
+    mSettings = settings;
+    mScale = std::min(std::max(mScale, mSettings.minScale), mSettings.maxScale);
+}
+
+
+void ResolutionScaleController::reset()
+{
+    mScale = mSettings.maxScale;
+    mHasSamples = false;
+    mFullScaleMs = 0.0;
+    mFixedMs = 0.0;
+}
+
+
+float ResolutionScaleController::addSample(float scale, double scaledMs, double fixedMs)
+{
+    if (scale <= 0.0f || scaledMs < 0.0 || fixedMs < 0.0)
+    {
+        return mScale;
+    }
+
+    double fullScaleMs = scaledMs / (static_cast<double>(scale) * scale);
+    if (!mHasSamples)
+    {
+        mFullScaleMs = fullScaleMs;
+        mFixedMs = fixedMs;
+        mHasSamples = true;
+    }
+    else
+    {
+        mFullScaleMs += mSettings.smoothing * (fullScaleMs - mFullScaleMs);
+        mFixedMs += mSettings.smoothing * (fixedMs - mFixedMs);
+    }
+
+    double predictedMs = getPredictedMs();
+    double lowMs = mSettings.targetMs * (1.0 - mSettings.headroom);
+    if (predictedMs > mSettings.targetMs || predictedMs < lowMs)
+    {
+        // Aim for the middle of the band, so that the load has to change by more
+        // than noise before the scale moves again
+        float aimScale = getScaleForMs(0.5 * (mSettings.targetMs + lowMs));
+        mScale = std::min(std::max(aimScale, mScale - mSettings.maxDecrease), mScale + mSettings.maxIncrease);
+    }
+    mScale = std::min(std::max(mScale, mSettings.minScale), mSettings.maxScale);
+    return mScale;
+}
+
+
+double ResolutionScaleController::getPredictedMs() const
+{
+    return mHasSamples ? mFixedMs + mFullScaleMs * mScale * mScale : 0.0;
+}
+
+
+/*===============================================================================
+ResolutionScaleController private methods
+===============================================================================*/
+
+float ResolutionScaleController::getScaleForMs(double targetMs) const
+{
+    double scaledBudgetMs = targetMs - mFixedMs;
+    if (scaledBudgetMs <= 0.0)
+    {
+        // Even nothing drawn at all wouldn't make it
+        return mSettings.minScale;
+    }
+    if (mFullScaleMs <= 0.0)
+    {
+        return mSettings.maxScale;
+    }
+    float scale = static_cast<float>(std::sqrt(scaledBudgetMs / mFullScaleMs));
+    return std::min(std::max(scale, mSettings.minScale), mSettings.maxScale);
+}
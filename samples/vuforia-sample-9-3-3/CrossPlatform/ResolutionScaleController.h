@@ -0,0 +1,86 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __RESOLUTIONSCALECONTROLLER_H__
+#define __RESOLUTIONSCALECONTROLLER_H__
+
+
+/// Picks the resolution augmentations are drawn at from the GPU time of recent frames.
+/**
+ * The scale is the fraction of the full resolution along each axis. Each frame
+ * whose GPU time is known is reported with the scale it was drawn at, split
+ * into the time of the work drawn at that scale and the time of the rest. The
+ * scaled time is taken to go with the number of pixels, so it is divided by the
+ * scale squared to estimate it at full resolution. That way frames reported a
+ * few frames late, drawn at an older scale, still say what the current scale
+ * costs, and the controller doesn't overshoot while waiting for the GPU.
+ *
+ * The smoothed estimates predict the frame time at the current scale. Once it
+ * is over the target, or under the target by more than the headroom, the scale
+ * moves toward the one predicted to land in the middle of that band, by no more
+ * than a step at a time: quickly down, slowly up.
+ *
+ * The policy has no dependency on GL or Vuforia so it can be driven by a
+ * simulated cost model, see Tools/ResolutionScaleSimulation.
+ */
+class ResolutionScaleController
+{
+public:
+    struct Settings
+    {
+        /// GPU time a frame should take, in milliseconds
+        double targetMs = 10.0;
+        /// Fraction of targetMs a frame has to come in under before the scale is
+        /// raised, so the scale doesn't flip between two values around the target
+        double headroom = 0.15;
+        /// Range of the scale
+        float minScale = 0.5f;
+        float maxScale = 1.0f;
+        /// Weight of each new frame in the smoothed times, lower smooths more
+        double smoothing = 0.2;
+        /// Largest change of the scale per frame. Dropping faster than rising recovers
+        /// from an overload quickly without creeping back up into the next one.
+        float maxDecrease = 0.1f;
+        float maxIncrease = 0.02f;
+    };
+
+    ResolutionScaleController();
+    explicit ResolutionScaleController(const Settings& settings);
+
+    /// Replace the settings, keeping the measurements so far
+    void setSettings(const Settings& settings);
+    const Settings& getSettings() const { return mSettings; }
+
+    /// Forget the measurements and go back to the maximum scale
+    void reset();
+
+    /// Report the GPU time of a frame drawn at scale: scaledMs for the work drawn at
+    /// that scale, fixedMs for the rest. Returns the scale to draw the next frame at.
+    float addSample(float scale, double scaledMs, double fixedMs);
+
+    /// The scale to draw at
+    float getScale() const { return mScale; }
+
+    /// GPU time of a frame at the current scale, from the smoothed measurements,
+    /// or 0 before any
+    double getPredictedMs() const;
+
+private: // methods
+    /// The scale predicted to bring the frame time to targetMs
+    float getScaleForMs(double targetMs) const;
+
+private: // data members
+    Settings mSettings;
+    float mScale = 1.0f;
+
+    bool mHasSamples = false;
+    /// Smoothed time of the scaled work at full resolution, and of the rest of the frame
+    double mFullScaleMs = 0.0;
+    double mFixedMs = 0.0;
+};
+
+#endif // __RESOLUTIONSCALECONTROLLER_H__
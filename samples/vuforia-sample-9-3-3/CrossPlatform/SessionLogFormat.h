@@ -0,0 +1,110 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __SESSIONLOGFORMAT_H__
+#define __SESSIONLOGFORMAT_H__
+
+#include "FrameSnapshot.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+
+/// Encoding shared by SessionRecorder and SessionReplayer.
+/**
+ * A session log starts with MAGIC followed by one record per frame. Each record
+ * is a varint payload length followed by the payload, so a log cut short by a
+ * crash is still readable up to the last complete frame.
+ *
+ * Poses and sizes are quantized to QUANTIZATION_SCALE and stored as zigzag varint
+ * deltas from the previous value for the same trackable, and timestamps as deltas
+ * in microseconds. A stationary target costs a few bytes per frame.
+ *
+ * Payload:
+ *   timestamp delta
+ *   flags (bit 0: device pose present)
+ *   [device status, status info, 12 pose deltas]
+ *   trackable count
+ *   per trackable: type, id, status, status info, 12 pose deltas,
+ *                  3 size deltas, 3 centre deltas
+ */
+namespace SessionLogFormat
+{
+    constexpr char MAGIC[] = { 'V', 'S', 'L', '1' };
+
+    /// Poses are stored to 10 micrometres, well below tracking noise
+    constexpr float QUANTIZATION_SCALE = 100000.0f;
+
+    constexpr uint8_t FLAG_DEVICE_POSE = 1;
+
+    /// Last values written or read for one trackable
+    struct History
+    {
+        int32_t pose[12] = {};
+        int32_t size[3] = {};
+        int32_t center[3] = {};
+    };
+
+    /// Delta state carried from frame to frame
+    struct State
+    {
+        int64_t timestampUs = 0;
+        History device;
+        std::map<int32_t, History> trackables;
+    };
+
+    inline int32_t quantize(float value)
+    {
+        return static_cast<int32_t>(std::lround(value * QUANTIZATION_SCALE));
+    }
+
+    inline float dequantize(int32_t value)
+    {
+        return value / QUANTIZATION_SCALE;
+    }
+
+    inline uint64_t zigzag(int64_t value)
+    {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    inline int64_t unzigzag(uint64_t value)
+    {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    inline void writeVarint(std::vector<uint8_t>& out, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    /// Returns false if the data ends before the varint does
+    inline bool readVarint(const uint8_t*& in, const uint8_t* end, uint64_t& value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64 && in < end; shift += 7)
+        {
+            uint8_t byte = *in++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+#endif // __SESSIONLOGFORMAT_H__
@@ -0,0 +1,221 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "SessionRecorder.h"
+
+#include "Log.h"
+
+#include <cmath>
+
+
+namespace
+{
+    /// Write values as zigzag deltas from history, then update history
+    void writeDeltas(std::vector<uint8_t>& out, const float* values, int32_t* history, int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            int32_t quantized = SessionLogFormat::quantize(values[i]);
+            SessionLogFormat::writeVarint(out, SessionLogFormat::zigzag(static_cast<int64_t>(quantized) - history[i]));
+            history[i] = quantized;
+        }
+    }
+}
+
+
+/*===============================================================================
+SessionRecorder public methods
+===============================================================================*/
+
+SessionRecorder::~SessionRecorder()
+{
+    close();
+}
+
+
+bool SessionRecorder::open(const std::string& path)
+{
+    close();
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr)
+    {
+        LOG("Error: Unable to create session log %s", path.c_str());
+        return false;
+    }
+
+    if (std::fwrite(SessionLogFormat::MAGIC, sizeof(SessionLogFormat::MAGIC), 1, file) != 1)
+    {
+        LOG("Error: Unable to write session log %s", path.c_str());
+        std::fclose(file);
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFile = file;
+        mClosing = false;
+        mNumFramesWritten = 0;
+        mNumFramesDropped = 0;
+        mNumBytesWritten = sizeof(SessionLogFormat::MAGIC);
+    }
+    mEncodeState = SessionLogFormat::State();
+    mWriterThread = std::thread(&SessionRecorder::writerLoop, this);
+
+    LOG("Recording session to %s", path.c_str());
+    return true;
+}
+
+
+void SessionRecorder::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mFile == nullptr)
+        {
+            return;
+        }
+        mClosing = true;
+    }
+    mFrameAvailable.notify_one();
+    mWriterThread.join();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::fclose(mFile);
+    mFile = nullptr;
+
+    LOG("Session recording closed: %zu frames, %zu bytes, %zu frames dropped",
+        mNumFramesWritten, mNumBytesWritten, mNumFramesDropped);
+}
+
+
+bool SessionRecorder::isOpen() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mFile != nullptr && !mClosing;
+}
+
+
+void SessionRecorder::record(FrameSnapshot snapshot)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mFile == nullptr || mClosing)
+        {
+            return;
+        }
+        if (mQueue.size() >= MAX_QUEUED_FRAMES)
+        {
+            ++mNumFramesDropped;
+            return;
+        }
+        mQueue.push_back(std::move(snapshot));
+    }
+    mFrameAvailable.notify_one();
+}
+
+
+size_t SessionRecorder::getNumFramesWritten() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mNumFramesWritten;
+}
+
+
+size_t SessionRecorder::getNumFramesDropped() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mNumFramesDropped;
+}
+
+
+size_t SessionRecorder::getNumBytesWritten() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mNumBytesWritten;
+}
+
+
+/*===============================================================================
+SessionRecorder private methods
+===============================================================================*/
+
+void SessionRecorder::writerLoop()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;)
+    {
+        mFrameAvailable.wait(lock, [this] { return mClosing || !mQueue.empty(); });
+        if (mQueue.empty())
+        {
+            // Closing and everything queued has been written
+            break;
+        }
+
+        FrameSnapshot snapshot = std::move(mQueue.front());
+        mQueue.pop_front();
+        bool flush = mQueue.empty();
+        lock.unlock();
+
+        mRecord.clear();
+        encode(snapshot);
+        bool written = std::fwrite(mRecord.data(), mRecord.size(), 1, mFile) == 1;
+        // Flush once caught up so a crash loses as little of the session as possible
+        if (flush)
+        {
+            std::fflush(mFile);
+        }
+
+        lock.lock();
+        if (written)
+        {
+            ++mNumFramesWritten;
+            mNumBytesWritten += mRecord.size();
+        }
+        else
+        {
+            ++mNumFramesDropped;
+        }
+    }
+}
+
+
+void SessionRecorder::encode(const FrameSnapshot& snapshot)
+{
+    using namespace SessionLogFormat;
+
+    mPayload.clear();
+
+    int64_t timestampUs = static_cast<int64_t>(std::llround(snapshot.timestamp * 1000000.0));
+    writeVarint(mPayload, zigzag(timestampUs - mEncodeState.timestampUs));
+    mEncodeState.timestampUs = timestampUs;
+
+    mPayload.push_back(snapshot.hasDevicePose ? FLAG_DEVICE_POSE : 0);
+    if (snapshot.hasDevicePose)
+    {
+        mPayload.push_back(snapshot.deviceStatus);
+        mPayload.push_back(snapshot.deviceStatusInfo);
+        writeDeltas(mPayload, snapshot.devicePose.data, mEncodeState.device.pose, 12);
+    }
+
+    writeVarint(mPayload, snapshot.trackables.size());
+    for (const auto& trackable : snapshot.trackables)
+    {
+        writeVarint(mPayload, trackable.type);
+        writeVarint(mPayload, zigzag(trackable.id));
+        mPayload.push_back(trackable.status);
+        mPayload.push_back(trackable.statusInfo);
+
+        History& history = mEncodeState.trackables[trackable.id];
+        writeDeltas(mPayload, trackable.pose.data, history.pose, 12);
+        writeDeltas(mPayload, trackable.size.data, history.size, 3);
+        writeDeltas(mPayload, trackable.center.data, history.center, 3);
+    }
+
+    writeVarint(mRecord, mPayload.size());
+    mRecord.insert(mRecord.end(), mPayload.begin(), mPayload.end());
+}
@@ -0,0 +1,90 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __SESSIONRECORDER_H__
+#define __SESSIONRECORDER_H__
+
+#include "FrameSnapshot.h"
+#include "SessionLogFormat.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+
+/// Writes FrameSnapshots to a compact append-only session log.
+/**
+ * record() only queues the snapshot, encoding and file writes happen on a
+ * dedicated writer thread so recording never stalls the caller. If the writer
+ * falls more than MAX_QUEUED_FRAMES behind, new frames are dropped and counted.
+ * See SessionLogFormat for the file layout and SessionReplayer to read it back.
+ */
+class SessionRecorder
+{
+public:
+    static constexpr size_t MAX_QUEUED_FRAMES = 256;
+
+    SessionRecorder() = default;
+    ~SessionRecorder();
+
+    SessionRecorder(const SessionRecorder&) = delete;
+    SessionRecorder& operator=(const SessionRecorder&) = delete;
+
+    /// Create the log file and start the writer thread, replacing any existing file.
+    /// Returns false if the file can't be created.
+    bool open(const std::string& path);
+
+    /// Write any queued frames and close the file
+    void close();
+
+    /// True between open and close
+    bool isOpen() const;
+
+    /// Queue a frame to be written, ignored if the recorder isn't open.
+    /// May be called from any thread, open and close must be called from the same thread.
+    void record(FrameSnapshot snapshot);
+
+    /// Get the number of frames written so far
+    size_t getNumFramesWritten() const;
+
+    /// Get the number of frames dropped because the writer fell behind
+    size_t getNumFramesDropped() const;
+
+    /// Get the number of bytes written so far, including the header
+    size_t getNumBytesWritten() const;
+
+private: // methods
+    void writerLoop();
+
+    /// Append the record for one frame to mRecord, updating mEncodeState
+    void encode(const FrameSnapshot& snapshot);
+
+private: // data members
+    /// Set and cleared under mMutex, only used by the writer thread while it runs
+    std::FILE* mFile = nullptr;
+    std::thread mWriterThread;
+
+    mutable std::mutex mMutex;
+    /// Signalled when a frame is queued or the recorder is closing
+    std::condition_variable mFrameAvailable;
+    std::deque<FrameSnapshot> mQueue;
+    bool mClosing = false;
+
+    size_t mNumFramesWritten = 0;
+    size_t mNumFramesDropped = 0;
+    size_t mNumBytesWritten = 0;
+
+    /// Only used on the writer thread
+    SessionLogFormat::State mEncodeState;
+    std::vector<uint8_t> mPayload;
+    std::vector<uint8_t> mRecord;
+};
+
+#endif // __SESSIONRECORDER_H__
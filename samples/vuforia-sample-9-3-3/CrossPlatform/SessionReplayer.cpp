@@ -0,0 +1,224 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "SessionReplayer.h"
+
+#include "Log.h"
+#include "MathUtils.h"
+
+#include <cstdio>
+#include <cstring>
+
+
+namespace
+{
+    /// Matches Vuforia::TrackableResult::NO_POSE
+    constexpr uint8_t STATUS_NO_POSE = 0;
+
+    /// Read values stored as zigzag deltas from history, then update history
+    bool readDeltas(const uint8_t*& in, const uint8_t* end, float* values, int32_t* history, int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            uint64_t delta;
+            if (!SessionLogFormat::readVarint(in, end, delta))
+            {
+                return false;
+            }
+            history[i] = static_cast<int32_t>(history[i] + SessionLogFormat::unzigzag(delta));
+            values[i] = SessionLogFormat::dequantize(history[i]);
+        }
+        return true;
+    }
+
+    bool readByte(const uint8_t*& in, const uint8_t* end, uint8_t& value)
+    {
+        if (in >= end)
+        {
+            return false;
+        }
+        value = *in++;
+        return true;
+    }
+}
+
+
+/*===============================================================================
+SessionReplayer public methods
+===============================================================================*/
+
+bool SessionReplayer::open(const std::string& path)
+{
+    mData.clear();
+    rewind();
+
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr)
+    {
+        LOG("Error: Unable to open session log %s", path.c_str());
+        return false;
+    }
+
+    uint8_t buffer[64 * 1024];
+    size_t numRead;
+    while ((numRead = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        mData.insert(mData.end(), buffer, buffer + numRead);
+    }
+    std::fclose(file);
+
+    if (mData.size() < sizeof(SessionLogFormat::MAGIC) ||
+        std::memcmp(mData.data(), SessionLogFormat::MAGIC, sizeof(SessionLogFormat::MAGIC)) != 0)
+    {
+        LOG("Error: %s is not a session log", path.c_str());
+        mData.clear();
+        return false;
+    }
+
+    rewind();
+    return true;
+}
+
+
+bool SessionReplayer::next(FrameSnapshot& snapshot)
+{
+    if (mTruncated || mOffset >= mData.size())
+    {
+        return false;
+    }
+
+    const uint8_t* in = mData.data() + mOffset;
+    const uint8_t* end = mData.data() + mData.size();
+
+    uint64_t length;
+    if (!SessionLogFormat::readVarint(in, end, length) || length > static_cast<uint64_t>(end - in) ||
+        !decode(in, in + length, snapshot))
+    {
+        LOG("Session log truncated after %zu frames", mNumFramesRead);
+        mTruncated = true;
+        return false;
+    }
+
+    mOffset = static_cast<size_t>(in + length - mData.data());
+    ++mNumFramesRead;
+    return true;
+}
+
+
+void SessionReplayer::rewind()
+{
+    mOffset = sizeof(SessionLogFormat::MAGIC);
+    mNumFramesRead = 0;
+    mTruncated = false;
+    mDecodeState = SessionLogFormat::State();
+}
+
+
+bool SessionReplayer::getAugmentations(const FrameSnapshot& snapshot, std::vector<ReplayedAugmentation>& augmentations)
+{
+    augmentations.clear();
+    if (!snapshot.hasDevicePose)
+    {
+        return false;
+    }
+
+    Vuforia::Matrix44F viewMatrix = MathUtils::Matrix44FFromPose(snapshot.devicePose);
+    viewMatrix = MathUtils::Matrix44FTranspose(MathUtils::Matrix44FInverse(viewMatrix));
+
+    for (const auto& trackable : snapshot.trackables)
+    {
+        if (trackable.status == STATUS_NO_POSE)
+        {
+            continue;
+        }
+
+        ReplayedAugmentation replayed;
+        replayed.resultType = trackable.type;
+        AugmentationRegistry::Augmentation& augmentation = replayed.augmentation;
+        augmentation.trackableId = trackable.id;
+
+        augmentation.modelViewMatrix = MathUtils::Matrix44FFromPose(trackable.pose);
+        MathUtils::multiplyMatrix(viewMatrix, augmentation.modelViewMatrix, augmentation.modelViewMatrix);
+
+        Vuforia::Matrix44F scaleMatrix;
+        MathUtils::makeScalingMatrix(trackable.size, scaleMatrix);
+        Vuforia::Matrix44F translateMatrix;
+        MathUtils::makeTranslationMatrix(trackable.center, translateMatrix);
+
+        MathUtils::multiplyMatrix(translateMatrix, scaleMatrix, augmentation.scaledModelViewMatrix);
+        MathUtils::multiplyMatrix(augmentation.modelViewMatrix, augmentation.scaledModelViewMatrix,
+                                  augmentation.scaledModelViewMatrix);
+
+        augmentations.push_back(replayed);
+    }
+
+    return true;
+}
+
+
+/*===============================================================================
+SessionReplayer private methods
+===============================================================================*/
+
+bool SessionReplayer::decode(const uint8_t* in, const uint8_t* end, FrameSnapshot& snapshot)
+{
+    using namespace SessionLogFormat;
+
+    uint64_t value;
+    if (!readVarint(in, end, value))
+    {
+        return false;
+    }
+    mDecodeState.timestampUs += unzigzag(value);
+    snapshot.timestamp = mDecodeState.timestampUs / 1000000.0;
+
+    uint8_t flags;
+    if (!readByte(in, end, flags))
+    {
+        return false;
+    }
+    snapshot.hasDevicePose = (flags & FLAG_DEVICE_POSE) != 0;
+    if (snapshot.hasDevicePose)
+    {
+        if (!readByte(in, end, snapshot.deviceStatus) || !readByte(in, end, snapshot.deviceStatusInfo) ||
+            !readDeltas(in, end, snapshot.devicePose.data, mDecodeState.device.pose, 12))
+        {
+            return false;
+        }
+    }
+
+    uint64_t numTrackables;
+    // Each trackable takes more than a byte, reject counts the rest of the payload cannot hold
+    if (!readVarint(in, end, numTrackables) || numTrackables > static_cast<uint64_t>(end - in))
+    {
+        return false;
+    }
+
+    snapshot.trackables.resize(static_cast<size_t>(numTrackables));
+    for (auto& trackable : snapshot.trackables)
+    {
+        uint64_t type;
+        uint64_t id;
+        if (!readVarint(in, end, type) || !readVarint(in, end, id) ||
+            !readByte(in, end, trackable.status) || !readByte(in, end, trackable.statusInfo))
+        {
+            return false;
+        }
+        trackable.type = static_cast<uint16_t>(type);
+        trackable.id = static_cast<int32_t>(unzigzag(id));
+
+        History& history = mDecodeState.trackables[trackable.id];
+        if (!readDeltas(in, end, trackable.pose.data, history.pose, 12) ||
+            !readDeltas(in, end, trackable.size.data, history.size, 3) ||
+            !readDeltas(in, end, trackable.center.data, history.center, 3))
+        {
+            return false;
+        }
+    }
+
+    return in == end;
+}
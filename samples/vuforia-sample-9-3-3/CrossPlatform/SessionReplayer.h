@@ -0,0 +1,68 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __SESSIONREPLAYER_H__
+#define __SESSIONREPLAYER_H__
+
+#include "AugmentationRegistry.h"
+#include "FrameSnapshot.h"
+#include "SessionLogFormat.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+/// Reads back the frames written by SessionRecorder.
+/**
+ * Replay needs neither the camera nor the Vuforia engine, so a recorded session
+ * can drive the renderer on a desktop to profile rendering with repeatable input.
+ */
+class SessionReplayer
+{
+public:
+    /// An augmentation computed from a replayed frame
+    struct ReplayedAugmentation
+    {
+        /// Vuforia::Type data of the recorded TrackableResult
+        uint16_t resultType;
+        AugmentationRegistry::Augmentation augmentation;
+    };
+
+    /// Read a session log into memory. Returns false if it can't be read or isn't a session log.
+    bool open(const std::string& path);
+
+    /// Decode the next frame. Returns false at the end of the log.
+    bool next(FrameSnapshot& snapshot);
+
+    /// Go back to the first frame
+    void rewind();
+
+    /// Get the number of frames decoded since open or rewind
+    size_t getNumFramesRead() const { return mNumFramesRead; }
+
+    /// True if decoding stopped at an incomplete or corrupt record rather than the end of the log
+    bool isTruncated() const { return mTruncated; }
+
+    /// Compute the model view matrices for the posed trackables in a frame, as
+    /// AppController::getTrackableResults does for live frames.
+    /// Returns false if the frame has no device pose.
+    static bool getAugmentations(const FrameSnapshot& snapshot, std::vector<ReplayedAugmentation>& augmentations);
+
+private: // methods
+    /// Decode one record payload into snapshot
+    bool decode(const uint8_t* data, const uint8_t* end, FrameSnapshot& snapshot);
+
+private: // data members
+    std::vector<uint8_t> mData;
+    size_t mOffset = 0;
+    size_t mNumFramesRead = 0;
+    bool mTruncated = false;
+    SessionLogFormat::State mDecodeState;
+};
+
+#endif // __SESSIONREPLAYER_H__
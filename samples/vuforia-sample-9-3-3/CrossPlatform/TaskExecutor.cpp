@@ -0,0 +1,82 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "TaskExecutor.h"
+
+#include <algorithm>
+
+
+TaskExecutor::TaskExecutor(unsigned int numThreads)
+{
+    numThreads = std::max(numThreads, 1u);
+    mThreads.reserve(numThreads);
+    for (unsigned int i = 0; i < numThreads; ++i)
+    {
+        mThreads.emplace_back(&TaskExecutor::workerLoop, this);
+    }
+}
+
+
+TaskExecutor::~TaskExecutor()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mShutdown = true;
+    }
+    mTaskAvailable.notify_all();
+
+    for (auto& thread : mThreads)
+    {
+        thread.join();
+    }
+}
+
+
+void TaskExecutor::submit(Task task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTasks.push_back(std::move(task));
+    }
+    mTaskAvailable.notify_one();
+}
+
+
+void TaskExecutor::waitIdle()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mIdle.wait(lock, [this] { return mTasks.empty() && mNumRunning == 0; });
+}
+
+
+void TaskExecutor::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;)
+    {
+        mTaskAvailable.wait(lock, [this] { return mShutdown || !mTasks.empty(); });
+        if (mTasks.empty())
+        {
+            // Only reached when shutting down with nothing left to do
+            return;
+        }
+
+        Task task = std::move(mTasks.front());
+        mTasks.pop_front();
+        ++mNumRunning;
+
+        lock.unlock();
+        task();
+        lock.lock();
+
+        --mNumRunning;
+        if (mTasks.empty() && mNumRunning == 0)
+        {
+            mIdle.notify_all();
+        }
+    }
+}
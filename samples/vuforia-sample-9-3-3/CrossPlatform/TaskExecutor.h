@@ -0,0 +1,62 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __TASKEXECUTOR_H__
+#define __TASKEXECUTOR_H__
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/// A small pool of worker threads used to run work off the calling thread.
+/**
+ * Tasks are executed in submission order by whichever worker becomes free first.
+ * The executor must outlive every task submitted to it, the destructor
+ * completes any queued tasks before joining the workers.
+ */
+class TaskExecutor
+{
+public:
+    using Task = std::function<void()>;
+
+    explicit TaskExecutor(unsigned int numThreads);
+    ~TaskExecutor();
+
+    TaskExecutor(const TaskExecutor&) = delete;
+    TaskExecutor& operator=(const TaskExecutor&) = delete;
+
+    /// Queue a task for execution on one of the worker threads
+    void submit(Task task);
+
+    /// Block the calling thread until every task submitted so far has completed
+    void waitIdle();
+
+    /// Get the number of worker threads in the pool
+    unsigned int getNumThreads() const { return static_cast<unsigned int>(mThreads.size()); }
+
+private: // methods
+    void workerLoop();
+
+private: // data members
+    std::vector<std::thread> mThreads;
+
+    std::mutex mMutex;
+    /// Signalled when a task is queued or the executor is shutting down
+    std::condition_variable mTaskAvailable;
+    /// Signalled when the last running task completes and the queue is empty
+    std::condition_variable mIdle;
+
+    std::deque<Task> mTasks;
+    unsigned int mNumRunning = 0;
+    bool mShutdown = false;
+};
+
+#endif // __TASKEXECUTOR_H__
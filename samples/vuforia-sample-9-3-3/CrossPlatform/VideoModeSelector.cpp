@@ -0,0 +1,222 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "VideoModeSelector.h"
+
+#include "Log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+
+namespace
+{
+    /// Median of the values, reordering them
+    double median(std::vector<double>& values)
+    {
+        auto middle = values.begin() + values.size() / 2;
+        std::nth_element(values.begin(), middle, values.end());
+        return *middle;
+    }
+
+    /// Higher is better quality
+    long long modeQuality(const VideoModeSelector::Mode& mode)
+    {
+        // Resolution matters most, frame rate breaks ties
+        return static_cast<long long>(mode.width) * mode.height * 1000 + static_cast<long long>(mode.framerate);
+    }
+}
+
+
+/*===============================================================================
+VideoModeSelector public methods
+===============================================================================*/
+
+VideoModeSelector::VideoModeSelector(std::vector<Mode> modes, double frameBudgetMs,
+                                     int warmupFrames, int sampleFrames)
+    : mModes(std::move(modes)), mMeasurements(mModes.size()), mFrameBudgetMs(frameBudgetMs),
+      mWarmupFrames(warmupFrames), mSampleFrames(sampleFrames)
+{
+    mTrackingPeriods.reserve(mSampleFrames);
+    mRenderTimes.reserve(mSampleFrames);
+}
+
+
+int VideoModeSelector::startCalibration()
+{
+    mMeasurements.assign(mModes.size(), Measurement());
+    mCandidate = 0;
+    mFramesInCandidate = 0;
+    mTrackingPeriods.clear();
+    mRenderTimes.clear();
+    mSelectedMode = NO_MODE;
+    mCalibrating = !mModes.empty();
+    return mCalibrating ? mModes[0].index : NO_MODE;
+}
+
+
+int VideoModeSelector::addSample(double trackingPeriodMs, double renderMs)
+{
+    if (!mCalibrating)
+    {
+        return NO_MODE;
+    }
+
+    ++mFramesInCandidate;
+    if (mFramesInCandidate <= mWarmupFrames)
+    {
+        return NO_MODE;
+    }
+
+    mTrackingPeriods.push_back(trackingPeriodMs);
+    mRenderTimes.push_back(renderMs);
+    if (static_cast<int>(mTrackingPeriods.size()) < mSampleFrames)
+    {
+        return NO_MODE;
+    }
+
+    // Medians, so the odd slow frame while the camera settles doesn't count
+    Measurement& measurement = mMeasurements[mCandidate];
+    measurement.trackingPeriodMs = median(mTrackingPeriods);
+    measurement.renderMs = median(mRenderTimes);
+    measurement.numSamples = static_cast<int>(mTrackingPeriods.size());
+    mTrackingPeriods.clear();
+    mRenderTimes.clear();
+
+    LOG("Video mode %dx%d@%.0f: tracking period %.1f ms, render %.1f ms",
+        mModes[mCandidate].width, mModes[mCandidate].height, mModes[mCandidate].framerate,
+        measurement.trackingPeriodMs, measurement.renderMs);
+
+    if (mCandidate + 1 < mModes.size())
+    {
+        ++mCandidate;
+        mFramesInCandidate = 0;
+        return mModes[mCandidate].index;
+    }
+
+    mCalibrating = false;
+    mSelectedMode = choose(mModes, mMeasurements, mFrameBudgetMs);
+    return mSelectedMode;
+}
+
+
+int VideoModeSelector::choose(const std::vector<Mode>& modes, const std::vector<Measurement>& measurements,
+                              double frameBudgetMs)
+{
+    int best = NO_MODE;
+    int cheapest = NO_MODE;
+    double cheapestCost = 0.0;
+
+    for (size_t i = 0; i < modes.size() && i < measurements.size(); ++i)
+    {
+        const Measurement& measurement = measurements[i];
+        if (measurement.numSamples == 0)
+        {
+            continue;
+        }
+
+        // The tracker gets every first, second, third... frame the camera delivers, so its period
+        // is a whole number of frame intervals. Rounding to one removes the camera's timing jitter.
+        double trackingPeriodMs = measurement.trackingPeriodMs;
+        if (modes[i].framerate > 0.0f)
+        {
+            double frameIntervalMs = 1000.0 / modes[i].framerate;
+            trackingPeriodMs = frameIntervalMs * std::max(1.0, std::round(trackingPeriodMs / frameIntervalMs));
+        }
+
+        // Tracking and rendering run on different threads, the slower of the two limits the frame rate
+        double cost = std::max(trackingPeriodMs, measurement.renderMs);
+        if (cheapest == NO_MODE || cost < cheapestCost)
+        {
+            cheapest = static_cast<int>(i);
+            cheapestCost = cost;
+        }
+
+        if (cost <= frameBudgetMs &&
+            (best == NO_MODE || modeQuality(modes[i]) > modeQuality(modes[best])))
+        {
+            best = static_cast<int>(i);
+        }
+    }
+
+    if (best == NO_MODE)
+    {
+        best = cheapest;
+    }
+
+    return best != NO_MODE ? modes[best].index : NO_MODE;
+}
+
+
+bool VideoModeSelector::loadSelection(const std::string& path, const std::string& deviceModel, Mode& mode)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        return false;
+    }
+
+    // One line per device: <width> <height> <framerate> <index> <model>
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream fields(line);
+        Mode savedMode;
+        std::string savedModel;
+        if (fields >> savedMode.width >> savedMode.height >> savedMode.framerate >> savedMode.index >> std::ws &&
+            std::getline(fields, savedModel) && savedModel == deviceModel)
+        {
+            mode = savedMode;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+bool VideoModeSelector::saveSelection(const std::string& path, const std::string& deviceModel, const Mode& mode)
+{
+    // Keep the entries for other devices, the file may be shared through a backup
+    std::vector<std::string> lines;
+    {
+        std::ifstream file(path);
+        std::string line;
+        while (std::getline(file, line))
+        {
+            std::istringstream fields(line);
+            Mode savedMode;
+            std::string savedModel;
+            if (fields >> savedMode.width >> savedMode.height >> savedMode.framerate >> savedMode.index >> std::ws &&
+                std::getline(fields, savedModel) && savedModel != deviceModel)
+            {
+                lines.push_back(line);
+            }
+        }
+    }
+
+    // Every digit of the frame rate, it is matched exactly against the camera's modes
+    std::ostringstream entry;
+    entry << std::setprecision(std::numeric_limits<float>::max_digits10) << mode.width << ' ' << mode.height << ' ' << mode.framerate << ' ' << mode.index << ' ' << deviceModel;
+    lines.push_back(entry.str());
+
+    std::ofstream file(path, std::ios::trunc);
+    if (!file)
+    {
+        LOG("Error: Unable to write video mode selection to %s", path.c_str());
+        return false;
+    }
+    for (const auto& line : lines)
+    {
+        file << line << '\n';
+    }
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,99 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __VIDEOMODESELECTOR_H__
+#define __VIDEOMODESELECTOR_H__
+
+#include <string>
+#include <vector>
+
+
+/// Picks a camera video mode by measuring what each one costs on the device.
+/**
+ * During calibration each candidate mode is used for a short window while the
+ * caller reports the tracking period and render time of every frame. Once all
+ * modes have been measured the highest quality mode whose median costs fit the
+ * frame budget is selected, falling back to the cheapest mode if none fit. The
+ * tracking period is counted in whole camera frames, so the jitter of the
+ * camera's frame timing can't tip a mode either side of the budget.
+ *
+ * The policy has no dependency on Vuforia so it can be driven by a simulated
+ * cost model. The result can be persisted per device model so calibration only
+ * runs once.
+ */
+class VideoModeSelector
+{
+public:
+    /// Video mode properties the selection depends on
+    struct Mode
+    {
+        int index;
+        int width;
+        int height;
+        float framerate;
+    };
+
+    /// Median costs measured for a mode
+    struct Measurement
+    {
+        double trackingPeriodMs = 0.0;
+        double renderMs = 0.0;
+        int numSamples = 0;
+    };
+
+    static constexpr int NO_MODE = -1;
+
+    /// Create a selector for the given modes
+    /// warmupFrames are discarded after each switch while the camera settles,
+    /// then the medians of sampleFrames are taken.
+    VideoModeSelector(std::vector<Mode> modes, double frameBudgetMs,
+                      int warmupFrames = 10, int sampleFrames = 30);
+
+    /// Start measuring the modes, returns the index of the first mode to select
+    int startCalibration();
+
+    /// True between startCalibration and the final mode being chosen
+    bool isCalibrating() const { return mCalibrating; }
+
+    /// Record the costs of one frame in the current candidate mode.
+    /// Returns the index of the mode to switch to, or NO_MODE to stay in the current one.
+    /// When calibration completes the selected mode is returned.
+    int addSample(double trackingPeriodMs, double renderMs);
+
+    /// Get the chosen mode index, NO_MODE until calibration has completed
+    int getSelectedMode() const { return mSelectedMode; }
+
+    /// Get the measurements for a mode, in the order of the modes passed to the constructor
+    const std::vector<Measurement>& getMeasurements() const { return mMeasurements; }
+
+    /// Choose a mode from completed measurements. Exposed for testing.
+    static int choose(const std::vector<Mode>& modes, const std::vector<Measurement>& measurements,
+                      double frameBudgetMs);
+
+    /// Read the mode saved for a device model. Returns false if none is saved.
+    static bool loadSelection(const std::string& path, const std::string& deviceModel, Mode& mode);
+
+    /// Save the mode for a device model, replacing any previous entry for it
+    static bool saveSelection(const std::string& path, const std::string& deviceModel, const Mode& mode);
+
+private: // data members
+    std::vector<Mode> mModes;
+    std::vector<Measurement> mMeasurements;
+    double mFrameBudgetMs;
+    int mWarmupFrames;
+    int mSampleFrames;
+
+    bool mCalibrating = false;
+    size_t mCandidate = 0;
+    int mFramesInCandidate = 0;
+    /// Samples of the current candidate after its warmup
+    std::vector<double> mTrackingPeriods;
+    std::vector<double> mRenderTimes;
+    int mSelectedMode = NO_MODE;
+};
+
+#endif // __VIDEOMODESELECTOR_H__
@@ -0,0 +1,875 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+// Desktop replayer of the GL command recordings made by the Android
+// renderer's GLESCommandRecorder, on a GLES 3.1 context without a window such
+// as Mesa's software renderer gives. Times the CPU cost of issuing each
+// recorded frame's calls and counts them. Given a second recording, from
+// another build, replays both in turn and compares them. See README.md.
+
+#include <GLESCommandFormat.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl31.h>
+#include <GLES2/gl2ext.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+
+using namespace GLESCommandFormat;
+
+
+namespace
+{
+    constexpr int DEFAULT_ITERATIONS = 5;
+    /// Surface size for recordings that didn't give one
+    constexpr GLsizei DEFAULT_WIDTH = 1280;
+    constexpr GLsizei DEFAULT_HEIGHT = 720;
+
+    constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+    constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+    struct Command
+    {
+        Opcode opcode;
+        int64_t ints[MAX_INTS];
+        float floats[MAX_FLOATS];
+        /// Payload within Recording::bytes, nullptr if empty
+        const uint8_t* data;
+        size_t size;
+    };
+
+    struct Recording
+    {
+        std::string path;
+        std::vector<uint8_t> bytes;
+        std::vector<Command> commands;
+        GLsizei width = DEFAULT_WIDTH;
+        GLsizei height = DEFAULT_HEIGHT;
+        size_t numFrames = 0;
+    };
+
+    /// Cost of replaying one frame
+    struct FrameResult
+    {
+        double cpuMs = 0.0;
+        unsigned int numCalls = 0;
+        unsigned int numDrawCalls = 0;
+        size_t uploadedBytes = 0;
+    };
+
+    /// A full replay, from the first command to the last
+    struct ReplayResult
+    {
+        std::vector<FrameResult> frames;
+        /// Of the pixels left after the last frame
+        uint64_t imageHash = 0;
+    };
+
+    /// Summary over the frames of a recording
+    struct Summary
+    {
+        double medianMs = 0.0;
+        double meanMs = 0.0;
+        double p95Ms = 0.0;
+        double numCalls = 0.0;
+        double numDrawCalls = 0.0;
+        double uploadedBytes = 0.0;
+    };
+
+    bool readFile(const std::string& path, std::vector<uint8_t>& data)
+    {
+        FILE* file = std::fopen(path.c_str(), "rb");
+        if (file == nullptr)
+        {
+            return false;
+        }
+        std::fseek(file, 0, SEEK_END);
+        data.resize(static_cast<size_t>(std::ftell(file)));
+        std::fseek(file, 0, SEEK_SET);
+        bool succeeded = std::fread(data.data(), 1, data.size(), file) == data.size();
+        std::fclose(file);
+        return succeeded;
+    }
+
+    /// Decode every command up front, so replays time GL and not the decoding
+    bool loadRecording(const std::string& path, Recording& recording)
+    {
+        recording.path = path;
+        if (!readFile(path, recording.bytes))
+        {
+            std::fprintf(stderr, "Failed to read %s\n", path.c_str());
+            return false;
+        }
+        if (recording.bytes.size() < sizeof(MAGIC) ||
+            std::memcmp(recording.bytes.data(), MAGIC, sizeof(MAGIC)) != 0)
+        {
+            std::fprintf(stderr, "%s isn't a GL command recording\n", path.c_str());
+            return false;
+        }
+
+        bool hasSurfaceSize = false;
+        const uint8_t* in = recording.bytes.data() + sizeof(MAGIC);
+        const uint8_t* end = recording.bytes.data() + recording.bytes.size();
+        while (in < end)
+        {
+            Command command = {};
+            if (*in >= NUM_OPCODES)
+            {
+                std::fprintf(stderr, "%s: unknown opcode %u, ignoring the rest\n", path.c_str(), *in);
+                break;
+            }
+            command.opcode = static_cast<Opcode>(*in++);
+            const Layout& layout = getLayout(command.opcode);
+
+            bool complete = true;
+            for (uint8_t i = 0; i < layout.numInts && complete; ++i)
+            {
+                uint64_t value = 0;
+                complete = readVarint(in, end, value);
+                command.ints[i] = unzigzag(value);
+            }
+            for (uint8_t i = 0; i < layout.numFloats && complete; ++i)
+            {
+                complete = readFloat(in, end, command.floats[i]);
+            }
+            if (layout.hasData && complete)
+            {
+                uint64_t size = 0;
+                complete = readVarint(in, end, size) && size <= static_cast<uint64_t>(end - in);
+                if (complete)
+                {
+                    command.data = size > 0 ? in : nullptr;
+                    command.size = static_cast<size_t>(size);
+                    in += size;
+                }
+            }
+            if (!complete)
+            {
+                // Recording cut short, keep the complete commands
+                break;
+            }
+
+            if (command.opcode == OP_SURFACE_SIZE && !hasSurfaceSize)
+            {
+                recording.width = static_cast<GLsizei>(command.ints[0]);
+                recording.height = static_cast<GLsizei>(command.ints[1]);
+                hasSurfaceSize = true;
+            }
+            else if (command.opcode == OP_FRAME_END)
+            {
+                ++recording.numFrames;
+            }
+            recording.commands.push_back(command);
+        }
+        return true;
+    }
+
+    EGLDisplay getDisplay()
+    {
+        auto getPlatformDisplay =
+            reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (getPlatformDisplay == nullptr)
+        {
+            return EGL_NO_DISPLAY;
+        }
+        EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr) || !eglBindAPI(EGL_OPENGL_ES_API))
+        {
+            return EGL_NO_DISPLAY;
+        }
+        return display;
+    }
+
+    /// Plays a recording back on a context of its own, so no objects are left from an earlier replay
+    class Replayer
+    {
+    public:
+        explicit Replayer(EGLDisplay display) : mDisplay(display) {}
+
+        bool replay(const Recording& recording, ReplayResult& result);
+
+    private: // methods
+        void execute(const Command& command);
+
+        /// The replay's name for a recorded object name, names it hasn't seen pass through
+        static GLuint getName(const std::map<int64_t, GLuint>& names, int64_t name)
+        {
+            auto nameIt = names.find(name);
+            return nameIt != names.end() ? nameIt->second : static_cast<GLuint>(name);
+        }
+
+        /// Framebuffers the recording didn't create are the surface's
+        GLuint getFramebuffer(int64_t name) const
+        {
+            auto nameIt = mFramebuffers.find(name);
+            return nameIt != mFramebuffers.end() ? nameIt->second : mSurfaceFramebuffer;
+        }
+
+        static const void* getPointer(int64_t offset)
+        {
+            return reinterpret_cast<const void*>(static_cast<intptr_t>(offset));
+        }
+
+    private: // data members
+        EGLDisplay mDisplay;
+
+        // Recorded names to the replay's
+        std::map<int64_t, GLuint> mBuffers;
+        std::map<int64_t, GLuint> mTextures;
+        std::map<int64_t, GLuint> mVertexArrays;
+        /// Shaders and programs share a namespace
+        std::map<int64_t, GLuint> mPrograms;
+        std::map<int64_t, GLsync> mSyncs;
+        std::map<int64_t, GLuint> mFramebuffers;
+
+        /// Stands in for the window surface
+        GLuint mSurfaceFramebuffer = 0;
+
+        /// From GL_OVR_multiview, without which multiview attachments are skipped
+        PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC mFramebufferTextureMultiview = nullptr;
+
+        /// Mapped ranges by buffer target
+        std::map<GLenum, uint8_t*> mMappings;
+    };
+
+
+    bool Replayer::replay(const Recording& recording, ReplayResult& result)
+    {
+        const EGLint contextAttributes[] = { EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 1, EGL_NONE };
+        EGLContext context = eglCreateContext(mDisplay, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttributes);
+        if (context == EGL_NO_CONTEXT || !eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+        {
+            std::fprintf(stderr, "Failed to create a GLES 3.1 context without a surface\n");
+            return false;
+        }
+
+        mFramebufferTextureMultiview = nullptr;
+        const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+        if (extensions != nullptr && std::strstr(extensions, "GL_OVR_multiview") != nullptr)
+        {
+            mFramebufferTextureMultiview = reinterpret_cast<PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC>(
+                eglGetProcAddress("glFramebufferTextureMultiviewOVR"));
+        }
+
+        // Stand in for the window surface, which the renderer only binds again after
+        // drawing to a framebuffer of its own
+        GLuint renderbuffers[2] = {};
+        glGenRenderbuffers(2, renderbuffers);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, recording.width, recording.height);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, recording.width, recording.height);
+        GLuint framebuffer = 0;
+        glGenFramebuffers(1, &framebuffer);
+        mSurfaceFramebuffer = framebuffer;
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+        glViewport(0, 0, recording.width, recording.height);
+
+        result.frames.clear();
+        FrameResult frame;
+        bool inFrame = false;
+        auto frameStart = std::chrono::steady_clock::now();
+        for (const Command& command : recording.commands)
+        {
+            switch (command.opcode)
+            {
+                case OP_FRAME_BEGIN:
+                    // Start each frame with the GPU idle, as the previous one's work would otherwise be timed
+                    glFinish();
+                    frame = FrameResult();
+                    inFrame = true;
+                    frameStart = std::chrono::steady_clock::now();
+                    break;
+                case OP_FRAME_END:
+                    frame.cpuMs = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - frameStart).count();
+                    result.frames.push_back(frame);
+                    inFrame = false;
+                    break;
+                case OP_SURFACE_SIZE:
+                    break;
+                default:
+                    execute(command);
+                    if (inFrame)
+                    {
+                        ++frame.numCalls;
+                        frame.uploadedBytes += command.size;
+                        if (command.opcode == OP_DRAW_ARRAYS || command.opcode == OP_DRAW_ARRAYS_INSTANCED ||
+                            command.opcode == OP_DRAW_ELEMENTS || command.opcode == OP_DRAW_ELEMENTS_INSTANCED)
+                        {
+                            ++frame.numDrawCalls;
+                        }
+                    }
+                    break;
+            }
+        }
+
+        std::vector<uint8_t> pixels(static_cast<size_t>(recording.width) * recording.height * 4);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glReadPixels(0, 0, recording.width, recording.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        result.imageHash = FNV_OFFSET_BASIS;
+        for (uint8_t byte : pixels)
+        {
+            result.imageHash = (result.imageHash ^ byte) * FNV_PRIME;
+        }
+        GLenum error = glGetError();
+        if (error != GL_NO_ERROR)
+        {
+            std::fprintf(stderr, "%s: GL error 0x%x during the replay\n", recording.path.c_str(), error);
+        }
+
+        eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(mDisplay, context);
+        mBuffers.clear();
+        mTextures.clear();
+        mVertexArrays.clear();
+        mPrograms.clear();
+        mSyncs.clear();
+        mFramebuffers.clear();
+        mMappings.clear();
+        return true;
+    }
+
+
+    void Replayer::execute(const Command& command)
+    {
+        const int64_t* a = command.ints;
+        const float* f = command.floats;
+        switch (command.opcode)
+        {
+            case OP_ACTIVE_TEXTURE:
+                glActiveTexture(static_cast<GLenum>(a[0]));
+                break;
+            case OP_ATTACH_SHADER:
+                glAttachShader(getName(mPrograms, a[0]), getName(mPrograms, a[1]));
+                break;
+            case OP_BIND_BUFFER:
+                glBindBuffer(static_cast<GLenum>(a[0]), getName(mBuffers, a[1]));
+                break;
+            case OP_BIND_BUFFER_RANGE:
+                glBindBufferRange(static_cast<GLenum>(a[0]), static_cast<GLuint>(a[1]), getName(mBuffers, a[2]),
+                                  static_cast<GLintptr>(a[3]), static_cast<GLsizeiptr>(a[4]));
+                break;
+            case OP_BIND_FRAMEBUFFER:
+                glBindFramebuffer(static_cast<GLenum>(a[0]), getFramebuffer(a[1]));
+                break;
+            case OP_BIND_TEXTURE:
+                glBindTexture(static_cast<GLenum>(a[0]), getName(mTextures, a[1]));
+                break;
+            case OP_BIND_VERTEX_ARRAY:
+                glBindVertexArray(getName(mVertexArrays, a[0]));
+                break;
+            case OP_BIND_VERTEX_BUFFER:
+                glBindVertexBuffer(static_cast<GLuint>(a[0]), getName(mBuffers, a[1]), static_cast<GLintptr>(a[2]),
+                                   static_cast<GLsizei>(a[3]));
+                break;
+            case OP_BLEND_FUNC:
+                glBlendFunc(static_cast<GLenum>(a[0]), static_cast<GLenum>(a[1]));
+                break;
+            case OP_BLEND_FUNC_SEPARATE:
+                glBlendFuncSeparate(static_cast<GLenum>(a[0]), static_cast<GLenum>(a[1]), static_cast<GLenum>(a[2]),
+                                    static_cast<GLenum>(a[3]));
+                break;
+            case OP_BLIT_FRAMEBUFFER:
+                glBlitFramebuffer(static_cast<GLint>(a[0]), static_cast<GLint>(a[1]), static_cast<GLint>(a[2]),
+                                  static_cast<GLint>(a[3]), static_cast<GLint>(a[4]), static_cast<GLint>(a[5]),
+                                  static_cast<GLint>(a[6]), static_cast<GLint>(a[7]), static_cast<GLbitfield>(a[8]),
+                                  static_cast<GLenum>(a[9]));
+                break;
+            case OP_BUFFER_DATA:
+                glBufferData(static_cast<GLenum>(a[0]), static_cast<GLsizeiptr>(a[1]), command.data,
+                             static_cast<GLenum>(a[2]));
+                break;
+            case OP_BUFFER_SUB_DATA:
+                glBufferSubData(static_cast<GLenum>(a[0]), static_cast<GLintptr>(a[1]), static_cast<GLsizeiptr>(a[2]),
+                                command.data);
+                break;
+            case OP_CLEAR:
+                glClear(static_cast<GLbitfield>(a[0]));
+                break;
+            case OP_CLEAR_BUFFERFV:
+                glClearBufferfv(static_cast<GLenum>(a[0]), static_cast<GLint>(a[1]), f);
+                break;
+            case OP_CLEAR_COLOR:
+                glClearColor(f[0], f[1], f[2], f[3]);
+                break;
+            case OP_CLIENT_WAIT_SYNC:
+            {
+                auto syncIt = mSyncs.find(a[0]);
+                if (syncIt != mSyncs.end())
+                {
+                    glClientWaitSync(syncIt->second, static_cast<GLbitfield>(a[1]), static_cast<GLuint64>(a[2]));
+                }
+                break;
+            }
+            case OP_COMPILE_SHADER:
+                glCompileShader(getName(mPrograms, a[0]));
+                break;
+            case OP_COMPRESSED_TEX_SUB_IMAGE_3D:
+                glCompressedTexSubImage3D(static_cast<GLenum>(a[0]), static_cast<GLint>(a[1]), static_cast<GLint>(a[2]),
+                                          static_cast<GLint>(a[3]), static_cast<GLint>(a[4]),
+                                          static_cast<GLsizei>(a[5]), static_cast<GLsizei>(a[6]),
+                                          static_cast<GLsizei>(a[7]), static_cast<GLenum>(a[8]),
+                                          static_cast<GLsizei>(command.size), command.data);
+                break;
+            case OP_CREATE_PROGRAM:
+                mPrograms[a[0]] = glCreateProgram();
+                break;
+            case OP_CREATE_SHADER:
+                mPrograms[a[1]] = glCreateShader(static_cast<GLenum>(a[0]));
+                break;
+            case OP_CULL_FACE:
+                glCullFace(static_cast<GLenum>(a[0]));
+                break;
+            case OP_DELETE_BUFFER:
+            {
+                GLuint buffer = getName(mBuffers, a[0]);
+                glDeleteBuffers(1, &buffer);
+                mBuffers.erase(a[0]);
+                break;
+            }
+            case OP_DELETE_FRAMEBUFFER:
+            {
+                auto framebufferIt = mFramebuffers.find(a[0]);
+                if (framebufferIt != mFramebuffers.end())
+                {
+                    glDeleteFramebuffers(1, &framebufferIt->second);
+                    mFramebuffers.erase(framebufferIt);
+                }
+                break;
+            }
+            case OP_DELETE_PROGRAM:
+                glDeleteProgram(getName(mPrograms, a[0]));
+                mPrograms.erase(a[0]);
+                break;
+            case OP_DELETE_SHADER:
+                glDeleteShader(getName(mPrograms, a[0]));
+                mPrograms.erase(a[0]);
+                break;
+            case OP_DELETE_SYNC:
+            {
+                auto syncIt = mSyncs.find(a[0]);
+                if (syncIt != mSyncs.end())
+                {
+                    glDeleteSync(syncIt->second);
+                    mSyncs.erase(syncIt);
+                }
+                break;
+            }
+            case OP_DELETE_TEXTURE:
+            {
+                GLuint texture = getName(mTextures, a[0]);
+                glDeleteTextures(1, &texture);
+                mTextures.erase(a[0]);
+                break;
+            }
+            case OP_DELETE_VERTEX_ARRAY:
+            {
+                GLuint array = getName(mVertexArrays, a[0]);
+                glDeleteVertexArrays(1, &array);
+                mVertexArrays.erase(a[0]);
+                break;
+            }
+            case OP_DISABLE:
+                glDisable(static_cast<GLenum>(a[0]));
+                break;
+            case OP_DRAW_ARRAYS:
+                glDrawArrays(static_cast<GLenum>(a[0]), static_cast<GLint>(a[1]), static_cast<GLsizei>(a[2]));
+                break;
+            case OP_DRAW_ARRAYS_INSTANCED:
+                glDrawArraysInstanced(static_cast<GLenum>(a[0]), static_cast<GLint>(a[1]), static_cast<GLsizei>(a[2]),
+                                      static_cast<GLsizei>(a[3]));
+                break;
+            case OP_DRAW_ELEMENTS:
+                glDrawElements(static_cast<GLenum>(a[0]), static_cast<GLsizei>(a[1]), static_cast<GLenum>(a[2]),
+                               getPointer(a[3]));
+                break;
+            case OP_DRAW_ELEMENTS_INSTANCED:
+                glDrawElementsInstanced(static_cast<GLenum>(a[0]), static_cast<GLsizei>(a[1]),
+                                        static_cast<GLenum>(a[2]), getPointer(a[3]), static_cast<GLsizei>(a[4]));
+                break;
+            case OP_ENABLE:
+                glEnable(static_cast<GLenum>(a[0]));
+                break;
+            case OP_ENABLE_VERTEX_ATTRIB_ARRAY:
+                glEnableVertexAttribArray(static_cast<GLuint>(a[0]));
+                break;
+            case OP_FENCE_SYNC:
+                mSyncs[a[2]] = glFenceSync(static_cast<GLenum>(a[0]), static_cast<GLbitfield>(a[1]));
+                break;
+            case OP_FLUSH_MAPPED_BUFFER_RANGE:
+            {
+                auto mappingIt = mMappings.find(static_cast<GLenum>(a[0]));
+                if (mappingIt != mMappings.end() && command.data != nullptr)
+                {
+                    std::memcpy(mappingIt->second + a[1], command.data, command.size);
+                }
+                glFlushMappedBufferRange(static_cast<GLenum>(a[0]), static_cast<GLintptr>(a[1]),
+                                         static_cast<GLsizeiptr>(a[2]));
+                break;
+            }
+            case OP_FRAMEBUFFER_TEXTURE_2D:
+                glFramebufferTexture2D(static_cast<GLenum>(a[0]), static_cast<GLenum>(a[1]),
+                                       static_cast<GLenum>(a[2]), getName(mTextures, a[3]),
+                                       static_cast<GLint>(a[4]));
+                break;
+            case OP_FRAMEBUFFER_TEXTURE_LAYER:
+                glFramebufferTextureLayer(static_cast<GLenum>(a[0]), static_cast<GLenum>(a[1]),
+                                          getName(mTextures, a[2]), static_cast<GLint>(a[3]),
+                                          static_cast<GLint>(a[4]));
+                break;
+            case OP_FRAMEBUFFER_TEXTURE_MULTIVIEW:
+                if (mFramebufferTextureMultiview != nullptr)
+                {
+                    mFramebufferTextureMultiview(static_cast<GLenum>(a[0]), static_cast<GLenum>(a[1]),
+                                                 getName(mTextures, a[2]), static_cast<GLint>(a[3]),
+                                                 static_cast<GLint>(a[4]), static_cast<GLsizei>(a[5]));
+                }
+                break;
+            case OP_FRONT_FACE:
+                glFrontFace(static_cast<GLenum>(a[0]));
+                break;
+            case OP_GEN_BUFFER:
+                glGenBuffers(1, &mBuffers[a[0]]);
+                break;
+            case OP_GEN_FRAMEBUFFER:
+                glGenFramebuffers(1, &mFramebuffers[a[0]]);
+                break;
+            case OP_GEN_TEXTURE:
+                glGenTextures(1, &mTextures[a[0]]);
+                break;
+            case OP_GEN_VERTEX_ARRAY:
+                glGenVertexArrays(1, &mVertexArrays[a[0]]);
+                break;
+            case OP_LINE_WIDTH:
+                glLineWidth(f[0]);
+                break;
+            case OP_LINK_PROGRAM:
+                glLinkProgram(getName(mPrograms, a[0]));
+                break;
+            case OP_MAP_BUFFER_RANGE:
+            {
+                void* pointer = glMapBufferRange(static_cast<GLenum>(a[0]), static_cast<GLintptr>(a[1]),
+                                                 static_cast<GLsizeiptr>(a[2]), static_cast<GLbitfield>(a[3]));
+                mMappings[static_cast<GLenum>(a[0])] = static_cast<uint8_t*>(pointer);
+                break;
+            }
+            case OP_PIXEL_STOREI:
+                glPixelStorei(static_cast<GLenum>(a[0]), static_cast<GLint>(a[1]));
+                break;
+            case OP_PROGRAM_PARAMETERI:
+                glProgramParameteri(getName(mPrograms, a[0]), static_cast<GLenum>(a[1]), static_cast<GLint>(a[2]));
+                break;
+            case OP_SCISSOR:
+                glScissor(static_cast<GLint>(a[0]), static_cast<GLint>(a[1]), static_cast<GLsizei>(a[2]),
+                          static_cast<GLsizei>(a[3]));
+                break;
+            case OP_SHADER_SOURCE:
+            {
+                auto source = reinterpret_cast<const GLchar*>(command.data);
+                GLint length = static_cast<GLint>(command.size);
+                glShaderSource(getName(mPrograms, a[0]), 1, &source, &length);
+                break;
+            }
+            case OP_TEX_IMAGE_2D:
+                glTexImage2D(static_cast<GLenum>(a[0]), static_cast<GLint>(a[1]), static_cast<GLint>(a[2]),
+                             static_cast<GLsizei>(a[3]), static_cast<GLsizei>(a[4]), static_cast<GLint>(a[5]),
+                             static_cast<GLenum>(a[6]), static_cast<GLenum>(a[7]), command.data);
+                break;
+            case OP_TEX_PARAMETERI:
+                glTexParameteri(static_cast<GLenum>(a[0]), static_cast<GLenum>(a[1]), static_cast<GLint>(a[2]));
+                break;
+            case OP_TEX_STORAGE_2D:
+                glTexStorage2D(static_cast<GLenum>(a[0]), static_cast<GLsizei>(a[1]), static_cast<GLenum>(a[2]),
+                               static_cast<GLsizei>(a[3]), static_cast<GLsizei>(a[4]));
+                break;
+            case OP_TEX_STORAGE_3D:
+                glTexStorage3D(static_cast<GLenum>(a[0]), static_cast<GLsizei>(a[1]), static_cast<GLenum>(a[2]),
+                               static_cast<GLsizei>(a[3]), static_cast<GLsizei>(a[4]), static_cast<GLsizei>(a[5]));
+                break;
+            case OP_TEX_SUB_IMAGE_3D:
+                glTexSubImage3D(static_cast<GLenum>(a[0]), static_cast<GLint>(a[1]), static_cast<GLint>(a[2]),
+                                static_cast<GLint>(a[3]), static_cast<GLint>(a[4]), static_cast<GLsizei>(a[5]),
+                                static_cast<GLsizei>(a[6]), static_cast<GLsizei>(a[7]), static_cast<GLenum>(a[8]),
+                                static_cast<GLenum>(a[9]), command.data);
+                break;
+            case OP_UNIFORM_1I:
+                glUniform1i(static_cast<GLint>(a[0]), static_cast<GLint>(a[1]));
+                break;
+            case OP_UNIFORM_4F:
+                glUniform4f(static_cast<GLint>(a[0]), f[0], f[1], f[2], f[3]);
+                break;
+            case OP_UNMAP_BUFFER:
+            {
+                auto mappingIt = mMappings.find(static_cast<GLenum>(a[0]));
+                if (mappingIt != mMappings.end())
+                {
+                    if (mappingIt->second != nullptr && command.data != nullptr)
+                    {
+                        std::memcpy(mappingIt->second, command.data, command.size);
+                    }
+                    mMappings.erase(mappingIt);
+                }
+                glUnmapBuffer(static_cast<GLenum>(a[0]));
+                break;
+            }
+            case OP_USE_PROGRAM:
+                glUseProgram(getName(mPrograms, a[0]));
+                break;
+            case OP_VERTEX_ATTRIB_BINDING:
+                glVertexAttribBinding(static_cast<GLuint>(a[0]), static_cast<GLuint>(a[1]));
+                break;
+            case OP_VERTEX_ATTRIB_FORMAT:
+                glVertexAttribFormat(static_cast<GLuint>(a[0]), static_cast<GLint>(a[1]), static_cast<GLenum>(a[2]),
+                                     static_cast<GLboolean>(a[3]), static_cast<GLuint>(a[4]));
+                break;
+            case OP_VERTEX_ATTRIB_POINTER:
+                glVertexAttribPointer(static_cast<GLuint>(a[0]), static_cast<GLint>(a[1]), static_cast<GLenum>(a[2]),
+                                      static_cast<GLboolean>(a[3]), static_cast<GLsizei>(a[4]), getPointer(a[5]));
+                break;
+            case OP_VERTEX_BINDING_DIVISOR:
+                glVertexBindingDivisor(static_cast<GLuint>(a[0]), static_cast<GLuint>(a[1]));
+                break;
+            case OP_VIEWPORT:
+                glViewport(static_cast<GLint>(a[0]), static_cast<GLint>(a[1]), static_cast<GLsizei>(a[2]),
+                           static_cast<GLsizei>(a[3]));
+                break;
+            default:
+                break;
+        }
+    }
+
+
+    /// Per frame, the median time over the replays and the counts of the first
+    std::vector<FrameResult> combineReplays(const std::vector<ReplayResult>& replays)
+    {
+        std::vector<FrameResult> frames = replays.front().frames;
+        for (size_t i = 0; i < frames.size(); ++i)
+        {
+            std::vector<double> times;
+            for (const ReplayResult& replay : replays)
+            {
+                times.push_back(replay.frames[i].cpuMs);
+            }
+            std::sort(times.begin(), times.end());
+            frames[i].cpuMs = times[times.size() / 2];
+        }
+        return frames;
+    }
+
+    Summary summarize(const std::vector<FrameResult>& frames)
+    {
+        Summary summary;
+        if (frames.empty())
+        {
+            return summary;
+        }
+        std::vector<double> times;
+        for (const FrameResult& frame : frames)
+        {
+            times.push_back(frame.cpuMs);
+            summary.meanMs += frame.cpuMs;
+            summary.numCalls += frame.numCalls;
+            summary.numDrawCalls += frame.numDrawCalls;
+            summary.uploadedBytes += static_cast<double>(frame.uploadedBytes);
+        }
+        std::sort(times.begin(), times.end());
+        double numFrames = static_cast<double>(frames.size());
+        summary.medianMs = times[times.size() / 2];
+        summary.p95Ms = times[std::min(times.size() - 1, times.size() * 95 / 100)];
+        summary.meanMs /= numFrames;
+        summary.numCalls /= numFrames;
+        summary.numDrawCalls /= numFrames;
+        summary.uploadedBytes /= numFrames;
+        return summary;
+    }
+
+    void printRow(const char* name, double value, const double* baseline, const char* format)
+    {
+        std::printf("  %-22s", name);
+        if (baseline != nullptr)
+        {
+            std::printf(format, *baseline);
+            std::printf("  ->");
+        }
+        std::printf(format, value);
+        if (baseline != nullptr && *baseline != 0.0)
+        {
+            std::printf("  %+.1f%%", (value - *baseline) / *baseline * 100.0);
+        }
+        std::printf("\n");
+    }
+
+    void printSummary(const Summary& summary, const Summary* baseline)
+    {
+        printRow("CPU ms, median", summary.medianMs, baseline ? &baseline->medianMs : nullptr, " %10.3f");
+        printRow("CPU ms, mean", summary.meanMs, baseline ? &baseline->meanMs : nullptr, " %10.3f");
+        printRow("CPU ms, 95th percentile", summary.p95Ms, baseline ? &baseline->p95Ms : nullptr, " %10.3f");
+        printRow("GL calls", summary.numCalls, baseline ? &baseline->numCalls : nullptr, " %10.1f");
+        printRow("Draw calls", summary.numDrawCalls, baseline ? &baseline->numDrawCalls : nullptr, " %10.1f");
+        printRow("Bytes uploaded", summary.uploadedBytes, baseline ? &baseline->uploadedBytes : nullptr, " %10.0f");
+    }
+
+    bool writeCsv(const std::string& path, const std::vector<FrameResult>& frames)
+    {
+        FILE* file = std::fopen(path.c_str(), "w");
+        if (file == nullptr)
+        {
+            return false;
+        }
+        std::fprintf(file, "frame,cpu_ms,gl_calls,draw_calls,uploaded_bytes\n");
+        for (size_t i = 0; i < frames.size(); ++i)
+        {
+            std::fprintf(file, "%zu,%.4f,%u,%u,%zu\n", i, frames[i].cpuMs, frames[i].numCalls,
+                         frames[i].numDrawCalls, frames[i].uploadedBytes);
+        }
+        std::fclose(file);
+        return true;
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    int iterations = DEFAULT_ITERATIONS;
+    std::string csvPath;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+        {
+            iterations = std::max(std::atoi(argv[++i]), 1);
+        }
+        else if (std::strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+        {
+            csvPath = argv[++i];
+        }
+        else
+        {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.empty() || paths.size() > 2)
+    {
+        std::fprintf(stderr, "Usage: GLCommandReplayer [--iterations <n>] [--csv <frames.csv>] "
+                             "<recording.vgl> [<baseline.vgl>]\n");
+        return 1;
+    }
+
+    // The recording to measure first, then the one to compare it with
+    std::vector<Recording> recordings(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        if (!loadRecording(paths[i], recordings[i]))
+        {
+            return 1;
+        }
+        if (recordings[i].numFrames == 0)
+        {
+            std::fprintf(stderr, "%s has no complete frames\n", paths[i].c_str());
+            return 1;
+        }
+    }
+
+    EGLDisplay display = getDisplay();
+    if (display == EGL_NO_DISPLAY)
+    {
+        std::fprintf(stderr, "Failed to initialize EGL without a window\n");
+        return 1;
+    }
+    Replayer replayer(display);
+    {
+        // Report the driver of the first context
+        const EGLint contextAttributes[] = { EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 1, EGL_NONE };
+        EGLContext context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttributes);
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+        std::printf("GL: %s, %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(display, context);
+    }
+
+    // Alternate between the recordings so that both see the same machine load, swapping which goes
+    // first each iteration as the second replay in a row runs measurably faster
+    std::vector<std::vector<ReplayResult>> replays(recordings.size());
+    for (int iteration = 0; iteration < iterations; ++iteration)
+    {
+        for (size_t order = 0; order < recordings.size(); ++order)
+        {
+            size_t i = iteration % 2 == 0 ? order : recordings.size() - 1 - order;
+            ReplayResult result;
+            if (!replayer.replay(recordings[i], result))
+            {
+                return 1;
+            }
+            replays[i].push_back(std::move(result));
+        }
+    }
+
+    std::vector<std::vector<FrameResult>> frames;
+    for (size_t i = 0; i < recordings.size(); ++i)
+    {
+        frames.push_back(combineReplays(replays[i]));
+        std::printf("%s: %zu commands, %zu frames at %dx%d, image hash %016llx\n", paths[i].c_str(),
+                    recordings[i].commands.size(), recordings[i].numFrames, recordings[i].width,
+                    recordings[i].height, static_cast<unsigned long long>(replays[i].front().imageHash));
+        for (const ReplayResult& replay : replays[i])
+        {
+            if (replay.imageHash != replays[i].front().imageHash)
+            {
+                std::printf("  Warning: the image differs between replays, the recording isn't deterministic\n");
+                break;
+            }
+        }
+    }
+
+    std::printf("Per frame, median of %d replays:\n", iterations);
+    if (recordings.size() == 1)
+    {
+        printSummary(summarize(frames[0]), nullptr);
+    }
+    else
+    {
+        // Only the frames both recordings have are compared
+        size_t numFrames = std::min(frames[0].size(), frames[1].size());
+        frames[0].resize(numFrames);
+        frames[1].resize(numFrames);
+        Summary baseline = summarize(frames[1]);
+        std::printf("  %-22s %10s  -> %10s\n", "", "baseline", "recording");
+        printSummary(summarize(frames[0]), &baseline);
+
+        size_t numFramesChanged = 0;
+        for (size_t i = 0; i < numFrames; ++i)
+        {
+            if (frames[0][i].numCalls != frames[1][i].numCalls ||
+                frames[0][i].numDrawCalls != frames[1][i].numDrawCalls)
+            {
+                ++numFramesChanged;
+            }
+        }
+        std::printf("  %zu of %zu frames make a different number of calls, the final images %s\n",
+                    numFramesChanged, numFrames,
+                    replays[0].front().imageHash == replays[1].front().imageHash ? "match" : "differ");
+    }
+
+    if (!csvPath.empty() && !writeCsv(csvPath, frames[0]))
+    {
+        std::fprintf(stderr, "Failed to write %s\n", csvPath.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,216 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+// Desktop check of the Android renderer's GLESGpuTimer, on a GLES 3.1
+// context without a window, such as Mesa's software renderer gives.
+// Times scopes drawing a known amount of fragment work each frame without
+// ever waiting for the GPU, then reports how many frames the results took
+// to come back and whether the GPU times scale with the work. See README.md.
+
+#include <GLESGpuTimer.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+
+namespace
+{
+    constexpr int DEFAULT_FRAMES = 120;
+    constexpr GLsizei TARGET_SIZE = 512;
+    /// Draws in the light and heavy scopes, the heavy one should take about this much longer
+    constexpr int LIGHT_DRAWS = 1;
+    constexpr int HEAVY_DRAWS = 4;
+
+    const char* VERTEX_SHADER = R"(#version 310 es
+void main()
+{
+    // One triangle covering the target
+    vec2 position = vec2(float((gl_VertexID & 1) << 2) - 1.0, float((gl_VertexID & 2) << 1) - 1.0);
+    gl_Position = vec4(position, 0.0, 1.0);
+}
+)";
+
+    // Enough arithmetic per fragment that the draw, not the setup, dominates
+    const char* FRAGMENT_SHADER = R"(#version 310 es
+precision highp float;
+layout(location = 0) out vec4 fragColor;
+void main()
+{
+    vec2 value = gl_FragCoord.xy * 0.001;
+    for (int i = 0; i < 16; ++i)
+    {
+        value = fract(vec2(sin(value.x * 12.9898 + value.y), cos(value.y * 78.233 - value.x)) * 43758.5453);
+    }
+    fragColor = vec4(value, 0.0, 1.0);
+}
+)";
+
+    bool createContext()
+    {
+        auto getPlatformDisplay =
+            reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (getPlatformDisplay == nullptr)
+        {
+            return false;
+        }
+        EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr) || !eglBindAPI(EGL_OPENGL_ES_API))
+        {
+            return false;
+        }
+        const EGLint contextAttributes[] = { EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 1, EGL_NONE };
+        EGLContext context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttributes);
+        return context != EGL_NO_CONTEXT && eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+    }
+
+    GLuint createShader(GLenum type, const char* source)
+    {
+        GLuint shader = glCreateShader(type);
+        glShaderSource(shader, 1, &source, nullptr);
+        glCompileShader(shader);
+        GLint compiled = GL_FALSE;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+        if (!compiled)
+        {
+            char log[1024];
+            glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+            std::fprintf(stderr, "Shader compile failed: %s\n", log);
+        }
+        return shader;
+    }
+
+    void draw(int numDraws)
+    {
+        for (int i = 0; i < numDraws; ++i)
+        {
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+    }
+
+    const GLESGpuTimer::ScopeTiming* findScope(const std::vector<GLESGpuTimer::ScopeTiming>& timings,
+                                               const char* name)
+    {
+        for (const GLESGpuTimer::ScopeTiming& timing : timings)
+        {
+            if (std::strcmp(timing.name, name) == 0)
+            {
+                return &timing;
+            }
+        }
+        return nullptr;
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    int numFrames = DEFAULT_FRAMES;
+    if (argc > 2 && std::strcmp(argv[1], "--frames") == 0)
+    {
+        numFrames = std::max(std::atoi(argv[2]), 1);
+    }
+
+    if (!createContext())
+    {
+        std::fprintf(stderr, "Failed to create a GLES 3.1 context without a surface\n");
+        return 1;
+    }
+    std::printf("GL: %s, %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+
+    // Render to a renderbuffer, as there is no window
+    GLuint colorBuffer = 0;
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, TARGET_SIZE, TARGET_SIZE);
+    GLuint framebuffer = 0;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glViewport(0, 0, TARGET_SIZE, TARGET_SIZE);
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, createShader(GL_VERTEX_SHADER, VERTEX_SHADER));
+    glAttachShader(program, createShader(GL_FRAGMENT_SHADER, FRAGMENT_SHADER));
+    glLinkProgram(program);
+    glUseProgram(program);
+    GLuint vertexArray = 0;
+    glGenVertexArrays(1, &vertexArray);
+    glBindVertexArray(vertexArray);
+
+    GLESGpuTimer timer;
+    if (!timer.init())
+    {
+        std::printf("No GL_EXT_disjoint_timer_query, checking CPU times only\n");
+    }
+
+    // Frames are only flushed, never finished, so the timer must not wait on the GPU either
+    int firstResultFrame = -1;
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < numFrames; ++frame)
+    {
+        timer.beginFrame();
+        if (firstResultFrame < 0 && !timer.getLastResults().empty())
+        {
+            firstResultFrame = frame;
+            // Averages from here on only, so every frame averaged had all its scopes
+            timer.resetAverages();
+        }
+
+        timer.beginScope("Clear");
+        glClear(GL_COLOR_BUFFER_BIT);
+        timer.beginScope("Light");
+        draw(LIGHT_DRAWS);
+        timer.beginScope("Heavy");
+        draw(HEAVY_DRAWS);
+        timer.endScope();
+        timer.endFrame();
+        glFlush();
+    }
+    double frameMs =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / numFrames;
+
+    std::vector<GLESGpuTimer::ScopeTiming> averages;
+    timer.getAverages(averages);
+    timer.deinit();
+
+    if (firstResultFrame < 0)
+    {
+        std::fprintf(stderr, "No results came back in %d frames\n", numFrames);
+        return 1;
+    }
+    std::printf("%d frames of %.2f ms, the first results came back at frame %d\n", numFrames, frameMs,
+                firstResultFrame);
+    for (const GLESGpuTimer::ScopeTiming& average : averages)
+    {
+        std::printf("  %s: %.3f ms GPU, %.3f ms CPU\n", average.name, average.gpuMs, average.cpuMs);
+    }
+
+    const GLESGpuTimer::ScopeTiming* light = findScope(averages, "Light");
+    const GLESGpuTimer::ScopeTiming* heavy = findScope(averages, "Heavy");
+    if (light == nullptr || heavy == nullptr)
+    {
+        std::fprintf(stderr, "Scopes missing from the results\n");
+        return 1;
+    }
+    if (light->gpuMs > 0.0)
+    {
+        std::printf("Heavy takes %.2f times the GPU time of Light, %d times the draws\n",
+                    heavy->gpuMs / light->gpuMs, HEAVY_DRAWS / LIGHT_DRAWS);
+    }
+    else if (light->gpuMs == 0.0)
+    {
+        // Software renderers may defer the rasterization past the end of the query
+        std::printf("The GPU times are zero, this renderer doesn't measure the draws with its queries\n");
+    }
+    return 0;
+}
@@ -0,0 +1,179 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+// Desktop benchmark of PngDecoder on the sample's textures.
+// Times each image decoded alone, then all of them decoded at once on one
+// thread each as the app's init does. Built with libpng it also checks the
+// pixels against libpng's and times it for comparison. See README.md.
+
+#include <PngDecoder.h>
+
+#ifdef HAVE_LIBPNG
+#include <png.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+    constexpr int DEFAULT_ITERATIONS = 10;
+
+    struct File
+    {
+        std::string path;
+        std::vector<unsigned char> data;
+    };
+
+    bool readFile(const std::string& path, std::vector<unsigned char>& data)
+    {
+        FILE* file = std::fopen(path.c_str(), "rb");
+        if (file == nullptr)
+        {
+            return false;
+        }
+        std::fseek(file, 0, SEEK_END);
+        data.resize(static_cast<size_t>(std::ftell(file)));
+        std::fseek(file, 0, SEEK_SET);
+        bool succeeded = std::fread(data.data(), 1, data.size(), file) == data.size();
+        std::fclose(file);
+        return succeeded;
+    }
+
+    double getMilliseconds(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /// Median of the times of running function iterations times
+    template<typename Function>
+    double timeMedian(int iterations, Function function)
+    {
+        std::vector<double> times;
+        for (int i = 0; i < iterations; ++i)
+        {
+            auto start = std::chrono::steady_clock::now();
+            function();
+            times.push_back(getMilliseconds(start));
+        }
+        std::sort(times.begin(), times.end());
+        return times[times.size() / 2];
+    }
+
+#ifdef HAVE_LIBPNG
+    /// Decode with libpng to the same bottom-up RGBA layout as PngDecoder
+    bool decodeWithLibpng(const std::vector<unsigned char>& data, PngDecoder::Image& image)
+    {
+        png_image png;
+        std::memset(&png, 0, sizeof(png));
+        png.version = PNG_IMAGE_VERSION;
+        if (!png_image_begin_read_from_memory(&png, data.data(), data.size()))
+        {
+            return false;
+        }
+        png.format = PNG_FORMAT_RGBA;
+        image.width = static_cast<int>(png.width);
+        image.height = static_cast<int>(png.height);
+        image.pixels.resize(PNG_IMAGE_SIZE(png));
+        // A negative stride writes the last row first
+        return png_image_finish_read(&png, nullptr, image.pixels.data(),
+                                     -static_cast<png_int_32>(PNG_IMAGE_ROW_STRIDE(png)), nullptr) != 0;
+    }
+#endif
+}
+
+
+int main(int argc, char** argv)
+{
+    int iterations = DEFAULT_ITERATIONS;
+    std::vector<File> files;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+        {
+            iterations = std::max(std::atoi(argv[++i]), 1);
+        }
+        else
+        {
+            File file;
+            file.path = argv[i];
+            if (!readFile(file.path, file.data))
+            {
+                std::fprintf(stderr, "Failed to read %s\n", file.path.c_str());
+                return 1;
+            }
+            files.push_back(std::move(file));
+        }
+    }
+    if (files.empty())
+    {
+        std::fprintf(stderr, "Usage: ImageDecodeBenchmark [--iterations <n>] <image.png>...\n");
+        return 1;
+    }
+
+    std::printf("Median of %d runs\n", iterations);
+    double totalMs = 0.0;
+    for (const File& file : files)
+    {
+        PngDecoder::Image image;
+        if (!PngDecoder::decode(file.data.data(), file.data.size(), image))
+        {
+            std::fprintf(stderr, "Failed to decode %s\n", file.path.c_str());
+            return 1;
+        }
+        double ms = timeMedian(iterations, [&file, &image]() {
+            PngDecoder::decode(file.data.data(), file.data.size(), image);
+        });
+        totalMs += ms;
+        std::printf("%s: %dx%d, %.1f ms", file.path.c_str(), image.width, image.height, ms);
+
+#ifdef HAVE_LIBPNG
+        PngDecoder::Image reference;
+        if (decodeWithLibpng(file.data, reference))
+        {
+            double referenceMs = timeMedian(iterations, [&file, &reference]() {
+                decodeWithLibpng(file.data, reference);
+            });
+            bool identical = reference.width == image.width && reference.height == image.height &&
+                             reference.pixels == image.pixels;
+            std::printf(", libpng %.1f ms, %s", referenceMs, identical ? "identical" : "PIXELS DIFFER");
+            if (!identical)
+            {
+                std::printf("\n");
+                return 1;
+            }
+        }
+#endif
+        std::printf("\n");
+    }
+
+    // All images at once, one thread each, as the renderer's preload tasks decode them
+    double parallelMs = timeMedian(iterations, [&files]() {
+        std::vector<std::thread> threads;
+        for (const File& file : files)
+        {
+            threads.emplace_back([&file]() {
+                PngDecoder::Image image;
+                PngDecoder::decode(file.data.data(), file.data.size(), image);
+            });
+        }
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    });
+    std::printf("All %zu images: %.1f ms one after another, %.1f ms on %zu threads (%u cores)\n",
+                files.size(), totalMs, parallelMs, files.size(), std::thread::hardware_concurrency());
+    return 0;
+}
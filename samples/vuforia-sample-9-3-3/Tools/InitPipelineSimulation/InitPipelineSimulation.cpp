@@ -0,0 +1,300 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+// Desktop simulation of AppController::initAR, which runs engine initialization
+// on an InitPipeline alongside the platform's preload tasks. Drives it against
+// a stub engine through successful, failed and cancelled initializations.
+// initAR returns straight away, deinitAR waits for the initialization to end.
+// Prints the calls each made and checks that initAR didn't block its caller,
+// that the ENGINE stages ran in order,
+// the BACKGROUND stages overlapped them, and that exactly the expected
+// callback was invoked. See README.md.
+
+#include "StubEngine.h"
+
+#include <AppController.h>
+
+#include <Vuforia/Vuforia.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+    /// How long each preload task takes, longer than the engine so it overlaps all of its stages
+    constexpr std::chrono::milliseconds PRELOAD_TIME { 150 };
+    /// Longest an initialization may take before the simulation gives up on it
+    constexpr std::chrono::milliseconds TIMEOUT { 5000 };
+
+    enum Cancellation
+    {
+        CANCEL_NONE,
+        /// cancelInitAR before initAR, as when the activity is destroyed before its init task starts
+        CANCEL_BEFORE,
+        /// cancelInitAR from another thread once Vuforia::init has started
+        CANCEL_DURING_ENGINE_INIT,
+    };
+
+    enum Outcome
+    {
+        OUTCOME_INIT_DONE,
+        OUTCOME_ERROR,
+        OUTCOME_NONE,
+    };
+
+    struct Scenario
+    {
+        const char* name;
+        StubEngine::Behaviour behaviour;
+        /// Name of a preload task that fails, nullptr for none
+        const char* failingPreload;
+        Cancellation cancellation;
+        Outcome outcome;
+        /// Error expected with OUTCOME_ERROR
+        const char* error;
+        /// Engine calls expected to have been made, and not made
+        std::vector<const char*> calls;
+        std::vector<const char*> skippedCalls;
+    };
+
+    /// What the callbacks were given
+    struct Callbacks
+    {
+        std::mutex mutex;
+        int numInitDone = 0;
+        std::vector<std::string> errors;
+        std::vector<int> progress;
+    };
+
+    StubEngine::Behaviour failingInit(int result)
+    {
+        StubEngine::Behaviour behaviour;
+        behaviour.initResult = result;
+        return behaviour;
+    }
+
+    StubEngine::Behaviour failingTrackerInit()
+    {
+        StubEngine::Behaviour behaviour;
+        behaviour.failTrackerInit = true;
+        return behaviour;
+    }
+
+    StubEngine::Behaviour failingDataSetLoad()
+    {
+        StubEngine::Behaviour behaviour;
+        behaviour.failDataSetLoad = true;
+        return behaviour;
+    }
+
+    bool check(bool condition, const char* what)
+    {
+        if (!condition)
+        {
+            std::printf("  FAILED: %s\n", what);
+        }
+        return condition;
+    }
+
+    bool simulate(const Scenario& scenario)
+    {
+        std::printf("%s:\n", scenario.name);
+        StubEngine::reset(scenario.behaviour);
+
+        Callbacks callbacks;
+        AppController::InitConfig initConfig;
+        initConfig.showErrorCallback = [&callbacks](const char* errorString)
+        {
+            std::lock_guard<std::mutex> lock(callbacks.mutex);
+            callbacks.errors.emplace_back(errorString);
+        };
+        initConfig.initDoneCallback = [&callbacks]
+        {
+            std::lock_guard<std::mutex> lock(callbacks.mutex);
+            ++callbacks.numInitDone;
+        };
+        initConfig.initProgressCallback = [&callbacks](int progress, const char*)
+        {
+            std::lock_guard<std::mutex> lock(callbacks.mutex);
+            callbacks.progress.push_back(progress);
+        };
+        for (const char* name : { "Models", "Textures" })
+        {
+            bool fails = scenario.failingPreload != nullptr && std::strcmp(scenario.failingPreload, name) == 0;
+            std::string callName = std::string("Preload ") + name;
+            initConfig.preloadTasks.push_back({ name, [callName, fails]
+            {
+                double startMs = StubEngine::getElapsedMs();
+                std::this_thread::sleep_for(fails ? PRELOAD_TIME / 3 : PRELOAD_TIME);
+                StubEngine::recordCall(callName, startMs, StubEngine::getElapsedMs());
+                return !fails;
+            } });
+        }
+
+        AppController controller;
+        std::thread canceller;
+        if (scenario.cancellation == CANCEL_BEFORE)
+        {
+            controller.cancelInitAR();
+        }
+        else if (scenario.cancellation == CANCEL_DURING_ENGINE_INIT)
+        {
+            canceller = std::thread([&controller]
+            {
+                if (StubEngine::waitForCall("init", TIMEOUT))
+                {
+                    controller.cancelInitAR();
+                }
+            });
+        }
+
+        double initStartMs = StubEngine::getElapsedMs();
+        controller.initAR(initConfig, AppController::IMAGE_TARGET_ID);
+        double returnedMs = StubEngine::getElapsedMs();
+        if (canceller.joinable())
+        {
+            canceller.join();
+        }
+        // Waits for the initialization to finish
+        controller.deinitAR();
+        double initMs = StubEngine::getElapsedMs() - initStartMs;
+
+        std::lock_guard<std::mutex> lock(callbacks.mutex);
+        std::printf("  initAR returned in %.1f ms, initialization took %.1f ms, "
+                    "%zu progress updates, %d initDone, %zu errors\n", returnedMs - initStartMs, initMs,
+                    callbacks.progress.size(), callbacks.numInitDone, callbacks.errors.size());
+        for (const std::string& error : callbacks.errors)
+        {
+            std::printf("  error: %s\n", error.c_str());
+        }
+        for (const char* call : { "init", "TrackerManager::initTracker", "DataSet::load",
+                                  "Preload Models", "Preload Textures" })
+        {
+            double startMs = 0.0;
+            double endMs = 0.0;
+            if (StubEngine::getCallTime(call, startMs, endMs))
+            {
+                std::printf("  %-28s x%-2d %6.1f ms -> %6.1f ms\n",
+                            call, StubEngine::getNumCalls(call), startMs, endMs);
+            }
+        }
+
+        bool passed = true;
+        switch (scenario.outcome)
+        {
+            case OUTCOME_INIT_DONE:
+                passed &= check(callbacks.numInitDone == 1 && callbacks.errors.empty(), "initDone called alone once");
+                passed &= check(!callbacks.progress.empty() && callbacks.progress.back() == 100,
+                                "progress reaches 100");
+                break;
+            case OUTCOME_ERROR:
+                passed &= check(callbacks.numInitDone == 0 && callbacks.errors.size() == 1 &&
+                                callbacks.errors[0] == scenario.error, "the expected error reported alone once");
+                break;
+            case OUTCOME_NONE:
+                passed &= check(callbacks.numInitDone == 0 && callbacks.errors.empty(),
+                                "no callback for a cancellation");
+                break;
+        }
+        passed &= check(std::is_sorted(callbacks.progress.begin(), callbacks.progress.end()) &&
+                        std::adjacent_find(callbacks.progress.begin(), callbacks.progress.end()) ==
+                        callbacks.progress.end(), "progress only moves forward");
+
+        for (const char* call : scenario.calls)
+        {
+            std::string what = std::string(call) + " called";
+            passed &= check(StubEngine::getNumCalls(call) > 0, what.c_str());
+        }
+        for (const char* call : scenario.skippedCalls)
+        {
+            std::string what = std::string(call) + " not called";
+            passed &= check(StubEngine::getNumCalls(call) == 0, what.c_str());
+        }
+
+        // ENGINE stages one after another, the BACKGROUND lane alongside them
+        double initStartCallMs = 0.0;
+        double initEndMs = 0.0;
+        double trackersStartMs = 0.0;
+        double trackersEndMs = 0.0;
+        double loadStartMs = 0.0;
+        double loadEndMs = 0.0;
+        double preloadStartMs = 0.0;
+        double preloadEndMs = 0.0;
+        bool initCalled = StubEngine::getCallTime("init", initStartCallMs, initEndMs);
+        bool trackersCalled = StubEngine::getCallTime("TrackerManager::initTracker", trackersStartMs, trackersEndMs);
+        bool loadCalled = StubEngine::getCallTime("DataSet::load", loadStartMs, loadEndMs);
+        if (initCalled)
+        {
+            passed &= check(returnedMs < initEndMs, "initAR returned before the engine initialized");
+        }
+        if (initCalled && trackersCalled)
+        {
+            passed &= check(trackersStartMs >= initEndMs, "trackers initialized after the engine");
+        }
+        if (trackersCalled && loadCalled)
+        {
+            passed &= check(loadStartMs >= trackersEndMs, "dataset loaded after the trackers");
+        }
+        if (initCalled && StubEngine::getCallTime("Preload Textures", preloadStartMs, preloadEndMs))
+        {
+            passed &= check(preloadStartMs < initEndMs, "preload overlaps engine init");
+        }
+
+        // Cancelling may only wait for the call in progress, and a failure for the stages already running
+        passed &= check(initMs < 2.0 * PRELOAD_TIME.count(), "initialization ended without running skipped stages");
+        passed &= check(StubEngine::getNumCalls("deinit") == 1, "deinitAR deinitialized the engine");
+
+        std::printf("  %s\n", passed ? "ok" : "FAILED");
+        return passed;
+    }
+}
+
+
+int main(int argc, char** /* argv */)
+{
+    if (argc > 1)
+    {
+        std::fprintf(stderr, "Usage: InitPipelineSimulation\n");
+        return 1;
+    }
+
+    const Scenario scenarios[] = {
+        { "Success", {}, nullptr, CANCEL_NONE, OUTCOME_INIT_DONE, nullptr,
+          { "setInitParameters", "init", "TrackerManager::initTracker", "DataSet::load",
+            "Preload Models", "Preload Textures" }, {} },
+        { "Invalid license key", failingInit(Vuforia::INIT_LICENSE_ERROR_INVALID_KEY), nullptr, CANCEL_NONE,
+          OUTCOME_ERROR, "Vuforia failed to initialize because the license key is invalid.",
+          { "init" }, { "TrackerManager::initTracker", "DataSet::load" } },
+        { "Device tracker init failure", failingTrackerInit(), nullptr, CANCEL_NONE,
+          OUTCOME_ERROR, "Error initializing the device tracker",
+          { "init", "TrackerManager::initTracker" }, { "DataSet::load" } },
+        { "Dataset load failure", failingDataSetLoad(), nullptr, CANCEL_NONE,
+          OUTCOME_ERROR, "Error loading dataset for Image Target",
+          { "init", "TrackerManager::initTracker", "DataSet::load" }, {} },
+        { "Preload failure", {}, "Models", CANCEL_NONE,
+          OUTCOME_ERROR, "Error preparing application data: Models",
+          { "init", "Preload Models" }, { "TrackerManager::initTracker", "DataSet::load" } },
+        { "Cancelled before initAR", {}, nullptr, CANCEL_BEFORE, OUTCOME_NONE, nullptr,
+          {}, { "init", "TrackerManager::initTracker", "DataSet::load", "Preload Models", "Preload Textures" } },
+        { "Cancelled during engine init", {}, nullptr, CANCEL_DURING_ENGINE_INIT, OUTCOME_NONE, nullptr,
+          { "init" }, { "TrackerManager::initTracker", "DataSet::load" } },
+    };
+
+    bool passed = true;
+    for (const Scenario& scenario : scenarios)
+    {
+        passed = simulate(scenario) && passed;
+    }
+    return passed ? 0 : 1;
+}
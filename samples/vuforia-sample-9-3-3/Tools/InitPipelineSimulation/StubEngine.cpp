@@ -0,0 +1,634 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "StubEngine.h"
+
+#include <Vuforia/Android/Vuforia_Android.h>
+#include <Vuforia/CameraDevice.h>
+#include <Vuforia/DataSet.h>
+#include <Vuforia/Device.h>
+#include <Vuforia/DeviceTrackableResult.h>
+#include <Vuforia/Frame.h>
+#include <Vuforia/ImageTargetResult.h>
+#include <Vuforia/ModelTarget.h>
+#include <Vuforia/ModelTargetResult.h>
+#include <Vuforia/Obb3D.h>
+#include <Vuforia/ObjectTracker.h>
+#include <Vuforia/PositionalDeviceTracker.h>
+#include <Vuforia/Renderer.h>
+#include <Vuforia/RenderingPrimitives.h>
+#include <Vuforia/StateUpdater.h>
+#include <Vuforia/Tool.h>
+#include <Vuforia/TrackerManager.h>
+#include <Vuforia/Vuforia.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+    /// Type data of the classes AppController asks for, the stub doesn't model their hierarchy
+    constexpr Vuforia::UInt16 OBJECT_TRACKER_TYPE = 1;
+    constexpr Vuforia::UInt16 POSITIONAL_DEVICE_TRACKER_TYPE = 2;
+    constexpr Vuforia::UInt16 MODEL_TARGET_TYPE = 3;
+    constexpr Vuforia::UInt16 DEVICE_TRACKABLE_RESULT_TYPE = 4;
+    constexpr Vuforia::UInt16 IMAGE_TARGET_RESULT_TYPE = 5;
+    constexpr Vuforia::UInt16 MODEL_TARGET_RESULT_TYPE = 6;
+
+    struct Call
+    {
+        std::string name;
+        double startMs;
+        double endMs;
+    };
+
+    std::mutex gMutex;
+    std::condition_variable gCallRecorded;
+    std::vector<Call> gCalls;
+    StubEngine::Behaviour gBehaviour;
+    std::chrono::steady_clock::time_point gStartTime = std::chrono::steady_clock::now();
+    int gInitStep = 0;
+
+    /// Stop the simulation at an engine call AppController only makes once AR is running
+    [[noreturn]] void notSimulated(const char* name)
+    {
+        std::fprintf(stderr, "AppController called %s, which the stub engine doesn't simulate\n", name);
+        std::abort();
+    }
+
+    /// Records a call from construction to destruction
+    class ScopedCall
+    {
+    public:
+        explicit ScopedCall(const char* name) : mName(name), mStartMs(StubEngine::getElapsedMs()) {}
+        ~ScopedCall() { StubEngine::recordCall(mName, mStartMs, StubEngine::getElapsedMs()); }
+
+    private:
+        const char* mName;
+        double mStartMs;
+    };
+
+    template <typename ValueType>
+    class EmptyListProvider : public Vuforia::ListDataProvider<ValueType>
+    {
+    public:
+        ValueType* getItem(int) override { return nullptr; }
+        int size() override { return 0; }
+        Vuforia::ListDataProvider<ValueType>* acquire() override { return this; }
+        void release() override {}
+        Vuforia::ListDataProvider<const ValueType>* constView() override
+        {
+            static EmptyListProvider<const ValueType> constProvider;
+            return &constProvider;
+        }
+    };
+
+    /// List's constructor from a provider is protected
+    template <typename ValueType>
+    class EmptyList : public Vuforia::List<ValueType>
+    {
+    public:
+        EmptyList() : Vuforia::List<ValueType>(&sProvider) {}
+
+    private:
+        static EmptyListProvider<ValueType> sProvider;
+    };
+
+    template <typename ValueType>
+    EmptyListProvider<ValueType> EmptyList<ValueType>::sProvider;
+
+    class StubDataSet : public Vuforia::DataSet
+    {
+    public:
+        bool load(const char* /* path */, Vuforia::STORAGE_TYPE /* storageType */) override
+        {
+            ScopedCall call("DataSet::load");
+            std::this_thread::sleep_for(gBehaviour.dataSetLoadTime);
+            return !gBehaviour.failDataSetLoad;
+        }
+        Vuforia::List<Vuforia::Trackable> getTrackables() override { return EmptyList<Vuforia::Trackable>(); }
+        Vuforia::Trackable* createTrackable(const Vuforia::TrackableSource*) override { return nullptr; }
+        Vuforia::Trackable* createTrackable(const Vuforia::RuntimeImageSource*) override { return nullptr; }
+        Vuforia::MultiTarget* createMultiTarget(const char*) override { return nullptr; }
+        bool destroy(Vuforia::Trackable*) override { return false; }
+        bool hasReachedTrackableLimit() override { return false; }
+        bool isActive() const override { return mActive; }
+
+        bool mActive = false;
+    };
+
+    class StubObjectTracker : public Vuforia::ObjectTracker
+    {
+    public:
+        Vuforia::Type getType() const override { return OBJECT_TRACKER_TYPE; }
+        bool isOfType(Vuforia::Type type) const override { return type.getData() == OBJECT_TRACKER_TYPE; }
+        bool start() override { return true; }
+        void stop() override {}
+        Vuforia::DataSet* createDataSet() override
+        {
+            StubEngine::recordCall("ObjectTracker::createDataSet", StubEngine::getElapsedMs(),
+                                   StubEngine::getElapsedMs());
+            return new StubDataSet();
+        }
+        bool destroyDataSet(Vuforia::DataSet* dataSet) override
+        {
+            StubEngine::recordCall("ObjectTracker::destroyDataSet", StubEngine::getElapsedMs(),
+                                   StubEngine::getElapsedMs());
+            delete dataSet;
+            return true;
+        }
+        bool activateDataSet(Vuforia::DataSet* dataSet) override
+        {
+            static_cast<StubDataSet*>(dataSet)->mActive = true;
+            return true;
+        }
+        bool deactivateDataSet(Vuforia::DataSet* dataSet) override
+        {
+            static_cast<StubDataSet*>(dataSet)->mActive = false;
+            return true;
+        }
+        Vuforia::List<Vuforia::DataSet> getActiveDataSets() override { return EmptyList<Vuforia::DataSet>(); }
+        Vuforia::ImageTargetBuilder* getImageTargetBuilder() override { return nullptr; }
+        Vuforia::RuntimeImageSource* getRuntimeImageSource() override { return nullptr; }
+        Vuforia::TargetFinder* getTargetFinder(TargetFinderType) override { return nullptr; }
+    };
+
+    class StubPositionalDeviceTracker : public Vuforia::PositionalDeviceTracker
+    {
+    public:
+        Vuforia::Type getType() const override { return POSITIONAL_DEVICE_TRACKER_TYPE; }
+        bool isOfType(Vuforia::Type type) const override { return type.getData() == POSITIONAL_DEVICE_TRACKER_TYPE; }
+        bool start() override { return true; }
+        void stop() override {}
+        Vuforia::Anchor* createAnchor(const char*, const Vuforia::Matrix34F&) override { return nullptr; }
+        Vuforia::Anchor* createAnchor(const char*, const Vuforia::HitTestResult&) override { return nullptr; }
+        bool destroyAnchor(Vuforia::Anchor*) override { return false; }
+        Vuforia::List<Vuforia::Anchor> getAnchors() const override { return EmptyList<Vuforia::Anchor>(); }
+        bool reset() override { return true; }
+    };
+
+    class StubStateUpdater : public Vuforia::StateUpdater
+    {
+    public:
+        Vuforia::State updateState() override { return Vuforia::State(); }
+        Vuforia::State getLatestState() const override { return Vuforia::State(); }
+        double getCurrentTimeStamp() const override { return StubEngine::getElapsedMs() / 1000.0; }
+    };
+
+    class StubTrackerManager : public Vuforia::TrackerManager
+    {
+    public:
+        Vuforia::Tracker* initTracker(Vuforia::Type type) override
+        {
+            ScopedCall call("TrackerManager::initTracker");
+            if (gBehaviour.failTrackerInit || getTracker(type) != nullptr)
+            {
+                return nullptr;
+            }
+            if (type.getData() == OBJECT_TRACKER_TYPE)
+            {
+                mObjectTracker = new StubObjectTracker();
+                return mObjectTracker;
+            }
+            if (type.getData() == POSITIONAL_DEVICE_TRACKER_TYPE)
+            {
+                mPositionalDeviceTracker = new StubPositionalDeviceTracker();
+                return mPositionalDeviceTracker;
+            }
+            return nullptr;
+        }
+
+        Vuforia::Tracker* getTracker(Vuforia::Type type) override
+        {
+            if (type.getData() == OBJECT_TRACKER_TYPE)
+            {
+                return mObjectTracker;
+            }
+            if (type.getData() == POSITIONAL_DEVICE_TRACKER_TYPE)
+            {
+                return mPositionalDeviceTracker;
+            }
+            return nullptr;
+        }
+
+        bool deinitTracker(Vuforia::Type type) override
+        {
+            ScopedCall call("TrackerManager::deinitTracker");
+            Vuforia::Tracker* tracker = getTracker(type);
+            if (tracker == nullptr)
+            {
+                return false;
+            }
+            delete tracker;
+            (tracker == mObjectTracker ? mObjectTracker : mPositionalDeviceTracker) = nullptr;
+            return true;
+        }
+
+        Vuforia::StateUpdater& getStateUpdater() override { return mStateUpdater; }
+
+    private:
+        Vuforia::Tracker* mObjectTracker = nullptr;
+        Vuforia::Tracker* mPositionalDeviceTracker = nullptr;
+        StubStateUpdater mStateUpdater;
+    };
+}
+
+
+/*===============================================================================
+StubEngine methods
+===============================================================================*/
+
+void StubEngine::reset(const Behaviour& behaviour)
+{
+    std::lock_guard<std::mutex> lock(gMutex);
+    gBehaviour = behaviour;
+    gCalls.clear();
+    gInitStep = 0;
+    gStartTime = std::chrono::steady_clock::now();
+}
+
+
+double StubEngine::getElapsedMs()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - gStartTime).count();
+}
+
+
+void StubEngine::recordCall(const std::string& name, double startMs, double endMs)
+{
+    std::lock_guard<std::mutex> lock(gMutex);
+    gCalls.push_back({ name, startMs, endMs });
+    gCallRecorded.notify_all();
+}
+
+
+int StubEngine::getNumCalls(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(gMutex);
+    return static_cast<int>(std::count_if(gCalls.begin(), gCalls.end(),
+                                          [&name](const Call& call) { return call.name == name; }));
+}
+
+
+bool StubEngine::getCallTime(const std::string& name, double& startMs, double& endMs)
+{
+    std::lock_guard<std::mutex> lock(gMutex);
+    bool found = false;
+    for (const Call& call : gCalls)
+    {
+        if (call.name == name)
+        {
+            startMs = found ? std::min(startMs, call.startMs) : call.startMs;
+            endMs = found ? std::max(endMs, call.endMs) : call.endMs;
+            found = true;
+        }
+    }
+    return found;
+}
+
+
+bool StubEngine::waitForCall(const std::string& name, std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(gMutex);
+    return gCallRecorded.wait_for(lock, timeout, [&name]
+    {
+        return std::any_of(gCalls.begin(), gCalls.end(), [&name](const Call& call) { return call.name == name; });
+    });
+}
+
+
+/*===============================================================================
+Vuforia Engine calls made while initializing and deinitializing
+===============================================================================*/
+
+namespace Vuforia
+{
+
+void setInitParameters(jobject /* activity */, int /* flags */, const char* /* licenseKey */)
+{
+    StubEngine::recordCall("setInitParameters", StubEngine::getElapsedMs(), StubEngine::getElapsedMs());
+}
+
+
+int init()
+{
+    ScopedCall call("init");
+    std::this_thread::sleep_for(gBehaviour.initStepTime);
+    int step = ++gInitStep;
+    if (step < gBehaviour.numInitSteps)
+    {
+        return step * 100 / gBehaviour.numInitSteps;
+    }
+    return gBehaviour.initResult;
+}
+
+
+void deinit()
+{
+    StubEngine::recordCall("deinit", StubEngine::getElapsedMs(), StubEngine::getElapsedMs());
+}
+
+
+void onPause()
+{
+}
+
+
+void registerCallback(UpdateCallback* /* object */)
+{
+}
+
+
+TrackerManager& TrackerManager::getInstance()
+{
+    static StubTrackerManager trackerManager;
+    return trackerManager;
+}
+
+
+Type Tracker::getClassType()
+{
+    return Type();
+}
+
+
+Type ObjectTracker::getClassType()
+{
+    return OBJECT_TRACKER_TYPE;
+}
+
+
+Type PositionalDeviceTracker::getClassType()
+{
+    return POSITIONAL_DEVICE_TRACKER_TYPE;
+}
+
+
+Type::Type() : mData(0)
+{
+}
+
+
+Type::Type(UInt16 data) : mData(data)
+{
+}
+
+
+UInt16 Type::getData() const
+{
+    return mData;
+}
+
+
+bool Type::isOfType(const Type type) const
+{
+    return mData == type.mData;
+}
+
+
+State::State() : mData(nullptr)
+{
+}
+
+
+State::State(const State& /* other */) : mData(nullptr)
+{
+}
+
+
+State& State::operator=(const State& /* other */)
+{
+    return *this;
+}
+
+
+State::~State()
+{
+}
+
+
+
+Type ModelTarget::getClassType()
+{
+    return MODEL_TARGET_TYPE;
+}
+
+
+Type DeviceTrackableResult::getClassType()
+{
+    return DEVICE_TRACKABLE_RESULT_TYPE;
+}
+
+
+Type ImageTargetResult::getClassType()
+{
+    return IMAGE_TARGET_RESULT_TYPE;
+}
+
+
+Type ModelTargetResult::getClassType()
+{
+    return MODEL_TARGET_RESULT_TYPE;
+}
+
+
+/*===============================================================================
+Vuforia Engine calls made only while AR runs, which the simulation never starts
+===============================================================================*/
+
+void onResume()
+{
+    notSimulated("Vuforia::onResume");
+}
+
+
+void onSurfaceCreated()
+{
+    notSimulated("Vuforia::onSurfaceCreated");
+}
+
+
+void onSurfaceChanged(int /* width */, int /* height */)
+{
+    notSimulated("Vuforia::onSurfaceChanged");
+}
+
+
+CameraDevice& CameraDevice::getInstance()
+{
+    notSimulated("CameraDevice::getInstance");
+}
+
+
+Device& Device::getInstance()
+{
+    notSimulated("Device::getInstance");
+}
+
+
+Renderer& Renderer::getInstance()
+{
+    notSimulated("Renderer::getInstance");
+}
+
+
+Obb3D::Obb3D(const Obb3D& /* other */)
+{
+    notSimulated("Obb3D::Obb3D");
+}
+
+
+const Vec3F& Obb3D::getCenter() const
+{
+    notSimulated("Obb3D::getCenter");
+}
+
+
+const Vec3F& Obb3D::getHalfExtents() const
+{
+    notSimulated("Obb3D::getHalfExtents");
+}
+
+
+float Obb3D::getRotationZ() const
+{
+    notSimulated("Obb3D::getRotationZ");
+}
+
+
+Obb3D::~Obb3D()
+{
+}
+
+
+RenderingPrimitives::RenderingPrimitives(const RenderingPrimitives& /* other */)
+{
+    notSimulated("RenderingPrimitives::RenderingPrimitives");
+}
+
+
+RenderingPrimitives::~RenderingPrimitives()
+{
+}
+
+
+bool RenderingPrimitives::isValid() const
+{
+    notSimulated("RenderingPrimitives::isValid");
+}
+
+
+ViewList& RenderingPrimitives::getRenderingViews() const
+{
+    notSimulated("RenderingPrimitives::getRenderingViews");
+}
+
+
+Vec4I RenderingPrimitives::getViewport(VIEW /* viewID */) const
+{
+    notSimulated("RenderingPrimitives::getViewport");
+}
+
+
+Vec4F RenderingPrimitives::getNormalizedViewport(VIEW /* viewID */) const
+{
+    notSimulated("RenderingPrimitives::getNormalizedViewport");
+}
+
+
+Matrix34F RenderingPrimitives::getProjectionMatrix(VIEW /* viewID */, const CameraCalibration* /* calibration */,
+                                                   bool /* adjustForViewportCentreToEyeAxis */)
+{
+    notSimulated("RenderingPrimitives::getProjectionMatrix");
+}
+
+
+Matrix34F RenderingPrimitives::getEyeDisplayAdjustmentMatrix(VIEW /* viewID */) const
+{
+    notSimulated("RenderingPrimitives::getEyeDisplayAdjustmentMatrix");
+}
+
+
+const Vec2I RenderingPrimitives::getVideoBackgroundTextureSize() const
+{
+    notSimulated("RenderingPrimitives::getVideoBackgroundTextureSize");
+}
+
+
+Matrix34F RenderingPrimitives::getVideoBackgroundProjectionMatrix(VIEW /* viewID */,
+                                                                  bool /* adjustForReflection */) const
+{
+    notSimulated("RenderingPrimitives::getVideoBackgroundProjectionMatrix");
+}
+
+
+const Mesh& RenderingPrimitives::getVideoBackgroundMesh(VIEW /* viewID */) const
+{
+    notSimulated("RenderingPrimitives::getVideoBackgroundMesh");
+}
+
+
+Frame State::getFrame() const
+{
+    notSimulated("State::getFrame");
+}
+
+
+Frame::~Frame()
+{
+}
+
+
+double Frame::getTimeStamp() const
+{
+    notSimulated("Frame::getTimeStamp");
+}
+
+
+const CameraCalibration* State::getCameraCalibration() const
+{
+    notSimulated("State::getCameraCalibration");
+}
+
+
+const DeviceTrackableResult* State::getDeviceTrackableResult() const
+{
+    notSimulated("State::getDeviceTrackableResult");
+}
+
+
+List<const TrackableResult> State::getTrackableResults() const
+{
+    notSimulated("State::getTrackableResults");
+}
+
+
+Matrix44F Tool::convertPose2GLMatrix(const Matrix34F& /* pose */)
+{
+    notSimulated("Tool::convertPose2GLMatrix");
+}
+
+
+Matrix44F Tool::convert2GLMatrix(const Matrix34F& /* matrix34F */)
+{
+    notSimulated("Tool::convert2GLMatrix");
+}
+
+
+Matrix44F Tool::convertPerspectiveProjection2GLMatrix(const Matrix34F& /* projection */, float /* nearPlane */,
+                                                      float /* farPlane */)
+{
+    notSimulated("Tool::convertPerspectiveProjection2GLMatrix");
+}
+
+}
@@ -0,0 +1,55 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __STUBENGINE_H__
+#define __STUBENGINE_H__
+
+#include <chrono>
+#include <string>
+
+
+/// Stand-in for the Vuforia Engine library, implementing the calls AppController
+/// makes while initializing and deinitializing.
+/**
+ * Each call takes a set time and succeeds unless the behaviour says otherwise, and
+ * is recorded with its start and end times so a simulation can check the order and
+ * overlap of what initAR did. Datasets load with no trackables.
+ */
+namespace StubEngine
+{
+    struct Behaviour
+    {
+        /// Vuforia::init() is called repeatedly until it reaches 100, or returns initResult
+        /// in place of 100 when that is an error code
+        int numInitSteps = 5;
+        std::chrono::milliseconds initStepTime { 20 };
+        int initResult = 100;
+        bool failTrackerInit = false;
+        bool failDataSetLoad = false;
+        std::chrono::milliseconds dataSetLoadTime { 20 };
+    };
+
+    /// Start a new simulation, forgetting the calls made so far
+    void reset(const Behaviour& behaviour);
+
+    /// Time since reset, in milliseconds
+    double getElapsedMs();
+
+    /// Record a call, with when it started and ended relative to reset
+    void recordCall(const std::string& name, double startMs, double endMs);
+
+    /// Number of calls recorded with the name
+    int getNumCalls(const std::string& name);
+
+    /// Start of the first and end of the last call recorded with the name, false if there was none
+    bool getCallTime(const std::string& name, double& startMs, double& endMs);
+
+    /// Wait until a call with the name has started, false if it didn't within timeout
+    bool waitForCall(const std::string& name, std::chrono::milliseconds timeout);
+}
+
+#endif // __STUBENGINE_H__
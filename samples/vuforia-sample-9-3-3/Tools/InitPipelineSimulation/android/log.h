@@ -0,0 +1,32 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __ANDROID_LOG_H__
+#define __ANDROID_LOG_H__
+
+// Desktop stand-in for the NDK's log header, printing to the standard output,
+// so the Android build of the cross platform code logs as the tools' builds do.
+
+#include <cstdarg>
+#include <cstdio>
+
+enum
+{
+    ANDROID_LOG_INFO = 4
+};
+
+inline int __android_log_print(int /* priority */, const char* /* tag */, const char* format, ...)
+{
+    std::va_list arguments;
+    va_start(arguments, format);
+    int length = std::vprintf(format, arguments);
+    std::printf("\n");
+    va_end(arguments);
+    return length;
+}
+
+#endif // __ANDROID_LOG_H__
@@ -0,0 +1,17 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __JNI_H__
+#define __JNI_H__
+
+// Desktop stand-in for the JNI header, with just the type the Vuforia Android
+// header needs, so AppController builds as it does for Android.
+
+class _jobject {};
+typedef _jobject* jobject;
+
+#endif // __JNI_H__
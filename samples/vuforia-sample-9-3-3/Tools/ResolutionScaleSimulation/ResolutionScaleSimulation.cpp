@@ -0,0 +1,237 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+// Desktop simulation of ResolutionScaleController, which the Android renderer
+// sets the resolution of its augmentations with. Drives it with GPU times
+// from a cost model, reported a few frames late as GLESGpuTimer reports them,
+// through scenes of steady and changing load. Prints how each scene settles
+// and checks that the frames end up within the target without the scale
+// oscillating. See README.md.
+
+#include <ResolutionScaleController.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <vector>
+
+
+namespace
+{
+    /// Frames between drawing a frame and its GPU time coming back
+    constexpr int LATENCY_FRAMES = 3;
+    /// Frames at the end of a scene its outcome is measured over
+    constexpr int MEASURED_FRAMES = 100;
+    /// Upscaling the target over the surface, only paid below full scale
+    constexpr double UPSCALE_MS = 0.6;
+
+    /// GPU time of a frame
+    struct CostModel
+    {
+        /// Video background and the rest of the frame drawn at full resolution
+        double fixedMs;
+        /// Vertex work of the scaled passes, which doesn't shrink with the scale
+        double vertexMs;
+        /// Fragment work of the scaled passes at full resolution
+        double pixelMs;
+        /// Each frame's time varies by up to this fraction either way
+        double noise;
+    };
+
+    enum Expectation
+    {
+        EXPECT_MAX_SCALE,
+        EXPECT_WITHIN_TARGET,
+        EXPECT_MIN_SCALE,
+    };
+
+    struct Segment
+    {
+        int numFrames;
+        CostModel cost;
+    };
+
+    struct Scene
+    {
+        const char* name;
+        std::vector<Segment> segments;
+        /// Outcome of the last segment
+        Expectation expectation;
+    };
+
+    struct Result
+    {
+        /// Over the last MEASURED_FRAMES frames
+        double meanScale = 0.0;
+        double meanMs = 0.0;
+        int numReversals = 0;
+        /// Over the whole scene
+        double overTargetFraction = 0.0;
+        /// Frames after the start of each segment until the scale stays put
+        std::vector<int> settleFrames;
+    };
+
+    Result simulate(const Scene& scene, const ResolutionScaleController::Settings& settings, bool scaling)
+    {
+        ResolutionScaleController controller(settings);
+        // Seeded, so every run gives the same numbers
+        std::mt19937 random(1);
+        std::uniform_real_distribution<double> noise(-1.0, 1.0);
+
+        struct Sample
+        {
+            float scale;
+            double scaledMs;
+            double fixedMs;
+        };
+        std::deque<Sample> pending;
+
+        std::vector<float> scales;
+        std::vector<double> frameMs;
+        int numOverTarget = 0;
+        Result result;
+        for (const Segment& segment : scene.segments)
+        {
+            size_t segmentStart = scales.size();
+            for (int frame = 0; frame < segment.numFrames; ++frame)
+            {
+                float scale = scaling ? controller.getScale() : 1.0f;
+                double variation = 1.0 + segment.cost.noise * noise(random);
+                Sample sample;
+                sample.scale = scale;
+                sample.scaledMs = (segment.cost.vertexMs + segment.cost.pixelMs * scale * scale) * variation;
+                sample.fixedMs = (segment.cost.fixedMs + (scale < 1.0f ? UPSCALE_MS : 0.0)) * variation;
+                pending.push_back(sample);
+
+                scales.push_back(scale);
+                frameMs.push_back(sample.scaledMs + sample.fixedMs);
+                if (frameMs.back() > settings.targetMs)
+                {
+                    ++numOverTarget;
+                }
+
+                if (pending.size() > LATENCY_FRAMES)
+                {
+                    const Sample& finished = pending.front();
+                    controller.addSample(finished.scale, finished.scaledMs, finished.fixedMs);
+                    pending.pop_front();
+                }
+            }
+
+            // The last frame the scale was away from where the segment ends up
+            float finalScale = scales.back();
+            int settle = 0;
+            for (size_t i = segmentStart; i < scales.size(); ++i)
+            {
+                if (std::fabs(scales[i] - finalScale) > 0.02f)
+                {
+                    settle = static_cast<int>(i - segmentStart) + 1;
+                }
+            }
+            result.settleFrames.push_back(settle);
+        }
+
+        size_t measuredStart = scales.size() - std::min<size_t>(scales.size(), MEASURED_FRAMES);
+        int lastDirection = 0;
+        for (size_t i = measuredStart; i < scales.size(); ++i)
+        {
+            result.meanScale += scales[i];
+            result.meanMs += frameMs[i];
+            if (i > measuredStart && scales[i] != scales[i - 1])
+            {
+                int direction = scales[i] > scales[i - 1] ? 1 : -1;
+                if (lastDirection != 0 && direction != lastDirection)
+                {
+                    ++result.numReversals;
+                }
+                lastDirection = direction;
+            }
+        }
+        result.meanScale /= scales.size() - measuredStart;
+        result.meanMs /= scales.size() - measuredStart;
+        result.overTargetFraction = static_cast<double>(numOverTarget) / scales.size();
+        return result;
+    }
+
+    bool meetsExpectation(const Scene& scene, const Result& result, const ResolutionScaleController::Settings& settings)
+    {
+        // A scale that keeps changing direction is oscillating rather than following the load
+        const int maxReversals = 4;
+        if (result.numReversals > maxReversals)
+        {
+            return false;
+        }
+        switch (scene.expectation)
+        {
+            case EXPECT_MAX_SCALE:
+                return result.meanScale >= settings.maxScale - 0.01;
+            case EXPECT_MIN_SCALE:
+                return result.meanScale <= settings.minScale + 0.01;
+            case EXPECT_WITHIN_TARGET:
+                return result.meanMs <= settings.targetMs &&
+                       result.meanMs >= settings.targetMs * (1.0 - 2.0 * settings.headroom);
+        }
+        return false;
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    ResolutionScaleController::Settings settings;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--target") == 0 && i + 1 < argc)
+        {
+            settings.targetMs = std::max(std::atof(argv[++i]), 1.0);
+        }
+        else
+        {
+            std::fprintf(stderr, "Usage: ResolutionScaleSimulation [--target <ms>]\n");
+            return 1;
+        }
+    }
+
+    const CostModel light = { 2.0, 0.5, 4.0, 0.05 };
+    const CostModel heavy = { 2.0, 0.5, 20.0, 0.05 };
+    const CostModel noisy = { 2.0, 0.5, 16.0, 0.25 };
+    const CostModel overload = { 2.0, 0.5, 60.0, 0.05 };
+    const Scene scenes[] = {
+        { "Light", { { 600, light } }, EXPECT_MAX_SCALE },
+        { "Heavy", { { 600, heavy } }, EXPECT_WITHIN_TARGET },
+        { "Noisy", { { 600, noisy } }, EXPECT_WITHIN_TARGET },
+        { "Overload", { { 600, overload } }, EXPECT_MIN_SCALE },
+        { "Light, heavy, light", { { 200, light }, { 200, heavy }, { 200, light } }, EXPECT_MAX_SCALE },
+        { "Heavy, light, heavy", { { 200, heavy }, { 200, light }, { 200, heavy } }, EXPECT_WITHIN_TARGET },
+    };
+
+    std::printf("Target %.1f ms, scale %.2f to %.2f, GPU times %d frames late\n",
+                settings.targetMs, settings.minScale, settings.maxScale, LATENCY_FRAMES);
+    bool passed = true;
+    for (const Scene& scene : scenes)
+    {
+        Result result = simulate(scene, settings, true);
+        Result fullResolution = simulate(scene, settings, false);
+        bool met = meetsExpectation(scene, result, settings);
+        passed = passed && met;
+
+        std::printf("%s: scale %.2f, %.1f ms, %.0f%% of frames over target (%.0f%% at full resolution), "
+                    "%d reversals, settled in",
+                    scene.name, result.meanScale, result.meanMs, result.overTargetFraction * 100.0,
+                    fullResolution.overTargetFraction * 100.0, result.numReversals);
+        for (int settle : result.settleFrames)
+        {
+            std::printf(" %d", settle);
+        }
+        std::printf(" frames, %s\n", met ? "ok" : "FAILED");
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "DesktopAssetManager.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+
+/// Assets are looked up by file name alone, as the app packages the
+/// directories' contents flat into its assets
+struct AAssetManager
+{
+    std::vector<std::string> directories;
+};
+
+
+/// The whole file is read on open, the renderer's assets are a few megabytes
+struct AAsset
+{
+    std::vector<unsigned char> data;
+    size_t offset = 0;
+};
+
+
+AAssetManager* DesktopAssetManager::create(const std::vector<std::string>& directories)
+{
+    AAssetManager* manager = new AAssetManager();
+    manager->directories = directories;
+    return manager;
+}
+
+
+void DesktopAssetManager::destroy(AAssetManager* manager)
+{
+    delete manager;
+}
+
+
+extern "C"
+{
+
+AAsset* AAssetManager_open(AAssetManager* manager, const char* filename, int /* mode */)
+{
+    if (manager == nullptr)
+    {
+        return nullptr;
+    }
+
+    for (const std::string& directory : manager->directories)
+    {
+        std::string path = directory + "/" + filename;
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (file == nullptr)
+        {
+            continue;
+        }
+
+        AAsset* asset = new AAsset();
+        unsigned char buffer[BUFSIZ];
+        size_t numRead = 0;
+        while ((numRead = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+        {
+            asset->data.insert(asset->data.end(), buffer, buffer + numRead);
+        }
+        std::fclose(file);
+        return asset;
+    }
+    return nullptr;
+}
+
+
+int AAsset_read(AAsset* asset, void* buffer, size_t count)
+{
+    size_t numRead = std::min(count, asset->data.size() - asset->offset);
+    std::memcpy(buffer, asset->data.data() + asset->offset, numRead);
+    asset->offset += numRead;
+    return static_cast<int>(numRead);
+}
+
+
+off_t AAsset_getLength(AAsset* asset)
+{
+    return static_cast<off_t>(asset->data.size());
+}
+
+
+const void* AAsset_getBuffer(AAsset* asset)
+{
+    return asset->data.data();
+}
+
+
+void AAsset_close(AAsset* asset)
+{
+    delete asset;
+}
+
+}
@@ -0,0 +1,25 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __DESKTOPASSETMANAGER_H__
+#define __DESKTOPASSETMANAGER_H__
+
+#include <android/asset_manager.h>
+
+#include <string>
+#include <vector>
+
+
+/// Creates the AAssetManager the renderer is given on the desktop, which
+/// opens assets from the first of the directories that has them
+namespace DesktopAssetManager
+{
+    AAssetManager* create(const std::vector<std::string>& directories);
+    void destroy(AAssetManager* manager);
+}
+
+#endif // __DESKTOPASSETMANAGER_H__
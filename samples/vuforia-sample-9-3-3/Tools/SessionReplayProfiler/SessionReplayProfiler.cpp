@@ -0,0 +1,420 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+// Desktop profiler of the Android renderer, driven by a session log written by
+// SessionRecorder. Each recorded frame is rendered the way VuforiaWrapper renders
+// a live one, on a GLES 3.1 context without a window such as Mesa's software
+// renderer gives, so the whole renderer can be timed, or run under perf, with
+// the same input every time. Can also hash the rendered images, to check that a
+// change leaves them as they were. See README.md.
+
+#include "DesktopAssetManager.h"
+
+#include <GLESRenderer.h>
+#include <GuideViewCache.h>
+#include <MathUtils.h>
+#include <SessionReplayer.h>
+
+#include <Vuforia/TrackableResult.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+    constexpr int DEFAULT_ITERATIONS = 1;
+    constexpr GLsizei DEFAULT_WIDTH = 1280;
+    constexpr GLsizei DEFAULT_HEIGHT = 720;
+    /// Vertical field of view of the projection, the log doesn't record the camera's
+    constexpr float DEFAULT_FOV = 60.0f;
+    constexpr float NEAR_PLANE = 0.01f;
+    constexpr float FAR_PLANE = 5.f;
+    /// FNV-1a, enough to tell images apart
+    constexpr uint64_t HASH_OFFSET_BASIS = 14695981039346656037ull;
+    constexpr uint64_t HASH_PRIME = 1099511628211ull;
+
+    /// What one replayed frame cost
+    struct FrameCost
+    {
+        double timestamp;
+        /// CPU time of the renderer's beginFrame to endFrame
+        double rendererMs;
+        /// CPU time of the whole frame, including decoding it from the log
+        double frameMs;
+        unsigned int numDrawCalls;
+        size_t uploadedBytes;
+        /// State changes the renderer asked its state cache for, and how many reached GL
+        unsigned int numStateCallsRequested;
+        unsigned int numStateCallsIssued;
+        size_t numAugmentations;
+        /// Hash of the rendered image, with --hash in the first iteration
+        bool hashed;
+        uint64_t imageHash;
+    };
+
+    bool createContext()
+    {
+        auto getPlatformDisplay =
+            reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (getPlatformDisplay == nullptr)
+        {
+            return false;
+        }
+        EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr) || !eglBindAPI(EGL_OPENGL_ES_API))
+        {
+            return false;
+        }
+        const EGLint contextAttributes[] = { EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 1, EGL_NONE };
+        EGLContext context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttributes);
+        return context != EGL_NO_CONTEXT && eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+    }
+
+    /// Render to renderbuffers, as there is no window
+    void createTarget(GLsizei width, GLsizei height)
+    {
+        GLuint renderbuffers[2] = {};
+        glGenRenderbuffers(2, renderbuffers);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        GLuint framebuffer = 0;
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+        glViewport(0, 0, width, height);
+    }
+
+    uint64_t hashBytes(uint64_t hash, const unsigned char* bytes, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ bytes[i]) * HASH_PRIME;
+        }
+        return hash;
+    }
+
+    /// Hash of the target's pixels
+    uint64_t hashImage(GLsizei width, GLsizei height, std::vector<unsigned char>& pixels)
+    {
+        pixels.resize(static_cast<size_t>(width) * height * 4);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        return hashBytes(HASH_OFFSET_BASIS, pixels.data(), pixels.size());
+    }
+
+    double percentile(std::vector<double> values, double fraction)
+    {
+        if (values.empty())
+        {
+            return 0.0;
+        }
+        std::sort(values.begin(), values.end());
+        return values[std::min(static_cast<size_t>(values.size() * fraction), values.size() - 1)];
+    }
+
+    void printTimes(const char* label, const std::vector<double>& times)
+    {
+        double total = 0.0;
+        for (double time : times)
+        {
+            total += time;
+        }
+        std::printf("  %-16s mean %8.3f  median %8.3f  95th percentile %8.3f  max %8.3f ms\n", label,
+                    times.empty() ? 0.0 : total / times.size(), percentile(times, 0.5), percentile(times, 0.95),
+                    percentile(times, 1.0));
+    }
+}
+
+
+// Guide Views are decoded by the engine, which replay doesn't run, so there are never any
+std::map<GuideViewCache::GuideViewId, std::shared_ptr<const GuideViewCache::Image>> GuideViewCache::getImages() const
+{
+    return {};
+}
+
+
+int main(int argc, char** argv)
+{
+    int iterations = DEFAULT_ITERATIONS;
+    GLsizei width = DEFAULT_WIDTH;
+    GLsizei height = DEFAULT_HEIGHT;
+    float fov = DEFAULT_FOV;
+    int modelTargetType = -1;
+    bool finish = false;
+    bool hash = false;
+    std::string csvPath;
+    std::vector<std::string> assetDirectories;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+        {
+            iterations = std::max(std::atoi(argv[++i]), 1);
+        }
+        else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+        {
+            if (std::sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0)
+            {
+                std::fprintf(stderr, "--size takes <width>x<height>\n");
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--fov") == 0 && i + 1 < argc)
+        {
+            fov = static_cast<float>(std::atof(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--model-target-type") == 0 && i + 1 < argc)
+        {
+            modelTargetType = std::atoi(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--assets") == 0 && i + 1 < argc)
+        {
+            assetDirectories.push_back(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--csv") == 0 && i + 1 < argc)
+        {
+            csvPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--finish") == 0)
+        {
+            finish = true;
+        }
+        else if (std::strcmp(argv[i], "--hash") == 0)
+        {
+            hash = true;
+        }
+        else
+        {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.size() != 1)
+    {
+        std::fprintf(stderr, "Usage: SessionReplayProfiler [--iterations <n>] [--size <width>x<height>] "
+                             "[--fov <degrees>] [--model-target-type <type>] [--assets <directory>]... "
+                             "[--csv <frames.csv>] [--finish] [--hash] <session.vsl>\n");
+        return 1;
+    }
+    if (assetDirectories.empty())
+    {
+        // Where the app packages its assets from, when run from the sample's directory
+        assetDirectories = { "Assets/ImageTargets", "Assets/ModelTargets" };
+    }
+
+    SessionReplayer replayer;
+    if (!replayer.open(paths[0]))
+    {
+        std::fprintf(stderr, "Failed to read the session log %s\n", paths[0].c_str());
+        return 1;
+    }
+
+    if (!createContext())
+    {
+        std::fprintf(stderr, "Failed to create a GLES 3.1 context without a surface\n");
+        return 1;
+    }
+    std::printf("GL: %s, %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+    createTarget(width, height);
+
+    AAssetManager* assetManager = DesktopAssetManager::create(assetDirectories);
+    GLESRenderer renderer;
+    auto initStart = std::chrono::steady_clock::now();
+    bool initialized = renderer.init(assetManager);
+    double initMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - initStart).count();
+    if (!initialized)
+    {
+        std::fprintf(stderr, "Failed to initialize the renderer, are the models and textures in the asset "
+                             "directories?\n");
+        DesktopAssetManager::destroy(assetManager);
+        return 1;
+    }
+    renderer.setSurfaceSize(width, height);
+    std::printf("Renderer initialized in %.1f ms\n", initMs);
+
+    // The camera image isn't recorded, the video background is drawn from an empty texture
+    const float vbVertices[] = { -1.0f, -1.0f, 0.0f, 1.0f, -1.0f, 0.0f, 1.0f, 1.0f, 0.0f, -1.0f, 1.0f, 0.0f };
+    const float vbTextureCoordinates[] = { 0.0f, 1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f };
+    const unsigned short vbIndices[] = { 0, 1, 2, 0, 2, 3 };
+    const int viewportInts[4] = { 0, 0, width, height };
+    const Vuforia::Vec4I viewport(viewportInts);
+    Vuforia::Matrix44F vbProjection = MathUtils::Matrix44FIdentity();
+    Vuforia::Matrix44F projection = MathUtils::Matrix44FPerspectiveGL(
+        fov, static_cast<float>(width) / height, NEAR_PLANE, FAR_PLANE);
+
+    std::vector<FrameCost> costs;
+    std::map<uint16_t, size_t> resultTypes;
+    FrameSnapshot snapshot;
+    std::vector<SessionReplayer::ReplayedAugmentation> augmentations;
+    std::vector<unsigned char> pixels;
+    uint64_t imagesHash = HASH_OFFSET_BASIS;
+    for (int iteration = 0; iteration < iterations; ++iteration)
+    {
+        replayer.rewind();
+        auto frameStart = std::chrono::steady_clock::now();
+        while (replayer.next(snapshot))
+        {
+            bool hasPose = SessionReplayer::getAugmentations(snapshot, augmentations);
+
+            renderer.beginFrame();
+            renderer.setViewport(viewport);
+            renderer.renderVideoBackground(vbProjection, viewport, vbVertices, vbTextureCoordinates, 2, vbIndices,
+                                           1, 0);
+            if (hasPose && snapshot.deviceStatus == Vuforia::TrackableResult::TRACKED &&
+                snapshot.deviceStatusInfo == Vuforia::TrackableResult::NORMAL)
+            {
+                Vuforia::Matrix44F viewMatrix = MathUtils::Matrix44FTranspose(
+                    MathUtils::Matrix44FInverse(MathUtils::Matrix44FFromPose(snapshot.devicePose)));
+                renderer.renderWorldOrigin(projection, viewMatrix);
+            }
+            // Result types are engine data, only known offline when given
+            for (SessionReplayer::ReplayedAugmentation& replayed : augmentations)
+            {
+                AugmentationRegistry::Augmentation& augmentation = replayed.augmentation;
+                if (replayed.resultType == modelTargetType)
+                {
+                    renderer.renderModelTarget(projection, augmentation.modelViewMatrix,
+                                               augmentation.scaledModelViewMatrix);
+                }
+                else
+                {
+                    renderer.renderImageTarget(projection, augmentation.modelViewMatrix,
+                                               augmentation.scaledModelViewMatrix);
+                }
+                if (iteration == 0)
+                {
+                    ++resultTypes[replayed.resultType];
+                }
+            }
+            renderer.endFrame();
+
+            // A flush stands in for the swap, finishing makes the frame time include the GPU's
+            if (finish)
+            {
+                glFinish();
+            }
+            else
+            {
+                glFlush();
+            }
+
+            auto frameEnd = std::chrono::steady_clock::now();
+            const GLESRenderer::FrameStats& stats = renderer.getLastFrameStats();
+            costs.push_back({ snapshot.timestamp, stats.cpuMs,
+                              std::chrono::duration<double, std::milli>(frameEnd - frameStart).count(),
+                              stats.numDrawCalls, stats.uploadedBytes, stats.numStateCallsRequested,
+                              stats.numStateCallsIssued, augmentations.size(), false, 0 });
+            frameStart = frameEnd;
+
+            // Later iterations draw the same frames with every texture streamed in
+            if (hash && iteration == 0)
+            {
+                uint64_t imageHash = hashImage(width, height, pixels);
+                costs.back().hashed = true;
+                costs.back().imageHash = imageHash;
+                imagesHash = hashBytes(imagesHash, reinterpret_cast<const unsigned char*>(&imageHash),
+                                       sizeof(imageHash));
+                // The readback isn't part of the next frame's time
+                frameStart = std::chrono::steady_clock::now();
+            }
+        }
+    }
+    glFinish();
+    renderer.deinit();
+    DesktopAssetManager::destroy(assetManager);
+
+    if (replayer.isTruncated())
+    {
+        std::printf("The log ends in an incomplete frame, replayed the %zu frames before it\n",
+                    replayer.getNumFramesRead());
+    }
+    if (costs.empty())
+    {
+        std::fprintf(stderr, "%s has no frames\n", paths[0].c_str());
+        return 1;
+    }
+
+    if (!csvPath.empty())
+    {
+        std::FILE* csv = std::fopen(csvPath.c_str(), "w");
+        if (csv == nullptr)
+        {
+            std::fprintf(stderr, "Failed to create %s\n", csvPath.c_str());
+            return 1;
+        }
+        std::fprintf(csv, "frame,timestamp,renderer_ms,frame_ms,draw_calls,uploaded_bytes,"
+                          "state_calls_requested,state_calls_issued,augmentations,image_hash\n");
+        for (size_t i = 0; i < costs.size(); ++i)
+        {
+            const FrameCost& cost = costs[i];
+            std::fprintf(csv, "%zu,%.6f,%.4f,%.4f,%u,%zu,%u,%u,%zu,", i, cost.timestamp, cost.rendererMs,
+                         cost.frameMs, cost.numDrawCalls, cost.uploadedBytes, cost.numStateCallsRequested,
+                         cost.numStateCallsIssued, cost.numAugmentations);
+            // Empty for frames that weren't hashed
+            if (cost.hashed)
+            {
+                std::fprintf(csv, "%016" PRIx64, cost.imageHash);
+            }
+            std::fprintf(csv, "\n");
+        }
+        std::fclose(csv);
+    }
+
+    std::vector<double> rendererTimes;
+    std::vector<double> frameTimes;
+    std::vector<size_t> uploadedBytes;
+    double numDrawCalls = 0.0;
+    double numStateCallsRequested = 0.0;
+    double numStateCallsIssued = 0.0;
+    double numAugmentations = 0.0;
+    for (const FrameCost& cost : costs)
+    {
+        rendererTimes.push_back(cost.rendererMs);
+        frameTimes.push_back(cost.frameMs);
+        uploadedBytes.push_back(cost.uploadedBytes);
+        numDrawCalls += cost.numDrawCalls;
+        numStateCallsRequested += cost.numStateCallsRequested;
+        numStateCallsIssued += cost.numStateCallsIssued;
+        numAugmentations += cost.numAugmentations;
+    }
+    std::printf("%zu frames replayed %d times at %dx%d, %.1f augmentations and %.1f draw calls per frame\n",
+                costs.size() / iterations, iterations, width, height, numAugmentations / costs.size(),
+                numDrawCalls / costs.size());
+    // Static geometry is uploaded by init, what a frame uploads is its constants and any texture streaming
+    std::sort(uploadedBytes.begin(), uploadedBytes.end());
+    std::printf("  %-16s median %8zu  max %8zu bytes per frame\n", "Uploaded",
+                uploadedBytes[uploadedBytes.size() / 2], uploadedBytes.back());
+    // The state cache drops the changes that would set a value GL already has
+    std::printf("  %-16s requested %8.1f  issued %8.1f per frame\n", "State changes",
+                numStateCallsRequested / costs.size(), numStateCallsIssued / costs.size());
+    if (hash)
+    {
+        std::printf("  %-16s %016" PRIx64 " over the first iteration's frames\n", "Image hash", imagesHash);
+    }
+    printTimes("Renderer CPU", rendererTimes);
+    printTimes(finish ? "Frame, finished" : "Frame", frameTimes);
+    for (const auto& typeCount : resultTypes)
+    {
+        std::printf("  Result type %u: %zu augmentations, drawn as %s\n", typeCount.first, typeCount.second,
+                    typeCount.first == modelTargetType ? "Model Targets" : "Image Targets");
+    }
+    return 0;
+}
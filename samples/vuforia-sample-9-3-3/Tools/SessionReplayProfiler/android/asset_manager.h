@@ -0,0 +1,40 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __ASSET_MANAGER_H__
+#define __ASSET_MANAGER_H__
+
+// Desktop stand-in for the NDK's asset manager, with just the calls the Android
+// renderer makes, so its sources build unchanged for SessionReplayProfiler.
+// Assets are read from directories on disk, see DesktopAssetManager.cpp.
+
+#include <sys/types.h>
+
+#include <cstddef>
+
+
+struct AAssetManager;
+struct AAsset;
+
+enum
+{
+    AASSET_MODE_UNKNOWN = 0,
+    AASSET_MODE_RANDOM = 1,
+    AASSET_MODE_STREAMING = 2,
+    AASSET_MODE_BUFFER = 3
+};
+
+extern "C"
+{
+    AAsset* AAssetManager_open(AAssetManager* manager, const char* filename, int mode);
+    int AAsset_read(AAsset* asset, void* buffer, size_t count);
+    off_t AAsset_getLength(AAsset* asset);
+    const void* AAsset_getBuffer(AAsset* asset);
+    void AAsset_close(AAsset* asset);
+}
+
+#endif // __ASSET_MANAGER_H__
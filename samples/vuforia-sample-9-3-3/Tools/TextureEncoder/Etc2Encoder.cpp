@@ -0,0 +1,474 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#include "Etc2Encoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <thread>
+
+
+namespace
+{
+    /// Intensity modifiers of the individual and differential modes, small then large
+    constexpr int MODIFIER_TABLE[8][2] = {
+        { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 },
+    };
+
+    constexpr int EAC_TABLE[16][8] = {
+        { -3, -6, -9, -15, 2, 5, 8, 14 },
+        { -3, -7, -10, -13, 2, 6, 9, 12 },
+        { -2, -5, -8, -13, 1, 4, 7, 12 },
+        { -2, -4, -6, -13, 1, 3, 5, 12 },
+        { -3, -6, -8, -12, 2, 5, 7, 11 },
+        { -3, -7, -9, -11, 2, 6, 8, 10 },
+        { -4, -7, -8, -11, 3, 6, 7, 10 },
+        { -3, -5, -8, -11, 2, 4, 7, 10 },
+        { -2, -6, -8, -10, 1, 5, 7, 9 },
+        { -2, -5, -8, -10, 1, 4, 7, 9 },
+        { -2, -4, -8, -10, 1, 3, 7, 9 },
+        { -2, -5, -7, -10, 1, 4, 6, 9 },
+        { -3, -4, -7, -10, 2, 3, 6, 9 },
+        { -1, -2, -3, -10, 0, 1, 2, 9 },
+        { -4, -6, -8, -9, 3, 5, 7, 8 },
+        { -3, -5, -7, -9, 2, 4, 6, 8 },
+    };
+
+    /// Pixels of each half block, by flip bit then half. ETC numbers pixels
+    /// down the columns, pixel i is at x = i / 4, y = i % 4.
+    constexpr int SUBBLOCK_PIXELS[2][2][8] = {
+        { { 0, 1, 2, 3, 4, 5, 6, 7 }, { 8, 9, 10, 11, 12, 13, 14, 15 } },
+        { { 0, 1, 4, 5, 8, 9, 12, 13 }, { 2, 3, 6, 7, 10, 11, 14, 15 } },
+    };
+
+    /// Base colors tried around the average of a half block, each channel -1, 0 and +1
+    constexpr int NUM_BASE_CANDIDATES = 27;
+
+    /// A 4x4 block in ETC pixel order
+    struct Block
+    {
+        int rgba[16][4];
+    };
+
+    /// Table and selectors for half a block around one base color
+    struct SubblockFit
+    {
+        int error;
+        int table;
+        uint8_t selectors[8];
+    };
+
+    /// A quantized base color and how well it fits its half block
+    struct BaseCandidate
+    {
+        int color[3];
+        SubblockFit fit;
+    };
+
+    int clampByte(int value)
+    {
+        return std::min(std::max(value, 0), 255);
+    }
+
+    int expandBits(int value, int bits)
+    {
+        return (value << (8 - bits)) | (value >> (2 * bits - 8));
+    }
+
+    int quantize(float value, int bits)
+    {
+        int maxValue = (1 << bits) - 1;
+        return std::min(std::max(static_cast<int>(std::lround(value * maxValue / 255.0f)), 0), maxValue);
+    }
+
+    int colorError(const int* pixel, int r, int g, int b)
+    {
+        int dr = pixel[0] - r;
+        int dg = pixel[1] - g;
+        int db = pixel[2] - b;
+        return dr * dr + dg * dg + db * db;
+    }
+
+    int signExtend3(uint32_t value)
+    {
+        return (value & 4) ? static_cast<int>(value) - 8 : static_cast<int>(value);
+    }
+
+    /// Best table and selectors for half a block around an expanded base color
+    SubblockFit fitSubblock(const Block& block, const int* pixels, int r, int g, int b)
+    {
+        SubblockFit best;
+        best.error = INT_MAX;
+        for (int table = 0; table < 8; ++table)
+        {
+            SubblockFit fit;
+            fit.error = 0;
+            fit.table = table;
+            for (int i = 0; i < 8 && fit.error < best.error; ++i)
+            {
+                const int* pixel = block.rgba[pixels[i]];
+                int bestPixelError = INT_MAX;
+                // Selector bit 0 picks the large modifier, bit 1 negates it
+                for (int selector = 0; selector < 4; ++selector)
+                {
+                    int modifier = MODIFIER_TABLE[table][selector & 1];
+                    if (selector & 2)
+                    {
+                        modifier = -modifier;
+                    }
+                    int error = colorError(pixel, clampByte(r + modifier), clampByte(g + modifier),
+                                           clampByte(b + modifier));
+                    if (error < bestPixelError)
+                    {
+                        bestPixelError = error;
+                        fit.selectors[i] = static_cast<uint8_t>(selector);
+                    }
+                }
+                fit.error += bestPixelError;
+            }
+            if (fit.error < best.error)
+            {
+                best = fit;
+            }
+        }
+        return best;
+    }
+
+    /// Fit the base colors with bits per channel around the average of half a block
+    void fitBaseCandidates(const Block& block, const int* pixels, int bits,
+                           BaseCandidate (&candidates)[NUM_BASE_CANDIDATES])
+    {
+        float average[3] = {};
+        for (int i = 0; i < 8; ++i)
+        {
+            for (int channel = 0; channel < 3; ++channel)
+            {
+                average[channel] += block.rgba[pixels[i]][channel] / 8.0f;
+            }
+        }
+
+        int maxValue = (1 << bits) - 1;
+        int center[3] = { quantize(average[0], bits), quantize(average[1], bits), quantize(average[2], bits) };
+        for (int i = 0; i < NUM_BASE_CANDIDATES; ++i)
+        {
+            BaseCandidate& candidate = candidates[i];
+            candidate.color[0] = std::min(std::max(center[0] + i % 3 - 1, 0), maxValue);
+            candidate.color[1] = std::min(std::max(center[1] + i / 3 % 3 - 1, 0), maxValue);
+            candidate.color[2] = std::min(std::max(center[2] + i / 9 - 1, 0), maxValue);
+            candidate.fit = fitSubblock(block, pixels,
+                                        expandBits(candidate.color[0], bits),
+                                        expandBits(candidate.color[1], bits),
+                                        expandBits(candidate.color[2], bits));
+        }
+    }
+
+    uint32_t packSelectors(int flip, const SubblockFit& first, const SubblockFit& second)
+    {
+        uint32_t selectorBits = 0;
+        const SubblockFit* fits[2] = { &first, &second };
+        for (int half = 0; half < 2; ++half)
+        {
+            for (int i = 0; i < 8; ++i)
+            {
+                int pixel = SUBBLOCK_PIXELS[flip][half][i];
+                uint32_t selector = fits[half]->selectors[i];
+                selectorBits |= (selector >> 1) << (16 + pixel);
+                selectorBits |= (selector & 1) << pixel;
+            }
+        }
+        return selectorBits;
+    }
+
+    /// Best individual or differential mode encoding of a block
+    uint64_t encodeEtc1Modes(const Block& block, int& bestError)
+    {
+        uint64_t bestBits = 0;
+        bestError = INT_MAX;
+
+        for (int flip = 0; flip < 2; ++flip)
+        {
+            BaseCandidate individual[2][NUM_BASE_CANDIDATES];
+            BaseCandidate differential[2][NUM_BASE_CANDIDATES];
+            for (int half = 0; half < 2; ++half)
+            {
+                fitBaseCandidates(block, SUBBLOCK_PIXELS[flip][half], 4, individual[half]);
+                fitBaseCandidates(block, SUBBLOCK_PIXELS[flip][half], 5, differential[half]);
+            }
+
+            // Individual mode, each half has its own 4-bit base color
+            const BaseCandidate* bestHalves[2];
+            for (int half = 0; half < 2; ++half)
+            {
+                bestHalves[half] = &individual[half][0];
+                for (const BaseCandidate& candidate : individual[half])
+                {
+                    if (candidate.fit.error < bestHalves[half]->fit.error)
+                    {
+                        bestHalves[half] = &candidate;
+                    }
+                }
+            }
+            int error = bestHalves[0]->fit.error + bestHalves[1]->fit.error;
+            if (error < bestError)
+            {
+                const BaseCandidate& first = *bestHalves[0];
+                const BaseCandidate& second = *bestHalves[1];
+                uint32_t high = (first.color[0] << 28) | (second.color[0] << 24) |
+                                (first.color[1] << 20) | (second.color[1] << 16) |
+                                (first.color[2] << 12) | (second.color[2] << 8) |
+                                (first.fit.table << 5) | (second.fit.table << 2) | flip;
+                bestBits = (static_cast<uint64_t>(high) << 32) | packSelectors(flip, first.fit, second.fit);
+                bestError = error;
+            }
+
+            // Differential mode, the second 5-bit base color is within -4 to 3 of the first
+            for (const BaseCandidate& first : differential[0])
+            {
+                for (const BaseCandidate& second : differential[1])
+                {
+                    int delta[3];
+                    bool inRange = true;
+                    for (int channel = 0; channel < 3; ++channel)
+                    {
+                        delta[channel] = second.color[channel] - first.color[channel];
+                        inRange = inRange && delta[channel] >= -4 && delta[channel] <= 3;
+                    }
+                    error = first.fit.error + second.fit.error;
+                    if (!inRange || error >= bestError)
+                    {
+                        continue;
+                    }
+
+                    uint32_t high = (first.color[0] << 27) | ((delta[0] & 7) << 24) |
+                                    (first.color[1] << 19) | ((delta[1] & 7) << 16) |
+                                    (first.color[2] << 11) | ((delta[2] & 7) << 8) |
+                                    (first.fit.table << 5) | (second.fit.table << 2) | (1 << 1) | flip;
+                    bestBits = (static_cast<uint64_t>(high) << 32) | packSelectors(flip, first.fit, second.fit);
+                    bestError = error;
+                }
+            }
+        }
+        return bestBits;
+    }
+
+    /// Error of one channel of a planar block, with the colors already expanded to 8 bits
+    int planarChannelError(const Block& block, int channel, int origin, int horizontal, int vertical)
+    {
+        int error = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            int x = i / 4;
+            int y = i % 4;
+            int value = clampByte((x * (horizontal - origin) + y * (vertical - origin) + 4 * origin + 2) >> 2);
+            int difference = value - block.rgba[i][channel];
+            error += difference * difference;
+        }
+        return error;
+    }
+
+    /// Planar mode encoding, a color gradient set by the colors at the origin,
+    /// 4 pixels to the right and 4 pixels down
+    uint64_t encodePlanar(const Block& block, int& error)
+    {
+        constexpr int CHANNEL_BITS[3] = { 6, 7, 6 };
+        int origin[3], horizontal[3], vertical[3];
+        error = 0;
+
+        for (int channel = 0; channel < 3; ++channel)
+        {
+            // Least squares plane through the block, x and y each average 1.5
+            float mean = 0.0f, slopeX = 0.0f, slopeY = 0.0f;
+            for (int i = 0; i < 16; ++i)
+            {
+                float value = static_cast<float>(block.rgba[i][channel]);
+                mean += value / 16.0f;
+                slopeX += (i / 4 - 1.5f) * value / 20.0f;
+                slopeY += (i % 4 - 1.5f) * value / 20.0f;
+            }
+            float originValue = mean - 1.5f * (slopeX + slopeY);
+
+            int bits = CHANNEL_BITS[channel];
+            int maxValue = (1 << bits) - 1;
+            int center[3] = { quantize(originValue, bits), quantize(originValue + 4.0f * slopeX, bits),
+                              quantize(originValue + 4.0f * slopeY, bits) };
+
+            // The rounded colors aren't always the best fit once clamped, try their neighbours
+            int bestChannelError = INT_MAX;
+            for (int i = 0; i < 27; ++i)
+            {
+                int o = std::min(std::max(center[0] + i % 3 - 1, 0), maxValue);
+                int h = std::min(std::max(center[1] + i / 3 % 3 - 1, 0), maxValue);
+                int v = std::min(std::max(center[2] + i / 9 - 1, 0), maxValue);
+                int channelError = planarChannelError(block, channel, expandBits(o, bits), expandBits(h, bits),
+                                                      expandBits(v, bits));
+                if (channelError < bestChannelError)
+                {
+                    bestChannelError = channelError;
+                    origin[channel] = o;
+                    horizontal[channel] = h;
+                    vertical[channel] = v;
+                }
+            }
+            error += bestChannelError;
+        }
+
+        uint32_t high = (origin[0] << 25) | ((origin[1] >> 6) << 24) | ((origin[1] & 63) << 17) |
+                        ((origin[2] >> 5) << 16) | (((origin[2] >> 3) & 3) << 11) | ((origin[2] & 7) << 7) |
+                        ((horizontal[0] >> 1) << 2) | (1 << 1) | (horizontal[0] & 1);
+        uint32_t low = (horizontal[1] << 25) | (horizontal[2] << 19) |
+                       (vertical[0] << 13) | (vertical[1] << 6) | vertical[2];
+
+        // Decoders pick planar mode when red and green are valid differential
+        // colors and blue overflows, set the unused bits to make that so
+        constexpr uint32_t FREE_BITS[6] = { 1u << 31, 1u << 23, 1u << 15, 1u << 14, 1u << 13, 1u << 10 };
+        for (uint32_t combination = 0; combination < 64; ++combination)
+        {
+            uint32_t candidate = high;
+            for (int bit = 0; bit < 6; ++bit)
+            {
+                if (combination & (1u << bit))
+                {
+                    candidate |= FREE_BITS[bit];
+                }
+            }
+
+            int red = static_cast<int>((candidate >> 27) & 31) + signExtend3((candidate >> 24) & 7);
+            int green = static_cast<int>((candidate >> 19) & 31) + signExtend3((candidate >> 16) & 7);
+            int blue = static_cast<int>((candidate >> 11) & 31) + signExtend3((candidate >> 8) & 7);
+            if (red >= 0 && red <= 31 && green >= 0 && green <= 31 && (blue < 0 || blue > 31))
+            {
+                return (static_cast<uint64_t>(candidate) << 32) | low;
+            }
+        }
+
+        // Not reachable, one setting of the blue bits always overflows
+        error = INT_MAX;
+        return 0;
+    }
+
+    uint64_t encodeColorBlock(const Block& block)
+    {
+        int etc1Error;
+        uint64_t etc1Bits = encodeEtc1Modes(block, etc1Error);
+        int planarError;
+        uint64_t planarBits = encodePlanar(block, planarError);
+        return planarError < etc1Error ? planarBits : etc1Bits;
+    }
+
+    uint64_t encodeAlphaBlock(const Block& block)
+    {
+        int minAlpha = 255, maxAlpha = 0;
+        for (const auto& pixel : block.rgba)
+        {
+            minAlpha = std::min(minAlpha, pixel[3]);
+            maxAlpha = std::max(maxAlpha, pixel[3]);
+        }
+
+        uint64_t bestBits = 0;
+        int bestError = INT_MAX;
+        for (int table = 0; table < 16 && bestError > 0; ++table)
+        {
+            for (int multiplier = 1; multiplier < 16 && bestError > 0; ++multiplier)
+            {
+                // Center the table's range on the block's
+                int tableCenter = (EAC_TABLE[table][3] + EAC_TABLE[table][7]) * multiplier;
+                int centerBase = clampByte((minAlpha + maxAlpha - tableCenter + 1) / 2);
+                for (int base = std::max(centerBase - 1, 0); base <= std::min(centerBase + 1, 255); ++base)
+                {
+                    uint64_t indexBits = 0;
+                    int error = 0;
+                    for (int i = 0; i < 16 && error < bestError; ++i)
+                    {
+                        int bestPixelError = INT_MAX;
+                        int bestIndex = 0;
+                        for (int index = 0; index < 8; ++index)
+                        {
+                            int difference = clampByte(base + EAC_TABLE[table][index] * multiplier) - block.rgba[i][3];
+                            if (difference * difference < bestPixelError)
+                            {
+                                bestPixelError = difference * difference;
+                                bestIndex = index;
+                            }
+                        }
+                        error += bestPixelError;
+                        indexBits |= static_cast<uint64_t>(bestIndex) << (45 - 3 * i);
+                    }
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        bestBits = (static_cast<uint64_t>(base) << 56) | (static_cast<uint64_t>(multiplier) << 52) |
+                                   (static_cast<uint64_t>(table) << 48) | indexBits;
+                    }
+                }
+            }
+        }
+        return bestBits;
+    }
+
+    void writeBigEndian(uint64_t bits, unsigned char* out)
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            out[i] = static_cast<unsigned char>(bits >> (56 - 8 * i));
+        }
+    }
+}
+
+
+std::vector<unsigned char> Etc2Encoder::encode(const unsigned char* rgba, uint32_t width, uint32_t height,
+                                               bool withAlpha, unsigned int numThreads)
+{
+    uint32_t blocksWide = (width + 3) / 4;
+    uint32_t blocksHigh = (height + 3) / 4;
+    size_t blockBytes = withAlpha ? 16 : 8;
+    std::vector<unsigned char> output(blocksWide * blocksHigh * blockBytes);
+
+    // Threads take a row of blocks at a time
+    std::atomic<uint32_t> nextRow(0);
+    auto encodeRows = [&]()
+    {
+        for (uint32_t blockY = nextRow++; blockY < blocksHigh; blockY = nextRow++)
+        {
+            for (uint32_t blockX = 0; blockX < blocksWide; ++blockX)
+            {
+                Block block;
+                for (int i = 0; i < 16; ++i)
+                {
+                    uint32_t x = std::min(blockX * 4 + i / 4, width - 1);
+                    uint32_t y = std::min(blockY * 4 + i % 4, height - 1);
+                    const unsigned char* pixel = rgba + (static_cast<size_t>(y) * width + x) * 4;
+                    for (int channel = 0; channel < 4; ++channel)
+                    {
+                        block.rgba[i][channel] = pixel[channel];
+                    }
+                }
+
+                unsigned char* out = output.data() + (static_cast<size_t>(blockY) * blocksWide + blockX) * blockBytes;
+                if (withAlpha)
+                {
+                    writeBigEndian(encodeAlphaBlock(block), out);
+                    out += 8;
+                }
+                writeBigEndian(encodeColorBlock(block), out);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int i = 1; i < numThreads; ++i)
+    {
+        threads.emplace_back(encodeRows);
+    }
+    encodeRows();
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+    return output;
+}
@@ -0,0 +1,34 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+#ifndef __ETC2ENCODER_H__
+#define __ETC2ENCODER_H__
+
+#include <cstdint>
+#include <vector>
+
+
+/// Compresses RGBA8 images to ETC2 for the sample's textures.
+/**
+ * Each block is tried in the ETC1 individual and differential modes, both
+ * flipped and not, and in the ETC2 planar mode, and the one closest to the
+ * source is kept. The T and H modes aren't used, they only help blocks with
+ * a few unrelated colors, which the sample textures have little of.
+ *
+ * Alpha is encoded with EAC, searching every table and multiplier.
+ */
+class Etc2Encoder
+{
+public:
+    /// Encode tightly packed RGBA8 rows into ETC2 RGB8 blocks, or ETC2 RGBA8
+    /// blocks with EAC alpha if withAlpha is set. Edge blocks are padded by
+    /// repeating the last row and column. Blocks are encoded on numThreads threads.
+    static std::vector<unsigned char> encode(const unsigned char* rgba, uint32_t width, uint32_t height,
+                                             bool withAlpha, unsigned int numThreads);
+};
+
+#endif // __ETC2ENCODER_H__
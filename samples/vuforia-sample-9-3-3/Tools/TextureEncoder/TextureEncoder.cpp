@@ -0,0 +1,471 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+// Offline encoder for the sample's textures.
+// Reads a PNG, builds the full mip chain and writes it as ETC2 or ASTC in a
+// KTX2 file the renderer can upload without decoding. See README.md.
+
+#include "Etc2Encoder.h"
+
+#include <Ktx2Format.h>
+
+#include <png.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace
+{
+    /// Tightly packed RGBA8 pixels, bottom row first
+    struct Image
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<unsigned char> rgba;
+    };
+
+    struct Options
+    {
+        uint32_t vkFormat = Ktx2Format::VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK;
+        bool astc = false;
+        std::string astcencPath = "astcenc";
+        std::string inputPath;
+        std::string outputPath;
+    };
+
+    void printUsage()
+    {
+        std::fprintf(stderr,
+            "Usage: TextureEncoder [--format etc2|astc4x4|astc6x6|astc8x8] [--astcenc <path>]\n"
+            "                      <input.png> <output.ktx2>\n"
+            "\n"
+            "Writes the image and its full mip chain to a KTX2 file, bottom row first.\n"
+            "etc2 (the default) is encoded here, using ETC2 RGBA8 with EAC alpha if the\n"
+            "image has any transparency. The astc formats run the astcenc tool from\n"
+            "https://github.com/ARM-software/astc-encoder on each level.\n");
+    }
+
+    bool parseOptions(int argc, char** argv, Options& options)
+    {
+        std::vector<std::string> paths;
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string argument = argv[i];
+            if (argument == "--format" && i + 1 < argc)
+            {
+                std::string format = argv[++i];
+                options.astc = format != "etc2";
+                if (format == "etc2")
+                {
+                    options.vkFormat = Ktx2Format::VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK;
+                }
+                else if (format == "astc4x4")
+                {
+                    options.vkFormat = Ktx2Format::VK_FORMAT_ASTC_4x4_UNORM_BLOCK;
+                }
+                else if (format == "astc6x6")
+                {
+                    options.vkFormat = Ktx2Format::VK_FORMAT_ASTC_6x6_UNORM_BLOCK;
+                }
+                else if (format == "astc8x8")
+                {
+                    options.vkFormat = Ktx2Format::VK_FORMAT_ASTC_8x8_UNORM_BLOCK;
+                }
+                else
+                {
+                    std::fprintf(stderr, "Error: Unknown format %s\n", format.c_str());
+                    return false;
+                }
+            }
+            else if (argument == "--astcenc" && i + 1 < argc)
+            {
+                options.astcencPath = argv[++i];
+            }
+            else if (argument.compare(0, 2, "--") == 0)
+            {
+                std::fprintf(stderr, "Error: Unknown option %s\n", argument.c_str());
+                return false;
+            }
+            else
+            {
+                paths.push_back(argument);
+            }
+        }
+
+        if (paths.size() != 2)
+        {
+            return false;
+        }
+        options.inputPath = paths[0];
+        options.outputPath = paths[1];
+        return true;
+    }
+
+    bool readPng(const std::string& path, Image& image)
+    {
+        png_image png;
+        std::memset(&png, 0, sizeof(png));
+        png.version = PNG_IMAGE_VERSION;
+        if (!png_image_begin_read_from_file(&png, path.c_str()))
+        {
+            std::fprintf(stderr, "Error: Unable to read %s: %s\n", path.c_str(), png.message);
+            return false;
+        }
+
+        png.format = PNG_FORMAT_RGBA;
+        image.width = png.width;
+        image.height = png.height;
+        image.rgba.resize(PNG_IMAGE_SIZE(png));
+
+        // A negative stride stores the rows bottom up, as the GL texture wants them
+        if (!png_image_finish_read(&png, nullptr, image.rgba.data(), -static_cast<png_int_32>(PNG_IMAGE_ROW_STRIDE(png)),
+                                   nullptr))
+        {
+            std::fprintf(stderr, "Error: Unable to decode %s: %s\n", path.c_str(), png.message);
+            png_image_free(&png);
+            return false;
+        }
+        return true;
+    }
+
+    bool writePng(const std::string& path, const Image& image)
+    {
+        png_image png;
+        std::memset(&png, 0, sizeof(png));
+        png.version = PNG_IMAGE_VERSION;
+        png.width = image.width;
+        png.height = image.height;
+        png.format = PNG_FORMAT_RGBA;
+
+        // Rows are written in memory order so the blocks come out in that order too
+        return png_image_write_to_file(&png, path.c_str(), 0, image.rgba.data(), 0, nullptr) != 0;
+    }
+
+    float srgbToLinear(float value)
+    {
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float linearToSrgb(float value)
+    {
+        return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    }
+
+    /// Half the size of an image, averaging in linear light so mips don't darken
+    Image downsample(const Image& image)
+    {
+        static float toLinear[256];
+        static bool tableBuilt = false;
+        if (!tableBuilt)
+        {
+            for (int i = 0; i < 256; ++i)
+            {
+                toLinear[i] = srgbToLinear(i / 255.0f);
+            }
+            tableBuilt = true;
+        }
+
+        Image half;
+        half.width = std::max(image.width / 2, 1u);
+        half.height = std::max(image.height / 2, 1u);
+        half.rgba.resize(static_cast<size_t>(half.width) * half.height * 4);
+
+        for (uint32_t y = 0; y < half.height; ++y)
+        {
+            for (uint32_t x = 0; x < half.width; ++x)
+            {
+                float sum[4] = {};
+                for (uint32_t i = 0; i < 4; ++i)
+                {
+                    // Odd sizes repeat the last row or column
+                    uint32_t sourceX = std::min(x * 2 + i % 2, image.width - 1);
+                    uint32_t sourceY = std::min(y * 2 + i / 2, image.height - 1);
+                    const unsigned char* pixel = &image.rgba[(static_cast<size_t>(sourceY) * image.width + sourceX) * 4];
+                    for (int channel = 0; channel < 3; ++channel)
+                    {
+                        sum[channel] += toLinear[pixel[channel]];
+                    }
+                    sum[3] += pixel[3] / 255.0f;
+                }
+
+                unsigned char* out = &half.rgba[(static_cast<size_t>(y) * half.width + x) * 4];
+                for (int channel = 0; channel < 3; ++channel)
+                {
+                    out[channel] = static_cast<unsigned char>(std::lround(linearToSrgb(sum[channel] / 4.0f) * 255.0f));
+                }
+                out[3] = static_cast<unsigned char>(std::lround(sum[3] / 4.0f * 255.0f));
+            }
+        }
+        return half;
+    }
+
+    /// Compress a level with astcenc, returning the blocks without the .astc header
+    bool encodeAstc(const Options& options, const Image& image, const Ktx2Format::BlockInfo& block,
+                    std::vector<unsigned char>& blocks)
+    {
+        std::string inputPath = options.outputPath + ".level.png";
+        std::string outputPath = options.outputPath + ".level.astc";
+        if (!writePng(inputPath, image))
+        {
+            std::fprintf(stderr, "Error: Unable to write %s\n", inputPath.c_str());
+            return false;
+        }
+
+        std::string command = "\"" + options.astcencPath + "\" -cl \"" + inputPath + "\" \"" + outputPath + "\" " +
+                              std::to_string(block.width) + "x" + std::to_string(block.height) + " -thorough -silent";
+        int result = std::system(command.c_str());
+        std::remove(inputPath.c_str());
+        if (result != 0)
+        {
+            std::fprintf(stderr, "Error: %s failed\n", command.c_str());
+            std::remove(outputPath.c_str());
+            return false;
+        }
+
+        std::FILE* file = std::fopen(outputPath.c_str(), "rb");
+        if (file == nullptr)
+        {
+            std::fprintf(stderr, "Error: Unable to read %s\n", outputPath.c_str());
+            return false;
+        }
+        std::fseek(file, 0, SEEK_END);
+        long fileSize = std::ftell(file);
+        std::fseek(file, 0, SEEK_SET);
+        std::vector<unsigned char> data(fileSize > 0 ? static_cast<size_t>(fileSize) : 0);
+        bool read = !data.empty() && std::fread(data.data(), 1, data.size(), file) == data.size();
+        std::fclose(file);
+        std::remove(outputPath.c_str());
+
+        // 16 byte header: magic, block size, then 24-bit little endian dimensions
+        constexpr size_t ASTC_HEADER_SIZE = 16;
+        uint64_t levelSize = Ktx2Format::getLevelSize(block, image.width, image.height);
+        if (!read || data.size() != ASTC_HEADER_SIZE + levelSize ||
+            data[0] != 0x13 || data[1] != 0xAB || data[2] != 0xA1 || data[3] != 0x5C)
+        {
+            std::fprintf(stderr, "Error: Unexpected astcenc output for a %ux%u level\n", image.width, image.height);
+            return false;
+        }
+        blocks.assign(data.begin() + ASTC_HEADER_SIZE, data.end());
+        return true;
+    }
+
+    template<typename T>
+    void append(std::vector<unsigned char>& bytes, T value)
+    {
+        const unsigned char* valueBytes = reinterpret_cast<const unsigned char*>(&value);
+        bytes.insert(bytes.end(), valueBytes, valueBytes + sizeof(value));
+    }
+
+    void pad(std::vector<unsigned char>& bytes, size_t alignment)
+    {
+        bytes.resize((bytes.size() + alignment - 1) / alignment * alignment, 0);
+    }
+
+    /// Basic data format descriptor for one of the formats getBlockInfo knows
+    std::vector<unsigned char> makeDataFormatDescriptor(uint32_t vkFormat)
+    {
+        struct Sample
+        {
+            uint16_t bitOffset;
+            uint8_t bitLength;
+            uint8_t channelType;
+        };
+        std::vector<Sample> samples;
+        uint8_t colorModel;
+        switch (vkFormat)
+        {
+            case Ktx2Format::VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+                colorModel = Ktx2Format::KHR_DF_MODEL_ETC2;
+                samples.push_back({ 0, 64, Ktx2Format::KHR_DF_CHANNEL_ETC2_COLOR });
+                break;
+            case Ktx2Format::VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+                colorModel = Ktx2Format::KHR_DF_MODEL_ETC2;
+                samples.push_back({ 0, 64, Ktx2Format::KHR_DF_CHANNEL_ETC2_ALPHA });
+                samples.push_back({ 64, 64, Ktx2Format::KHR_DF_CHANNEL_ETC2_COLOR });
+                break;
+            default:
+                colorModel = Ktx2Format::KHR_DF_MODEL_ASTC;
+                samples.push_back({ 0, 128, Ktx2Format::KHR_DF_CHANNEL_ASTC_DATA });
+                break;
+        }
+
+        Ktx2Format::BlockInfo block = Ktx2Format::getBlockInfo(vkFormat);
+        uint16_t blockSize = static_cast<uint16_t>(24 + 16 * samples.size());
+
+        std::vector<unsigned char> dfd;
+        append<uint32_t>(dfd, 4 + blockSize);
+        // Khronos vendor, basic descriptor type
+        append<uint32_t>(dfd, 0);
+        append<uint16_t>(dfd, Ktx2Format::KHR_DF_VERSION);
+        append<uint16_t>(dfd, blockSize);
+        append<uint8_t>(dfd, colorModel);
+        append<uint8_t>(dfd, Ktx2Format::KHR_DF_PRIMARIES_BT709);
+        append<uint8_t>(dfd, Ktx2Format::KHR_DF_TRANSFER_LINEAR);
+        append<uint8_t>(dfd, 0);
+        append<uint8_t>(dfd, static_cast<uint8_t>(block.width - 1));
+        append<uint8_t>(dfd, static_cast<uint8_t>(block.height - 1));
+        append<uint16_t>(dfd, 0);
+        append<uint8_t>(dfd, static_cast<uint8_t>(block.bytes));
+        dfd.resize(dfd.size() + 7, 0);
+        for (const Sample& sample : samples)
+        {
+            append<uint16_t>(dfd, sample.bitOffset);
+            append<uint8_t>(dfd, sample.bitLength - 1);
+            append<uint8_t>(dfd, sample.channelType);
+            append<uint32_t>(dfd, 0);
+            append<uint32_t>(dfd, 0);
+            append<uint32_t>(dfd, 0xFFFFFFFF);
+        }
+        return dfd;
+    }
+
+    void appendKeyValue(std::vector<unsigned char>& kvd, const char* key, const char* value)
+    {
+        size_t keyLength = std::strlen(key) + 1;
+        size_t valueLength = std::strlen(value) + 1;
+        append<uint32_t>(kvd, static_cast<uint32_t>(keyLength + valueLength));
+        kvd.insert(kvd.end(), key, key + keyLength);
+        kvd.insert(kvd.end(), value, value + valueLength);
+        pad(kvd, 4);
+    }
+
+    bool writeKtx2(const std::string& path, uint32_t vkFormat, uint32_t width, uint32_t height,
+                   const std::vector<std::vector<unsigned char>>& levels)
+    {
+        std::vector<unsigned char> dfd = makeDataFormatDescriptor(vkFormat);
+        std::vector<unsigned char> kvd;
+        appendKeyValue(kvd, "KTXorientation", "ru");
+        appendKeyValue(kvd, "KTXwriter", "Vuforia sample TextureEncoder");
+
+        Ktx2Format::Header header = {};
+        std::memcpy(header.identifier, Ktx2Format::IDENTIFIER, sizeof(Ktx2Format::IDENTIFIER));
+        header.vkFormat = vkFormat;
+        header.typeSize = 1;
+        header.pixelWidth = width;
+        header.pixelHeight = height;
+        header.faceCount = 1;
+        header.levelCount = static_cast<uint32_t>(levels.size());
+        header.dfdByteOffset = static_cast<uint32_t>(sizeof(header) + levels.size() * sizeof(Ktx2Format::LevelIndex));
+        header.dfdByteLength = static_cast<uint32_t>(dfd.size());
+        header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+        header.kvdByteLength = static_cast<uint32_t>(kvd.size());
+
+        // Level data follows, smallest first, each aligned to the block size
+        size_t blockBytes = Ktx2Format::getBlockInfo(vkFormat).bytes;
+        std::vector<Ktx2Format::LevelIndex> levelIndex(levels.size());
+        std::vector<unsigned char> levelData;
+        size_t dataOffset = header.kvdByteOffset + header.kvdByteLength;
+        for (size_t level = levels.size(); level-- > 0;)
+        {
+            size_t padding = (blockBytes - (dataOffset + levelData.size()) % blockBytes) % blockBytes;
+            levelData.resize(levelData.size() + padding, 0);
+            levelIndex[level].byteOffset = dataOffset + levelData.size();
+            levelIndex[level].byteLength = levels[level].size();
+            levelIndex[level].uncompressedByteLength = levels[level].size();
+            levelData.insert(levelData.end(), levels[level].begin(), levels[level].end());
+        }
+
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr)
+        {
+            std::fprintf(stderr, "Error: Unable to create %s\n", path.c_str());
+            return false;
+        }
+        bool written = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                       std::fwrite(levelIndex.data(), sizeof(Ktx2Format::LevelIndex), levelIndex.size(), file) == levelIndex.size() &&
+                       std::fwrite(dfd.data(), 1, dfd.size(), file) == dfd.size() &&
+                       std::fwrite(kvd.data(), 1, kvd.size(), file) == kvd.size() &&
+                       std::fwrite(levelData.data(), 1, levelData.size(), file) == levelData.size();
+        written = std::fclose(file) == 0 && written;
+        if (!written)
+        {
+            std::fprintf(stderr, "Error: Unable to write %s\n", path.c_str());
+        }
+        return written;
+    }
+}
+
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    Image image;
+    if (!readPng(options.inputPath, image))
+    {
+        return 1;
+    }
+
+    bool hasAlpha = false;
+    for (size_t i = 3; i < image.rgba.size() && !hasAlpha; i += 4)
+    {
+        hasAlpha = image.rgba[i] != 255;
+    }
+    uint32_t vkFormat = options.vkFormat;
+    if (!options.astc && hasAlpha)
+    {
+        vkFormat = Ktx2Format::VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK;
+    }
+    Ktx2Format::BlockInfo block = Ktx2Format::getBlockInfo(vkFormat);
+
+    unsigned int numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<std::vector<unsigned char>> levels;
+    uint32_t width = image.width;
+    uint32_t height = image.height;
+    while (true)
+    {
+        std::vector<unsigned char> blocks;
+        if (options.astc)
+        {
+            if (!encodeAstc(options, image, block, blocks))
+            {
+                return 1;
+            }
+        }
+        else
+        {
+            blocks = Etc2Encoder::encode(image.rgba.data(), image.width, image.height, hasAlpha, numThreads);
+        }
+        levels.push_back(std::move(blocks));
+
+        if (image.width == 1 && image.height == 1)
+        {
+            break;
+        }
+        image = downsample(image);
+    }
+
+    if (!writeKtx2(options.outputPath, vkFormat, width, height, levels))
+    {
+        return 1;
+    }
+
+    size_t totalBytes = 0;
+    for (const auto& level : levels)
+    {
+        totalBytes += level.size();
+    }
+    std::printf("%s: %ux%u, %zu levels, %zu bytes in %.1f s\n", options.outputPath.c_str(), width, height,
+                levels.size(), totalBytes,
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count());
+    return 0;
+}
@@ -0,0 +1,250 @@
+/*===============================================================================
+Copyright (c) 2020, PTC Inc. All rights reserved.
+
+Vuforia is a trademark of PTC Inc., registered in the United States and other
+countries.
+===============================================================================*/
+
+// Desktop simulation of VideoModeSelector, which AppController calibrates the
+// camera video mode with. Drives it as AppController does, switching modes when
+// asked, with the tracking period and render time of each frame from a cost
+// model of a device. Frames just after a switch still come from the previous
+// mode, then arrive slowly while the camera restarts. Checks that the selector
+// switches through every mode, that the frames around a switch don't sway the
+// choice, and that the same mode is chosen across runs. Also checks that a
+// saved selection reloads exactly, as AppController matches it against the
+// camera's modes. See README.md.
+
+#include <VideoModeSelector.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+
+namespace
+{
+    /// Frames after a switch still delivered in the previous mode
+    constexpr int SWITCH_LATENCY_FRAMES = 2;
+    /// Frames after those that arrive slowly while the camera restarts
+    constexpr int RESTART_FRAMES = 6;
+    /// How much slower they arrive
+    constexpr double RESTART_SLOWDOWN = 3.0;
+    /// Camera frame intervals vary by up to this fraction either way
+    constexpr double FRAME_JITTER = 0.05;
+    /// Seeded runs of each device, every one has to choose the same mode
+    constexpr int NUM_RUNS = 8;
+    /// As AppController calibrates with
+    constexpr double FRAME_BUDGET_MS = 1000.0 / 30.0;
+
+    /// Per frame costs of a device
+    struct CostModel
+    {
+        /// Tracking a frame, a fixed part and a part per megapixel of the mode
+        double trackingMs;
+        double trackingMsPerMegapixel;
+        /// Rendering a frame, a fixed part and the video background's part per megapixel
+        double renderMs;
+        double renderMsPerMegapixel;
+        /// Each frame's costs vary by up to this fraction either way
+        double noise;
+    };
+
+    struct Device
+    {
+        const char* name;
+        CostModel cost;
+        /// Index of the mode the selector should choose
+        int expectedMode;
+    };
+
+    /// Outcome of one calibration
+    struct Result
+    {
+        int selectedMode = VideoModeSelector::NO_MODE;
+        /// Modes the selector asked for, in order, starting with the one startCalibration returned
+        std::vector<int> switches;
+        /// Frames reported between consecutive switches
+        std::vector<int> framesPerSwitch;
+    };
+
+    const VideoModeSelector::Mode* findMode(const std::vector<VideoModeSelector::Mode>& modes, int index)
+    {
+        for (const auto& mode : modes)
+        {
+            if (mode.index == index)
+            {
+                return &mode;
+            }
+        }
+        return nullptr;
+    }
+
+    Result calibrate(const std::vector<VideoModeSelector::Mode>& modes, const CostModel& cost,
+                     int warmupFrames, unsigned seed)
+    {
+        VideoModeSelector selector(modes, FRAME_BUDGET_MS, warmupFrames);
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<double> noise(-1.0, 1.0);
+
+        Result result;
+        int currentMode = selector.startCalibration();
+        int previousMode = currentMode;
+        int framesSinceSwitch = 0;
+        result.switches.push_back(currentMode);
+
+        // Well beyond the frames calibration needs, so a selector that never finishes fails rather than hangs
+        const int maxFrames = 1000 * static_cast<int>(modes.size());
+        for (int frame = 0; frame < maxFrames && selector.isCalibrating(); ++frame)
+        {
+            const VideoModeSelector::Mode& mode = *findMode(modes, framesSinceSwitch < SWITCH_LATENCY_FRAMES ?
+                                                                   previousMode : currentMode);
+            double megapixels = mode.width * mode.height / 1.0e6;
+            double trackingMs = (cost.trackingMs + cost.trackingMsPerMegapixel * megapixels) *
+                                (1.0 + cost.noise * noise(random));
+            double renderMs = (cost.renderMs + cost.renderMsPerMegapixel * megapixels) *
+                              (1.0 + cost.noise * noise(random));
+
+            // Frames that arrive while the tracker is busy are dropped, so the tracker
+            // gets every first, second, third... frame the camera delivers
+            double frameIntervalMs = 1000.0 / mode.framerate;
+            double trackingPeriodMs = frameIntervalMs * std::max(1.0, std::ceil(trackingMs / frameIntervalMs)) *
+                                      (1.0 + FRAME_JITTER * noise(random));
+            if (framesSinceSwitch >= SWITCH_LATENCY_FRAMES &&
+                framesSinceSwitch < SWITCH_LATENCY_FRAMES + RESTART_FRAMES)
+            {
+                trackingPeriodMs *= RESTART_SLOWDOWN;
+            }
+
+            ++framesSinceSwitch;
+            int nextMode = selector.addSample(trackingPeriodMs, renderMs);
+            if (nextMode != VideoModeSelector::NO_MODE)
+            {
+                result.switches.push_back(nextMode);
+                result.framesPerSwitch.push_back(framesSinceSwitch);
+                previousMode = currentMode;
+                currentMode = nextMode;
+                framesSinceSwitch = 0;
+            }
+        }
+
+        result.selectedMode = selector.getSelectedMode();
+        return result;
+    }
+
+    /// The selector asked for every mode in turn, each after the same number of frames, then the selected one
+    bool switchedAsExpected(const std::vector<VideoModeSelector::Mode>& modes, const Result& result,
+                            int framesPerMode)
+    {
+        if (result.switches.size() != modes.size() + 1)
+        {
+            return false;
+        }
+        for (size_t i = 0; i < modes.size(); ++i)
+        {
+            if (result.switches[i] != modes[i].index)
+            {
+                return false;
+            }
+        }
+        return result.switches.back() == result.selectedMode &&
+               std::all_of(result.framesPerSwitch.begin(), result.framesPerSwitch.end(),
+                           [framesPerMode](int frames) { return frames == framesPerMode; });
+    }
+
+    /// A saved mode loads back with the same frame rate, to the last bit
+    bool savedSelectionReloads()
+    {
+        const char* path = "VideoModeSelectorSimulation.txt";
+        // NTSC frame rates don't survive being printed with the default 6 digits
+        const VideoModeSelector::Mode saved = { 4, 1920, 1080, 30000.0f / 1001.0f };
+        VideoModeSelector::Mode loaded = { VideoModeSelector::NO_MODE, 0, 0, 0.0f };
+        bool reloaded = VideoModeSelector::saveSelection(path, "Simulated device", saved) &&
+                        VideoModeSelector::loadSelection(path, "Simulated device", loaded) &&
+                        loaded.index == saved.index && loaded.width == saved.width &&
+                        loaded.height == saved.height && loaded.framerate == saved.framerate;
+        std::remove(path);
+        return reloaded;
+    }
+
+    void printMode(const std::vector<VideoModeSelector::Mode>& modes, int index)
+    {
+        const VideoModeSelector::Mode* mode = findMode(modes, index);
+        if (mode != nullptr)
+        {
+            std::printf("%dx%d@%.0f", mode->width, mode->height, mode->framerate);
+        }
+        else
+        {
+            std::printf("none");
+        }
+    }
+}
+
+
+int main(int argc, char** /* argv */)
+{
+    if (argc > 1)
+    {
+        std::fprintf(stderr, "Usage: VideoModeSelectorSimulation\n");
+        return 1;
+    }
+
+    // In the order a typical device lists them, AppController tries them in this order
+    const std::vector<VideoModeSelector::Mode> modes = {
+        { 0, 640, 480, 30.0f },
+        { 1, 1280, 720, 30.0f },
+        { 2, 1920, 1080, 30.0f },
+        { 3, 1280, 720, 60.0f },
+    };
+    const Device devices[] = {
+        // Everything fits, the highest resolution wins
+        { "Fast", { 2.0, 8.0, 6.0, 2.0, 0.1 }, 2 },
+        // 1080p tracks at 15 fps, 720p fits and the 60 fps mode breaks the tie
+        { "Mid-range", { 4.0, 18.0, 8.0, 3.0, 0.1 }, 3 },
+        // Tracks fast enough but renders 1080p's video background too slowly
+        { "Slow GPU", { 2.0, 8.0, 20.0, 10.0, 0.1 }, 3 },
+        // Nothing fits, the cheapest mode wins
+        { "Slow", { 20.0, 60.0, 12.0, 4.0, 0.1 }, 0 },
+        // 720p with its costs varying a lot from frame to frame
+        { "Noisy", { 4.0, 18.0, 8.0, 3.0, 0.3 }, 3 },
+    };
+
+    // VideoModeSelector's defaults, which AppController uses
+    const int warmupFrames = 10;
+    const int sampleFrames = 30;
+
+    std::printf("Budget %.1f ms, %d warmup and %d sample frames per mode, %d runs per device\n",
+                FRAME_BUDGET_MS, warmupFrames, sampleFrames, NUM_RUNS);
+    bool passed = true;
+    for (const Device& device : devices)
+    {
+        std::printf("%s:\n", device.name);
+
+        bool switched = true;
+        int numExpected = 0;
+        for (int run = 0; run < NUM_RUNS; ++run)
+        {
+            Result result = calibrate(modes, device.cost, warmupFrames, run + 1);
+            switched = switched && switchedAsExpected(modes, result, warmupFrames + sampleFrames);
+            numExpected += result.selectedMode == device.expectedMode ? 1 : 0;
+        }
+        Result withoutWarmup = calibrate(modes, device.cost, 0, 1);
+
+        bool met = switched && numExpected == NUM_RUNS;
+        passed = passed && met;
+
+        std::printf("  chose the expected ");
+        printMode(modes, device.expectedMode);
+        std::printf(" in %d of %d runs, %s switching, ", numExpected, NUM_RUNS, switched ? "expected" : "UNEXPECTED");
+        printMode(modes, withoutWarmup.selectedMode);
+        std::printf(" without warmup, %s\n", met ? "ok" : "FAILED");
+    }
+
+    bool reloaded = savedSelectionReloads();
+    passed = passed && reloaded;
+    std::printf("Saved selection reloads exactly, %s\n", reloaded ? "ok" : "FAILED");
+    return passed ? 0 : 1;
+}